@@ -0,0 +1,179 @@
+#if ! defined NSM66_NSM_CLIENTREGISTRY_HPP
+#define NSM66_NSM_CLIENTREGISTRY_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          clientregistry.hpp
+ *
+ *    This module provides the registry of clients known to an
+ *    nsmcontroller.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The clients are stored by value in one vector, so that walking them is
+ *  cache-friendly. Each client gets a small-integer handle that does not
+ *  change while the client is registered, even as other clients come and
+ *  go. Hashed indices map the client ID and the client name to the handle,
+ *  so the status updates from /nsm/gui/client/... are O(1).
+ *
+ *  Pointers to the clients are NOT stable; adding or removing a client
+ *  can move the others. Keep the handle, not the pointer.
+ */
+
+#include <string>                       /* std::string class                */
+#include <unordered_map>                /* std::unordered_map<>             */
+#include <vector>                       /* std::vector<> container          */
+
+#include "nsm/nsmctlclient.hpp"         /* nsm::nsmctlclient class          */
+
+namespace nsm
+{
+
+/**
+ *  A dense store of nsmctlclient objects, with lookup by handle, by
+ *  client ID, and by client name.
+ */
+
+class clientregistry
+{
+
+public:
+
+    using handle = int;
+
+    static const handle c_no_handle = (-1);
+
+    using container = std::vector<nsmctlclient>;
+
+private:
+
+    using index = std::unordered_map<std::string, handle>;
+
+    /**
+     *  The clients, packed. Removal moves the last client into the hole.
+     */
+
+    container m_clients;
+
+    /**
+     *  For each slot in m_clients, its handle.
+     */
+
+    std::vector<handle> m_handles;
+
+    /**
+     *  For each handle, the slot in m_clients, or -1 if the handle is free.
+     */
+
+    std::vector<int> m_slots;
+
+    /**
+     *  Handles freed by remove(), reused by add(). Keeping the handles
+     *  small keeps m_slots small.
+     */
+
+    std::vector<handle> m_free_handles;
+
+    /**
+     *  The indices. Client IDs are unique. Client names need not be (two
+     *  instances of one program); the name index holds the first client
+     *  registered with the name.
+     */
+
+    index m_by_id;
+    index m_by_name;
+
+public:
+
+    clientregistry ();
+
+    handle add (nsmctlclient && c);
+    bool remove (handle h);
+    void clear ();
+
+    handle find_id (const std::string & id) const;
+    handle find_name (const std::string & name) const;
+    nsmctlclient * get (handle h);
+    const nsmctlclient * get (handle h) const;
+
+    nsmctlclient * by_id (const std::string & id)
+    {
+        return get(find_id(id));
+    }
+
+    nsmctlclient * by_name (const std::string & name)
+    {
+        return get(find_name(name));
+    }
+
+    bool client_id (handle h, const std::string & id);
+    bool client_name (handle h, const std::string & name);
+
+    std::size_t size () const
+    {
+        return m_clients.size();
+    }
+
+    bool empty () const
+    {
+        return m_clients.empty();
+    }
+
+    container::iterator begin ()
+    {
+        return m_clients.begin();
+    }
+
+    container::iterator end ()
+    {
+        return m_clients.end();
+    }
+
+    container::const_iterator begin () const
+    {
+        return m_clients.cbegin();
+    }
+
+    container::const_iterator end () const
+    {
+        return m_clients.cend();
+    }
+
+private:
+
+    int slot (handle h) const;
+    void reindex_name (const std::string & name);
+
+};          // class clientregistry
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_CLIENTREGISTRY_HPP
+
+/*
+ * clientregistry.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,166 @@
+#if ! defined NSM66_NSM_DAEMONREGISTRY_HPP
+#define NSM66_NSM_DAEMONREGISTRY_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          daemonregistry.hpp
+ *
+ *    This module keeps track of the running NSM daemons by way of their
+ *    files in the XDG runtime directory.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Each daemon has a file "/run/user/<uid>/nsm/d/<pid>". The first line is
+ *  the daemon's OSC URL, which is all that older daemons write. Daemons
+ *  registered through this class add their PID, their start time, and the
+ *  word "flock", meaning that the daemon holds an exclusive flock(2) on
+ *  the file while it runs:
+ *
+ *      osc.udp://mlsleno:16133/
+ *      37739
+ *      1760400000
+ *      flock
+ *
+ *  A daemon is alive if it holds that lock; for files without the lock
+ *  marker, if kill(pid, 0) finds the process. Files of dead daemons are
+ *  stale, and prune() deletes them.
+ *
+ *  The list is cached. On Linux an inotify watch on the directory tells
+ *  when to read it again; in between, only the cheap kill(pid, 0) check is
+ *  repeated, so a daemon that crashes drops out at once.
+ */
+
+#include <ctime>                        /* std::time_t                      */
+#include <string>                       /* std::string class                */
+#include <sys/types.h>                  /* pid_t                            */
+#include <vector>                       /* std::vector<> container          */
+
+namespace nsm
+{
+
+/**
+ *  What a daemon file says about its daemon.
+ */
+
+struct daemon_info
+{
+    std::string di_file;                /* full path of the daemon file     */
+    std::string di_url;                 /* OSC URL of the daemon            */
+    pid_t di_pid;                       /* from the file, else its name     */
+    std::time_t di_start_time;          /* 0 if not recorded                */
+    bool di_locked;                     /* daemon holds a flock on the file */
+};
+
+/**
+ *  Lists, checks, and prunes the daemon files, and registers this process
+ *  as a daemon.
+ */
+
+class daemonregistry
+{
+
+public:
+
+    using daemon_list = std::vector<daemon_info>;
+
+private:
+
+    std::string m_directory;
+
+    /**
+     *  The live daemons found by the last scan, and the stale files.
+     */
+
+    daemon_list m_daemons;
+    std::vector<std::string> m_stale_files;
+
+    /**
+     *  True if the directory must be read again. Always true if there is
+     *  no inotify watch.
+     */
+
+    bool m_dirty;
+    int m_inotify_fd;
+
+    /**
+     *  The daemon file of this process, if registered, and the open file
+     *  that holds the lock on it.
+     */
+
+    std::string m_own_file;
+    int m_own_fd;
+
+public:
+
+    daemonregistry (const std::string & directory = "");
+    daemonregistry (const daemonregistry &) = delete;
+    daemonregistry & operator = (const daemonregistry &) = delete;
+    ~daemonregistry ();
+
+    static std::string default_directory ();
+    static std::string pid_file_name (const std::string & directory = "");
+    static std::time_t start_time ();
+    static bool read_entry (const std::string & filename, daemon_info & info);
+    static bool alive (const daemon_info & info, bool checklock = true);
+
+    const daemon_list & daemons ();
+    bool refresh (bool force = false);
+    int prune ();
+    std::string newest_url ();
+
+    bool register_self (const std::string & url);
+    void unregister_self ();
+
+    const std::string & directory () const
+    {
+        return m_directory;
+    }
+
+    /**
+     *  The inotify descriptor, for an application's own event loop, or -1.
+     *  When it is readable, daemons() will read the directory again.
+     */
+
+    int watch_fd () const
+    {
+        return m_inotify_fd;
+    }
+
+private:
+
+    bool changed ();
+    void scan ();
+
+};          // class daemonregistry
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_DAEMONREGISTRY_HPP
+
+/*
+ * daemonregistry.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
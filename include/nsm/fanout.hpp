@@ -0,0 +1,173 @@
+#if ! defined NSM66_NSM_FANOUT_HPP
+#define NSM66_NSM_FANOUT_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          fanout.hpp
+ *
+ *    This module tracks a command sent to many clients at once, such as a
+ *    session-wide save.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The nsmcontroller sends the command to every selected client without
+ *  waiting, then feeds the status, progress, and visibility messages from
+ *  nsmd to the fanout, which matches them to the clients. Each client has
+ *  a deadline; a client that has not answered by then is expired. The
+ *  fanout keeps the latency of each client, so that the slow ones, which
+ *  set the time of the whole save, stand out.
+ *
+ *  nsmd answers a save with the client status "ready" (or "error"), a
+ *  stop with "stopped", a remove with "removed", and a resume with
+ *  "ready". Show and hide are answered by /nsm/gui/client/visible.
+ */
+
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <string>                       /* std::string class                */
+#include <vector>                       /* std::vector<> container          */
+
+#include "osc/messages.hpp"             /* osc::tag                         */
+
+namespace nsm
+{
+
+/**
+ *  The state of one command fanned out to a set of clients.
+ */
+
+class fanout
+{
+
+public:
+
+    using clock = std::chrono::steady_clock;
+
+    enum class state
+    {
+        pending,        /* sent, no answer yet                              */
+        done,           /* answered with success                            */
+        failed,         /* answered with an error                           */
+        expired         /* no answer before the deadline                    */
+    };
+
+    /**
+     *  One client of the fan-out.
+     */
+
+    struct entry
+    {
+        std::string fe_client_id;
+        std::string fe_client_name;
+        state fe_state;
+        float fe_progress;
+        clock::time_point fe_done_time;
+    };
+
+    using container = std::vector<entry>;
+
+private:
+
+    osc::tag m_command;
+    bool m_started;
+    clock::time_point m_start_time;
+    clock::time_point m_deadline;
+    container m_entries;
+
+public:
+
+    fanout ();
+
+    void start (osc::tag cmd, clock::time_point t, int timeoutms);
+    void add (const std::string & id, const std::string & name);
+    bool status
+    (
+        const std::string & id,
+        const std::string & s,
+        clock::time_point t
+    );
+    bool visible (const std::string & id, clock::time_point t);
+    bool progress (const std::string & id, float p);
+    bool client_switch (const std::string & id, const std::string & newid);
+    int expire (clock::time_point t);
+
+    float total_progress () const;
+    int count (state s) const;
+    long latency_us (const entry & e) const;
+    long elapsed_us () const;
+    const entry * slowest () const;
+    const entry * client (const std::string & id) const;
+    std::string report () const;
+
+    osc::tag command () const
+    {
+        return m_command;
+    }
+
+    bool started () const
+    {
+        return m_started;
+    }
+
+    bool active () const
+    {
+        return count(state::pending) > 0;
+    }
+
+    clock::time_point start_time () const
+    {
+        return m_start_time;
+    }
+
+    clock::time_point deadline () const
+    {
+        return m_deadline;
+    }
+
+    const container & entries () const
+    {
+        return m_entries;
+    }
+
+    static bool answers
+    (
+        osc::tag cmd, const std::string & s, bool & success
+    );
+
+private:
+
+    entry * find (const std::string & id);
+    bool finish (entry & e, state s, clock::time_point t);
+
+};          // class fanout
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_FANOUT_HPP
+
+/*
+ * fanout.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
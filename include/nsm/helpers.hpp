@@ -30,7 +30,7 @@
  * \library       helpers application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-01
- * \updates       2025-04-20
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -38,6 +38,8 @@
  *   numbers, various NSM files and directories, and parsing.
  */
 
+#include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view class           */
 #include <vector>                       /* std::vector<>                    */
 
 #include "c_macros.h"
@@ -114,6 +116,25 @@ extern bool parse_session_triplet
 );
 extern std::string session_triplet_to_string (const session_triplet & t);
 extern session_triplets parse_session_lines (const std::string & sessionfile);
+extern bool parse_session_lines
+(
+    const std::string & sessionfile,
+    session_triplets & destination,
+    std::string & errmsg
+);
+extern bool write_session_lines
+(
+    const std::string & sessionfile,
+    const session_triplets & source,
+    std::string & errmsg
+);
+extern bool write_file_atomically
+(
+    const std::string & filename,
+    std::string_view data,
+    std::string & errmsg,
+    int * lockedfd = nullptr
+);
 extern bool make_xdg_runtime_lock_directory (std::string & lockfiledir);
 extern std::string lookup_active_nsmd_url ();
 extern std::string get_daemon_pid_file ();
@@ -155,6 +176,19 @@ extern bool extract_client_port
     std::string & clientname,
     std::string & portname
 );
+extern patch_direction split_patch_line
+(
+    std::string_view patch,
+    std::string_view & leftside,
+    std::string_view & rightside
+);
+extern bool split_client_port
+(
+    std::string_view fullname,
+    std::string_view & clientname,
+    std::string_view & portname
+);
+extern std::string_view trim_view (std::string_view s);
 extern patch_direction process_patch
 (
     const std::string & patch,
@@ -0,0 +1,140 @@
+#if ! defined NSM66_NSM_LAUNCHER_HPP
+#define NSM66_NSM_LAUNCHER_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          launcher.hpp
+ *
+ *    This module provides a process launcher based on posix_spawn(3).
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The launcher starts a client process directly, with a tokenized argument
+ *  list, instead of forking the caller and running "/bin/sh -c". The log
+ *  redirection is done with spawn file actions, and the environment is
+ *  passed to the spawn call. glibc implements posix_spawn() with
+ *  clone(CLONE_VM | CLONE_VFORK), so the caller's address space is not
+ *  copied.
+ *
+ *  If the arguments need the shell (pipes, variables, globs, etc.), the
+ *  launcher spawns "/bin/sh -c 'exec ...'", as the old code did.
+ */
+
+#include <string>                       /* std::string class                */
+#include <sys/types.h>                  /* pid_t                            */
+#include <vector>                       /* std::vector<> container          */
+
+#include "cpp_types.hpp"                /* lib66::tokenization alias        */
+
+namespace nsm
+{
+
+/**
+ *  Describes one process to launch.
+ */
+
+struct launch_spec
+{
+    /**
+     *  The program, looked up in PATH if it has no slash.
+     */
+
+    std::string ls_executable;
+
+    /**
+     *  The arguments, as a user would type them in a shell.
+     */
+
+    std::string ls_arguments;
+
+    /**
+     *  If not empty, standard output and standard error go to this file,
+     *  which is truncated.
+     */
+
+    std::string ls_log_file;
+
+    /**
+     *  "NAME=value" entries to add to (or replace in) the environment.
+     */
+
+    lib66::tokenization ls_environment;
+
+    /**
+     *  The names of variables to remove from the environment.
+     */
+
+    lib66::tokenization ls_unset;
+};
+
+/**
+ *  Launches processes one at a time, or many at once with a limit on the
+ *  number of spawns in progress.
+ */
+
+class launcher
+{
+
+private:
+
+    /**
+     *  The most spawns to run at the same time in spawn_all().
+     */
+
+    int m_max_concurrent;
+
+public:
+
+    launcher (int maxconcurrent = 4);
+
+    int max_concurrent () const
+    {
+        return m_max_concurrent;
+    }
+
+    static pid_t spawn (const launch_spec & spec, std::string & errmsg);
+    std::vector<pid_t> spawn_all (const std::vector<launch_spec> & specs) const;
+
+};          // class launcher
+
+/*
+ *  Free functions.
+ */
+
+extern bool split_arguments
+(
+    const std::string & args,
+    lib66::tokenization & argv
+);
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_LAUNCHER_HPP
+
+/*
+ * launcher.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
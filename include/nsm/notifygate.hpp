@@ -0,0 +1,131 @@
+#if ! defined NSM66_NSM_NOTIFYGATE_HPP
+#define NSM66_NSM_NOTIFYGATE_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          notifygate.hpp
+ *
+ *    This module decides when a client's dirty state and progress are
+ *    sent to the session manager.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-15
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The dirty state is sent only when it differs from the state last sent,
+ *  and, if there is a debounce time, only once it has held for that long,
+ *  so a state that flips back in the meantime is never sent. Progress is
+ *  sent at most once per interval, with the latest value held for the
+ *  trailing edge; 100% is always sent at once.
+ *
+ *  The gate only decides; the caller sends. It has no lock of its own:
+ *  nsmbase holds its notification mutex around each call and the send
+ *  that follows, so that two sends cannot go out in the wrong order.
+ */
+
+#include <chrono>                       /* std::chrono::steady_clock        */
+
+namespace nsm
+{
+
+/**
+ *  The coalescing state of the dirty and progress notifications.
+ */
+
+class notifygate
+{
+
+public:
+
+    using clock = std::chrono::steady_clock;
+
+private:
+
+    bool m_dirty;
+    int m_dirty_debounce_ms;
+    bool m_dirty_known;
+    bool m_dirty_reported;
+    bool m_dirty_pending;
+    clock::time_point m_dirty_due;
+    int m_progress_interval_ms;
+    bool m_progress_pending;
+    float m_progress_value;
+    clock::time_point m_progress_last;
+
+public:
+
+    notifygate ();
+
+    bool offer_dirty (bool isdirty, clock::time_point now);
+    bool due_dirty (clock::time_point now, bool & isdirty);
+    bool offer_progress (float percent, clock::time_point now);
+    bool due_progress (clock::time_point now, float & percent);
+    int timeout (clock::time_point now) const;
+    void mark_clean ();
+
+    /**
+     *  Changes the dirty state without sending it, as the session load and
+     *  save do.
+     */
+
+    void set_dirty (bool isdirty)
+    {
+        m_dirty = isdirty;
+    }
+
+    bool dirty () const
+    {
+        return m_dirty;
+    }
+
+    void dirty_debounce (int ms)
+    {
+        m_dirty_debounce_ms = ms > 0 ? ms : 0 ;
+    }
+
+    int dirty_debounce () const
+    {
+        return m_dirty_debounce_ms;
+    }
+
+    void progress_interval (int ms)
+    {
+        m_progress_interval_ms = ms > 0 ? ms : 0 ;
+    }
+
+    int progress_interval () const
+    {
+        return m_progress_interval_ms;
+    }
+
+};          // class notifygate
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_NOTIFYGATE_HPP
+
+/*
+ * notifygate.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
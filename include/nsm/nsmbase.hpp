@@ -10,14 +10,24 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-01-29
- * \updates       2025-04-24
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
  *  Upcoming support for the Non Session Manager.
+ *
+ *  The announcement can be asynchronous: announce_async() returns at once
+ *  with a future, and can also call a completion callback. Completion is
+ *  signalled by the OSC thread when the session is opened (is_active(true))
+ *  or the announce is refused, or by a watchdog thread on timeout.
  */
 
 #include <atomic>                       /* std::atomic<bool>                */
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <condition_variable>           /* std::condition_variable          */
+#include <future>                       /* std::future<>, std::promise<>    */
+#include <mutex>                        /* std::mutex, std::unique_lock     */
+#include <thread>                       /* std::thread                      */
 #include <vector>                       /* std::vector                      */
 
 #include "c_macros.h"                   /* is_nullptr() & not_nullptr()     */
@@ -25,7 +35,10 @@
 #include "nsm66-config.h"               /* feature (HAVE) macros            */
 #include "nsm/nsmcodes.hpp"             /* ns::error enumeration            */
 #include "nsm/nsmmessagesex.hpp"        /* osc::tag                         */
+#include "nsm/notifygate.hpp"           /* nsm::notifygate class            */
 #include "osc/lowrapper.hpp"            /* osc::lowrapper base class        */
+#include "osc/msgbuilder.hpp"           /* osc::msgtemplate class           */
+#include "osc/thread.hpp"               /* osc::thread_attributes           */
 
 namespace nsm
 {
@@ -77,6 +90,26 @@ enum class caps
     server_control,
 };
 
+/**
+ *  The progress of an announcement. See nsmbase::announce_async().
+ */
+
+enum class announce_status
+{
+    idle,               /* no announcement made yet                         */
+    pending,            /* sent, waiting for the open or an error           */
+    succeeded,          /* the session was opened                           */
+    failed              /* refused by the server, not sent, or timed out    */
+};
+
+/**
+ *  The announce completion callback. The flag is true if the announce
+ *  succeeded. It is called in the OSC thread, in the watchdog thread (on
+ *  timeout), or in the caller's thread (if the send fails).
+ */
+
+using announce_callback = void (*) (bool, void *);
+
 /**
  *  nsmbase is an NSM OSC server/client base class.
  */
@@ -102,6 +135,14 @@ private:
 
     lo_server_thread m_server_thread;
 
+    /**
+     *  The scheduling policy, priority, CPU affinity, and stack locking for
+     *  the server thread. They are applied by the thread itself when it
+     *  starts, so the stack size cannot be set. See start_thread().
+     */
+
+    osc::thread_attributes m_thread_attributes;
+
     /**
      *  Provides a reference (a void pointer) to an object representing an
      *  an OSC server. See /usr/include/lo/lo_types.h.
@@ -117,12 +158,68 @@ private:
 
     mutable std::atomic<bool> m_active;
 
+    /**
+     *  Announce completion items. The mutex protects the status, promise,
+     *  and callback, and the condition variable is notified when the status
+     *  leaves announce_status::pending.
+     */
+
+    mutable std::mutex m_announce_mutex;
+
+    std::condition_variable m_announce_cond;
+
+    announce_status m_announce_status;
+
+    std::promise<bool> m_announce_promise;
+
+    announce_callback m_announce_callback;
+
+    void * m_announce_userdata;
+
+    /**
+     *  How long to wait for the announce to complete, in milliseconds. The
+     *  default is 12000, as in the original polling loop. It is always
+     *  positive, so that nsmclient::announce() cannot wait forever.
+     */
+
+    int m_announce_timeout_ms;
+
+    /**
+     *  Fails the announce if it times out. The mutex serializes the
+     *  joining and starting of the watchdog by announce_async() callers
+     *  and the destructor.
+     */
+
+    std::mutex m_watchdog_mutex;
+
+    std::thread m_announce_watchdog;
+
     /**
      *  Additional data.
      */
 
-    bool m_dirty;
     int m_dirty_count;
+
+    /**
+     *  The coalescing of the dirty/clean and progress notifications; see
+     *  nsm::notifygate, and dirty(), progress(), and flush_notifications().
+     *  The mutex protects the gate, as the application, its timer, and the
+     *  OSC thread use it, and is held while a notification is sent, so
+     *  that the sends go out in the order the gate decided them.
+     */
+
+    mutable std::mutex m_notify_mutex;
+    notifygate m_notify;
+
+    /**
+     *  The prebuilt headers of the messages sent to the server, indexed by
+     *  osc::tag, made once in initialize(). See send_from_client() and
+     *  send_progress(), which then need neither client_msg() lookups nor
+     *  liblo's allocations for each message.
+     */
+
+    std::vector<osc::msgtemplate> m_templates;
+
     std::string m_manager;
     std::string m_capabilities;
     std::string m_path_name;
@@ -149,6 +246,24 @@ public:
         return m_active;
     }
 
+    std::future<bool> announce_async
+    (
+        const std::string & appname,
+        const std::string & exename,
+        const std::string & capabilities,
+        announce_callback cb    = nullptr,
+        void * userdata         = nullptr
+    );
+    announce_status announce_state () const;
+    bool wait_announce (int timeoutms);
+
+    int announce_timeout () const
+    {
+        return m_announce_timeout_ms;
+    }
+
+    bool announce_timeout (int ms);
+
     bool is_a_client (const nsmbase * p)
     {
         return not_nullptr(p) && p->is_active();
@@ -205,10 +320,42 @@ public:
 
     bool dirty () const
     {
-        return m_dirty;
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        return m_notify.dirty();
     }
 
     void dirty (bool isdirty);          /* session managers call this one   */
+    void dirty_debounce (int ms);
+    void progress_interval (int ms);
+    int flush_notifications ();
+    int notification_timeout () const;
+
+    int dirty_debounce () const
+    {
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        return m_notify.dirty_debounce();
+    }
+
+    int progress_interval () const
+    {
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        return m_notify.progress_interval();
+    }
+
+    const osc::thread_attributes & thread_attributes () const
+    {
+        return m_thread_attributes;
+    }
+
+    /**
+     *  Sets the attributes for the server thread. Call this before the
+     *  thread is started (e.g. before nsmclient::init()).
+     */
+
+    void thread_attributes (const osc::thread_attributes & attr)
+    {
+        m_thread_attributes = attr;
+    }
 
 protected:
 
@@ -230,8 +377,12 @@ protected:
     void is_active (bool f)
     {
         m_active = f;
+        if (f)
+            finish_announce(true);
     }
 
+    void finish_announce (bool success);
+
     void manager (const std::string & s)
     {
         m_manager = s;
@@ -254,8 +405,13 @@ protected:
         const std::string & capabilities
     );
     void start_thread ();
+    void start_thread (const osc::thread_attributes & attr);
     void stop_thread ();
     void update_dirty_count (bool flag = true);
+    void mark_clean ();
+    void send_dirtiness (bool isdirty);
+    void send_progress (float percent);
+    void make_templates ();
 
     // Session client reply methods
 
@@ -280,6 +436,14 @@ protected:
         const std::string & message,
         const std::string & pattern
     );
+    const osc::msgtemplate * client_template (osc::tag t) const;
+    int send_template
+    (
+        const osc::msgtemplate & mt,
+        const std::string & s1 = "",
+        const std::string & s2 = "",
+        const std::string & s3 = ""
+    );
     bool send_from_client (osc::tag t);
     bool send_from_client
     (
@@ -293,14 +457,14 @@ protected:
     {
         open_reply(loaded ? nsm::error::ok : nsm::error::general);
         if (loaded)
-            m_dirty = false;
+            mark_clean();
     }
 
     void save_reply (bool saved)
     {
         save_reply(saved ? nsm::error::ok : nsm::error::general);
         if (saved)
-            m_dirty = false;
+            mark_clean();
     }
 
 public:             // virtual methods for callbacks in nsmbase
@@ -326,6 +490,33 @@ protected:          // virtual methods
         void * userdata = nullptr
     );
 
+    /**
+     *  The server-thread version of lowrapper::add_typed_method().
+     */
+
+    template <auto F>
+    bool add_typed_thread_method
+    (
+        osc::tag t, typename osc::typed_handler<F>::object_type * object
+    )
+    {
+        std::string message, pattern;
+        const char * spec = osc::typed_handler<F>::typespec();
+        bool result = osc::typed_method_check(t, spec, message, pattern);
+        if (result)
+        {
+            result = not_nullptr
+            (
+                lo_server_thread_add_method
+                (
+                    m_server_thread, message.c_str(), spec,
+                    &osc::typed_handler<F>::call, object
+                )
+            );
+        }
+        return result;
+    }
+
     /*
      * Used by the free-function OSC callbacks, and there are too many to make
      * as friends.
@@ -376,6 +567,7 @@ protected:
 
 private:
 
+    void announce_watchdog (int timeoutms);
     int send_from
     (
         const std::string & message,
@@ -394,6 +586,8 @@ private:
 
 private:
 
+    static int server_thread_init (lo_server_thread st, void * user_data);
+
     /*
      * Static OSC callback functions.
      */
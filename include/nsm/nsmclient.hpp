@@ -10,18 +10,53 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-01-29
- * \updates       2025-04-24
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
  *  Upcoming support for the Non Session Manager.
+ *
+ *  By default, the session commands (open, save, etc.) call the virtual
+ *  functions directly in the OSC server thread. With queue_commands(true),
+ *  they are instead queued in a wait-free queue, and the application calls
+ *  dispatch_commands() or pop_command() from its own thread.
  */
 
+#include <memory>                       /* std::unique_ptr<>                */
+#include <string>                       /* std::string                      */
+#include <string_view>                  /* std::string_view                 */
+
 #include "nsm/nsmbase.hpp"              /* nsm::nsmbase base class          */
+#include "osc/spscqueue.hpp"            /* osc::spscqueue<> template        */
 
 namespace nsm
 {
 
+/**
+ *  A session command decoded by the OSC thread, for delivery to the
+ *  application's thread. The string members that are not used by a command
+ *  are empty.
+ */
+
+struct session_command
+{
+    enum class kind
+    {
+        none,
+        open,           /* sc_text is the path, plus the other two members  */
+        save,
+        loaded,
+        label,          /* sc_text is the label                             */
+        show,           /* sc_text is the OSC path                          */
+        hide            /* sc_text is the OSC path                          */
+    };
+
+    kind sc_kind;
+    std::string sc_text;
+    std::string sc_display_name;
+    std::string sc_client_id;
+};
+
 /**
  *  nsmclient is an NSM OSC client agent.
  */
@@ -42,6 +77,30 @@ private:
 
     std::atomic<bool> m_hidden;
 
+    /**
+     *  Session commands are queued here by the OSC thread, instead of being
+     *  handled there, if m_queueing is true. The queue is created by the
+     *  first queue_commands(true) and kept until destruction, so that the
+     *  mode can be changed while the OSC thread runs.
+     */
+
+    std::unique_ptr<osc::spscqueue<session_command>> m_commands;
+
+    std::atomic<bool> m_queueing;
+
+    /**
+     *  An eventfd(2) signalled for each queued command, so that the
+     *  application can poll for them. It is -1 if not in use.
+     */
+
+    int m_command_fd;
+
+    /**
+     *  The number of commands lost because the queue was full.
+     */
+
+    std::atomic<unsigned long> m_commands_dropped;
+
 public:
 
     nsmclient
@@ -59,6 +118,27 @@ public:
         return m_hidden;
     }
 
+    bool queue_commands (bool flag, std::size_t capacity = 64);
+
+    bool queue_commands () const
+    {
+        return m_queueing;
+    }
+
+    int command_fd () const
+    {
+        return m_command_fd;
+    }
+
+    unsigned long commands_dropped () const
+    {
+        return m_commands_dropped;
+    }
+
+    bool pop_command (session_command & cmd);
+    void acknowledge_commands ();
+    int dispatch_commands ();
+
 public:     // session client method overrides
 
     virtual bool initialize () override;
@@ -110,45 +190,43 @@ protected:
 
 private:
 
+    bool post_command
+    (
+        session_command::kind k,
+        std::string_view text           = "",
+        std::string_view displayname    = "",
+        std::string_view clientid       = ""
+    );
+
     /*
-     * Static OSC callback functions.
+     * Typed OSC handlers; see osc/typedmethod.hpp.
      */
 
-    static int osc_nsm_announce_reply
-    (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
-    );
-    static int osc_nsm_open
-    (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
-    );
-    static int osc_nsm_save
-    (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
-    );
-    static int osc_nsm_session_loaded
-    (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
-    );
-    static int osc_nsm_label
-    (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
-    );
-    static int osc_nsm_show
+    bool on_announce_reply
     (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
+        const osc::message_info & info,
+        const char * replied,
+        std::string_view mesg,
+        std::string_view manager,
+        std::string_view capabilities
     );
-    static int osc_nsm_hide
+    bool on_open
     (
-        const char * path, const char * types, lo_arg ** argv,
-        int argc, lo_message msg, void * user_data
+        const osc::message_info & info,
+        std::string_view pathname,
+        std::string_view displayname,
+        std::string_view clientid
     );
+    bool on_save (const osc::message_info & info);
+    bool on_loaded (const osc::message_info & info);
+    bool on_label (const osc::message_info & info, std::string_view text);
+    bool on_show (const osc::message_info & info);
+    bool on_hide (const osc::message_info & info);
+
+    /*
+     * Static OSC callback functions.
+     */
+
     static int osc_nsm_broadcast
     (
         const char * path, const char * types, lo_arg ** argv,
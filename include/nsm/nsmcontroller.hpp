@@ -30,18 +30,39 @@
  * \library       nsmctl application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-21
- * \updates       2025-04-16
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
  *   To do.
+ *
+ *  Pinging: ping() is the original blocking check. ping_tick() is a
+ *  non-blocking scheduler, to be called from the control loop, that keeps
+ *  one ping outstanding per daemon and maintains per-daemon statistics
+ *  (round-trip histogram, losses); see ping_stats().
+ *
+ *  Fan-out: send_clients_message() sends one command (usually save) to a
+ *  set of clients at once, and tracks the answers against a deadline; see
+ *  nsm::fanout. fanout_tick() and fanout_wait() expire the stragglers and
+ *  log a summary naming the slowest client.
+ *
+ *  Session list: the names arrive one "/reply" per session from nsmd, or
+ *  in batches from an nsm66 daemon (see batched_list()). The caller reads
+ *  them as they come with get_sessions(), passing the count it already
+ *  has, rather than one string at the end.
  */
 
 #include <map>                          /* std::map<>                       */
 #include <memory>                       /* std::unique_ptr<>                */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
+#include <string_view>                  /* std::string_view                 */
 
+#include "nsm/clientregistry.hpp"       /* nsm::clientregistry class        */
+#include "nsm/fanout.hpp"               /* nsm::fanout class                */
 #include "nsm/nsmctlclient.hpp"         /* nsm::nsmctlclient & nsm::daemon  */
+#include "nsm/pingstats.hpp"            /* nsm::pingstats                   */
 #include "osc/messages.hpp"             /* osc::tag                         */
+#include "osc/typedmethod.hpp"          /* osc::message_info                */
 
 namespace osc
 {
@@ -54,27 +75,72 @@ namespace nsm
 class nsmcontroller
 {
 
-public:
+private:
+
+    std::unique_ptr<osc::endpoint> m_osc_server;
+    daemon_list & m_daemon_list;
 
     /*
-     *  The key is the client ID, which is the random tag used by nsmd,
-     *  of the form "nXYZT". Note that the nsmctlclient holds information
-     *  about its ID, label, and name.
+     *  The session names, as they arrive. The mutex protects them, as the
+     *  replies can be handled in the OSC thread while the caller reads
+     *  them with get_sessions().
      *
-     * TODO: use unique_ptr
+     *  Each daemon asked for its list has an entry in m_list_sources, keyed
+     *  by its URL: the index of the batch expected next, and whether the
+     *  end of its list (an empty "/reply" from nsmd, or the last batch of
+     *  an "/nsm66/reply/list") has come. The list is done when every
+     *  daemon's is. A batch arriving out of order counts as a gap.
      */
 
-    using clientmap = std::map<std::string, nsmctlclient *>;
-
-private:
+    struct list_source
+    {
+        int ls_next_batch;
+        bool ls_done;
+    };
 
-    std::unique_ptr<osc::endpoint> m_osc_server;
-    daemon_list & m_daemon_list;
     lib66::tokenization m_session_list;
-    clientmap m_clients_pack;           /* name reminiscent of the FLTK GUI */
+    mutable std::mutex m_session_mutex;
+    std::map<std::string, list_source> m_list_sources;
+    int m_session_list_gaps;
+    bool m_batched_list;
+    /*
+     *  The clients, stored densely and indexed by client ID (the random
+     *  tag used by nsmd, of the form "nXYZT") and by client name. The
+     *  member name is reminiscent of the FLTK GUI.
+     */
+
+    clientregistry m_clients_pack;
+
+    /*
+     * Adding or removing a client, in the OSC thread, can move the others,
+     * so every lookup of a client, and every use of the pointer found, is
+     * made under this lock. It is recursive because a status handler can
+     * remove the client it is working on.
+     */
+
+    mutable std::recursive_mutex m_clients_mutex;
     time_t m_last_ping_response;
-    time_t m_ping_timeout;
     int m_ping_count;
+
+    /*
+     * Ping statistics keyed by daemon URL. The mutex protects them, as the
+     * replies can be handled in the OSC thread or in osc_wait().
+     */
+
+    std::map<std::string, pingstats> m_ping_stats;
+    mutable std::mutex m_ping_mutex;
+    int m_ping_interval_ms;
+    int m_ping_reply_timeout_ms;
+
+    /*
+     * The latest command sent to many clients. The mutex protects it, as
+     * the answers are handled in the OSC thread or in osc_wait().
+     */
+
+    fanout m_fanout;
+    mutable std::mutex m_fanout_mutex;
+    int m_fanout_timeout_ms;
+    bool m_fanout_reported;
     std::string m_app_name;
     std::string m_exe_name;
     std::string m_capabilities;
@@ -97,7 +163,7 @@ public:
     nsmcontroller (nsmcontroller &&) = delete;
     nsmcontroller & operator = (const nsmcontroller &) = delete;
     nsmcontroller & operator = (nsmcontroller &&) = delete;
-    ~nsmcontroller () = default;
+    ~nsmcontroller ();
 
     static void send_server_message (void * v, osc::tag msg);
     bool send_server_message
@@ -111,9 +177,41 @@ public:
         const std::string & clientname
     );
 
-    nsmctlclient * client_by_id (const std::string & id) const;
-    nsmctlclient * client_by_name (const std::string & name) const;
-    void log_status (const std::string & s, bool iserror = false);
+    int send_clients_message
+    (
+        osc::tag msg,
+        const lib66::tokenization & clients = lib66::tokenization(),
+        int timeoutms = 0
+    );
+    bool fanout_tick ();
+    bool fanout_wait ();
+    float fanout_progress () const;
+    bool fanout_status (fanout & f) const;
+
+    void fanout_timeout (int ms)
+    {
+        m_fanout_timeout_ms = ms > 0 ? ms : 1 ;
+    }
+
+    nsmctlclient * client_by_id (const std::string & id);
+    nsmctlclient * client_by_name (const std::string & name);
+
+    /*
+     * Hold this lock while using clients() or the pointers returned by
+     * client_by_id() and client_by_name().
+     */
+
+    std::unique_lock<std::recursive_mutex> lock_clients () const
+    {
+        return std::unique_lock<std::recursive_mutex>(m_clients_mutex);
+    }
+
+    const clientregistry & clients () const
+    {
+        return m_clients_pack;
+    }
+
+    void log_status (std::string_view s, bool iserror = false);
 
     std::string url () const
     {
@@ -126,7 +224,7 @@ public:
         return m_session_name;
     }
 
-    void session_name (const std::string & name)
+    void session_name (std::string_view name)
     {
         m_session_name = name;
     }
@@ -138,23 +236,60 @@ public:
         const std::string & client_id,
         const std::string & client_name
     );
+    bool client_switch
+    (
+        const std::string & client_id,
+        const std::string & new_id
+    );
     void client_pending_command
     (
         nsmctlclient * c,
-        const std::string & command
+        std::string_view command
+    );
+
+    void add_session_to_list (lo_address source, std::string_view name);
+    void add_sessions_to_list
+    (
+        lo_address source,
+        lo_arg ** argv, int argc,
+        const char * types
     );
+    std::size_t get_sessions
+    (
+        std::size_t from,
+        lib66::tokenization & names
+    ) const;
+    std::size_t session_count () const;
+    bool session_list_done () const;
+    int session_list_gaps () const;
+    std::string get_session_list () const;
+
+    /**
+     *  If true, the session list is asked for with "/nsm66/server/list",
+     *  which an nsm66 daemon answers with a few large batches; see
+     *  lowrapper::send_batched(). Plain nsmd does not know it.
+     */
 
-    void add_session_to_list (const std::string & name)
+    void batched_list (bool f)
     {
-        if (! name.empty())
-            m_session_list.push_back(name);
+        m_batched_list = f;
     }
-
-    std::string get_session_list () const;
     void osc_wait (int timeout);
     bool osc_active () const;
     bool deactivate ();
     bool ping ();
+    bool ping_tick ();
+    bool ping_stats (const std::string & url, pingstats & stats) const;
+
+    void ping_interval (int ms)
+    {
+        m_ping_interval_ms = ms > 0 ? ms : 1 ;
+    }
+
+    void ping_reply_timeout (int ms)
+    {
+        m_ping_reply_timeout_ms = ms > 0 ? ms : 1 ;
+    }
     bool init_osc (const std::string & portname = "");
     void announce ();
     void quit ();
@@ -163,6 +298,20 @@ private:
 
     void announce (const std::string & nsmurl, bool legacy = true);
     bool child_check () const;
+    int send_pings (bool force);
+    bool pings_outstanding () const;
+    bool pings_lost () const;
+    void ping_reply (lo_address source, pingstats::clock::time_point t);
+    void fanout_message
+    (
+        osc::tag msgtag,
+        nsmctlclient * c,
+        std::string_view value,
+        float p,
+        fanout::clock::time_point t
+    );
+    void fanout_expire (fanout::clock::time_point t);
+    void request_session_list (lo_address a);
     void add_method
     (
         osc::tag t,
@@ -170,6 +319,43 @@ private:
         const std::string & argument_description
     );
 
+private:
+
+    /*
+     * Typed OSC handlers; see osc/typedmethod.hpp. The "/reply" and "/error"
+     * messages, which share paths across typespecs, go to osc_handler().
+     */
+
+    bool on_server_message (std::string_view text);
+    bool on_session (const osc::message_info & info, std::string_view name);
+    bool on_session_name (std::string_view name, std::string_view path);
+    bool on_session_root (std::string_view root);
+    bool on_gui_announce
+    (
+        const osc::message_info & info,
+        std::string_view hello
+    );
+    bool on_server_announce
+    (
+        const osc::message_info & info,
+        std::string_view hello
+    );
+    bool on_client_new (std::string_view id, std::string_view name);
+    bool on_client_status (std::string_view id, std::string_view status);
+    bool on_client_progress (std::string_view id, float progress);
+    bool on_client_dirty (std::string_view id, int isdirty);
+    bool on_client_visible (std::string_view id, int isvisible);
+    bool on_client_label (std::string_view id, std::string_view label);
+    bool on_client_option (std::string_view id);
+    bool on_client_switch (std::string_view id, std::string_view newid);
+    nsmctlclient * client_message
+    (
+        osc::tag msgtag,
+        std::string_view id,
+        std::string_view value,
+        float p = 0.0f
+    );
+
 private:
 
     static int osc_broadcast_handler
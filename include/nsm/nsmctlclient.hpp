@@ -30,7 +30,7 @@
  * \library       nsmctl application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-21
- * \updates       2025-04-04
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -56,6 +56,14 @@ private:
 
     std::string m_url;
     lo_address m_addr;
+
+    /**
+     *  The canonical URL of m_addr, as made by osc::address_url(). It is
+     *  made once, when the address is set, so that relaying a broadcast
+     *  can compare it with the source of each message cheaply.
+     */
+
+    std::string m_addr_url;
     bool m_is_child;
 
 public:
@@ -91,6 +99,12 @@ public:
     void addr (lo_address a)
     {
         m_addr = a;
+        m_addr_url = osc::address_url(a);
+    }
+
+    const std::string & addr_url () const
+    {
+        return m_addr_url;
     }
 
     bool is_child () const
@@ -119,7 +133,8 @@ using daemon_list = std::vector<daemon>;    /* list of connected daemons    */
 class nsmctlclient
 {
     osc::endpoint * m_osc_server;       /* pointer owned by nsmcontroller   */
-    daemon_list & m_daemon_list;        /* list owned by the application    */
+    daemon_list * m_daemon_list;        /* owned by the app; pointer so the */
+                                        /* clientregistry can move clients  */
     std::string m_client_id;
     std::string m_client_label;
     std::string m_client_name;
@@ -127,6 +142,13 @@ class nsmctlclient
     bool m_dirty;
     bool m_visible;
 
+    /**
+     *  How long the client took to answer the latest save sent to many
+     *  clients at once (see nsm::fanout), or -1 if it did not answer.
+     */
+
+    long m_save_latency_us;
+
 public:
 
     nsmctlclient () = delete;
@@ -187,6 +209,26 @@ public:
         m_visible = b;
     }
 
+    float progress () const
+    {
+        return m_progress;
+    }
+
+    bool dirty () const
+    {
+        return m_dirty;
+    }
+
+    long save_latency_us () const
+    {
+        return m_save_latency_us;
+    }
+
+    void save_latency_us (long us)
+    {
+        m_save_latency_us = us;
+    }
+
     void stopped (bool b);
     void pending_command (const std::string & command);
     bool send_client_message (osc::tag o);
@@ -21,6 +21,7 @@
 
 #include <map>                          /* std::map dictionary class        */
 #include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view                 */
 
 #include "osc/messages.hpp"             /* osc::tag                         */
 
@@ -70,7 +71,8 @@ extern bool server_msg
 );
 extern std::string get_dirtiness_msg (bool isdirty);
 extern std::string get_visibility_msg (bool isvisible);
-extern bool is_gui_announce (const std::string & s = "");
+extern bool is_gui_announce (std::string_view s = "");
+extern bool is_gui_announce (const char * s);
 
 #if defined USE_THIS_CODE
 
@@ -30,7 +30,7 @@
  * \library       nsm-proxy66 application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-06
- * \updates       2025-03-20
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v3 or above
  *
@@ -51,6 +51,7 @@
 #endif
 
 #define NSM_CONFIG_FILE_NAME    "nsm-proxy.config"
+#define NSM_SNAPSHOT_FILE_NAME  "nsm-proxy.snapshot"
 
 namespace nsm
 {
@@ -111,8 +112,9 @@ public:
 
     void label (const std::string & s);
     void save ();
-    bool dump (const std::string & path);
+    bool dump (const std::string & path, bool binary = false);
     bool restore (const std::string & path);
+    bool restore_snapshot (const std::string & filename);
     void update (lo_address to);
 
 private:
@@ -0,0 +1,192 @@
+#if ! defined NSM66_NSM_PATCHDIFF_HPP
+#define NSM66_NSM_PATCHDIFF_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          patchdiff.hpp
+ *
+ *    This module works out which JACK connections to make and break to
+ *    get from the live graph to a saved one.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The saved connections (the "desired" set) come from a patch_graph
+ *  loaded from a .jackpatch file. The live ports and connections come
+ *  either from a snapshot, also a patch_graph, or from the JACK callbacks
+ *  one at a time: port_registered(), port_unregistered(), connected(),
+ *  and disconnected(). Each call updates the pending work incrementally,
+ *  touching only the connections of the ports involved, and take() hands
+ *  out only what changed since the last take(), so nothing is issued
+ *  twice.
+ *
+ *  A connection is "to make" if it is desired, both of its ports exist,
+ *  and it is not live. A connection is "to break" if it is live, both of
+ *  its ports appear in the desired set, and it is not desired. Ports that
+ *  the saved session does not mention are left alone.
+ */
+
+#include <cstdint>                      /* std::uint64_t                    */
+#include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view class           */
+#include <unordered_map>                /* std::unordered_map<>             */
+#include <unordered_set>                /* std::unordered_set<>             */
+#include <vector>                       /* std::vector<> container          */
+
+#include "nsm/patchgraph.hpp"           /* nsm::patch_graph class           */
+
+namespace nsm
+{
+
+/**
+ *  Keeps the difference between a saved and a live patch graph.
+ */
+
+class patch_diff
+{
+
+public:
+
+    using id = patch_graph::id;
+
+    /**
+     *  A directed connection, from an output (source) port to an input
+     *  (destination) port, as port IDs of this object.
+     */
+
+    struct connection
+    {
+        id c_source;
+        id c_destination;
+    };
+
+    using connections = std::vector<connection>;
+
+private:
+
+    using key = std::uint64_t;
+    using keyset = std::unordered_set<key>;
+    using adjacency = std::unordered_map<id, std::vector<key>>;
+    using live_adjacency = std::unordered_map<id, keyset>;
+
+    /**
+     *  Used only to intern the names of the ports in both graphs, so that
+     *  the port IDs of the saved and the live graph can be compared.
+     */
+
+    patch_graph m_names;
+
+    keyset m_desired;
+    adjacency m_desired_by_port;
+
+    /**
+     *  Indexed by port ID; non-zero if the port exists in JACK.
+     */
+
+    std::vector<char> m_present;
+
+    /**
+     *  The live connections, and for each port, its live connections.
+     *  Unlike the desired lists, these sets lose a key on a disconnect,
+     *  since connections come and go.
+     */
+
+    keyset m_live;
+    live_adjacency m_live_by_port;
+
+    /**
+     *  The work not yet handed out by take().
+     */
+
+    keyset m_to_make;
+    keyset m_to_break;
+
+public:
+
+    patch_diff ();
+
+    void clear ();
+    void set_desired (const patch_graph & saved);
+    void set_live (const patch_graph & live);
+
+    id port (std::string_view fullname);
+    void port_registered (std::string_view fullname);
+    void port_unregistered (std::string_view fullname);
+    void connected (std::string_view source, std::string_view destination);
+    void disconnected (std::string_view source, std::string_view destination);
+
+    void port_registered (id p);
+    void port_unregistered (id p);
+    void connected (id source, id destination);
+    void disconnected (id source, id destination);
+
+    void take (connections & tomake, connections & tobreak);
+
+    std::size_t pending () const
+    {
+        return m_to_make.size() + m_to_break.size();
+    }
+
+    std::string port_fullname (id p) const
+    {
+        return m_names.port_fullname(p);
+    }
+
+private:
+
+    static key make_key (id source, id destination)
+    {
+        return (key(source) << 32) | destination;
+    }
+
+    static id source_of (key k)
+    {
+        return id(k >> 32);
+    }
+
+    static id destination_of (key k)
+    {
+        return id(k & 0xFFFFFFFF);
+    }
+
+    id import_port (const patch_graph & g, id p);
+    bool present (id p) const;
+    bool managed (id p) const;
+    void reevaluate (key k);
+    void rebuild ();
+    void add_desired (key k);
+    void add_live (key k);
+    bool remove_live (key k);
+
+};          // class patch_diff
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_PATCHDIFF_HPP
+
+/*
+ * patchdiff.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
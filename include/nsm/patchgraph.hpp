@@ -0,0 +1,194 @@
+#if ! defined NSM66_NSM_PATCHGRAPH_HPP
+#define NSM66_NSM_PATCHGRAPH_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          patchgraph.hpp
+ *
+ *    This module provides a compact form of the connections in a
+ *    .jackpatch file.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Each client name and port name is stored once, and given an integer
+ *  ID. A port is a pair of name IDs (client, port), and is itself given an
+ *  ID. A connection (edge) is a pair of port IDs plus the direction, so
+ *  comparing ports or connections compares integers, not strings.
+ *
+ *  The file is read in one pass, one line at a time, into one reused
+ *  buffer; the line is split with string views (see split_patch_line() and
+ *  split_client_port() in helpers.cpp), so only new names are copied.
+ */
+
+#include <cstdint>                      /* std::uint32_t, std::uint64_t     */
+#include <deque>                        /* std::deque<>, stable elements    */
+#include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view class           */
+#include <unordered_map>                /* std::unordered_map<>             */
+#include <vector>                       /* std::vector<> container          */
+
+#include "nsm/helpers.hpp"              /* nsm::patch_direction enum        */
+
+namespace nsm
+{
+
+/**
+ *  The connections of a session, with interned names.
+ */
+
+class patch_graph
+{
+
+public:
+
+    using id = std::uint32_t;
+
+    static const id c_no_id = 0xFFFFFFFF;
+
+    /**
+     *  A port, as the IDs of its client name and its port name.
+     */
+
+    struct port
+    {
+        id pt_client;
+        id pt_name;
+    };
+
+    /**
+     *  A connection between two ports. The left and right ports are as in
+     *  the patch line; the direction tells which is the source.
+     */
+
+    struct edge
+    {
+        id e_left;
+        id e_right;
+        patch_direction e_direction;
+    };
+
+private:
+
+    /**
+     *  The interned names. A deque does not move its elements as it grows,
+     *  so the views in m_name_ids stay valid.
+     */
+
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string_view, id> m_name_ids;
+
+    /**
+     *  The ports, and an index keyed by the two name IDs packed into 64
+     *  bits.
+     */
+
+    std::vector<port> m_ports;
+    std::unordered_map<std::uint64_t, id> m_port_ids;
+
+    std::vector<edge> m_edges;
+
+    /**
+     *  Lines that could not be parsed are skipped, as jackpatch does, but
+     *  counted, and the first one is described in m_error.
+     */
+
+    int m_bad_lines;
+    std::string m_error;
+
+public:
+
+    patch_graph ();
+
+    void clear ();
+    bool load (const std::string & filename);
+    bool add_line (std::string_view line);
+
+    id intern (std::string_view name);
+    id find_name (std::string_view name) const;
+    id add_port (std::string_view clientname, std::string_view portname);
+    id find_port (std::string_view clientname, std::string_view portname) const;
+    void add_edge (id left, id right, patch_direction d);
+
+    const std::string & name (id n) const
+    {
+        return m_names[n];
+    }
+
+    const port & port_at (id p) const
+    {
+        return m_ports[p];
+    }
+
+    std::string port_fullname (id p) const;
+    std::string edge_line (const edge & e) const;
+
+    const std::vector<edge> & edges () const
+    {
+        return m_edges;
+    }
+
+    std::size_t name_count () const
+    {
+        return m_names.size();
+    }
+
+    std::size_t port_count () const
+    {
+        return m_ports.size();
+    }
+
+    std::size_t edge_count () const
+    {
+        return m_edges.size();
+    }
+
+    int bad_lines () const
+    {
+        return m_bad_lines;
+    }
+
+    const std::string & error_message () const
+    {
+        return m_error;
+    }
+
+private:
+
+    static std::uint64_t port_key (id clientname, id portname)
+    {
+        return (std::uint64_t(clientname) << 32) | portname;
+    }
+
+};          // class patch_graph
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_PATCHGRAPH_HPP
+
+/*
+ * patchgraph.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,175 @@
+#if ! defined NSM66_NSM_PINGSTATS_HPP
+#define NSM66_NSM_PINGSTATS_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          pingstats.hpp
+ *
+ *    This module provides the per-daemon ping statistics used by the
+ *    nsmcontroller ping scheduler.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Round-trip times are kept in microseconds, in a histogram of
+ *  power-of-two buckets: bucket 0 holds RTTs under 32 us, bucket 1 those
+ *  under 64 us, and so on; the last bucket holds everything longer.
+ */
+
+#include <array>                        /* std::array<> container           */
+#include <chrono>                       /* std::chrono::steady_clock        */
+
+namespace nsm
+{
+
+/**
+ *  Ping state and statistics for one daemon. Only one ping is outstanding
+ *  at a time; a ping not answered within the timeout is counted as lost,
+ *  and an answer that comes after that is counted as late.
+ */
+
+class pingstats
+{
+
+public:
+
+    using clock = std::chrono::steady_clock;
+
+    static const int c_bucket_count = 16;
+
+    static const long c_first_bucket_us = 32;
+
+    using histogram = std::array<unsigned long, c_bucket_count>;
+
+private:
+
+    unsigned long m_sent;
+    unsigned long m_received;
+    unsigned long m_lost;
+    unsigned long m_late;
+
+    /**
+     *  How many pings in a row were lost. Reset by any reply.
+     */
+
+    int m_consecutive_lost;
+
+    bool m_outstanding;
+    clock::time_point m_sent_time;
+    clock::time_point m_reply_time;
+
+    long m_last_us;
+    long m_min_us;
+    long m_max_us;
+    double m_total_us;
+    histogram m_histogram;
+
+public:
+
+    pingstats ();
+
+    void sent (clock::time_point t);
+    long replied (clock::time_point t);
+    bool expire (clock::time_point t, long timeoutus);
+
+    static int bucket (long rttus);
+    static long bucket_limit (int b);
+    long percentile (double p) const;
+
+    bool outstanding () const
+    {
+        return m_outstanding;
+    }
+
+    clock::time_point sent_time () const
+    {
+        return m_sent_time;
+    }
+
+    clock::time_point reply_time () const
+    {
+        return m_reply_time;
+    }
+
+    unsigned long sent_count () const
+    {
+        return m_sent;
+    }
+
+    unsigned long received () const
+    {
+        return m_received;
+    }
+
+    unsigned long lost () const
+    {
+        return m_lost;
+    }
+
+    unsigned long late () const
+    {
+        return m_late;
+    }
+
+    int consecutive_lost () const
+    {
+        return m_consecutive_lost;
+    }
+
+    long last_us () const
+    {
+        return m_last_us;
+    }
+
+    long min_us () const
+    {
+        return m_min_us;
+    }
+
+    long max_us () const
+    {
+        return m_max_us;
+    }
+
+    double mean_us () const
+    {
+        return m_received > 0 ? m_total_us / double(m_received) : 0.0 ;
+    }
+
+    const histogram & buckets () const
+    {
+        return m_histogram;
+    }
+
+};          // class pingstats
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_PINGSTATS_HPP
+
+/*
+ * pingstats.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,166 @@
+#if ! defined NSM66_NSM_SESSIONFILE_HPP
+#define NSM66_NSM_SESSIONFILE_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          sessionfile.hpp
+ *
+ *    This module reads and writes the session.nsm file without copying
+ *    its lines.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The file is mapped into memory, and each entry is handed out as three
+ *  std::string_view fields pointing into the mapping, so reading a session
+ *  does not allocate. The views are valid until the sessionfile is loaded
+ *  again, saved, or destroyed.
+ *
+ *  Saving builds the new contents from the old: an entry that has not
+ *  changed is copied as the bytes of its old line, only changed entries
+ *  are formatted, and if nothing changed the file is not touched at all.
+ *  Otherwise the new contents go to a temporary file in the same
+ *  directory, which is then renamed over the old one, so a crash never
+ *  leaves a half-written session.nsm.
+ */
+
+#include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view class           */
+
+#include "nsm/helpers.hpp"              /* nsm::session_triplets            */
+
+namespace nsm
+{
+
+/**
+ *  Reads and writes one session.nsm file.
+ */
+
+class sessionfile
+{
+
+public:
+
+    /**
+     *  One line of the file, "name:exe:id", as views into the mapping.
+     */
+
+    struct entry
+    {
+        std::string_view e_client_name;
+        std::string_view e_client_exe;
+        std::string_view e_client_id;
+    };
+
+private:
+
+    std::string m_filename;
+
+    /**
+     *  The mapping of the file, or null if the file is not loaded or is
+     *  empty.
+     */
+
+    const char * m_data;
+    std::size_t m_size;
+    bool m_loaded;
+
+    /**
+     *  The offset of the next line to parse, and its line number (1-based)
+     *  for error messages.
+     */
+
+    std::size_t m_position;
+    int m_line;
+
+    /**
+     *  The reason for the last failure, and the line number, if any, at
+     *  which a parse failed.
+     */
+
+    std::string m_error;
+    int m_error_line;
+
+public:
+
+    sessionfile (const std::string & filename);
+    sessionfile (const sessionfile &) = delete;
+    sessionfile & operator = (const sessionfile &) = delete;
+    ~sessionfile ();
+
+    bool load ();
+    bool next (entry & e);
+    bool save (const session_triplets & entries, bool & changed);
+    void close ();
+
+    void rewind ()
+    {
+        m_position = 0;
+        m_line = 0;
+        m_error.clear();
+        m_error_line = 0;
+    }
+
+    const std::string & filename () const
+    {
+        return m_filename;
+    }
+
+    std::string_view contents () const
+    {
+        return std::string_view(m_data, m_size);
+    }
+
+    bool loaded () const
+    {
+        return m_loaded;
+    }
+
+    const std::string & error_message () const
+    {
+        return m_error;
+    }
+
+    int error_line () const
+    {
+        return m_error_line;
+    }
+
+    static bool parse_line (std::string_view line, entry & e);
+
+private:
+
+    bool fail (const std::string & msg);
+
+};          // class sessionfile
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_SESSIONFILE_HPP
+
+/*
+ * sessionfile.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
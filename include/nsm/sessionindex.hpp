@@ -0,0 +1,191 @@
+#if ! defined NSM66_NSM_SESSIONINDEX_HPP
+#define NSM66_NSM_SESSIONINDEX_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          sessionindex.hpp
+ *
+ *    This module keeps an index of the sessions under the session root,
+ *    kept current by inotify.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  A session is a directory under the root (see make_session_root())
+ *  that holds a "session.nsm" file. Its name is its path relative to the
+ *  root, e.g. "Work/Song 1", since sessions can be grouped in directories.
+ *
+ *  scan() walks the root once and puts an inotify watch on every
+ *  directory. After that, refresh() reads only the events: a session.nsm
+ *  that is written or renamed into place is read again, and a directory
+ *  that comes or goes is walked or dropped. Lists and searches are then
+ *  answered from memory. If inotify is not available, or runs out of
+ *  watches, or its queue overflows, refresh() walks the whole root again.
+ *
+ *  The index is not locked; use it from one thread, the daemon's or the
+ *  controller's main loop.
+ */
+
+#include <ctime>                        /* std::time_t                      */
+#include <map>                          /* std::map<>                       */
+#include <string>                       /* std::string class                */
+#include <unordered_map>                /* std::unordered_map<>             */
+#include <vector>                       /* std::vector<> container          */
+
+#include "cpp_types.hpp"                /* lib66::tokenization alias        */
+
+namespace nsm
+{
+
+/**
+ *  What the index knows about one session.
+ */
+
+struct session_info
+{
+    std::string si_name;                /* path relative to the root        */
+    std::string si_path;                /* full path of the directory       */
+    std::time_t si_mtime;               /* modification time of session.nsm */
+    int si_client_count;                /* lines in session.nsm             */
+};
+
+/**
+ *  Session index of one session root.
+ */
+
+class sessionindex
+{
+
+public:
+
+    using container = std::map<std::string, session_info>;
+    using matches = std::vector<const session_info *>;
+
+private:
+
+    std::string m_root;
+
+    /**
+     *  The sessions, by name, so that listing them is in order and a
+     *  group (a name prefix) is a range.
+     */
+
+    container m_sessions;
+
+    /**
+     *  The inotify descriptor, or -1, and the directory (relative to the
+     *  root, "" for the root itself) of each watch.
+     */
+
+    int m_inotify_fd;
+    std::unordered_map<int, std::string> m_watches;
+
+    /**
+     *  True if the whole root must be walked again at the next refresh().
+     *  Always true if there is no inotify descriptor.
+     */
+
+    bool m_rescan;
+
+    /**
+     *  How many times the root was walked, for statistics and tests.
+     */
+
+    int m_scan_count;
+
+public:
+
+    sessionindex (const std::string & root);
+    sessionindex (const sessionindex &) = delete;
+    sessionindex & operator = (const sessionindex &) = delete;
+    ~sessionindex ();
+
+    static bool read_session
+    (
+        const std::string & path,
+        const std::string & name,
+        session_info & info
+    );
+
+    bool scan ();
+    int refresh ();
+    lib66::tokenization list (const std::string & group = "") const;
+    matches search (const std::string & text) const;
+    const session_info * find (const std::string & name) const;
+
+    const std::string & root () const
+    {
+        return m_root;
+    }
+
+    std::size_t size () const
+    {
+        return m_sessions.size();
+    }
+
+    const container & sessions () const
+    {
+        return m_sessions;
+    }
+
+    int scan_count () const
+    {
+        return m_scan_count;
+    }
+
+    /**
+     *  The inotify descriptor, for an application's own event loop, or -1.
+     *  When it is readable, call refresh().
+     */
+
+    int watch_fd () const
+    {
+        return m_inotify_fd;
+    }
+
+    bool watching () const
+    {
+        return m_inotify_fd >= 0 && ! m_rescan;
+    }
+
+private:
+
+    void walk (const std::string & relative);
+    void add_watch (const std::string & relative);
+    void drop (const std::string & relative);
+    bool update (const std::string & relative);
+    std::string full_path (const std::string & relative) const;
+    void close_watches ();
+
+};          // class sessionindex
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_SESSIONINDEX_HPP
+
+/*
+ * sessionindex.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,155 @@
+#if ! defined NSM66_NSM_SNAPSHOT_HPP
+#define NSM66_NSM_SNAPSHOT_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          snapshot.hpp
+ *
+ *    This module provides a compact, versioned, checksummed binary file
+ *    format for saving nsmproxy state and session entries.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The layout, with all integers little-endian:
+ *
+ *      Offset  Size    Item
+ *      0       8       Magic, "NSM66SNP"
+ *      8       4       Format version (c_snapshot_version)
+ *      12      4       Kind of snapshot (snapshot_kind)
+ *      16      4       Length of the payload in bytes
+ *      20      4       CRC-32 of the payload
+ *      24      ...     Payload: fields, each a 2-byte tag, a 4-byte
+ *                      length, and that many bytes of value
+ *
+ *  The file is written atomically (see write_file_atomically()) and read
+ *  with one read(2); the fields are then handed out as views into the
+ *  buffer. A reader skips tags it does not know, so fields can be added
+ *  without a version change.
+ */
+
+#include <cstdint>                      /* std::uint16_t, std::uint32_t     */
+#include <string>                       /* std::string class                */
+#include <string_view>                  /* std::string_view class           */
+
+#include "nsm/helpers.hpp"              /* nsm::session_triplets            */
+
+namespace nsm
+{
+
+/**
+ *  The kind of data in the snapshot, so that a proxy snapshot is not
+ *  taken for a session.
+ */
+
+enum class snapshot_kind : std::uint32_t
+{
+    none,
+    proxy,                              /* nsmproxy state                   */
+    session                             /* session.nsm entries              */
+};
+
+const std::uint32_t c_snapshot_version = 1;
+
+extern std::uint32_t crc32 (std::string_view data);
+extern bool is_snapshot_file (const std::string & filename);
+extern bool write_session_snapshot
+(
+    const std::string & filename,
+    const session_triplets & entries,
+    std::string & errmsg
+);
+extern bool read_session_snapshot
+(
+    const std::string & filename,
+    session_triplets & entries,
+    std::string & errmsg
+);
+
+/**
+ *  Builds a snapshot in memory, then writes it.
+ */
+
+class snapshot_writer
+{
+
+private:
+
+    snapshot_kind m_kind;
+    std::string m_payload;
+
+public:
+
+    snapshot_writer (snapshot_kind k);
+
+    void add (std::uint16_t tag, std::string_view value);
+    void add (std::uint16_t tag, std::int32_t value);
+    std::string data () const;
+    bool write (const std::string & filename, std::string & errmsg) const;
+
+};          // class snapshot_writer
+
+/**
+ *  Reads a snapshot and checks its header and checksum.
+ */
+
+class snapshot_reader
+{
+
+private:
+
+    std::string m_buffer;
+    std::size_t m_position;
+    std::string m_error;
+
+public:
+
+    snapshot_reader ();
+
+    bool load (const std::string & filename, snapshot_kind k);
+    bool parse (std::string buffer, snapshot_kind k);
+    bool next (std::uint16_t & tag, std::string_view & value);
+
+    static std::int32_t to_int (std::string_view value);
+
+    const std::string & error_message () const
+    {
+        return m_error;
+    }
+
+private:
+
+    bool fail (const std::string & msg);
+
+};          // class snapshot_reader
+
+}           // namespace nsm
+
+#endif      // NSM66_NSM_SNAPSHOT_HPP
+
+/*
+ * snapshot.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -30,7 +30,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-04-08
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -45,17 +45,30 @@
  *          -   Signals.
  *          -   Methods.
  *      -   Various static OSC method handlers.
+ *      -   Optional batching of signal output into one bundle per peer.
+ *      -   Integration into the application's event loop, via socket_fd(),
+ *          next_timeout(), and dispatch_ready().
+ *      -   Optional extra receive threads on the same UDP port; see
+ *          start_sharded() and the shard module.
  *      -   And a lot more.
  *
  *  Used by nsmd and nsm-legacy-gui.
  */
 
+#include <atomic>                       /* std::atomic<>                    */
+#include <chrono>                       /* std::chrono::steady_clock        */
 #include <map>
+#include <memory>                       /* std::unique_ptr<>                */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
 #include <string>
+#include <unordered_map>                /* std::unordered_map               */
+#include <vector>                       /* std::vector                      */
 #include <lo/lo.h>
 
 #include "osc/lowrapper.hpp"            /* osc::lowrapper base class, funcs */
-#include "osc/method.hpp"               /* osc::method, method_list alias   */
+#include "osc/method.hpp"               /* osc::method, osc::method_trie    */
+#include "osc/pool.hpp"                 /* osc::pool<> template             */
+#include "osc/shard.hpp"                /* osc::shard, osc::mailbox         */
 #include "osc/signal.hpp"               /* osc::signal, peer & signal lists */
 #include "osc/thread.hpp"               /* osc::thread                      */
 
@@ -72,6 +85,7 @@ namespace osc
 class endpoint : public lowrapper
 {
     friend class signal;
+    friend class shard;
 
 private:
 
@@ -83,16 +97,62 @@ private:
         float m_current_value;
         bool m_suppress_feedback;
 
+        /*
+         * The feedback state, used if the destination signal has an
+         * output policy; see send_feedback().
+         */
+
+        output_gate m_output_gate;
+
         translation_destination () :
             m_path              (),
             m_current_value     (-1.0f),
-            m_suppress_feedback (false)
+            m_suppress_feedback (false),
+            m_output_gate       ()
         {
             // no code
         }
     };
 
-    using translation_map = std::map<std::string, translation_destination>;
+    /*
+     * The std::less<> comparator lets find() take the const char * path of
+     * an incoming message without making a string from it.
+     */
+
+    using translation_map =
+        std::map<std::string, translation_destination, std::less<>>;
+
+    /*
+     * The reverse of the translation map, from a destination path to the
+     * source paths translated to it.
+     */
+
+    using translation_sources = std::multimap<std::string, std::string>;
+
+    /*
+     * A pending output value for batching mode. Only the latest value for
+     * a path is kept; the index map gives the slot of the path in the
+     * vector, which keeps the order of the first change of each path.
+     */
+
+    using pending_value = std::pair<std::string, float>;
+    using pending_list = std::vector<pending_value>;
+    using pending_index = std::unordered_map<std::string, std::size_t>;
+
+    /*
+     * A value held back by a rate limit: the path of the signal, or the
+     * source path of the translation if ho_feedback is true, and when the
+     * rate allows it to be sent. The value itself is in the output_gate.
+     */
+
+    struct held_output
+    {
+        std::string ho_path;
+        bool ho_feedback;
+        std::chrono::steady_clock::time_point ho_due;
+    };
+
+    using held_list = std::vector<held_output>;
 
 private:
 
@@ -109,31 +169,133 @@ private:
     thread m_thread;
 
     /*
-     * Defined as an std::list<peer *> in the signal module.
+     * The peers, and the signals of the peers, are owned by these pools,
+     * which delete whatever is left when the endpoint goes away. The
+     * signals added by add_signal() belong to the application.
+     */
+
+    pool<peer> m_peer_pool;
+
+    pool<signal> m_signal_pool;
+
+    /*
+     * Defined as an std::vector<peer *> in the signal module.
      */
 
     peer_list m_peers;
 
     /*
-     * Defined as an std::list<signal *> in the signal module.
+     * The addresses of m_peers, in the same order, so that sending a value
+     * to all peers reads one array. See refresh_peer_destinations().
+     */
+
+    std::vector<lo_address> m_peer_destinations;
+
+    /*
+     * Hashed indices into m_peers, by peer name and by the canonical
+     * address key (see address_key()).
+     */
+
+    peer_index m_peer_names;
+
+    peer_index m_peer_addresses;
+
+    /*
+     * Defined as an std::vector<signal *> in the signal module.
      */
 
     signal_list m_signals;
 
     /*
-     * Defined as an std::list<method *> in the method module.
+     * Hashed index into m_signals, by the signal path.
+     */
+
+    signal_index m_signal_paths;
+
+    /*
+     * The methods added by add_method(), in a path trie; see the method
+     * module. The trie owns them.
      */
 
-    method_list m_methods;
+    method_trie m_methods;
 
     std::string m_learning_path;
 
     translation_map m_translations;
 
+    /*
+     * Maintained by every function that alters m_translations, so that
+     * lookups by destination path touch only the affected translations.
+     */
+
+    translation_sources m_translation_sources;
+
+    /*
+     * Remembers the last position found by get_translation(), so that
+     * enumerating all translations in order is not quadratic. Reset
+     * whenever a translation is erased.
+     */
+
+    translation_map::iterator m_translation_cursor;
+
+    int m_translation_cursor_index;
+
     std::string m_name;
 
     bool m_time_to_die;
 
+    /*
+     * Batching mode. If true, signal output values and feedback values are
+     * queued and sent as one bundle per peer by flush(), which is called
+     * by the user (once per "tick") or by run() and wait() when the flush
+     * interval has passed. These are mutable because run() and wait() are
+     * const functions; the mutex protects the pending values and the
+     * time of the last flush, which are queued in the caller's thread and
+     * flushed in the OSC thread. The flags are set in the caller's thread.
+     */
+
+    std::atomic<bool> m_batching;
+
+    std::atomic<int> m_flush_interval_ms;
+
+    mutable std::mutex m_pending_mutex;
+
+    mutable pending_list m_pending_values;
+
+    mutable pending_index m_pending_paths;
+
+    mutable std::chrono::steady_clock::time_point m_last_flush;
+
+    /*
+     * The values held by the rate limits of signals and feedback; see
+     * send_gated() and flush_held(). The mutex also protects the gates,
+     * which are used in the caller's thread and in the OSC thread, and
+     * the changes to m_signal_paths and m_translations, where flush_held()
+     * looks the gates up.
+     */
+
+    mutable std::mutex m_held_mutex;
+
+    held_list m_held_outputs;
+
+    /*
+     * An eventfd(2) written by wakeup() so that an epoll-based run() wakes
+     * up at once to check active() and the flush deadline. It is -1 if
+     * not supported.
+     */
+
+    int m_wake_fd;
+
+    /*
+     * The extra receive threads, if start_sharded() was used, and the
+     * mailbox through which they hand messages to the endpoint thread. The
+     * mailbox is drained by dispatch_ready(), wait(), and run().
+     */
+
+    std::vector<std::unique_ptr<shard>> m_shards;
+
+    mutable mailbox m_mailbox;
+
     void * m_peer_scan_complete_userdata;
 
     void * m_peer_signal_notification_userdata;
@@ -202,6 +364,11 @@ private:
         const char * path, const char * types, lo_arg ** argv, int argc,
         lo_message msg, void * user_data
     );
+    static int osc_stats
+    (
+        const char * path, const char * types, lo_arg ** argv, int argc,
+        lo_message msg, void * user_data
+    );
     static int osc_generic
     (
         const char * path, const char * types, lo_arg ** argv, int argc,
@@ -244,6 +411,7 @@ private:
     );
     static void * osc_thread (void * arg);
     static bool address_matches (lo_address addr1, lo_address addr2);
+    static std::string address_key (lo_address addr);
     static signal * find_target_by_peer_address
     (
         signal_list * lst, lo_address addr
@@ -258,16 +426,69 @@ private:
     osc::signal * find_signal_by_path (const std::string & path);
     peer * find_peer_by_name (const std::string & name);
     peer * find_peer_by_address (lo_address addr);
+    void index_peer_address (peer * p);
+    void refresh_peer_destinations ();
+    void unindex_peer_address (peer * p);
+    void unindex_signal_path (signal * s);
+    static void add_peer_signal (peer * p, signal * s);
+    static void remove_peer_signal (peer * p, signal * s);
 
     void add_sig_methods (void * userdata);
+    method * list_method
+    (
+        osc::tag t,
+        const std::string & argument_description
+    );
     void del_signal (signal * signal);
     void send_signal_rename_notifications(signal * s);
+    void link_translation (const std::string & src, const std::string & dst);
+    void unlink_translation (const std::string & src, const std::string & dst);
+    void reset_translation_cursor ()
+    {
+        m_translation_cursor_index = (-1);
+    }
+
+    void share_signal (signal * s);
+    void unshare_signal (const std::string & path, bool wait);
+    void dispatch_handed_over
+    (
+        const std::string & bytes,
+        const std::string & url
+    );
+    void stop_shards ();
+    void queue_value (const std::string & path, float v);
+    void send_value (const std::string & path, float v);
+    void send_gated
+    (
+        const std::string & path, float v,
+        output_gate & gate, const parameter_limits & pl,
+        bool feedback
+    );
+    void reset_gate (output_gate & gate);
+    output_gate * find_gate (const std::string & path, bool feedback);
+    int flush_held ();
+    void flush_if_due () const;
+    bool run_epoll () const;
+    void run_polling () const;
     void (* m_peer_signal_callback)(osc::signal *,  osc::signal::state, void *);
     void * m_peer_signal_userdata;
 
 public:
 
     void send_feedback (const std::string &path, float v);
+    void batching (bool flag, int flushms = 0);
+
+    bool batching () const
+    {
+        return m_batching;
+    }
+
+    int flush_interval () const
+    {
+        return m_flush_interval_ms;
+    }
+
+    int flush () const;
     void learn (const std::string &path);
 
 #if defined USE_OLD_CODE
@@ -335,6 +556,29 @@ public:
         void * user_data                            = nullptr,
         const std::string & argument_description    = ""
     );
+
+    using lowrapper::add_typed_method;
+
+    /**
+     *  Adds a typed handler, as lowrapper::add_typed_method() does, and
+     *  lists it with its argument description, as add_method() does, so
+     *  that a directory query shows it.
+     */
+
+    template <auto F>
+    bool add_typed_method
+    (
+        osc::tag t,
+        typename typed_handler<F>::object_type * object,
+        const std::string & argument_description
+    )
+    {
+        bool result = lowrapper::add_typed_method<F>(t, object);
+        if (result)
+            result = not_nullptr(list_method(t, argument_description));
+
+        return result;
+    }
     signal * add_signal
     (
         const std::string & path,
@@ -348,12 +592,39 @@ public:
     void del_method (const std::string & path, const std::string & typespec);
     void del_method (method * method);
 #endif
-    void start ();
+    void start (const thread_attributes & attr = thread_attributes());
+    bool start_sharded
+    (
+        int receivers,
+        const thread_attributes & attr = thread_attributes()
+    );
     void stop ();
+
+    int receivers () const
+    {
+        return 1 + int(m_shards.size());
+    }
+
+    /**
+     *  Queues a command to run in the endpoint thread, the next time it
+     *  dispatches messages. Safe to call from any thread.
+     */
+
+    void post (mailbox::command c)
+    {
+        stats().queue_depth
+        (
+            metric_queue::mailbox, m_mailbox.post(std::move(c))
+        );
+    }
+
     int port () const;
     void check () const;
     void wait (int timeout ) const;
     void run () const;
+    int dispatch_ready (int maxcount = 0) const;
+    int next_timeout (int timeout = (-1)) const;
+    void wakeup () const;
 
     void name (const std::string & name)
     {
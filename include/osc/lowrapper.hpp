@@ -31,7 +31,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-26
- * \updates       2025-04-24
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -58,16 +58,30 @@
  *          -   Virtual functions for extensibility.
  *          -   send() functions for a number of type-specifications
  *              (e.g. "sis" for "/error" messages).
+ *          -   A per-thread osc::msgbuilder, used by the send() functions
+ *              for "", "i", "f", "s", "ss", and "sss" to serialize the
+ *              message without allocation and send it with one sendto(2)
+ *              on the server's UDP socket. They fall back to liblo for
+ *              other protocols or if that fails.
+ *          -   An optional receive budget (messages and/or microseconds)
+ *              that limits how much one wait dispatches, so that a flood
+ *              of messages cannot starve the caller.
  */
 
+#include <atomic>                       /* std::atomic<>                    */
 #include <map>
 #include <string>
+#include <string_view>                  /* std::string_view                 */
+#include <vector>                       /* std::vector<> container          */
 
 #include "cpp_types.hpp"                /* lib66::tokenization              */
 #include "platform_macros.h"            /* PLATFORM_CLANG                   */
 #include "nsm/nsmmessagesex.hpp"        /* nsm66::nsm new message functions */
 #include "osc/messages.hpp"             /* osc::tag, etc.                   */
+#include "osc/metrics.hpp"              /* osc::metrics                     */
+#include "osc/msgbuilder.hpp"           /* osc::msgbuilder                  */
 #include "osc/osc_value.hpp"            /* osc::osc_value_list              */
+#include "osc/typedmethod.hpp"          /* osc::typed_handler<> template    */
 
 #include "nsm66-config.h"               /* feature (HAVE) macros            */
 #if defined NSM66_HAVE_LO_H
@@ -165,6 +179,23 @@ using method_handler = int (*)
     void * userdata
 );
 
+/**
+ *  The largest message that a TCP server made by lowrapper::init()
+ *  accepts. liblo's default is 32 KB, the same as for datagrams; over a
+ *  stream it can be raised, so that long replies are not refused.
+ */
+
+const int c_tcp_max_msg_size = 1024 * 1024;
+
+/**
+ *  The largest batch made by lowrapper::send_batched(). A datagram batch
+ *  stays well under liblo's 32 KB receive buffer (and the 64 KB UDP
+ *  limit); a stream batch is bounded by c_tcp_max_msg_size.
+ */
+
+const std::size_t c_datagram_batch_bytes = 16 * 1024;
+const std::size_t c_stream_batch_bytes = 256 * 1024;
+
 /**
  *  Provides functionality that is useful in the most common operations in
  *  the NSM.
@@ -213,6 +244,33 @@ private:
 
     bool m_active;
 
+    /**
+     *  The receive budget used by receive_ready(): the most messages, and
+     *  the most microseconds, to spend dispatching in one call. Zero means
+     *  no limit.
+     */
+
+    int m_budget_messages;
+
+    int m_budget_us;
+
+    /**
+     *  How many times the budget ran out with messages still waiting, and
+     *  whether messages were still waiting after the last receive_ready().
+     *  Atomic so that other threads can read them.
+     */
+
+    mutable std::atomic<unsigned long> m_budget_exhausted;
+
+    mutable std::atomic<bool> m_receive_pending;
+
+    /**
+     *  The counters of this object; see stats(). Mutable, as they are
+     *  updated by const functions such as receive_ready(), and are atomic.
+     */
+
+    mutable metrics m_metrics;
+
 public:
 
     lowrapper ();
@@ -248,6 +306,56 @@ public:
         method_handler f,
         void * userdata = nullptr
     );
+
+    /**
+     *  Adds a typed handler, the member function F of the object, for the
+     *  message of a tag; see typedmethod.hpp. Fails if the function's
+     *  parameters do not fit the tag's pattern.
+     */
+
+    template <auto F>
+    bool add_typed_method
+    (
+        osc::tag t, typename typed_handler<F>::object_type * object
+    )
+    {
+        std::string message, pattern;
+        const char * spec = typed_handler<F>::typespec();
+        bool result = typed_method_check(t, spec, message, pattern);
+        if (result)
+        {
+            result = not_nullptr
+            (
+                lo_server_add_method
+                (
+                    server(), message.c_str(), spec,
+                    &typed_handler<F>::call, object
+                )
+            );
+        }
+        return result;
+    }
+
+    /**
+     *  Adds a typed handler for a path that has no tag.
+     */
+
+    template <auto F>
+    bool add_typed_method
+    (
+        const std::string & path,
+        typename typed_handler<F>::object_type * object
+    )
+    {
+        return not_nullptr
+        (
+            lo_server_add_method
+            (
+                server(), path.c_str(), typed_handler<F>::typespec(),
+                &typed_handler<F>::call, object
+            )
+        );
+    }
     void error_send (const std::string & errmsg, int errcode);
     void error_send
     (
@@ -277,6 +385,39 @@ public:
         m_active = f;
     }
 
+    int socket_fd () const;
+    void receive_budget (int maxmessages, int maxus = 0);
+
+    int budget_messages () const
+    {
+        return m_budget_messages;
+    }
+
+    int budget_us () const
+    {
+        return m_budget_us;
+    }
+
+    unsigned long budget_exhausted () const
+    {
+        return m_budget_exhausted;
+    }
+
+    bool receive_pending () const
+    {
+        return m_receive_pending;
+    }
+
+    /**
+     *  The message counters, failure counts, queue depths, and latency
+     *  histograms. Any thread can read them or add to them.
+     */
+
+    metrics & stats () const
+    {
+        return m_metrics;
+    }
+
 public:         /* send() functions */
 
     /*
@@ -385,6 +526,22 @@ public:         /* send() functions */
     (
         lo_address to, const std::string & path, lo_message msg
     );
+    int send_to_all     /* lo msg, serialized once  */
+    (
+        const std::vector<lo_address> & dests,
+        const std::string & path, lo_message msg
+    );
+    int send_to_all     /* "f", built once          */
+    (
+        const std::vector<lo_address> & dests,
+        const std::string & path, float v
+    );
+    int send_batched    /* "ii" + "s"..., in batches */
+    (
+        lo_address to, const std::string & path,
+        const lib66::tokenization & items,
+        std::size_t maxbytes = 0
+    );
     int send    /* "ssifff" */
     (
         lo_address to, const std::string & path,
@@ -430,6 +587,27 @@ public:         /* send() functions */
     (
         lo_address to, const std::string & path, long v
     );
+    int send_strings    /* "", "s", "ss", "sss" */
+    (
+        lo_address to, const std::string & path, const std::string & types,
+        const std::string & v1 = "",
+        const std::string & v2 = "",
+        const std::string & v3 = ""
+    );
+
+protected:
+
+    static msgbuilder & thread_builder ();
+    int receive_ready
+    (
+        lo_server srv, int maxcount = 0, bool stopifinactive = false
+    ) const;
+    int send_built (lo_address to, const msgbuilder & mb);
+    int send_raw
+    (
+        lo_address to, const char * data, std::size_t size,
+        tag t = tag::illegal
+    );
 
 protected:      /* virtual functions    */
 
@@ -522,11 +700,28 @@ protected:
  *--------------------------------------------------------------------------*/
 
 extern std::string extract_port_number (const std::string & portspec);
+extern bool is_osc_url (const std::string & url);
+extern int url_protocol (const std::string & url);
+extern std::string unix_socket_path (const std::string & url);
+extern std::string unix_url (const std::string & path);
+extern std::string make_unix_socket_path ();
+extern std::size_t batch_end
+(
+    const lib66::tokenization & items,
+    std::size_t first,
+    std::size_t pathlength,
+    std::size_t maxbytes
+);
+extern std::string address_url (lo_address a);
+extern std::string numeric_address_url (lo_address a);
+extern lo_address message_source (lo_message msg);
+extern void message_source_override (lo_address a);
 extern void osc_msg_summary
 (
-    const std::string & funcname,
-    const std::string & path, const char * types,
-    lo_arg ** argv, int argc, void * userdata
+    const char * funcname,
+    const char * path, const char * types,
+    lo_arg ** argv, int argc, void * userdata,
+    lo_message msg = nullptr
 );
 extern void process_announce
 (
@@ -551,6 +746,17 @@ string_from_lo_arg (const lo_arg * arg)
     return std::string(&arg->s);
 }
 
+/**
+ *  The same, but without the copy. The view is good only while the
+ *  lo_message is, that is, for the duration of the handler.
+ */
+
+inline std::string_view
+view_from_lo_arg (const lo_arg * arg)
+{
+    return std::string_view(&arg->s);
+}
+
 inline int
 osc_msg_handled ()
 {
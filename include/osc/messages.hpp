@@ -10,7 +10,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom
  * \date          2025-02-12
- * \updates       2025-04-23
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -21,6 +21,8 @@
 
 #include <map>                          /* std::map dictionary class        */
 #include <string>                       /* std::string class                */
+#include <unordered_map>                /* std::unordered_map hash table    */
+#include <unordered_set>                /* std::unordered_set hash set      */
 
 #include "cpp_types.hpp"                /* lib66::tokenization vector       */
 
@@ -175,6 +177,8 @@ enum class tag
     proxyupdate,        // proxy
     reply,              // used by many, signal has no args
     replyex,            // another variation
+    replylist,          // nsm66 extension, batched session list reply
+    replystats,         // nsm66 extension, rows of the metrics snapshot
     sessionlist,        // server, session, signal
     sessionname,        // gui/session, session
     sessionroot,        // gui/session
@@ -193,12 +197,14 @@ enum class tag
     srvclose,           // server
     srvduplicate,       // server
     srvlist,            // server, session, signal
+    srvlistbatch,       // nsm66 extension, asks for replylist batches
     srvmessage,         // client, gui/client, gui/server
     srvnew,             // server, was called "new" (C++ keyword)
     srvopen,            // client, server
     srvquit,            // server
     srvreply,           // another variation, see the nsmctl app
     srvsave,            // client, gui/client, server
+    stats,              // nsm66 extension, asks for replystats rows
     stripbynumber,      // non
     illegal             // indicates some kind of lookup error
 };
@@ -226,6 +232,22 @@ using lookup = std::map<tag, messagepair>;
 
 using taglist = std::vector<tag>;
 
+/**
+ *  A hashed set of tags, for O(1) membership tests of a tag in a category
+ *  of messages (e.g. client versus server messages).
+ */
+
+using tagset = std::unordered_set<tag>;
+
+/**
+ *  A hashed inverse index of the message table. The key is built from the
+ *  message (path) and the pattern (typespec); see make_index_key() in
+ *  messages.cpp. Only the first (lowest) tag for any key is stored, so
+ *  that the index yields the same tag as a linear scan of the table.
+ */
+
+using reverse_index = std::unordered_map<std::string, tag>;
+
 /*
  *  Free functions for inverse table lookup.
  */
@@ -245,6 +267,11 @@ extern bool tag_lookup
     const taglist & tl,
     tag t, std::string & message, std::string & pattern
 );
+extern bool tag_lookup
+(
+    const tagset & ts,
+    tag t, std::string & message, std::string & pattern
+);
 extern const std::string & tag_message (tag t);
 extern tag tag_reverse_lookup
 (
@@ -257,6 +284,7 @@ extern tag tag_reverse_lookup
     const std::string & message,
     const std::string & pattern = "?"
 );
+extern tag tag_reverse_lookup (const char * message, const char * pattern);
 
 /**
  *  This type is used for lookup up some of the tags so that the user
@@ -278,6 +306,13 @@ using tagspec = struct
 
 using tagmap = std::map<std::string, tagspec>;
 
+/**
+ *  A hashed version of the tagmap, used for the name lookups.  The
+ *  ordered tagmap is still used for listing the actions alphabetically.
+ */
+
+using tagindex = std::unordered_map<std::string, tagspec>;
+
 /*
  *  Free function to convert a string to a client/server tag name.
  */
@@ -30,15 +30,22 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-10-27
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
- *   To do.
+ *  The method_trie holds an endpoint's methods in a radix trie keyed by
+ *  the OSC path. Each node has the methods (one per typespec) whose path
+ *  ends there. Lookups are done on std::string_view, and a prefix query
+ *  (a peer browsing "/some/directory/") visits only the subtree under the
+ *  prefix.
  */
 
 #include <list>
+#include <memory>                       /* std::unique_ptr<>                */
 #include <string>
+#include <string_view>                  /* std::string_view                 */
+#include <vector>                       /* std::vector<>                    */
 
 #include "cpp_types.hpp"                /* CSTR() inline function           */
 
@@ -96,6 +103,18 @@ public:
     }
 
     method () = default;
+    method
+    (
+        const std::string & path,
+        const std::string & typespec,
+        const std::string & documentation = ""
+    ) :
+        m_path          (path),
+        m_typespec      (typespec),
+        m_documentation (documentation)
+    {
+        // no code
+    }
     method (const method &) = delete;
     method & operator = (const method &) = delete;
     ~method () = default;
@@ -108,6 +127,100 @@ public:
 
 using method_list = std::list<method *>;
 
+/**
+ *  A radix trie of methods, keyed by path, with the methods for the
+ *  different typespecs of a path at its node. The trie owns the methods,
+ *  and deletes them when they are removed.
+ */
+
+class method_trie
+{
+
+private:
+
+    /**
+     *  A node's label is the part of the path between its parent and
+     *  itself. The children are kept sorted by the first character of
+     *  their labels, which differ.
+     */
+
+    struct node
+    {
+        std::string n_label;
+        std::vector<std::unique_ptr<node>> n_children;
+        std::vector<method *> n_methods;
+    };
+
+    node m_root;
+
+    std::size_t m_count;
+
+public:
+
+    method_trie ();
+    method_trie (const method_trie &) = delete;
+    method_trie & operator = (const method_trie &) = delete;
+    ~method_trie ();
+
+    void insert (method * m);
+    method * find (std::string_view path, std::string_view typespec) const;
+    bool remove (std::string_view path, std::string_view typespec);
+    bool remove (method * m);
+    void clear ();
+
+    std::size_t size () const
+    {
+        return m_count;
+    }
+
+    bool empty () const
+    {
+        return m_count == 0;
+    }
+
+    /**
+     *  Calls f(const method &) for each method whose path starts with the
+     *  prefix, in path order. An empty prefix visits all of the methods.
+     */
+
+    template <typename F>
+    void for_each_prefix (std::string_view prefix, F && f) const
+    {
+        const node * n = prefix_node(prefix);
+        if (n != nullptr)
+            visit(*n, f);
+    }
+
+    template <typename F>
+    void for_each (F && f) const
+    {
+        visit(m_root, f);
+    }
+
+private:
+
+    template <typename F>
+    static void visit (const node & n, F & f)
+    {
+        for (const method * m : n.n_methods)
+            f(*m);
+
+        for (const auto & c : n.n_children)
+            visit(*c, f);
+    }
+
+    const node * find_node (std::string_view path) const;
+    const node * prefix_node (std::string_view prefix) const;
+    bool remove_from
+    (
+        node & n, std::string_view path,
+        std::string_view typespec, const method * target
+    );
+    static void delete_methods (node & n);
+    static std::size_t child_index (const node & n, char c);
+
+};          // class method_trie
+
 }           // namespace osc
 
 #endif      // NSM66_OSC_METHOD_HPP
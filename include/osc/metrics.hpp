@@ -0,0 +1,306 @@
+#if ! defined NSM66_OSC_METRICS_HPP
+#define NSM66_OSC_METRICS_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          metrics.hpp
+ *
+ *    This module provides the always-on counters of an OSC endpoint or NSM
+ *    client: message and byte counts per tag, failures, queue depths, and
+ *    latency histograms.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Each osc::lowrapper (and so each endpoint and nsmbase) has a metrics
+ *  object; see lowrapper::stats(). All of the updates are relaxed atomic
+ *  increments, with no locks, so that they can stay on in production and
+ *  be read from any thread. A snapshot() is not a consistent cut across
+ *  the counters, but each value in it is exact.
+ *
+ *  Unlike the trace (see osc/trace.hpp), which keeps the latest events,
+ *  the metrics keep totals since the start (or the last reset()).
+ *
+ *  The incoming messages are counted by osc_msg_summary(), which every
+ *  handler calls. It counts them in the metrics bound to the receiving
+ *  thread by a metrics::scope, as done by lowrapper::receive_ready().
+ *
+ *  The snapshot can also be asked for over OSC: endpoint answers
+ *  "/nsm66/stats" (osc::tag::stats) from a known peer with a bundle of
+ *  "/nsm66/reply/stats" messages.
+ */
+
+#include <atomic>                       /* std::atomic<>                    */
+#include <cstdint>                      /* std::uint64_t, std::int64_t      */
+#include <string>                       /* std::string class                */
+#include <vector>                       /* std::vector<> container          */
+
+#include "osc/messages.hpp"             /* osc::tag enumeration             */
+
+namespace osc
+{
+
+/**
+ *  The queues whose depths are tracked. The depth is set by the code that
+ *  pushes to the queue, and the largest depth seen is kept.
+ */
+
+enum class metric_queue
+{
+    values,             /**< endpoint::queue_value(), coalesced values. */
+    mailbox,            /**< endpoint::post(), commands for the thread. */
+    commands,           /**< nsmclient session commands.                */
+    count               /**< The number of queues, not a queue.         */
+};
+
+/**
+ *  One line of a metrics snapshot. The meaning of the two values depends
+ *  on the kind:
+ *
+ *      -   "in", "out": name is the OSC path; the messages and the bytes.
+ *      -   "counter": the value, and 0.
+ *      -   "queue": the current and the largest depth.
+ *      -   "handler_us", "ping_us": name is "count" (count, sum), "max"
+ *          (max, 0), or "le_N" for a histogram bucket (the number of
+ *          samples in (N/2, N] microseconds, and N). The counts are per
+ *          bucket, not cumulative; "le_1" also holds the zeroes, and the
+ *          last bucket, "le_inf", holds everything above the one before.
+ */
+
+struct metric_row
+{
+    std::string mr_kind;
+    std::string mr_name;
+    std::int64_t mr_a;
+    std::int64_t mr_b;
+};
+
+using metric_rows = std::vector<metric_row>;
+
+/**
+ *  A histogram of times in microseconds with power-of-2 buckets: bucket 0
+ *  holds 0 and 1 us, bucket n holds up to 2^n us, and the last bucket
+ *  holds everything larger.
+ */
+
+class histogram
+{
+
+public:
+
+    static const int c_buckets = 24;    /* the last one is over 4 seconds   */
+
+private:
+
+    std::atomic<std::uint64_t> m_buckets[c_buckets];
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+
+public:
+
+    histogram ();
+
+    histogram (const histogram &) = delete;
+    histogram & operator = (const histogram &) = delete;
+
+    void record (std::uint64_t us);
+    void reset ();
+    std::uint64_t percentile (double fraction) const;
+    static int bucket_of (std::uint64_t us);
+
+    static std::uint64_t bucket_limit (int b)
+    {
+        return std::uint64_t(1) << b;
+    }
+
+    std::uint64_t bucket (int b) const
+    {
+        return b >= 0 && b < c_buckets ?
+            m_buckets[b].load(std::memory_order_relaxed) : 0 ;
+    }
+
+    std::uint64_t count () const
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t sum () const
+    {
+        return m_sum.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max () const
+    {
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+};          // class histogram
+
+/**
+ *  The counters of one endpoint or NSM client.
+ */
+
+class metrics
+{
+
+public:
+
+    /**
+     *  Binds a metrics object to the calling thread for the life of the
+     *  scope, so that osc_msg_summary() can count what the thread
+     *  receives. Scopes nest; the previous binding is restored.
+     */
+
+    class scope
+    {
+
+    private:
+
+        metrics * m_previous;
+
+    public:
+
+        scope (metrics * m);
+        ~scope ();
+
+        scope (const scope &) = delete;
+        scope & operator = (const scope &) = delete;
+
+    };      // class scope
+
+private:
+
+    /**
+     *  The number of tags, so that the counters can be indexed by tag.
+     *  Messages with an unknown path are counted under tag::illegal.
+     */
+
+    static const int c_tag_count = static_cast<int>(tag::illegal) + 1;
+
+    struct tag_counters
+    {
+        std::atomic<std::uint64_t> tc_in_messages;
+        std::atomic<std::uint64_t> tc_in_bytes;
+        std::atomic<std::uint64_t> tc_out_messages;
+        std::atomic<std::uint64_t> tc_out_bytes;
+    };
+
+    struct gauge
+    {
+        std::atomic<std::uint64_t> g_current;
+        std::atomic<std::uint64_t> g_max;
+    };
+
+    tag_counters m_tags[c_tag_count];
+    std::atomic<std::uint64_t> m_send_failures;
+    std::atomic<std::uint64_t> m_unhandled;
+    gauge m_queues[static_cast<int>(metric_queue::count)];
+    histogram m_handler_latency;
+    histogram m_ping_rtt;
+
+public:
+
+    metrics ();
+
+    metrics (const metrics &) = delete;
+    metrics & operator = (const metrics &) = delete;
+
+    static metrics * current ();
+    static metrics * bind (metrics * m);
+    static tag path_tag (const char * path);
+
+    void received (tag t, std::uint64_t bytes);
+    void sent (tag t, std::uint64_t bytes);
+    void queue_depth (metric_queue q, std::size_t depth);
+    void reset ();
+    metric_rows snapshot () const;
+
+    void received (const char * path, std::uint64_t bytes)
+    {
+        received(path_tag(path), bytes);
+    }
+
+    void sent (const char * path, std::uint64_t bytes)
+    {
+        sent(path_tag(path), bytes);
+    }
+
+    void send_failed ()
+    {
+        m_send_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unhandled ()
+    {
+        m_unhandled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void handler_time (std::uint64_t us)
+    {
+        m_handler_latency.record(us);
+    }
+
+    void ping_rtt (std::uint64_t us)
+    {
+        m_ping_rtt.record(us);
+    }
+
+    std::uint64_t received_messages (tag t) const;
+    std::uint64_t received_bytes (tag t) const;
+    std::uint64_t sent_messages (tag t) const;
+    std::uint64_t sent_bytes (tag t) const;
+    std::uint64_t queue_max (metric_queue q) const;
+
+    std::uint64_t send_failures () const
+    {
+        return m_send_failures.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t unhandled_count () const
+    {
+        return m_unhandled.load(std::memory_order_relaxed);
+    }
+
+    const histogram & handler_latency () const
+    {
+        return m_handler_latency;
+    }
+
+    const histogram & ping_times () const
+    {
+        return m_ping_rtt;
+    }
+
+};          // class metrics
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_METRICS_HPP
+
+/*
+ * metrics.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,232 @@
+#if ! defined NSM66_OSC_MSGBUILDER_HPP
+#define NSM66_OSC_MSGBUILDER_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          msgbuilder.hpp
+ *
+ *    This module provides a reusable buffer for serializing OSC messages
+ *    without the allocations done by lo_message_new() and friends.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The msgbuilder serializes an OSC message (path, type-tag string, and
+ *  the arguments) directly into its buffer, in OSC wire format. The buffer
+ *  only grows, so once it has been used for the largest message, further
+ *  use does not allocate. It supports the 'i', 'f', and 's' types, which
+ *  cover the common NSM messages; anything else must go through liblo.
+ *
+ *  See the lowrapper class, which keeps one of these per thread.
+ *
+ *  A msgtemplate holds the serialized path and type-tag string of a
+ *  message that is sent often, such as "/nsm/client/progress" + "f". Then
+ *  msgbuilder::start(const msgtemplate &) copies that header and only the
+ *  arguments remain to be added. See nsmbase::client_template(). The
+ *  template also carries its tag, which the builder passes on, so that a
+ *  send can count the message in the metrics without looking up the path.
+ */
+
+#include <cstdint>                      /* std::int32_t, std::uint32_t      */
+#include <string>                       /* std::string class                */
+#include <vector>                       /* std::vector<> container          */
+
+#include "osc/messages.hpp"             /* osc::tag enumeration             */
+
+namespace osc
+{
+
+/**
+ *  The path, type-tag string, and serialized header of one kind of message,
+ *  made once. A template is valid only if the message can be built by
+ *  msgbuilder, i.e. if the types are all 'i', 'f', or 's'.
+ */
+
+class msgtemplate
+{
+
+private:
+
+    std::string m_path;
+    std::string m_types;
+    std::vector<char> m_header;
+    tag m_tag { tag::illegal };
+
+public:
+
+    msgtemplate () = default;
+    msgtemplate
+    (
+        const std::string & path,
+        const std::string & types,
+        tag t = tag::illegal
+    );
+
+    bool valid () const
+    {
+        return ! m_header.empty();
+    }
+
+    const std::string & path () const
+    {
+        return m_path;
+    }
+
+    const std::string & types () const
+    {
+        return m_types;
+    }
+
+    tag message_tag () const
+    {
+        return m_tag;
+    }
+
+    const char * header () const
+    {
+        return m_header.data();
+    }
+
+    std::size_t header_size () const
+    {
+        return m_header.size();
+    }
+
+};          // class msgtemplate
+
+/**
+ *  Serializes one OSC message at a time into a reusable buffer.
+ *  Usage:
+ *
+\verbatim
+        msgbuilder mb;
+        if (mb.start("/nsm/client/label", "s") && mb.add_string("Label"))
+            send(mb.data(), mb.size());
+\endverbatim
+ */
+
+class msgbuilder
+{
+
+private:
+
+    /**
+     *  The buffer, sized to the largest message so far. Its size is not
+     *  the size of the message; see m_size.
+     */
+
+    std::vector<char> m_buffer;
+
+    /**
+     *  The number of bytes of the current message.
+     */
+
+    std::size_t m_size;
+
+    /**
+     *  The type-tag string given to start(), and the index in it of the
+     *  next argument to add. This lets the add functions check that the
+     *  arguments match the types.
+     */
+
+    const char * m_types;
+
+    std::size_t m_next_type;
+
+    /**
+     *  False if start() was not called, or if an argument did not match
+     *  the type-tag string.
+     */
+
+    bool m_valid;
+
+    /**
+     *  The tag of the template given to start(), else tag::illegal.
+     */
+
+    tag m_tag;
+
+public:
+
+    msgbuilder (std::size_t reserve = 512);
+
+    bool start (const char * path, const char * types);
+    bool start (const msgtemplate & mt);
+    bool add_int32 (std::int32_t v);
+    bool add_float (float v);
+    bool add_string (const char * s);
+
+    bool add_string (const std::string & s)
+    {
+        return add_string(s.c_str());
+    }
+
+    /**
+     *  True if the message started correctly and all of the arguments
+     *  named in the type-tag string have been added.
+     */
+
+    bool complete () const
+    {
+        return m_valid && m_types[m_next_type] == 0;
+    }
+
+    const char * data () const
+    {
+        return m_buffer.data();
+    }
+
+    tag message_tag () const
+    {
+        return m_tag;
+    }
+
+    std::size_t size () const
+    {
+        return m_size;
+    }
+
+    std::size_t capacity () const
+    {
+        return m_buffer.size();
+    }
+
+private:
+
+    bool next_type (char t);
+    char * reserve (std::size_t count);
+    void append_padded (const char * s);
+    void append_32 (std::uint32_t v);
+
+};          // class msgbuilder
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_MSGBUILDER_HPP
+
+/*
+ * msgbuilder.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
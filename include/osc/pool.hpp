@@ -0,0 +1,304 @@
+#if ! defined NSM66_OSC_POOL_HPP
+#define NSM66_OSC_POOL_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          pool.hpp
+ *
+ *    This module provides a pool allocator with stable addresses and
+ *    handles, for the objects owned by an endpoint.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The pool allocates its slots in chunks, which never move, so a pointer
+ *  to a pooled object stays valid until the object is destroyed. The
+ *  objects of a chunk are next to each other in memory, so walking them
+ *  touches far fewer cache lines than walking objects allocated one by
+ *  one. Freed slots are reused, most recently freed first.
+ *
+ *  A pool_handle names a slot and the generation of the object in it.
+ *  Each destroy() bumps the generation, so get() returns null for the
+ *  handle of an object that is gone, even if its slot has been reused.
+ *
+ *  The pool destroys any objects left in it when it is destroyed.
+ */
+
+#include <cstddef>                      /* std::size_t                      */
+#include <cstdint>                      /* std::uint32_t                    */
+#include <memory>                       /* std::unique_ptr<>                */
+#include <new>                          /* placement new, std::nothrow      */
+#include <utility>                      /* std::forward<>()                 */
+#include <vector>                       /* std::vector<> container          */
+
+namespace osc
+{
+
+/**
+ *  Identifies an object in a pool. The generation is never 0 for a handle
+ *  obtained from the pool, so a default handle is invalid.
+ */
+
+struct pool_handle
+{
+    std::uint32_t ph_index;
+    std::uint32_t ph_generation;
+
+    pool_handle () :
+        ph_index        (0),
+        ph_generation   (0)
+    {
+        // no code
+    }
+
+    pool_handle (std::uint32_t index, std::uint32_t generation) :
+        ph_index        (index),
+        ph_generation   (generation)
+    {
+        // no code
+    }
+
+    bool valid () const
+    {
+        return ph_generation != 0;
+    }
+};
+
+/**
+ *  A pool of objects of type T, allocated ChunkSize at a time.
+ */
+
+template <typename T, std::size_t ChunkSize = 64>
+class pool
+{
+
+private:
+
+    static const std::uint32_t c_none = 0xFFFFFFFF;
+
+    /**
+     *  The storage for one object. It must stay the first member, so that
+     *  a pointer to the object is also a pointer to its slot.
+     */
+
+    struct slot
+    {
+        alignas(T) unsigned char s_storage[sizeof(T)];
+        std::uint32_t s_index;
+        std::uint32_t s_generation;
+        std::uint32_t s_next_free;
+        bool s_live;
+    };
+
+    std::vector<std::unique_ptr<slot []>> m_chunks;
+
+    std::uint32_t m_free;
+
+    std::size_t m_count;
+
+public:
+
+    pool () :
+        m_chunks    (),
+        m_free      (c_none),
+        m_count     (0)
+    {
+        // no code
+    }
+
+    pool (const pool &) = delete;
+    pool & operator = (const pool &) = delete;
+
+    ~pool ()
+    {
+        clear();
+    }
+
+    /**
+     *  Constructs an object in a free slot, adding a chunk if there is no
+     *  free slot. The arguments are passed to the constructor of T.
+     *
+     * \return
+     *      Returns a pointer to the new object, or null if a chunk could
+     *      not be allocated.
+     */
+
+    template <typename ... Args>
+    T * create (Args && ... args)
+    {
+        if (m_free == c_none && ! add_chunk())
+            return nullptr;
+
+        slot & s = at(m_free);
+        m_free = s.s_next_free;
+
+        T * result = new (s.s_storage) T(std::forward<Args>(args)...);
+        s.s_live = true;
+        ++m_count;
+        return result;
+    }
+
+    /**
+     *  Destroys an object created by this pool, and frees its slot.
+     *  A null pointer is ignored.
+     */
+
+    void destroy (T * p)
+    {
+        if (p == nullptr)
+            return;
+
+        slot * s = reinterpret_cast<slot *>(p);
+        if (s->s_live)
+        {
+            p->~T();
+            s->s_live = false;
+            if (++s->s_generation == 0)
+                s->s_generation = 1;
+
+            s->s_next_free = m_free;
+            m_free = s->s_index;
+            --m_count;
+        }
+    }
+
+    /**
+     *  Gets the handle of an object created by this pool.
+     */
+
+    pool_handle handle (const T * p) const
+    {
+        if (p == nullptr)
+            return pool_handle();
+
+        const slot * s = reinterpret_cast<const slot *>(p);
+        return pool_handle(s->s_index, s->s_generation);
+    }
+
+    /**
+     *  Gets the object named by a handle.
+     *
+     * \return
+     *      Returns null if the handle is invalid, or if its object has been
+     *      destroyed.
+     */
+
+    T * get (pool_handle h) const
+    {
+        if (! h.valid() || h.ph_index >= capacity())
+            return nullptr;
+
+        slot & s = at(h.ph_index);
+        if (! s.s_live || s.s_generation != h.ph_generation)
+            return nullptr;
+
+        return reinterpret_cast<T *>(s.s_storage);
+    }
+
+    /**
+     *  Calls f(T &) for each live object, in slot order.
+     */
+
+    template <typename F>
+    void for_each (F && f)
+    {
+        for (auto & c : m_chunks)
+        {
+            for (std::size_t i = 0; i < ChunkSize; ++i)
+            {
+                if (c[i].s_live)
+                    f(*reinterpret_cast<T *>(c[i].s_storage));
+            }
+        }
+    }
+
+    /**
+     *  Destroys all of the objects. The chunks are kept for reuse.
+     */
+
+    void clear ()
+    {
+        for (auto & c : m_chunks)
+        {
+            for (std::size_t i = 0; i < ChunkSize; ++i)
+            {
+                if (c[i].s_live)
+                    destroy(reinterpret_cast<T *>(c[i].s_storage));
+            }
+        }
+    }
+
+    std::size_t size () const
+    {
+        return m_count;
+    }
+
+    std::size_t capacity () const
+    {
+        return m_chunks.size() * ChunkSize;
+    }
+
+private:
+
+    slot & at (std::uint32_t index) const
+    {
+        return m_chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    /**
+     *  Allocates a chunk and puts its slots on the free list, lowest index
+     *  first.
+     */
+
+    bool add_chunk ()
+    {
+        std::unique_ptr<slot []> c(new (std::nothrow) slot[ChunkSize]);
+        if (! c)
+            return false;
+
+        std::uint32_t base = std::uint32_t(capacity());
+        for (std::size_t i = 0; i < ChunkSize; ++i)
+        {
+            c[i].s_index = base + std::uint32_t(i);
+            c[i].s_generation = 1;
+            c[i].s_live = false;
+            c[i].s_next_free = i + 1 < ChunkSize ?
+                base + std::uint32_t(i + 1) : m_free ;
+        }
+        m_chunks.push_back(std::move(c));
+        m_free = base;
+        return true;
+    }
+
+};          // class pool
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_POOL_HPP
+
+/*
+ * pool.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
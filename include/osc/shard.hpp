@@ -0,0 +1,215 @@
+#if ! defined NSM66_OSC_SHARD_HPP
+#define NSM66_OSC_SHARD_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          shard.hpp
+ *
+ *    This module provides the extra receive threads of a sharded
+ *    osc::endpoint, and the mailbox used to reach them.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  In sharded mode (see endpoint::start_sharded()), the endpoint socket
+ *  and the socket of each shard are bound to the same UDP port with
+ *  SO_REUSEPORT. The kernel picks the socket for a datagram from a hash of
+ *  the sender's address and port, so all of the traffic of a given peer
+ *  goes to the same receive thread.
+ *
+ *  A shard handles the hot traffic itself: messages to a signal path are
+ *  handed to the signal, as the endpoint would do. Senders hash to
+ *  different threads, so the signal's handler lock makes those threads
+ *  take turns.
+ *
+ *  The shard keeps its own table of signals, changed only in its own
+ *  thread, so this needs no locks. Everything else (the /signal/ protocol,
+ *  application methods, translations, learning) is handed over to the
+ *  endpoint thread through the endpoint's mailbox, along with the sender's
+ *  URL; see message_source(). Translations go there too because
+ *  osc_generic() also records the value translated and suppresses its
+ *  feedback (see endpoint::send_feedback()), state that belongs to the
+ *  endpoint thread.
+ *
+ *  Going the other way, the endpoint posts changes to the signal table to
+ *  the mailbox of each shard.
+ *
+ *  Sharding is supported only for UDP, and only on Linux.
+ */
+
+#include <atomic>                       /* std::atomic<bool>                */
+#include <functional>                   /* std::function<>                  */
+#include <map>                          /* std::map<> container             */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
+#include <string>                       /* std::string class                */
+#include <vector>                       /* std::vector<> container          */
+#include <sys/socket.h>                 /* struct sockaddr, socklen_t       */
+#include <lo/lo.h>                      /* lo_server, lo_address, etc.      */
+
+#include "osc/thread.hpp"               /* osc::thread, thread_attributes   */
+
+namespace osc
+{
+
+class endpoint;
+class signal;
+
+/**
+ *  A queue of commands to run in a given thread. Any thread can post(); only
+ *  the owning thread calls drain(). An atomic flag lets drain() return at
+ *  once, without locking, when nothing has been posted, which is nearly
+ *  always.
+ */
+
+class mailbox
+{
+
+public:
+
+    using command = std::function<void ()>;
+
+private:
+
+    mutable std::mutex m_mutex;
+
+    /**
+     *  The commands posted, and the ones being run by drain(). The two are
+     *  swapped, so that their buffers are reused.
+     */
+
+    std::vector<command> m_commands;
+
+    std::vector<command> m_running;
+
+    std::atomic<bool> m_pending;
+
+    /**
+     *  An eventfd(2) written by post(), so that the owning thread wakes up.
+     *  The mailbox does not own it. It is -1 if not used.
+     */
+
+    int m_wake_fd;
+
+public:
+
+    mailbox (int wakefd = (-1));
+
+    void wake_fd (int fd)
+    {
+        m_wake_fd = fd;
+    }
+
+    bool pending () const
+    {
+        return m_pending.load(std::memory_order_acquire);
+    }
+
+    std::size_t post (command c);
+    int drain ();
+
+};          // class mailbox
+
+/**
+ *  One extra receive thread of a sharded endpoint. It owns a liblo server
+ *  whose socket shares the endpoint's port.
+ */
+
+class shard
+{
+
+private:
+
+    using signal_map = std::map<std::string, signal *, std::less<>>;
+
+    endpoint * m_endpoint;
+
+    int m_index;
+
+    lo_server m_server;
+
+    signal_map m_signals;
+
+    int m_wake_fd;
+
+    mailbox m_mailbox;
+
+    thread m_thread;
+
+    std::atomic<bool> m_running;
+
+public:
+
+    shard (endpoint * ep, int index);
+    ~shard ();
+
+    shard (const shard &) = delete;
+    shard & operator = (const shard &) = delete;
+
+    bool open (const struct sockaddr * addr, socklen_t length);
+    bool start (const thread_attributes & attr);
+    void stop ();
+    void post (mailbox::command c);
+    void call (mailbox::command c);
+
+    int index () const
+    {
+        return m_index;
+    }
+
+    bool running () const
+    {
+        return m_running;
+    }
+
+    /*
+     * These are called only in the shard thread, by posted commands. See
+     * endpoint::share_signal() and friends.
+     */
+
+    void add_signal (signal * s);
+    void del_signal (const std::string & path);
+
+private:
+
+    static void * shard_thread (void * arg);
+    static int osc_receive
+    (
+        const char * path, const char * types, lo_arg ** argv, int argc,
+        lo_message msg, void * user_data
+    );
+
+    void run ();
+    void hand_over (const char * path, lo_message msg);
+
+};          // class shard
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_SHARD_HPP
+
+/*
+ * shard.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -30,15 +30,18 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-10-27
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
  *   To do.
  */
 
-#include <list>
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <lo/lo.h>
 
 #include "method.hpp"
@@ -50,24 +53,122 @@ class signal;
 
 using signal_handler = int (*) (float value, void * user_data);
 
+/**
+ *  The range of a signal, and the policies for sending its values to the
+ *  peers. The policies are off (zero) by default:
+ *
+ *      -   pl_deadband: a change smaller than this, from the value last
+ *          sent, is not sent. If pl_relative_deadband is true, it is a
+ *          fraction of the range, pl_max - pl_min.
+ *      -   pl_max_rate: the most values sent per second. A change that
+ *          comes too soon is held, and the latest held value is sent when
+ *          the rate allows it (see endpoint::flush_held()), so the final
+ *          value of a fast sweep is always sent.
+ */
+
 struct parameter_limits
 {
     float pl_min;
     float pl_max;
     float pl_default_value;
+    float pl_deadband;
+    bool pl_relative_deadband;
+    int pl_max_rate;
 };
 
-using signal_list = std::list<signal *>;
+inline bool
+has_output_policy (const parameter_limits & pl)
+{
+    return pl.pl_deadband > 0.0f || pl.pl_max_rate > 0;
+}
+
+/**
+ *  The output state of a signal, or of a translation's feedback, for the
+ *  policies of a parameter_limits. The endpoint locks its held-value mutex
+ *  around all use of it.
+ */
+
+class output_gate
+{
+
+public:
+
+    using clock = std::chrono::steady_clock;
+
+    enum class verdict
+    {
+        send,           /**< Send this value now.                           */
+        hold,           /**< Too soon; it is held for the trailing edge.    */
+        drop            /**< Inside the deadband; do not send it.           */
+    };
+
+private:
+
+    float m_last_sent;
+    float m_held_value;
+    bool m_has_sent;
+    bool m_holding;
+    clock::time_point m_last_time;
+
+public:
+
+    output_gate ();
+
+    verdict offer (const parameter_limits & pl, float v, clock::time_point now);
+    void sent (float v, clock::time_point now);
+    clock::time_point due (const parameter_limits & pl) const;
+    void reset ();
+
+    bool holding () const
+    {
+        return m_holding;
+    }
+
+    float held_value () const
+    {
+        return m_held_value;
+    }
+
+};          // class output_gate
+
+/**
+ *  The signals are pooled (see osc/pool.hpp) or owned by the application,
+ *  so the lists hold only pointers, in a contiguous array.
+ */
+
+using signal_list = std::vector<signal *>;
+
+/**
+ *  A hashed index of signals keyed by the signal path. It is kept alongside
+ *  a signal_list, which still owns the iteration order.
+ */
+
+using signal_index = std::unordered_map<std::string, signal *>;
+
+/**
+ *  The p_addr_key member is the canonical form of p_addr, as made by
+ *  endpoint::address_key(), and is the key in the endpoint's address index.
+ *  The p_signal_index member indexes p_signals by path. Peers are created
+ *  in the endpoint's pool, value-initialized.
+ */
 
 struct peer
 {
     bool p_scanning;
     std::string p_name;             // char * name;
     lo_address p_addr;
+    std::string p_addr_key;
     signal_list p_signals;
+    signal_index p_signal_index;
 };
 
-using peer_list = std::list<peer *>;
+using peer_list = std::vector<peer *>;
+
+/**
+ *  A hashed index of peers, keyed either by name or by address key.
+ */
+
+using peer_index = std::unordered_map<std::string, peer *>;
 
 class signal
 {
@@ -92,13 +193,11 @@ public:
 
 private:
 
-    endpoint * m_endpoint;          // shared or unique?
-
-    peer * m_peer;                  // ditto?
-
-    std::string m_path;             // char * _path;
-
-    std::string m_documentation;    // char * _documentation;
+    /*
+     * The members used for each value come first, so that they share a
+     * cache line. The path string and the rest follow. Descriptions live
+     * in the method trie (see osc::method), away from the signals.
+     */
 
     float m_value;
 
@@ -108,8 +207,25 @@ private:
 
     void * m_user_data;
 
+    /*
+     * In sharded mode, a message to this signal's path can be received by
+     * any shard thread, or by the endpoint thread, depending on the
+     * sender. This lock makes them take turns at the value and the
+     * handler; see endpoint::osc_sig_handler().
+     */
+
+    std::mutex m_handler_mutex;
+
+    endpoint * m_endpoint;          // shared or unique?
+
+    peer * m_peer;                  // ditto?
+
+    std::string m_path;             // char * _path;
+
     parameter_limits m_parameter_limits;
 
+    output_gate m_output_gate;
+
     void (* m_connection_state_callback) (osc::signal *, void *);
 
     void * m_connection_state_userdata;
@@ -126,7 +242,13 @@ public:
     }
 
     void connection_state_callback (callback cb, void * userdata);
-    void set_parameter_limits (float min, float max, float default_value);
+    void set_parameter_limits
+    (
+        float min, float max, float default_value,
+        float deadband          = 0.0f,
+        bool relative           = false,
+        int maxrate             = 0
+    );
 
     const parameter_limits & get_parameter_limits () const
     {
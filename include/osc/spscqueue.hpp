@@ -0,0 +1,198 @@
+#if ! defined NSM66_OSC_SPSCQUEUE_HPP
+#define NSM66_OSC_SPSCQUEUE_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          spscqueue.hpp
+ *
+ *    This module provides a bounded, wait-free, single-producer,
+ *    single-consumer queue.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The spscqueue passes items from one thread (e.g. the OSC server thread)
+ *  to one other thread (e.g. an application's realtime or UI thread)
+ *  without locks. The slots are allocated once, in the constructor. Each
+ *  index is written by only one side: the producer writes the tail and the
+ *  consumer writes the head. The release store of an index, paired with
+ *  the acquire load done by the other side, publishes the slot contents.
+ *
+ *  The indices only increase; the slot is the index masked by the
+ *  capacity, which is a power of 2.
+ */
+
+#include <atomic>                       /* std::atomic<>                    */
+#include <cstddef>                      /* std::size_t                      */
+#include <utility>                      /* std::move()                      */
+#include <vector>                       /* std::vector<> container          */
+
+namespace osc
+{
+
+/**
+ *  A fixed-capacity queue for exactly one producer thread and one consumer
+ *  thread. push() and pop() never block, and the queue does not allocate
+ *  after construction. push() fails if the queue is full, and pop() fails
+ *  if it is empty.
+ *
+ *  The item type must be default-constructible and move-assignable. Note
+ *  that pop() moves an item out of its slot; for std::string members, the
+ *  libstdc++ move-assignment swaps the buffers, so that a consumer reusing
+ *  the same destination object does not free memory.
+ */
+
+template <typename T>
+class spscqueue
+{
+
+private:
+
+    /**
+     *  This value avoids false sharing of the two indices, which are
+     *  written by different threads.
+     */
+
+    static const std::size_t c_cache_line = 64;
+
+    std::vector<T> m_slots;
+
+    std::size_t m_mask;
+
+    /**
+     *  The index of the next item to pop. Written only by the consumer.
+     */
+
+    alignas(c_cache_line) std::atomic<std::size_t> m_head;
+
+    /**
+     *  The index of the next slot to push. Written only by the producer.
+     */
+
+    alignas(c_cache_line) std::atomic<std::size_t> m_tail;
+
+public:
+
+    /**
+     *  Creates the queue.
+     *
+     * \param capacity
+     *      The number of items the queue can hold. It is rounded up to a
+     *      power of 2, and is at least 2.
+     */
+
+    explicit spscqueue (std::size_t capacity = 64) :
+        m_slots (),
+        m_mask  (0),
+        m_head  (0),
+        m_tail  (0)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    spscqueue (const spscqueue &) = delete;
+    spscqueue & operator = (const spscqueue &) = delete;
+
+    std::size_t capacity () const
+    {
+        return m_slots.size();
+    }
+
+    /**
+     *  The number of items waiting. Exact only when called from the
+     *  producer or consumer thread while the other side is idle.
+     */
+
+    std::size_t size () const
+    {
+        return m_tail.load(std::memory_order_acquire) -
+            m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty () const
+    {
+        return size() == 0;
+    }
+
+    /**
+     *  Called only by the producer thread.
+     *
+     * \return
+     *      Returns false if the queue is full; the item is not moved.
+     */
+
+    bool push (T && item)
+    {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t head = m_head.load(std::memory_order_acquire);
+        if (tail - head >= m_slots.size())
+            return false;
+
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push (const T & item)
+    {
+        T copy(item);
+        return push(std::move(copy));
+    }
+
+    /**
+     *  Called only by the consumer thread.
+     *
+     * \return
+     *      Returns false if the queue is empty; the destination is not
+     *      altered.
+     */
+
+    bool pop (T & item)
+    {
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        std::size_t tail = m_tail.load(std::memory_order_acquire);
+        if (head == tail)
+            return false;
+
+        item = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+};          // class spscqueue
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_SPSCQUEUE_HPP
+
+/*
+ * spscqueue.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -30,21 +30,40 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-10-27
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
- *   To do.
+ *  Thread attributes:
+ *
+ *  A thread_attributes structure can be passed to clone(), which applies
+ *  it while creating the thread, or to apply(), which applies it to the
+ *  calling thread. The latter is for threads created elsewhere, such as
+ *  the liblo server thread started by nsmbase::start_thread().
+ *
+ *  A realtime policy (SCHED_FIFO or SCHED_RR) needs the proper privileges
+ *  (e.g. membership in the "audio" group via /etc/security/limits.d). If
+ *  they are lacking, a warning is shown and the thread runs with the
+ *  default policy; the affinity and stack settings are still kept.
+ *
+ *  The affinity mask can be used to keep the OSC thread off the cores
+ *  given to JACK. Locking the stack touches all of its pages and, on
+ *  Linux, mlock()s them, so that the thread does not page-fault later.
+ *  Use a modest stack size with it, as RLIMIT_MEMLOCK is often small.
  */
 
 /*
  * Simple wrapper for pthreads with thread role checking
  */
 
+#include <cstddef>                      /* std::size_t                      */
 #include <pthread.h>                    /* <thread> for std::thread?        */
+#include <sched.h>                      /* SCHED_OTHER, SCHED_FIFO, ...     */
 #include <string>                       /* std::string                      */
+#include <vector>                       /* std::vector<> container          */
 
 #include "cpp_types.hpp"                /* CSTR() inline functions          */
+#include "platform_macros.h"            /* PLATFORM_LINUX macro             */
 
 #if defined USE_THREAD_ASSERT           /* nobody uses this macro           */
 #define THREAD_ASSERT(n) \
@@ -56,6 +75,68 @@
 namespace osc
 {
 
+/**
+ *  Settings for the scheduling, placement, and stack of a thread. The
+ *  defaults leave everything as the system would set it.
+ */
+
+struct thread_attributes
+{
+    /**
+     *  SCHED_OTHER (the default), SCHED_FIFO, or SCHED_RR.
+     */
+
+    int ta_policy;
+
+    /**
+     *  The realtime priority, used only with SCHED_FIFO and SCHED_RR. It
+     *  is clamped to the range allowed for the policy.
+     */
+
+    int ta_priority;
+
+    /**
+     *  The CPUs (numbered from 0) on which the thread may run. Empty means
+     *  any CPU. Ignored on systems without pthread affinity support.
+     */
+
+    std::vector<int> ta_cpus;
+
+    /**
+     *  The stack size in bytes, 0 for the default. It is honored only by
+     *  clone(); apply() cannot change the stack of a running thread.
+     */
+
+    std::size_t ta_stack_size;
+
+    /**
+     *  If true, the stack is pre-faulted and locked into memory.
+     */
+
+    bool ta_lock_stack;
+
+    thread_attributes () :
+        ta_policy       (SCHED_OTHER),
+        ta_priority     (0),
+        ta_cpus         (),
+        ta_stack_size   (0),
+        ta_lock_stack   (false)
+    {
+        // no code
+    }
+
+    bool realtime () const
+    {
+        return ta_policy == SCHED_FIFO || ta_policy == SCHED_RR;
+    }
+
+    bool is_default () const
+    {
+        return ! realtime() && ta_cpus.empty() &&
+            ta_stack_size == 0 && ! ta_lock_stack;
+    }
+};
+
 class thread
 {
     using entry_point = void * (*) (void *);
@@ -65,9 +146,15 @@ class thread
         entry_point td_entry_point;
         void * td_arg;
         void * td_t;
+        bool td_lock_stack;
     };
 
-    static pthread_key_t m_current;
+    /**
+     *  The thread object of the calling thread, set by set() and by the
+     *  clone()d thread. Formerly this was a pthread key.
+     */
+
+    static thread_local thread * sm_current_thread;
 
     pthread_t m_thread;
 
@@ -87,6 +174,10 @@ public:
     static bool is (const std::string & name);
     static void init ();
     static thread * current (void );
+    static bool apply (const thread_attributes & attr);
+    static bool set_scheduling (int policy, int priority);
+    static bool set_affinity (const std::vector<int> & cpus);
+    static bool lock_stack ();
 
     const char * name_pointer () const
     {
@@ -116,13 +207,26 @@ public:
         return m_running;
     }
 
-    bool clone (entry_point ep, void * arg);
+    bool clone
+    (
+        entry_point ep, void * arg,
+        const thread_attributes & attr = thread_attributes()
+    );
     void clear_thread ();
     void detach ();
     void join ();
     void cancel ();
     void exit (void * retval = nullptr);
 
+private:
+
+    int create
+    (
+        thread_data * td,
+        const thread_attributes & attr,
+        bool withsched
+    );
+
 };
 
 }           // namespace osc
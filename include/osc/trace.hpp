@@ -0,0 +1,143 @@
+#if ! defined NSM66_OSC_TRACE_HPP
+#define NSM66_OSC_TRACE_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          trace.hpp
+ *
+ *    This module provides a binary trace of OSC messages, kept in a
+ *    lock-free ring buffer per thread.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Formatting a line of text for every OSC message is too slow to leave on
+ *  in production. Instead, each message is recorded as a small fixed-size
+ *  trace_event in a ring owned by the thread that handles the message.
+ *  Only that thread writes its ring, so recording is a few stores and one
+ *  atomic release; nothing is locked and nothing is allocated.
+ *
+ *  The rings can be copied out on demand (trace_snapshot()), written to a
+ *  file (trace_dump()), or written by a crash handler (see
+ *  trace_install_crash_dump()). The binary dump is turned into text later
+ *  by trace_read() and trace_format().
+ *
+ *  Tracing is built in only if NSM66_USE_TRACE is defined (the meson
+ *  "trace" option), and is then switched on and off at run time by
+ *  trace_enable(). When it is not built in, the functions do nothing.
+ */
+
+#include <cstdint>                      /* std::uint32_t, std::uint64_t     */
+#include <string>                       /* std::string class                */
+#include <vector>                       /* std::vector<> container          */
+
+#include <lo/lo.h>                      /* lo_address, lo_message           */
+
+#include "osc/messages.hpp"             /* osc::tag enumeration             */
+
+namespace osc
+{
+
+/**
+ *  The direction of a traced message.
+ */
+
+enum class trace_dir : std::uint8_t
+{
+    in,                 /**< Received and handled by this process.      */
+    out                 /**< Sent by this process.                      */
+};
+
+/**
+ *  One traced message. The layout is fixed, since it is also the layout
+ *  of the events in a dump file. The thread number is the index of the
+ *  ring that recorded the event.
+ */
+
+struct trace_event
+{
+    std::uint64_t te_time_ns;           /**< Monotonic clock, nanoseconds.  */
+    std::uint32_t te_peer;              /**< Hash of the peer's host/port.  */
+    std::uint32_t te_bytes;             /**< Size of the OSC message.       */
+    std::uint32_t te_duration_us;       /**< Handler time, incoming only.   */
+    std::uint16_t te_tag;               /**< The osc::tag, or "illegal".    */
+    std::uint8_t te_direction;          /**< A trace_dir value.             */
+    std::uint8_t te_thread;             /**< Index of the recording ring.   */
+};
+
+static_assert(sizeof(trace_event) == 24, "trace_event must be 24 bytes");
+
+/**
+ *  The number of events kept per thread (a power of 2), and the maximum
+ *  number of threads that can trace at the same time.
+ */
+
+const std::size_t c_trace_ring_size = 4096;
+const std::size_t c_trace_max_rings = 32;
+
+/*
+ *  Free functions.
+ */
+
+extern bool trace_compiled ();
+extern bool trace_enabled ();
+extern void trace_enable (bool flag);
+extern std::uint64_t trace_clock ();
+extern std::uint32_t trace_peer (lo_address a);
+extern void trace_record
+(
+    trace_dir direction, tag t,
+    std::uint32_t peer, std::uint32_t bytes,
+    std::uint32_t durationus = 0
+);
+extern void trace_record
+(
+    trace_dir direction,
+    const char * path, const char * types,
+    lo_address peer, std::uint32_t bytes
+);
+extern void trace_finish ();
+extern void trace_reset ();
+extern std::vector<trace_event> trace_snapshot ();
+extern bool trace_dump (int fd);
+extern bool trace_dump (const std::string & filename);
+extern bool trace_install_crash_dump (const std::string & filename);
+extern bool trace_read
+(
+    const std::string & filename,
+    std::vector<trace_event> & events,
+    std::string & errmsg
+);
+extern std::string trace_format (const trace_event & ev);
+extern std::string trace_format (const std::vector<trace_event> & events);
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_TRACE_HPP
+
+/*
+ * trace.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,307 @@
+#if ! defined NSM66_OSC_TYPEDMETHOD_HPP
+#define NSM66_OSC_TYPEDMETHOD_HPP
+
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          typedmethod.hpp
+ *
+ *    This module provides OSC handlers whose arguments are decoded at
+ *    compile time, from the parameter types of a member function.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  A normal handler gets (path, types, argv, argc, msg, userdata), and has
+ *  to check the types and pick apart argv itself. A typed handler is a
+ *  member function taking the arguments as C++ values:
+ *
+\verbatim
+        bool myclass::on_label (std::string_view label);
+
+        lw.add_typed_method<&myclass::on_label>(osc::tag::clilabel, this);
+\endverbatim
+ *
+ *  The typespec ("s" here) is made at compile time from the parameter
+ *  types, and a liblo handler (typed_handler<F>::call()) is generated that
+ *  checks the message and calls the member function. The arguments are
+ *  decoded in place: strings are std::string_view (or const char *) into
+ *  the message, so nothing is allocated. If the first parameter is a
+ *  "const message_info &", it gets the path, types, and message, for
+ *  handlers that need the sender or the path.
+ *
+ *  The parameter types and their OSC types:
+ *
+ *      -   std::string_view, const char *: 's'
+ *      -   std::int32_t (int): 'i'
+ *      -   std::int64_t: 'h'
+ *      -   float: 'f'
+ *      -   double: 'd'
+ *
+ *  The return type can be bool (false means "not handled", so that liblo
+ *  tries the next handler), int (returned to liblo as is), or void
+ *  (always handled).
+ *
+ *  C++17 does not allow a string literal as a template argument
+ *  (add_typed_method<"ss">), so the typespec comes from the function.
+ *  Typed handlers can be mixed freely with add_osc_method() and the
+ *  OSC_HANDLER() macros.
+ */
+
+#include <cstdint>                      /* std::int32_t, std::int64_t       */
+#include <cstring>                      /* std::strcmp()                    */
+#include <string_view>                  /* std::string_view                 */
+#include <tuple>                        /* std::tuple, std::tuple_element_t */
+#include <type_traits>                  /* std::is_same_v, std::decay_t     */
+#include <utility>                      /* std::index_sequence              */
+
+#include <lo/lo.h>                      /* lo_arg, lo_message               */
+
+#include "osc/messages.hpp"             /* osc::tag enumeration             */
+
+namespace osc
+{
+
+/**
+ *  What a typed handler can ask for, besides its arguments.
+ */
+
+struct message_info
+{
+    const char * mi_path;
+    const char * mi_types;
+    lo_message mi_msg;
+};
+
+/**
+ *  The OSC type and the decoding of each supported parameter type. Any
+ *  other parameter type fails to compile.
+ */
+
+template <typename T>
+struct arg_traits;
+
+template <>
+struct arg_traits<std::string_view>
+{
+    static constexpr char c_type = 's';
+
+    static std::string_view decode (lo_arg * a)
+    {
+        return std::string_view(&a->s);
+    }
+};
+
+template <>
+struct arg_traits<const char *>
+{
+    static constexpr char c_type = 's';
+
+    static const char * decode (lo_arg * a)
+    {
+        return &a->s;
+    }
+};
+
+template <>
+struct arg_traits<std::int32_t>
+{
+    static constexpr char c_type = 'i';
+
+    static std::int32_t decode (lo_arg * a)
+    {
+        return a->i;
+    }
+};
+
+template <>
+struct arg_traits<std::int64_t>
+{
+    static constexpr char c_type = 'h';
+
+    static std::int64_t decode (lo_arg * a)
+    {
+        return a->h;
+    }
+};
+
+template <>
+struct arg_traits<float>
+{
+    static constexpr char c_type = 'f';
+
+    static float decode (lo_arg * a)
+    {
+        return a->f;
+    }
+};
+
+template <>
+struct arg_traits<double>
+{
+    static constexpr char c_type = 'd';
+
+    static double decode (lo_arg * a)
+    {
+        return a->d;
+    }
+};
+
+/**
+ *  The OSC arguments of a handler: its parameters, less a leading
+ *  message_info. Provides the typespec as a constexpr string.
+ */
+
+template <typename... Args>
+struct typed_args
+{
+    static constexpr bool c_has_info = false;
+    static constexpr int c_count = int(sizeof...(Args));
+    static constexpr char c_typespec [sizeof...(Args) + 1] =
+    {
+        arg_traits<std::decay_t<Args>>::c_type..., 0
+    };
+
+    using types = std::tuple<std::decay_t<Args>...>;
+};
+
+template <typename... Args>
+struct typed_args<const message_info &, Args...> : typed_args<Args...>
+{
+    static constexpr bool c_has_info = true;
+};
+
+/*
+ *  Free functions used by the generated handlers, defined in
+ *  typedmethod.cpp.
+ */
+
+extern void typed_method_summary
+(
+    const char * path, const char * types,
+    lo_arg ** argv, int argc, lo_message msg, void * userdata
+);
+extern bool typed_method_check
+(
+    tag t, const char * typespec,
+    std::string & message, std::string & pattern
+);
+
+/**
+ *  The generated liblo handler for the member function F. Only member
+ *  functions are supported: the userdata given at registration is the
+ *  object.
+ */
+
+template <auto F>
+struct typed_handler;
+
+template <typename C, typename R, typename... Args, R (C::* F)(Args...)>
+struct typed_handler<F>
+{
+    using object_type = C;
+    using args = typed_args<Args...>;
+
+    static constexpr const char * typespec ()
+    {
+        return args::c_typespec;
+    }
+
+    /**
+     *  The handler given to liblo. Returns 0 (handled) or -1 (not
+     *  handled), as osc_msg_handled() and osc_msg_unhandled() do.
+     */
+
+    static int call
+    (
+        const char * path, const char * types,
+        lo_arg ** argv, int argc, lo_message msg, void * userdata
+    )
+    {
+        C * object = static_cast<C *>(userdata);
+        bool ok = object != nullptr && argc == args::c_count &&
+            (types == nullptr ?
+                args::c_count == 0 : std::strcmp(types, typespec()) == 0);
+
+        if (! ok)
+            return (-1);
+
+        typed_method_summary(path, types, argv, argc, msg, userdata);
+
+        message_info info { path, types, msg };
+        using indices = std::make_index_sequence<std::size_t(args::c_count)>;
+        if constexpr (std::is_void_v<R>)
+        {
+            apply(object, info, argv, indices{});
+            return 0;
+        }
+        else if constexpr (std::is_same_v<R, bool>)
+        {
+            return apply(object, info, argv, indices{}) ? 0 : (-1);
+        }
+        else
+        {
+            return int(apply(object, info, argv, indices{}));
+        }
+    }
+
+private:
+
+    template <std::size_t... I>
+    static R apply
+    (
+        C * object, const message_info & info,
+        lo_arg ** argv, std::index_sequence<I...>
+    )
+    {
+        using T = typename args::types;
+        (void) argv;
+        if constexpr (args::c_has_info)
+        {
+            return (object->*F)
+            (
+                info,
+                arg_traits<std::tuple_element_t<I, T>>::decode(argv[I])...
+            );
+        }
+        else
+        {
+            (void) info;
+            return (object->*F)
+            (
+                arg_traits<std::tuple_element_t<I, T>>::decode(argv[I])...
+            );
+        }
+    }
+
+};          // struct typed_handler
+
+}           // namespace osc
+
+#endif      // NSM66_OSC_TYPEDMETHOD_HPP
+
+/*
+ * typedmethod.hpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
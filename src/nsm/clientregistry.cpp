@@ -0,0 +1,265 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          clientregistry.cpp
+ *
+ *    This module stores the clients of an nsmcontroller densely, with
+ *    hashed indices.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ */
+
+#include "nsm/clientregistry.hpp"       /* nsm::clientregistry class        */
+
+namespace nsm
+{
+
+clientregistry::clientregistry () :
+    m_clients       (),
+    m_handles       (),
+    m_slots         (),
+    m_free_handles  (),
+    m_by_id         (),
+    m_by_name       ()
+{
+    // no code
+}
+
+/**
+ *  Adds a client.
+ *
+ * \param c
+ *      The client to move into the registry. Its ID must not already be
+ *      registered.
+ *
+ * \return
+ *      Returns the handle of the new client, or c_no_handle if the ID is
+ *      empty or already registered.
+ */
+
+clientregistry::handle
+clientregistry::add (nsmctlclient && c)
+{
+    const std::string id = c.client_id();
+    if (id.empty() || m_by_id.find(id) != m_by_id.end())
+        return c_no_handle;
+
+    handle h;
+    if (m_free_handles.empty())
+    {
+        h = handle(m_slots.size());
+        m_slots.push_back(-1);
+    }
+    else
+    {
+        h = m_free_handles.back();
+        m_free_handles.pop_back();
+    }
+    m_slots[h] = int(m_clients.size());
+    m_handles.push_back(h);
+    m_clients.push_back(std::move(c));
+    m_by_id.emplace(id, h);
+
+    const std::string & name = m_clients.back().client_name();
+    if (! name.empty())
+        (void) m_by_name.emplace(name, h);      /* keeps the first, if any  */
+
+    return h;
+}
+
+/**
+ *  Removes a client. The last client is moved into its slot, so only that
+ *  client's slot number changes; no handle changes.
+ */
+
+bool
+clientregistry::remove (handle h)
+{
+    int s = slot(h);
+    bool result = s >= 0;
+    if (result)
+    {
+        std::string id = m_clients[s].client_id();
+        std::string name = m_clients[s].client_name();
+        int last = int(m_clients.size()) - 1;
+        if (s != last)
+        {
+            m_clients[s] = std::move(m_clients[last]);
+            m_handles[s] = m_handles[last];
+            m_slots[m_handles[s]] = s;
+        }
+        m_clients.pop_back();
+        m_handles.pop_back();
+        m_slots[h] = -1;
+        m_free_handles.push_back(h);
+        m_by_id.erase(id);
+
+        auto n = m_by_name.find(name);
+        if (n != m_by_name.end() && n->second == h)
+        {
+            m_by_name.erase(n);
+            reindex_name(name);
+        }
+    }
+    return result;
+}
+
+void
+clientregistry::clear ()
+{
+    m_clients.clear();
+    m_handles.clear();
+    m_slots.clear();
+    m_free_handles.clear();
+    m_by_id.clear();
+    m_by_name.clear();
+}
+
+clientregistry::handle
+clientregistry::find_id (const std::string & id) const
+{
+    auto i = m_by_id.find(id);
+    return i != m_by_id.end() ? i->second : c_no_handle ;
+}
+
+clientregistry::handle
+clientregistry::find_name (const std::string & name) const
+{
+    auto n = m_by_name.find(name);
+    return n != m_by_name.end() ? n->second : c_no_handle ;
+}
+
+nsmctlclient *
+clientregistry::get (handle h)
+{
+    int s = slot(h);
+    return s >= 0 ? &m_clients[s] : nullptr ;
+}
+
+const nsmctlclient *
+clientregistry::get (handle h) const
+{
+    int s = slot(h);
+    return s >= 0 ? &m_clients[s] : nullptr ;
+}
+
+/**
+ *  Changes the ID of a client, as done by /nsm/gui/client/switch, keeping
+ *  the ID index in step.
+ *
+ * \return
+ *      Returns false if the handle is bad or the new ID belongs to another
+ *      client.
+ */
+
+bool
+clientregistry::client_id (handle h, const std::string & id)
+{
+    int s = slot(h);
+    if (s < 0 || id.empty())
+        return false;
+
+    nsmctlclient & c = m_clients[s];
+    if (c.client_id() == id)
+        return true;
+
+    if (m_by_id.find(id) != m_by_id.end())
+        return false;
+
+    m_by_id.erase(c.client_id());
+    m_by_id.emplace(id, h);
+    c.client_id(id);
+    return true;
+}
+
+/**
+ *  Changes the name of a client, keeping the name index in step.
+ */
+
+bool
+clientregistry::client_name (handle h, const std::string & name)
+{
+    int s = slot(h);
+    if (s < 0)
+        return false;
+
+    nsmctlclient & c = m_clients[s];
+    std::string oldname = c.client_name();
+    if (oldname == name)
+        return true;
+
+    c.name(name);
+
+    auto n = m_by_name.find(oldname);
+    if (n != m_by_name.end() && n->second == h)
+    {
+        m_by_name.erase(n);
+        reindex_name(oldname);
+    }
+    if (! name.empty())
+        (void) m_by_name.emplace(name, h);
+
+    return true;
+}
+
+int
+clientregistry::slot (handle h) const
+{
+    if (h < 0 || h >= handle(m_slots.size()))
+        return (-1);
+
+    return m_slots[h];
+}
+
+/**
+ *  After the client that held a name in the index goes away, another client
+ *  with that name, if any, takes its place. This is an O(n) scan, done on
+ *  every removal or renaming of the client that holds the name, whether
+ *  or not another client shares it. Names are rarely duplicated, so no
+ *  per-name count is kept to skip the scan.
+ */
+
+void
+clientregistry::reindex_name (const std::string & name)
+{
+    if (name.empty())
+        return;
+
+    for (std::size_t s = 0; s < m_clients.size(); ++s)
+    {
+        if (m_clients[s].client_name() == name)
+        {
+            m_by_name.emplace(name, m_handles[s]);
+            break;
+        }
+    }
+}
+
+}           // namespace nsm
+
+/*
+ * clientregistry.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,464 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          daemonregistry.cpp
+ *
+ *    This module lists, checks, prunes, and writes the daemon files.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See daemonregistry.hpp for the format of a daemon file.
+ */
+
+#include <cctype>                       /* std::isdigit()                   */
+#include <cerrno>                       /* errno, EWOULDBLOCK               */
+#include <csignal>                      /* kill(2)                          */
+#include <cstdint>                      /* std::uint32_t                    */
+#include <cstdlib>                      /* std::strtol(), std::atoll()      */
+#include <dirent.h>                     /* opendir(3), readdir(3)           */
+#include <fcntl.h>                      /* open(2), O_RDONLY                */
+#include <fstream>                      /* std::ifstream                    */
+#include <sys/file.h>                   /* flock(2)                         */
+#include <unistd.h>                     /* getpid(), unlink(2), close(2)    */
+
+#include "platform_macros.h"            /* PLATFORM_LINUX                   */
+#include "nsm/daemonregistry.hpp"       /* nsm::daemonregistry class        */
+#include "nsm/helpers.hpp"              /* nsm::write_file_atomically()     */
+#include "util/filefunctions.hpp"       /* util::get_xdg_runtime_directory  */
+#include "util/msgfunctions.hpp"        /* util::error_message()            */
+
+#if defined PLATFORM_LINUX
+#include <sys/inotify.h>                /* inotify_init1(2)                 */
+#endif
+
+namespace nsm
+{
+
+namespace
+{
+
+const char * const s_lock_marker = "flock";
+
+bool
+all_digits (const char * name)
+{
+    if (*name == 0)
+        return false;
+
+    for ( ; *name != 0; ++name)
+    {
+        if (! std::isdigit(static_cast<unsigned char>(*name)))
+            return false;
+    }
+    return true;
+}
+
+}           // namespace (anonymous)
+
+daemonregistry::daemonregistry (const std::string & directory) :
+    m_directory     (directory.empty() ? default_directory() : directory),
+    m_daemons       (),
+    m_stale_files   (),
+    m_dirty         (true),
+    m_inotify_fd    (-1),
+    m_own_file      (),
+    m_own_fd        (-1)
+{
+#if defined PLATFORM_LINUX
+    if (! m_directory.empty())
+    {
+        m_inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotify_fd >= 0)
+        {
+            const std::uint32_t mask = IN_CREATE | IN_DELETE |
+                IN_MOVED_TO | IN_MOVED_FROM | IN_CLOSE_WRITE |
+                IN_DELETE_SELF | IN_MOVE_SELF;
+
+            int wd = ::inotify_add_watch
+            (
+                m_inotify_fd, m_directory.c_str(), mask
+            );
+            if (wd < 0)
+            {
+                (void) ::close(m_inotify_fd);     /* e.g. no directory yet    */
+                m_inotify_fd = (-1);
+            }
+        }
+    }
+#endif
+}
+
+daemonregistry::~daemonregistry ()
+{
+    unregister_self();
+    if (m_inotify_fd >= 0)
+        (void) ::close(m_inotify_fd);
+}
+
+std::string
+daemonregistry::default_directory ()
+{
+    return util::get_xdg_runtime_directory("nsm", "d");
+}
+
+/**
+ *  Gets the name of the daemon file of this process, "<directory>/<pid>".
+ *
+ * \param directory
+ *      The daemon directory. If empty, default_directory() is used.
+ *
+ * \return
+ *      Returns the file name, or an empty string if there is no runtime
+ *      directory.
+ */
+
+std::string
+daemonregistry::pid_file_name (const std::string & directory)
+{
+    std::string dir = directory.empty() ? default_directory() : directory ;
+    std::string result;
+    if (! dir.empty())
+        result = dir + "/" + std::to_string(int(::getpid()));
+
+    return result;
+}
+
+/**
+ *  The start time recorded for this process. It is taken at the first
+ *  call, which in a daemon happens at startup, when the lock file or the
+ *  daemon file is written.
+ */
+
+std::time_t
+daemonregistry::start_time ()
+{
+    static const std::time_t s_start_time = std::time(nullptr);
+    return s_start_time;
+}
+
+/**
+ *  Reads a daemon file. Only the URL is required; the PID defaults to the
+ *  name of the file.
+ *
+ * \return
+ *      Returns false if the file cannot be read or does not start with an
+ *      OSC URL.
+ */
+
+bool
+daemonregistry::read_entry (const std::string & filename, daemon_info & info)
+{
+    std::ifstream file(filename);
+    std::string line;
+    if (! file || ! std::getline(file, line))
+        return false;
+
+    std::string_view url = trim_view(line);
+    if (url.substr(0, 3) != "osc")
+        return false;
+
+    info.di_file = filename;
+    info.di_url = std::string(url);
+    info.di_pid = 0;
+    info.di_start_time = 0;
+    info.di_locked = false;
+
+    std::string::size_type slash = filename.find_last_of('/');
+    std::string base = slash == std::string::npos ?
+        filename : filename.substr(slash + 1) ;
+
+    info.di_pid = pid_t(std::strtol(base.c_str(), nullptr, 10));
+    if (std::getline(file, line))
+    {
+        long pid = std::strtol(line.c_str(), nullptr, 10);
+        if (pid > 0)
+            info.di_pid = pid_t(pid);
+
+        if (std::getline(file, line))
+        {
+            info.di_start_time = std::time_t(std::atoll(line.c_str()));
+            if (std::getline(file, line))
+                info.di_locked = trim_view(line) == s_lock_marker;
+        }
+    }
+    return true;
+}
+
+/**
+ *  Checks that the daemon of an entry is running.
+ *
+ * \param info
+ *      The entry.
+ *
+ * \param checklock
+ *      If true, and the entry says the daemon holds a lock, the lock is
+ *      tested; this is definite, even if the PID has been reused. If
+ *      false, or there is no lock, kill(pid, 0) is used. EPERM from it
+ *      means the process exists but is not ours.
+ */
+
+bool
+daemonregistry::alive (const daemon_info & info, bool checklock)
+{
+    if (checklock && info.di_locked)
+    {
+        bool result = false;
+        int fd = ::open(info.di_file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            if (::flock(fd, LOCK_SH | LOCK_NB) != 0)
+                result = errno == EWOULDBLOCK;      /* the daemon holds it  */
+            else
+                (void) ::flock(fd, LOCK_UN);        /* nobody holds it      */
+
+            (void) ::close(fd);
+        }
+        return result;
+    }
+    if (info.di_pid <= 0)
+        return false;
+
+    return ::kill(info.di_pid, 0) == 0 || errno == EPERM;
+}
+
+/**
+ *  Drains the inotify events, if any.
+ *
+ * \return
+ *      Returns true if the directory may have changed since the last scan.
+ */
+
+bool
+daemonregistry::changed ()
+{
+    if (m_dirty || m_inotify_fd < 0)
+        return true;
+
+    bool result = false;
+#if defined PLATFORM_LINUX
+    char buffer[4096];
+    for (;;)
+    {
+        ssize_t rc = ::read(m_inotify_fd, buffer, sizeof buffer);
+        if (rc <= 0)
+            break;
+
+        result = true;
+    }
+#endif
+    return result;
+}
+
+/**
+ *  Reads the directory. Only files named by a PID are looked at; anything
+ *  else there is left alone. A file is stale only if its daemon is known
+ *  to be gone. A file that cannot be parsed may be one that a daemon is
+ *  still writing (nsmd does not write it atomically), so it is stale only
+ *  if the PID in its name is not running; otherwise it is skipped until
+ *  the next scan.
+ */
+
+void
+daemonregistry::scan ()
+{
+    m_daemons.clear();
+    m_stale_files.clear();
+    DIR * dir = m_directory.empty() ? nullptr : ::opendir(m_directory.c_str());
+    if (dir == nullptr)
+        return;
+
+    while (const struct dirent * de = ::readdir(dir))
+    {
+        if (! all_digits(de->d_name))
+            continue;
+
+        daemon_info info;
+        std::string fname = m_directory + "/" + de->d_name;
+        if (read_entry(fname, info))
+        {
+            if (alive(info))
+                m_daemons.push_back(info);
+            else
+                m_stale_files.push_back(fname);
+        }
+        else
+        {
+            info.di_file = fname;
+            info.di_pid = pid_t(std::strtol(de->d_name, nullptr, 10));
+            info.di_locked = false;
+            if (! alive(info, false))
+                m_stale_files.push_back(fname);
+        }
+    }
+    (void) ::closedir(dir);
+}
+
+/**
+ *  Brings the list up to date. The directory is read only if it changed
+ *  (or there is no inotify watch); otherwise the cached daemons are
+ *  checked with kill(pid, 0), and those that are gone become stale.
+ *
+ * \param force
+ *      If true, the directory is read regardless.
+ *
+ * \return
+ *      Returns true if the directory was read.
+ */
+
+bool
+daemonregistry::refresh (bool force)
+{
+    if (force || changed())
+    {
+        scan();
+        m_dirty = false;
+        return true;
+    }
+
+    auto d = m_daemons.begin();
+    while (d != m_daemons.end())
+    {
+        if (alive(*d, false))
+        {
+            ++d;
+        }
+        else
+        {
+            m_stale_files.push_back(d->di_file);
+            d = m_daemons.erase(d);
+        }
+    }
+    return false;
+}
+
+const daemonregistry::daemon_list &
+daemonregistry::daemons ()
+{
+    (void) refresh();
+    return m_daemons;
+}
+
+/**
+ *  Deletes the files of the daemons that are gone.
+ *
+ * \return
+ *      Returns the number of files deleted.
+ */
+
+int
+daemonregistry::prune ()
+{
+    int result = 0;
+    (void) refresh();
+    for (const auto & f : m_stale_files)
+    {
+        if (f != m_own_file && ::unlink(f.c_str()) == 0)
+            ++result;
+    }
+    m_stale_files.clear();
+    return result;
+}
+
+/**
+ *  Gets the URL of the live daemon started most recently, which is the
+ *  likeliest one for a new client to want.
+ */
+
+std::string
+daemonregistry::newest_url ()
+{
+    const daemon_info * newest = nullptr;
+    for (const auto & d : daemons())
+    {
+        if (newest == nullptr || d.di_start_time > newest->di_start_time)
+            newest = &d;
+    }
+    return newest != nullptr ? newest->di_url : std::string("") ;
+}
+
+/**
+ *  Writes the daemon file of this process and holds a lock on it for as
+ *  long as this object (or the process) lives. The lock is taken before
+ *  the file appears, so no reader can find it unlocked.
+ *
+ * \param url
+ *      The OSC URL of the daemon.
+ */
+
+bool
+daemonregistry::register_self (const std::string & url)
+{
+    unregister_self();
+    if (m_directory.empty() || ! util::make_directory_path(m_directory, 0771))
+    {
+        util::error_message("Cannot create daemon directory", m_directory);
+        return false;
+    }
+
+    std::string fname = pid_file_name(m_directory);
+    std::string data = url + "\n" + std::to_string(int(::getpid())) + "\n" +
+        std::to_string(start_time()) + "\n" + s_lock_marker + "\n";
+
+    std::string errmsg;
+    int fd = (-1);
+    bool result = write_file_atomically(fname, data, errmsg, &fd);
+    if (result)
+    {
+        m_own_file = fname;
+        m_own_fd = fd;
+        m_dirty = true;
+    }
+    else
+        util::error_message("Cannot write daemon file", errmsg);
+
+    return result;
+}
+
+/**
+ *  Removes the daemon file of this process, then releases the lock.
+ */
+
+void
+daemonregistry::unregister_self ()
+{
+    if (! m_own_file.empty())
+    {
+        (void) ::unlink(m_own_file.c_str());
+        m_own_file.clear();
+        m_dirty = true;
+    }
+    if (m_own_fd >= 0)
+    {
+        (void) ::close(m_own_fd);
+        m_own_fd = (-1);
+    }
+}
+
+}           // namespace nsm
+
+/*
+ * daemonregistry.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
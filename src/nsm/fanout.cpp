@@ -0,0 +1,396 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          fanout.cpp
+ *
+ *    This module tracks a command sent to many clients at once.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See the fanout.hpp module.
+ */
+
+#include "nsm/fanout.hpp"               /* nsm::fanout class                */
+#include "util/strfunctions.hpp"        /* util::string_asprintf(), V()     */
+
+namespace nsm
+{
+
+fanout::fanout () :
+    m_command       (osc::tag::null),
+    m_started       (false),
+    m_start_time    (),
+    m_deadline      (),
+    m_entries       ()
+{
+    // no code
+}
+
+/**
+ *  Starts a new fan-out, forgetting the previous one.
+ *
+ * \param cmd
+ *      The command sent, such as osc::tag::guisave.
+ *
+ * \param t
+ *      The time just before the first send.
+ *
+ * \param timeoutms
+ *      How long every client has to answer.
+ */
+
+void
+fanout::start (osc::tag cmd, clock::time_point t, int timeoutms)
+{
+    m_command = cmd;
+    m_started = true;
+    m_start_time = t;
+    m_deadline = t + std::chrono::milliseconds(timeoutms > 0 ? timeoutms : 1);
+    m_entries.clear();
+}
+
+void
+fanout::add (const std::string & id, const std::string & name)
+{
+    m_entries.push_back
+    (
+        entry { id, name, state::pending, 0.0f, clock::time_point() }
+    );
+}
+
+/**
+ *  Decides if a client status sent by nsmd answers a command.
+ *
+ * \param cmd
+ *      The command.
+ *
+ * \param s
+ *      The status, as sent in /nsm/gui/client/status.
+ *
+ * \param [out] success
+ *      Set to false if the status is an error.
+ *
+ * \return
+ *      Returns true if the status ends the command for the client.
+ */
+
+bool
+fanout::answers (osc::tag cmd, const std::string & s, bool & success)
+{
+    bool result = true;
+    success = true;
+    if (s == "error")
+    {
+        success = false;
+    }
+    else
+    {
+        switch (cmd)
+        {
+            case osc::tag::guisave:
+            case osc::tag::guidirty:
+            case osc::tag::guiresume:
+
+                result = s == "ready";
+                break;
+
+            case osc::tag::guistop:
+
+                result = s == "stopped";
+                break;
+
+            case osc::tag::guiremove:
+
+                result = s == "removed";
+                break;
+
+            default:
+
+                result = false;
+                break;
+        }
+    }
+    return result;
+}
+
+/**
+ *  Handles a /nsm/gui/client/status message.
+ *
+ * \return
+ *      Returns true if the status finished a pending client.
+ */
+
+bool
+fanout::status
+(
+    const std::string & id,
+    const std::string & s,
+    clock::time_point t
+)
+{
+    bool success;
+    entry * e = find(id);
+    bool result = not_nullptr(e) && answers(m_command, s, success);
+    if (result)
+        result = finish(*e, success ? state::done : state::failed, t);
+
+    return result;
+}
+
+/**
+ *  Handles a /nsm/gui/client/visible message, which answers show and hide.
+ */
+
+bool
+fanout::visible (const std::string & id, clock::time_point t)
+{
+    bool result = false;
+    if (m_command == osc::tag::guishow || m_command == osc::tag::guihide)
+    {
+        entry * e = find(id);
+        if (not_nullptr(e))
+            result = finish(*e, state::done, t);
+    }
+    return result;
+}
+
+bool
+fanout::progress (const std::string & id, float p)
+{
+    entry * e = find(id);
+    bool result = not_nullptr(e) && e->fe_state == state::pending;
+    if (result)
+        e->fe_progress = p < 0.0f ? 0.0f : (p > 1.0f ? 1.0f : p) ;
+
+    return result;
+}
+
+/**
+ *  Follows a client whose ID was changed by /nsm/gui/client/switch.
+ */
+
+bool
+fanout::client_switch (const std::string & id, const std::string & newid)
+{
+    entry * e = find(id);
+    bool result = not_nullptr(e);
+    if (result)
+        e->fe_client_id = newid;
+
+    return result;
+}
+
+/**
+ *  Expires the clients that are still pending at the deadline.
+ *
+ * \return
+ *      Returns the number of clients newly expired.
+ */
+
+int
+fanout::expire (clock::time_point t)
+{
+    int result = 0;
+    if (t >= m_deadline)
+    {
+        for (auto & e : m_entries)
+        {
+            if (finish(e, state::expired, t))
+                ++result;
+        }
+    }
+    return result;
+}
+
+/**
+ *  The progress of the whole fan-out, from 0 to 1. A client that has
+ *  answered (or expired) counts as 1; a pending client counts as the
+ *  progress it last reported.
+ */
+
+float
+fanout::total_progress () const
+{
+    if (m_entries.empty())
+        return m_started ? 1.0f : 0.0f ;
+
+    float total = 0.0f;
+    for (const auto & e : m_entries)
+        total += e.fe_state == state::pending ? e.fe_progress : 1.0f ;
+
+    return total / float(m_entries.size());
+}
+
+int
+fanout::count (state s) const
+{
+    int result = 0;
+    for (const auto & e : m_entries)
+    {
+        if (e.fe_state == s)
+            ++result;
+    }
+    return result;
+}
+
+/**
+ *  The time from the start to the answer of a client, or -1 if the client
+ *  did not answer.
+ */
+
+long
+fanout::latency_us (const entry & e) const
+{
+    if (e.fe_state == state::done || e.fe_state == state::failed)
+    {
+        auto d = e.fe_done_time - m_start_time;
+        return long
+        (
+            std::chrono::duration_cast<std::chrono::microseconds>(d).count()
+        );
+    }
+    return (-1);
+}
+
+/**
+ *  The time from the start to the last answer (or expiry), which is the
+ *  time the whole command took. While clients are pending, it is the time
+ *  so far.
+ */
+
+long
+fanout::elapsed_us () const
+{
+    clock::time_point last = m_start_time;
+    if (active())
+        last = clock::now();
+    else
+    {
+        for (const auto & e : m_entries)
+        {
+            if (e.fe_done_time > last)
+                last = e.fe_done_time;
+        }
+    }
+    return long
+    (
+        std::chrono::duration_cast<std::chrono::microseconds>
+        (
+            last - m_start_time
+        ).count()
+    );
+}
+
+/**
+ *  The client that held up the command: the first expired one, if any,
+ *  otherwise the one that answered last.
+ */
+
+const fanout::entry *
+fanout::slowest () const
+{
+    const entry * result = nullptr;
+    long worst = (-1);
+    for (const auto & e : m_entries)
+    {
+        if (e.fe_state == state::expired)
+            return &e;
+
+        long us = latency_us(e);
+        if (us > worst)
+        {
+            worst = us;
+            result = &e;
+        }
+    }
+    return result;
+}
+
+/**
+ *  A one-line summary, for the log.
+ */
+
+std::string
+fanout::report () const
+{
+    std::string result = util::string_asprintf
+    (
+        "%s to %d clients: %d done, %d failed, %d expired, %ld ms",
+        V(osc::tag_message(m_command)), int(m_entries.size()),
+        count(state::done), count(state::failed), count(state::expired),
+        elapsed_us() / 1000
+    );
+    const entry * e = slowest();
+    if (not_nullptr(e))
+    {
+        long us = latency_us(*e);
+        result += "; slowest " + e->fe_client_name + " (" +
+            e->fe_client_id + ") " +
+            (us >= 0 ? std::to_string(us / 1000) + " ms" : "expired");
+    }
+    return result;
+}
+
+const fanout::entry *
+fanout::client (const std::string & id) const
+{
+    for (const auto & e : m_entries)
+    {
+        if (e.fe_client_id == id)
+            return &e;
+    }
+    return nullptr;
+}
+
+fanout::entry *
+fanout::find (const std::string & id)
+{
+    return const_cast<entry *>(client(id));
+}
+
+/**
+ *  Ends a client's part in the command, if it was still pending.
+ */
+
+bool
+fanout::finish (entry & e, state s, clock::time_point t)
+{
+    bool result = e.fe_state == state::pending;
+    if (result)
+    {
+        e.fe_state = s;
+        e.fe_done_time = t;
+        if (s != state::expired)
+            e.fe_progress = 1.0f;
+    }
+    return result;
+}
+
+}           // namespace nsm
+
+/*
+ * fanout.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
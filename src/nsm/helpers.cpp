@@ -27,7 +27,7 @@
  * \library       helpers application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-03
- * \updates       2025-04-20
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -41,14 +41,20 @@
 #include <cerrno>                       /* #include <errno.h>               */
 #include <cstring>                      /* std::strerror()                  */
 #include <cstdlib>                      /* std::getenv(), std::rand()       */
+#include <fcntl.h>                      /* open(2), O_CLOEXEC               */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
+#include <sys/file.h>                   /* flock(2)                         */
+#include <sys/stat.h>                   /* stat(2), fchmod(2)               */
 #include <sys/time.h>                   /* time() and time_t                */
 #include <unistd.h>                     /* getpid()                         */
 
 #include "c_macros.h"
 #include "cpp_types.hpp"                /* lib66::tokenization alias        */
+#include "nsm/daemonregistry.hpp"       /* nsm::daemonregistry class        */
 #include "nsm/helpers.hpp"              /* functions in this module         */
+#include "nsm/sessionfile.hpp"          /* nsm::sessionfile class           */
+#include "osc/lowrapper.hpp"            /* osc::unix_socket_path(), etc.    */
 #include "util/filefunctions.hpp"       /* cfg66: util::file_write_lines()  */
-#include "util/ftswalker.hpp"           /* util::ftswalker class & funcs    */
 #include "util/msgfunctions.hpp"        /* cfg66: util::string_asprintf()   */
 #include "util/strfunctions.hpp"        /* cfg66: util::simple_hash()       */
 
@@ -267,9 +273,9 @@ get_lock_file_name
  *  but simply a file with information about the NSM Server and the
  *  loaded session.
  *
- *  For this new version of the code, util::file_write_string()
- *  used, which prepends the file-name and date-time, then *appends*
- *  the string to the file.
+ *  The file is replaced atomically, and holds the session path, the
+ *  server URL, the PID, and the start time of the daemon (see
+ *  daemonregistry::start_time()), one per line.
  *
  * \param filename
  *      Provides the lock-file name, obtained from get_lock_file_name().
@@ -292,24 +298,17 @@ write_lock_file
     const std::string & serverurl
 )
 {
-    std::string lockdata = util::string_asprintf
-    (
-        "%s\n%s\n%d\n", V(sessionpath), V(serverurl), int(getpid())
-    );
-    bool result = util::file_write_string(filename, lockdata);
+    std::string lockdata = sessionpath + "\n" + serverurl + "\n" +
+        std::to_string(getpid()) + "\n" +
+        std::to_string(daemonregistry::start_time()) + "\n";
+
+    std::string errmsg;
+    bool result = write_file_atomically(filename, lockdata, errmsg);
     if (result)
-    {
         util::file_message("Created lock file", filename);
-    }
     else
-    {
-        int ec = errno;
-        util::error_printf
-        (
-            "Failed to write lock file %s; error: %s",
-            V(filename), std::strerror(ec)
-        );
-    }
+        util::error_message("Failed to write lock file", errmsg);
+
     return result;
 }
 
@@ -412,27 +411,238 @@ session_triplet_to_string (const session_triplet & t)
 
 /**
  *  A helper function for load_session_file(). It tries to scan the
- *  session_triplets line-by-line, storing them in a vector.
+ *  session_triplets line-by-line, storing them in a vector. The file is
+ *  mapped and parsed in place by nsm::sessionfile; only the triplets
+ *  themselves are copied.
+ *
+ * \param sessionfile
+ *      The path to the session.nsm file.
+ *
+ * \param [out] destination
+ *      The entries read before any error.
+ *
+ * \param [out] errmsg
+ *      Set to the reason for a failure, including the number of the
+ *      malformed line if that was the problem.
+ *
+ * \return
+ *      Returns true if the whole file was read.
  */
 
+bool
+parse_session_lines
+(
+    const std::string & sessionfile,
+    session_triplets & destination,
+    std::string & errmsg
+)
+{
+    nsm::sessionfile sf(sessionfile);
+    bool result = sf.load();
+    destination.clear();
+    if (result)
+    {
+        nsm::sessionfile::entry e;
+        while (sf.next(e))
+        {
+            destination.push_back
+            (
+                session_triplet
+                {
+                    std::string(e.e_client_name),
+                    std::string(e.e_client_exe),
+                    std::string(e.e_client_id)
+                }
+            );
+        }
+        result = sf.error_line() == 0;
+    }
+    if (! result)
+        errmsg = sf.error_message();
+
+    return result;
+}
+
 session_triplets __attribute__((used))
 parse_session_lines (const std::string & sessionfile)
 {
     session_triplets result;
-    lib66::tokenization lines;
-    bool ok = util::file_read_lines(sessionfile, lines, true);  /* trim */
+    std::string errmsg;
+    if (! parse_session_lines(sessionfile, result, errmsg))
+        util::error_message("Session file", errmsg);
+
+    return result;
+}
+
+/**
+ *  The save counterpart of parse_session_lines(). The file is replaced
+ *  atomically by nsm::sessionfile::save(), which copies the unchanged lines
+ *  and does not touch the file at all if nothing changed.
+ *
+ * \param sessionfile
+ *      The path to the session.nsm file. It need not exist yet.
+ *
+ * \param source
+ *      The clients of the session, in order.
+ *
+ * \param [out] errmsg
+ *      Set to the reason for a failure.
+ *
+ * \return
+ *      Returns true if the file holds the entries, whether or not it had
+ *      to be written.
+ */
+
+bool
+write_session_lines
+(
+    const std::string & sessionfile,
+    const session_triplets & source,
+    std::string & errmsg
+)
+{
+    nsm::sessionfile sf(sessionfile);
+    bool changed = false;
+    (void) sf.load();                   /* a missing file is just new       */
+    bool result = sf.save(source, changed);
+    if (! result)
+        errmsg = sf.error_message();
+
+    return result;
+}
+
+namespace
+{
+
+/**
+ *  Syncs the directory holding a file, so that a rename into it survives a
+ *  crash. The file's own fsync() does not cover its directory entry.
+ */
+
+bool
+fsync_directory (const std::string & filename)
+{
+    std::string::size_type slash = filename.find_last_of('/');
+    std::string dirname = slash == std::string::npos ? std::string(".") :
+        slash == 0 ? std::string("/") : filename.substr(0, slash) ;
+
+    int dfd = ::open(dirname.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0)
+        return false;
+
+    bool result = ::fsync(dfd) == 0;
+    int ec = errno;
+    (void) ::close(dfd);
+    errno = ec;
+    return result;
+}
+
+}           // namespace (anonymous)
+
+/**
+ *  Replaces a file so that readers see either the old contents or the new,
+ *  never part of one. The data goes to a temporary file in the same
+ *  directory, which is synced and then renamed over the old file. The
+ *  directory is then synced, so that the rename itself is not lost in a
+ *  crash. The permissions of the old file, if any, are kept.
+ *
+ * \param filename
+ *      The file to replace or create.
+ *
+ * \param data
+ *      The new contents.
+ *
+ * \param [out] errmsg
+ *      Set to the reason for a failure.
+ *
+ * \param [out] lockedfd
+ *      If not null, the file is locked with flock(LOCK_EX) before it is
+ *      written, and is left open, so that the lock is held from the moment
+ *      the file appears. The descriptor is returned here; closing it
+ *      releases the lock. See daemonregistry::register_self().
+ *
+ * \return
+ *      Returns true if the file was replaced.
+ */
+
+bool
+write_file_atomically
+(
+    const std::string & filename,
+    std::string_view data,
+    std::string & errmsg,
+    int * lockedfd
+)
+{
+    mode_t mode = 0644;
+    struct stat st;
+    if (::stat(filename.c_str(), &st) == 0)
+        mode = st.st_mode & 07777;
+
+    std::string tmpname = filename + ".XXXXXX";
+    int fd = ::mkostemp(&tmpname[0], O_CLOEXEC);
+    if (fd < 0)
+    {
+        errmsg = tmpname + ": " + std::strerror(errno);
+        return false;
+    }
+
+    bool ok = ::fchmod(fd, mode) == 0;
+    if (ok && not_nullptr(lockedfd))
+        ok = ::flock(fd, LOCK_EX | LOCK_NB) == 0;
+
+    const char * p = data.data();
+    std::size_t remaining = data.size();
+    while (ok && remaining > 0)
+    {
+        ssize_t rc = ::write(fd, p, remaining);
+        if (rc < 0 && errno == EINTR)
+            continue;
+
+        ok = rc > 0;
+        if (ok)
+        {
+            p += rc;
+            remaining -= std::size_t(rc);
+        }
+    }
     if (ok)
+        ok = ::fsync(fd) == 0;
+
+    int ec = ok ? 0 : errno ;
+    if (is_nullptr(lockedfd))
     {
-        for (const auto & line : lines)
+        if (::close(fd) != 0 && ok)
         {
-            session_triplet lineitem;
-            if (parse_session_triplet(line, lineitem))
-                result.push_back(lineitem);
-            else
-                break;
+            ok = false;
+            ec = errno;
         }
+        fd = (-1);
     }
-    return result;
+    if (ok && ::rename(tmpname.c_str(), filename.c_str()) != 0)
+    {
+        ok = false;
+        ec = errno;
+    }
+    if (ok && ! fsync_directory(filename))
+    {
+        ok = false;                     /* replaced, but maybe not durably  */
+        ec = errno;
+    }
+    if (ok)
+    {
+        if (not_nullptr(lockedfd))
+            *lockedfd = fd;
+    }
+    else
+    {
+        if (fd >= 0)
+            (void) ::close(fd);
+
+        (void) ::unlink(tmpname.c_str());
+        errmsg = filename + ": " + std::strerror(ec);
+    }
+    return ok;
 }
 
 /**
@@ -509,29 +719,36 @@ make_xdg_runtime_lock_directory (std::string & lockfiledir)
  *
  *      osc.udp://mlsleno:16133/
  *
- *  Thus, an easy way to hook to the first daemon we find is to
- *  look for that second file and read it.
+ *  The daemonregistry reads those files, skips (and here prunes) the ones
+ *  left by daemons that are gone, and returns the URL of the daemon
+ *  started most recently. One registry is kept for the life of the
+ *  process, so that later calls reuse its inotify-driven cache instead of
+ *  reading the directory again.
+ *
+ *  The URL can also be a Unix-domain one, "osc.unix:///run/user/1000/...";
+ *  then the socket must exist, or the daemon is not really reachable.
  */
 
 std::string
 lookup_active_nsmd_url ()
 {
-    std::string result;
-    std::string runtimedir = util::get_xdg_runtime_directory("nsm", "d");
-    if (! runtimedir.empty())
+    static daemonregistry s_registry;       /* keeps its inotify cache      */
+    static std::mutex s_registry_mutex;
+    std::lock_guard<std::mutex> lock(s_registry_mutex);
+    daemonregistry & registry = s_registry;
+    int stale = registry.prune();
+    if (stale > 0)
+        util::info_printf("Pruned %d stale daemon files", stale);
+
+    std::string result = registry.newest_url();
+    if (osc::url_protocol(result) == LO_UNIX)
     {
-        util::ftswalker walker(runtimedir);
-        lib66::tokenization files;
-        if (walker.find_regular_files(files))
+        struct stat st;
+        std::string path = osc::unix_socket_path(result);
+        if (::stat(path.c_str(), &st) != 0 || ! S_ISSOCK(st.st_mode))
         {
-            std::string f0 = files[0];
-            lib66::tokenization lines;
-            if (util::file_read_lines(f0, lines))
-            {
-                f0 = lines[0];
-                if (util::strncompare("osc", f0))
-                    result = f0;
-            }
+            util::warn_message("Daemon socket missing", path);
+            result.clear();
         }
     }
     return result;
@@ -539,22 +756,15 @@ lookup_active_nsmd_url ()
 
 /**
  *  Get the daemon directory plus the PID file. This is useful in reading
- *  the PID file.
+ *  the PID file. See daemonregistry::register_self() for writing it.
  */
 
 std::string
 get_daemon_pid_file ()
 {
-    std::string result;
-    std::string daemondir = util::get_xdg_runtime_directory("nsm", "d");
-    if (! daemondir.empty())
-    {
-        result = util::string_asprintf
-        (
-            "%s/%d", V(daemondir), getpid()
-        );
-        util::info_message("Daemon file", daemondir);
-    }
+    std::string result = daemonregistry::pid_file_name();
+    if (! result.empty())
+        util::info_message("Daemon file", result);
     else
         util::error_message("Could not get a daemon file-name");
 
@@ -901,32 +1111,51 @@ extract_patch_line
     std::string & leftside,
     std::string & rightside
 )
+{
+    std::string_view left, right;
+    patch_direction result = split_patch_line(patch, left, right);
+    if (result != patch_direction::error)
+    {
+        leftside = std::string(left);
+        rightside = std::string(right);
+    }
+    return result;
+}
+
+/**
+ *  The guts of extract_patch_line(), without copying. The views point into
+ *  the patch line.
+ */
+
+patch_direction
+split_patch_line
+(
+    std::string_view patch,
+    std::string_view & leftside,
+    std::string_view & rightside
+)
 {
     patch_direction result = patch_direction::error;    /* be pessimistic   */
-    if (! patch.empty())
+    std::string_view::size_type leftposend = patch.find_first_of("<|>");
+    std::string_view::size_type rightposstart = patch.find_last_of("<|>");
+    bool ok = leftposend != std::string_view::npos &&
+        rightposstart != std::string_view::npos;
+
+    if (ok)
     {
-        std::string::size_type leftposend = patch.find_first_of("<|>");
-        std::string::size_type rightposstart = patch.find_last_of("<|>");
-        if (util::not_npos(leftposend) && util::not_npos(rightposstart))
-        {
-            std::string leftpart = patch.substr(0, leftposend - 1);
-            std::string rightpart = patch.substr(rightposstart + 1);
-            std::string::size_type sepcount = rightposstart - leftposend + 1;
-            std::string separator = patch.substr(leftposend, sepcount);
-            leftpart = util::trim(leftpart);
-            rightpart = util::trim(rightpart);
-            if (separator == "<|")
-                result = patch_direction::left;
-            else if (separator == "||")
-                result = patch_direction::duplex;
-            else if (separator == "|>")
-                result = patch_direction::right;
+        std::string_view::size_type sepcount = rightposstart - leftposend + 1;
+        std::string_view separator = patch.substr(leftposend, sepcount);
+        if (separator == "<|")
+            result = patch_direction::left;
+        else if (separator == "||")
+            result = patch_direction::duplex;
+        else if (separator == "|>")
+            result = patch_direction::right;
 
-            if (result != patch_direction::error)
-            {
-                leftside = leftpart;
-                rightside = rightpart;
-            }
+        if (result != patch_direction::error)
+        {
+            leftside = trim_view(patch.substr(0, leftposend));
+            rightside = trim_view(patch.substr(rightposstart + 1));
         }
     }
     return result;
@@ -995,22 +1224,41 @@ extract_client_port
     std::string & clientname,
     std::string & portname
 )
+{
+    std::string_view cname, pname;
+    bool result = split_client_port(fullname, cname, pname);
+    clientname = std::string(cname);
+    portname = std::string(pname);
+    return result;
+}
+
+/**
+ *  The guts of extract_client_port(), without copying. The views point
+ *  into the full name.
+ */
+
+bool
+split_client_port
+(
+    std::string_view fullname,
+    std::string_view & clientname,
+    std::string_view & portname
+)
 {
     bool result = ! fullname.empty();
-    clientname.clear();
-    portname.clear();
+    clientname = std::string_view();
+    portname = std::string_view();
     if (result)
     {
-        std::string::size_type colonpos = 0;
-        std::string a2j { "a2j:" };
-        bool is_a2j = util::contains(fullname, a2j);
-        if (is_a2j)
-            colonpos = fullname.find(a2j) + a2j.length();
-
-        std::string cname;
-        std::string pname;
-        colonpos = fullname.find_first_of(":", colonpos);
-        if (colonpos != std::string::npos)
+        static const std::string_view s_a2j { "a2j:" };
+        std::string_view::size_type colonpos = fullname.find(s_a2j);
+        if (colonpos != std::string_view::npos)
+            colonpos += s_a2j.length();
+        else
+            colonpos = 0;
+
+        colonpos = fullname.find(':', colonpos);
+        if (colonpos != std::string_view::npos)
         {
             /*
              * The client name consists of all characters up the the first
@@ -1018,19 +1266,32 @@ extract_client_port
              * after that colon. Period.
              */
 
-            cname = fullname.substr(0, colonpos);
-            pname = fullname.substr(colonpos +1);
-            result = ! cname.empty() && ! pname.empty();
+            clientname = fullname.substr(0, colonpos);
+            portname = fullname.substr(colonpos + 1);
+            result = ! clientname.empty() && ! portname.empty();
         }
         else
-            pname = fullname;
-
-        clientname = cname;
-        portname = pname;
+            portname = fullname;
     }
     return result;
 }
 
+/**
+ *  Strips white space from both ends of a string view.
+ */
+
+std::string_view
+trim_view (std::string_view s)
+{
+    static const char * const s_white = " \t\r\n";
+    std::string_view::size_type first = s.find_first_not_of(s_white);
+    if (first == std::string_view::npos)
+        return std::string_view();
+
+    std::string_view::size_type last = s.find_last_not_of(s_white);
+    return s.substr(first, last - first + 1);
+}
+
 patch_direction
 process_patch
 (
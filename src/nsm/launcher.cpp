@@ -0,0 +1,388 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          launcher.cpp
+ *
+ *    This module launches processes with posix_spawn(3).
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Compared to fork() plus "/bin/sh -c", a spawn does not copy the page
+ *  tables of the caller, and does not start a shell unless the arguments
+ *  need one. An exec failure (e.g. ENOENT) is returned by the spawn call
+ *  itself, rather than by a child process that exits with status 1.
+ */
+
+#include <algorithm>                    /* std::min()                       */
+#include <atomic>                       /* std::atomic<> for spawn_all()    */
+#include <cstring>                      /* std::strchr(), std::strerror()   */
+#include <fcntl.h>                      /* O_WRONLY, O_CREAT, O_TRUNC       */
+#include <signal.h>                     /* sigset_t, sigemptyset()          */
+#include <spawn.h>                      /* posix_spawnp(), file actions     */
+#include <thread>                       /* std::thread                      */
+#include <unistd.h>                     /* STDOUT_FILENO, STDERR_FILENO     */
+
+#include "nsm/launcher.hpp"             /* nsm::launcher class              */
+#include "util/msgfunctions.hpp"        /* util::error_printf()             */
+#include "util/strfunctions.hpp"        /* V() macro                        */
+
+extern char ** environ;
+
+namespace nsm
+{
+
+namespace
+{
+
+/**
+ *  Characters that, outside of quotes, mean that the arguments need a real
+ *  shell. The '#' and '~' characters are special only at the start of a
+ *  word, and are checked separately.
+ */
+
+const char * const c_shell_chars = "|&;<>()$`*?[\n";
+
+/**
+ *  Makes the null-terminated array of pointers needed by the exec family.
+ *  The strings must outlive the array.
+ */
+
+std::vector<char *>
+make_pointers (const lib66::tokenization & strings)
+{
+    std::vector<char *> result;
+    result.reserve(strings.size() + 1);
+    for (const auto & s : strings)
+        result.push_back(const_cast<char *>(s.c_str()));
+
+    result.push_back(nullptr);
+    return result;
+}
+
+/**
+ *  Copies our environment, leaving out the variables that are to be unset
+ *  or replaced, then adds the new variables.
+ */
+
+lib66::tokenization
+make_environment (const launch_spec & spec)
+{
+    lib66::tokenization result;
+    for (char ** e = environ; not_nullptr(e) && not_nullptr(*e); ++e)
+    {
+        std::string entry(*e);
+        std::string name = entry.substr(0, entry.find('='));
+        bool keep = true;
+        for (const auto & u : spec.ls_unset)
+        {
+            if (u == name)
+            {
+                keep = false;
+                break;
+            }
+        }
+        for (const auto & v : spec.ls_environment)
+        {
+            if (! keep)
+                break;
+
+            if (v.size() > name.size() && v[name.size()] == '=' &&
+                v.compare(0, name.size(), name) == 0)
+            {
+                keep = false;
+            }
+        }
+        if (keep)
+            result.push_back(entry);
+    }
+    result.insert(result.end(), spec.ls_environment.begin(),
+        spec.ls_environment.end());
+
+    return result;
+}
+
+}           // namespace anonymous
+
+/**
+ *  Splits an argument string the way the shell would for simple cases:
+ *  blanks separate words, single quotes preserve everything, double quotes
+ *  preserve everything but a backslash before '"' or '\', and a backslash
+ *  outside of quotes escapes the next character.
+ *
+ * \param args
+ *      The arguments, as typed by the user.
+ *
+ * \param [out] argv
+ *      The words are appended to this list, but only if the function
+ *      succeeds.
+ *
+ * \return
+ *      Returns false if the quotes are not balanced, or if the string uses
+ *      shell features (pipes, redirection, variables, globs, etc.), in which
+ *      case the caller needs to run a shell.
+ */
+
+bool
+split_arguments (const std::string & args, lib66::tokenization & argv)
+{
+    lib66::tokenization words;
+    std::string word;
+    bool inword = false;
+    char quote = 0;
+    for (std::size_t i = 0; i < args.size(); ++i)
+    {
+        char c = args[i];
+        if (quote == '\'')
+        {
+            if (c == '\'')
+                quote = 0;
+            else
+                word += c;
+        }
+        else if (quote == '"')
+        {
+            if (c == '"')
+                quote = 0;
+            else if (c == '$' || c == '`')
+                return false;
+            else if (c == '\\' && i + 1 < args.size() &&
+                (args[i + 1] == '"' || args[i + 1] == '\\'))
+            {
+                word += args[++i];
+            }
+            else
+                word += c;
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+            inword = true;
+        }
+        else if (c == '\\')
+        {
+            if (i + 1 == args.size() || args[i + 1] == '\n')
+                return false;
+
+            word += args[++i];
+            inword = true;
+        }
+        else if (c == ' ' || c == '\t')
+        {
+            if (inword)
+            {
+                words.push_back(word);
+                word.clear();
+                inword = false;
+            }
+        }
+        else if (c == 0 || not_nullptr(std::strchr(c_shell_chars, c)))
+        {
+            return false;
+        }
+        else if (! inword && (c == '#' || c == '~'))
+        {
+            return false;
+        }
+        else
+        {
+            word += c;
+            inword = true;
+        }
+    }
+    if (quote != 0)
+        return false;
+
+    if (inword)
+        words.push_back(word);
+
+    argv.insert(argv.end(), words.begin(), words.end());
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+ * launcher
+ *--------------------------------------------------------------------------*/
+
+launcher::launcher (int maxconcurrent) :
+    m_max_concurrent    (maxconcurrent > 0 ? maxconcurrent : 1)
+{
+    // no code
+}
+
+/**
+ *  Launches one process. The signal mask of the child is cleared and its
+ *  signal dispositions are reset to the defaults, as the calling thread
+ *  may block signals (e.g. SIGCHLD) that the client expects.
+ *
+ * \param spec
+ *      Describes the process to launch.
+ *
+ * \param [out] errmsg
+ *      Set to the reason for a failure.
+ *
+ * \return
+ *      Returns the PID of the new process, or -1 on failure.
+ */
+
+pid_t
+launcher::spawn (const launch_spec & spec, std::string & errmsg)
+{
+    if (spec.ls_executable.empty())
+    {
+        errmsg = "Executable is empty";
+        return pid_t(-1);
+    }
+
+    lib66::tokenization args;
+    args.push_back(spec.ls_executable);
+    if (! split_arguments(spec.ls_arguments, args))
+    {
+        args.clear();
+        args.push_back("/bin/sh");
+        args.push_back("-c");
+        args.push_back("exec " + spec.ls_executable + " " + spec.ls_arguments);
+    }
+
+    lib66::tokenization env = make_environment(spec);
+    std::vector<char *> argp = make_pointers(args);
+    std::vector<char *> envp = make_pointers(env);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    int rc = posix_spawn_file_actions_init(&actions);
+    if (rc != 0)
+    {
+        errmsg = std::strerror(rc);
+        return pid_t(-1);
+    }
+    rc = posix_spawnattr_init(&attributes);
+    if (rc != 0)
+    {
+        (void) posix_spawn_file_actions_destroy(&actions);
+        errmsg = std::strerror(rc);
+        return pid_t(-1);
+    }
+    if (! spec.ls_log_file.empty())
+    {
+        rc = posix_spawn_file_actions_addopen
+        (
+            &actions, STDOUT_FILENO, spec.ls_log_file.c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC, 0644
+        );
+        if (rc == 0)
+        {
+            rc = posix_spawn_file_actions_adddup2
+            (
+                &actions, STDOUT_FILENO, STDERR_FILENO
+            );
+        }
+    }
+    if (rc == 0)
+    {
+        sigset_t nomask;
+        sigset_t alldefault;
+        (void) sigemptyset(&nomask);
+        (void) sigfillset(&alldefault);
+        (void) posix_spawnattr_setsigmask(&attributes, &nomask);
+        (void) posix_spawnattr_setsigdefault(&attributes, &alldefault);
+        rc = posix_spawnattr_setflags
+        (
+            &attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF
+        );
+    }
+
+    pid_t result = pid_t(-1);
+    if (rc == 0)
+    {
+        rc = posix_spawnp
+        (
+            &result, argp[0], &actions, &attributes, argp.data(), envp.data()
+        );
+        if (rc != 0)
+            result = pid_t(-1);
+    }
+    if (rc != 0)
+        errmsg = std::strerror(rc);
+
+    (void) posix_spawnattr_destroy(&attributes);
+    (void) posix_spawn_file_actions_destroy(&actions);
+    return result;
+}
+
+/**
+ *  Launches many processes, with at most max_concurrent() spawns in
+ *  progress at once. Failures are logged.
+ *
+ * \param specs
+ *      The processes to launch.
+ *
+ * \return
+ *      Returns the PIDs, in the order of the specs, with -1 for each
+ *      process that could not be launched.
+ */
+
+std::vector<pid_t>
+launcher::spawn_all (const std::vector<launch_spec> & specs) const
+{
+    std::vector<pid_t> result(specs.size(), pid_t(-1));
+    std::atomic<std::size_t> next(0);
+    auto worker = [&specs, &result, &next] ()
+    {
+        for (;;)
+        {
+            std::size_t i = next++;
+            if (i >= specs.size())
+                break;
+
+            std::string errmsg;
+            result[i] = spawn(specs[i], errmsg);
+            if (result[i] < 0)
+            {
+                util::error_printf
+                (
+                    "Could not launch %s: %s",
+                    V(specs[i].ls_executable), V(errmsg)
+                );
+            }
+        }
+    };
+    std::size_t count = std::min(std::size_t(m_max_concurrent), specs.size());
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < count; ++t)         /* caller is a worker  */
+        pool.emplace_back(worker);
+
+    worker();
+    for (auto & t : pool)
+        t.join();
+
+    return result;
+}
+
+}           // namespace nsm
+
+/*
+ * launcher.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,232 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          notifygate.cpp
+ *
+ *    This module decides when a client's dirty state and progress are
+ *    sent to the session manager.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-15
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See the notifygate.hpp module.
+ */
+
+#include "nsm/notifygate.hpp"           /* nsm::notifygate class            */
+
+namespace nsm
+{
+
+notifygate::notifygate () :
+    m_dirty                 (false),
+    m_dirty_debounce_ms     (0),
+    m_dirty_known           (false),
+    m_dirty_reported        (false),
+    m_dirty_pending         (false),
+    m_dirty_due             (),
+    m_progress_interval_ms  (0),
+    m_progress_pending      (false),
+    m_progress_value        (0.0f),
+    m_progress_last         ()
+{
+    // no code
+}
+
+/**
+ *  Takes a new dirty state from the application.
+ *
+ * \return
+ *      Returns true if the state is to be sent now. Otherwise the session
+ *      manager already has it, or it is held until due_dirty() says so.
+ */
+
+bool
+notifygate::offer_dirty (bool isdirty, clock::time_point now)
+{
+    bool result = false;
+    m_dirty = isdirty;
+    if (m_dirty_known && isdirty == m_dirty_reported)
+    {
+        m_dirty_pending = false;                /* nsmd already has it      */
+    }
+    else if (m_dirty_debounce_ms > 0)
+    {
+        if (! m_dirty_pending)
+        {
+            m_dirty_pending = true;
+            m_dirty_due = now + std::chrono::milliseconds(m_dirty_debounce_ms);
+        }
+    }
+    else
+    {
+        m_dirty_known = true;
+        m_dirty_reported = isdirty;
+        result = true;
+    }
+    return result;
+}
+
+/**
+ *  Checks a held dirty state.
+ *
+ * \param [out] isdirty
+ *      Set to the state to send, if the return value is true.
+ *
+ * \return
+ *      Returns true if the debounce time is over and the state still
+ *      differs from the one last sent.
+ */
+
+bool
+notifygate::due_dirty (clock::time_point now, bool & isdirty)
+{
+    bool result = false;
+    if (m_dirty_pending && now >= m_dirty_due)
+    {
+        m_dirty_pending = false;
+        if (! m_dirty_known || m_dirty != m_dirty_reported)
+        {
+            m_dirty_known = true;
+            m_dirty_reported = isdirty = m_dirty;
+            result = true;
+        }
+    }
+    return result;
+}
+
+/**
+ *  Takes a new progress value.
+ *
+ * \return
+ *      Returns true if the value is to be sent now, false if it is held
+ *      until due_progress() says so.
+ */
+
+bool
+notifygate::offer_progress (float percent, clock::time_point now)
+{
+    bool result = true;
+    if (m_progress_interval_ms > 0)
+    {
+        auto due = m_progress_last +
+            std::chrono::milliseconds(m_progress_interval_ms);
+
+        if (percent < 100.0f && now < due)
+        {
+            m_progress_value = percent;
+            m_progress_pending = true;
+            result = false;
+        }
+        else
+        {
+            m_progress_pending = false;
+            m_progress_last = now;
+        }
+    }
+    return result;
+}
+
+/**
+ *  Checks a held progress value.
+ *
+ * \param [out] percent
+ *      Set to the value to send, if the return value is true.
+ *
+ * \return
+ *      Returns true if the interval since the last value sent is over.
+ */
+
+bool
+notifygate::due_progress (clock::time_point now, float & percent)
+{
+    bool result = false;
+    auto interval = std::chrono::milliseconds(m_progress_interval_ms);
+    if (m_progress_pending && now >= m_progress_last + interval)
+    {
+        m_progress_pending = false;
+        m_progress_last = now;
+        percent = m_progress_value;
+        result = true;
+    }
+    return result;
+}
+
+/**
+ *  Provides the time until due_dirty() or due_progress() has something to
+ *  send, for use as a poll timeout.
+ *
+ * \return
+ *      Returns the milliseconds (0 if overdue), or -1 if nothing is held.
+ */
+
+int
+notifygate::timeout (clock::time_point now) const
+{
+    int result = (-1);
+    auto shorten = [&result, now] (clock::time_point due)
+    {
+        int remaining = 0;
+        if (due > now)
+        {
+            remaining = int
+            (
+                std::chrono::ceil<std::chrono::milliseconds>(due - now).count()
+            );
+        }
+        if (result < 0 || remaining < result)
+            result = remaining;
+    };
+    if (m_dirty_pending)
+        shorten(m_dirty_due);
+
+    if (m_progress_pending)
+    {
+        shorten
+        (
+            m_progress_last + std::chrono::milliseconds(m_progress_interval_ms)
+        );
+    }
+    return result;
+}
+
+/**
+ *  Notes that the session manager considers the client clean, after a
+ *  successful open or save reply, so that the next dirty(true) is sent.
+ */
+
+void
+notifygate::mark_clean ()
+{
+    m_dirty = false;
+    m_dirty_known = true;
+    m_dirty_reported = false;
+    m_dirty_pending = false;
+}
+
+}           // namespace nsm
+
+/*
+ * notifygate.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -25,7 +25,7 @@
  * \library       nsm66 application
  * \author        Chris Ahlstrom
  * \date          2020-03-07
- * \updates       2025-04-24
+ * \updates       2026-10-14
  * \license       GNU GPLv2 or above
  *
  *  nsmbase is an Non Session Manager (NSM) OSC client helper.  The NSM API
@@ -109,6 +109,7 @@
 #include <iostream>                     /* std::cout                        */
 #endif
 
+#include <chrono>                       /* std::chrono::milliseconds        */
 #include <cstring>                      /* std::strlen()                    */
 #include <sys/types.h>                  /* provides the pid_t typedef       */
 #include <unistd.h>                     /* C getpid()                       */
@@ -116,6 +117,7 @@
 #include "c_macros.h"                   /* not_nullptr(), warnprint(), etc. */
 #include "nsm/nsmbase.hpp"              /* nsm66::nsmbase class             */
 #include "nsm/nsmmessagesex.hpp"        /* nsm66::nsm new message functions */
+#include "osc/trace.hpp"                /* osc::trace_record()              */
 #include "util/msgfunctions.hpp"        /* util::session_message from Cfg66 */
 #include "util/strfunctions.hpp"        /* CSTR() macro                     */
 
@@ -197,7 +199,12 @@ nsmbase::osc_nsm_error
         path, types, argv, argc, msg, user_data
     );
     if (rc == osc::osc_msg_handled())
+    {
+        if (std::strcmp(&argv[0]->s, "/nsm/server/announce") == 0)
+            pnsmc->finish_announce(false);
+
         pnsmc->nsm_error(int(argv[1]->i), &argv[2]->s);
+    }
 
     return rc;
 }
@@ -226,9 +233,21 @@ nsmbase::nsmbase
 ) :
     osc::lowrapper      (),
     m_server_thread     (nullptr),
+    m_thread_attributes (),
     m_active            (false),        /* an atomic boolean value          */
-    m_dirty             (false),
+    m_announce_mutex    (),
+    m_announce_cond     (),
+    m_announce_status   (announce_status::idle),
+    m_announce_promise  (),
+    m_announce_callback (nullptr),
+    m_announce_userdata (nullptr),
+    m_announce_timeout_ms (12000),
+    m_watchdog_mutex    (),
+    m_announce_watchdog (),
     m_dirty_count       (0),
+    m_notify_mutex      (),
+    m_notify            (),
+    m_templates         (),
     m_manager           (),
     m_capabilities      (),
     m_path_name         (),
@@ -249,14 +268,38 @@ nsmbase::nsmbase
 
 nsmbase::~nsmbase ()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_announce_mutex);
+        m_announce_callback = nullptr;      /* the object is going away     */
+    }
+    finish_announce(false);                 /* releases the watchdog        */
+    {
+        std::lock_guard<std::mutex> lock(m_watchdog_mutex);
+        if (m_announce_watchdog.joinable())
+            m_announce_watchdog.join();
+    }
     stop_thread();
 }
 
+/**
+ *  Starts the liblo server thread. Via the liblo init callback, the thread
+ *  binds our stats() to itself as it starts, and applies the thread
+ *  attributes, if any have been set (see thread_attributes()).
+ */
+
 void
 nsmbase::start_thread ()
 {
     if (not_nullptr(m_server_thread))
     {
+        if (m_thread_attributes.ta_stack_size > 0)
+            util::warn_message("OSC server thread stack size ignored");
+
+        lo_server_thread_set_callbacks
+        (
+            m_server_thread, server_thread_init, nullptr, this
+        );
+
         int rcode = lo_server_thread_start(m_server_thread);
         if (rcode == 0)                                     /* successful?  */
             util::session_message("OSC server thread started");
@@ -265,6 +308,38 @@ nsmbase::start_thread ()
     }
 }
 
+void
+nsmbase::start_thread (const osc::thread_attributes & attr)
+{
+    m_thread_attributes = attr;
+    start_thread();
+}
+
+/**
+ *  The liblo init callback, called in the server thread before it starts
+ *  handling messages. It binds the metrics, so that the messages handled
+ *  in the thread are counted. A failure to apply the attributes is not
+ *  fatal; the thread keeps running with what it got.
+ *
+ * \return
+ *      Always returns 0, which tells liblo to go on.
+ */
+
+int
+nsmbase::server_thread_init (lo_server_thread /*st*/, void * user_data)
+{
+    nsmbase * nsmptr = static_cast<nsmbase *>(user_data);
+    if (not_nullptr(nsmptr))
+    {
+        (void) osc::metrics::bind(&nsmptr->stats());
+
+        const osc::thread_attributes & attr = nsmptr->m_thread_attributes;
+        if (! attr.is_default() && osc::thread::apply(attr))
+            util::info_message("OSC server thread attributes applied");
+    }
+    return 0;
+}
+
 /**
  *  TODO: Investigate and reconcile.
  */
@@ -274,8 +349,9 @@ nsmbase::stop_thread ()
 {
     if (not_nullptr(m_server_thread))
     {
-        lo_server_thread_free(m_server_thread);
+        lo_server_thread_free(m_server_thread);     /* frees its server */
         m_server_thread = nullptr;
+        m_lo_server = nullptr;
     }
     else
     {
@@ -285,6 +361,7 @@ nsmbase::stop_thread ()
             m_lo_server = nullptr;
         }
     }
+    server(nullptr);                        /* so ~lowrapper() skips it     */
 }
 
 /**
@@ -313,7 +390,14 @@ nsmbase::initialize ()
         }
         ps += " OSC protocol";
         util::session_message(ps);
-        m_server_thread = lo_server_thread_new_with_proto(NULL, proto, NULL);
+        std::string sockpath;
+        if (proto == LO_UNIX)
+            sockpath = osc::make_unix_socket_path();   /* liblo needs one  */
+
+        m_server_thread = lo_server_thread_new_with_proto
+        (
+            sockpath.empty() ? NULL : sockpath.c_str(), proto, NULL
+        );
         result = not_nullptr(m_server_thread);
         if (result)
         {
@@ -321,12 +405,15 @@ nsmbase::initialize ()
             result = not_nullptr(m_lo_server);
             if (result)
             {
+                server(m_lo_server);        /* for lo_send_from(), etc.     */
+
                 /*
                  * Similar in the base class, though.
                  */
 
                 add_thread_method(osc::tag::error, &nsmbase::osc_nsm_error);
                 add_thread_method(osc::tag::reply, &nsmbase::osc_nsm_reply);
+                make_templates();
 
                 /*
                  * See nsmclient.
@@ -346,6 +433,86 @@ nsmbase::initialize ()
     return result;
 }
 
+/**
+ *  Makes a message template for each client tag, so that the sends need
+ *  not look up the path and types, nor go through liblo. The tags that
+ *  are not client messages, or whose types msgbuilder cannot handle, get
+ *  an invalid template, and are sent the old way.
+ */
+
+void
+nsmbase::make_templates ()
+{
+    int count = static_cast<int>(osc::tag::illegal);
+    m_templates.clear();
+    m_templates.reserve(std::size_t(count));
+    for (int i = 0; i < count; ++i)
+    {
+        std::string message;
+        std::string pattern;
+        osc::tag t = static_cast<osc::tag>(i);
+        if (t != osc::tag::null && nsm::client_msg(t, message, pattern))
+            m_templates.emplace_back(message, pattern, t);
+        else
+            m_templates.emplace_back();
+    }
+}
+
+/**
+ *  Gets the prebuilt template of a client message.
+ *
+ * \return
+ *      Returns null if there is no usable template, in which case the
+ *      caller must build the message with nsm::client_msg().
+ */
+
+const osc::msgtemplate *
+nsmbase::client_template (osc::tag t) const
+{
+    int i = static_cast<int>(t);
+    if (i < 0 || i >= int(m_templates.size()))
+        return nullptr;
+
+    const osc::msgtemplate & mt = m_templates[std::size_t(i)];
+    return mt.valid() ? &mt : nullptr ;
+}
+
+/**
+ *  Sends a client message from its template, filling in the string
+ *  arguments in order.
+ *
+ * \return
+ *      Returns the number of bytes sent, or a negative value if the
+ *      message could not be sent this way (for example, over TCP, or if
+ *      the types are not all 's'). Then the caller should use send_from().
+ */
+
+int
+nsmbase::send_template
+(
+    const osc::msgtemplate & mt,
+    const std::string & s1,
+    const std::string & s2,
+    const std::string & s3
+)
+{
+    const std::string * args [] = { &s1, &s2, &s3 };
+    const std::string & types = mt.types();
+    if (types.size() > 3)
+        return (-1);
+
+    osc::msgbuilder & mb = thread_builder();
+    if (! mb.start(mt))
+        return (-1);
+
+    for (std::size_t i = 0; i < types.size(); ++i)
+    {
+        if (types[i] != 's' || ! mb.add_string(*args[i]))
+            return (-1);
+    }
+    return send_built(address(), mb);
+}
+
 /**
  *  Checks to be sure that the server and the address are usable (i.e. not
  *  null).
@@ -369,6 +536,10 @@ nsmbase::lo_is_valid () const
  *  Note that lo_server_wait() waits for the given timeout, then returns 1 if
  *  a message is waiting.
  *
+ *  The messages are dispatched under the receive budget, if one was set
+ *  via osc::lowrapper::receive_budget(). Any messages left over are
+ *  flagged by receive_pending(), and handled by the next call.
+ *
  * \param timeoutms
  *      Indicates how long to wait for a server message, in milliseconds.
  *      Defaults to 100 ms.
@@ -391,10 +562,7 @@ nsmbase::msg_check (int timeoutms)
         {
             result = true;
             util::session_message("NSM waiting for reply...");
-            while (lo_server_recv_noblock(m_lo_server, 0))
-            {
-                /* do nothing, handle the message(s) */
-            }
+            (void) receive_ready(m_lo_server);  /* handle the message(s) */
         }
         if (! result)
             util::error_message("NSM no reply!");
@@ -407,12 +575,19 @@ nsmbase::msg_check (int timeoutms)
  */
 
 /**
- *  Sends one of these messages:
+ *  Sets the dirty flag, and tells the session manager with one of these
+ *  messages, but only if the state differs from the one last sent:
  *
  *      -   osc::tag::cliclean:     "/nsm/client/is_clean"
  *      -   osc::tag::clidirty:     "/nsm/client/is_dirty"
  *
- *  It sets the m_dirty flag accordingly.
+ *  So an application can call dirty(true) on every edit. If a debounce
+ *  time is set (see dirty_debounce()), the message is sent by
+ *  flush_notifications() once the new state has held that long, and a
+ *  state that flips back in the meantime is never sent. See notifygate.
+ *
+ *  The message is sent under the lock, as endpoint::send_gated() does, so
+ *  that a send decided earlier cannot go out after one decided later.
  *
  *  The old code is not robust enough, we need to get the pattern ("")\
  *  as well.
@@ -425,12 +600,106 @@ nsmbase::dirty (bool isdirty)
 {
     if (lo_is_valid())
     {
-        osc::tag t = isdirty ? osc::tag::clidirty : osc::tag::cliclean ;
-        (void) send_from_client(t);
-        m_dirty = isdirty;
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        if (m_notify.offer_dirty(isdirty, now))
+            send_dirtiness(isdirty);
     }
 }
 
+/**
+ *  Sets how long a new dirty state must hold before it is sent. If 0 (the
+ *  default), a change is sent at once.
+ */
+
+void
+nsmbase::dirty_debounce (int ms)
+{
+    std::lock_guard<std::mutex> lock(m_notify_mutex);
+    m_notify.dirty_debounce(ms);
+}
+
+/**
+ *  Sets the shortest time between progress messages. If 0 (the default),
+ *  every call to progress() sends one.
+ */
+
+void
+nsmbase::progress_interval (int ms)
+{
+    std::lock_guard<std::mutex> lock(m_notify_mutex);
+    m_notify.progress_interval(ms);
+}
+
+/**
+ *  Sends the dirty state and the progress value held back by the debounce
+ *  and the progress interval, if their time has come. Call it from the
+ *  application's timer or event loop; notification_timeout() tells when
+ *  it is next needed. nsmclient::dispatch_commands() also calls it.
+ *
+ * \return
+ *      Returns the number of messages sent.
+ */
+
+int
+nsmbase::flush_notifications ()
+{
+    int result = 0;
+    if (! lo_is_valid())
+        return result;
+
+    bool isdirty = false;
+    float percent = 0.0f;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_notify_mutex);
+    if (m_notify.due_dirty(now, isdirty))
+    {
+        send_dirtiness(isdirty);
+        ++result;
+    }
+    if (m_notify.due_progress(now, percent))
+    {
+        send_progress(percent);
+        ++result;
+    }
+    return result;
+}
+
+/**
+ *  Provides the time until flush_notifications() has something to send,
+ *  for use as a poll timeout.
+ *
+ * \return
+ *      Returns the milliseconds (0 if overdue), or -1 if nothing is held.
+ */
+
+int
+nsmbase::notification_timeout () const
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_notify_mutex);
+    return m_notify.timeout(now);
+}
+
+/**
+ *  Notes that the session manager considers the client clean, after a
+ *  successful open or save reply, so that the next dirty(true) is sent.
+ */
+
+void
+nsmbase::mark_clean ()
+{
+    std::lock_guard<std::mutex> lock(m_notify_mutex);
+    m_notify.mark_clean();
+}
+
+void
+nsmbase::send_dirtiness (bool isdirty)
+{
+    osc::tag t = isdirty ? osc::tag::clidirty : osc::tag::cliclean ;
+    (void) send_from_client(t);
+}
+
 /**
  *  Optionally increments, or clears, the dirty-count.  If active, then the
  *  dirty-count is checked in order to set the dirty-flag.
@@ -446,10 +715,8 @@ nsmbase::update_dirty_count (bool updatedirt)
 
     if (is_active())
     {
-        if (! m_dirty && updatedirt)
-            m_dirty = true;
-        else if (m_dirty && ! updatedirt)
-            m_dirty = false;
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        m_notify.set_dirty(updatedirt);
     }
 }
 
@@ -461,6 +728,12 @@ nsmbase::update_dirty_count (bool updatedirt)
  *
  *  No error handling here, as the data is informational.
  *
+ *  If a progress interval is set (see progress_interval()), a value that
+ *  comes sooner than that after the last one sent is held, and the latest
+ *  held value is sent by flush_notifications(). A value of 100 or more is
+ *  always sent at once, and discards any held value, so the final update
+ *  is never lost or delayed.
+ *
  * \param percent
  *      The indication of progress, ranging from 0.0 to 100.0.
  */
@@ -471,20 +744,46 @@ nsmbase::progress (float percent)
     bool result = lo_is_valid();
     if (result)
     {
-        std::string message;
-        std::string pattern;
-        bool ok = nsm::client_msg(osc::tag::cliprogress, message, pattern);
-        if (ok)
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_notify_mutex);
+        if (m_notify.offer_progress(percent, now))
+            send_progress(percent);
+    }
+    return result;
+}
+
+void
+nsmbase::send_progress (float percent)
+{
+    const osc::msgtemplate * mt = client_template(osc::tag::cliprogress);
+    if (not_nullptr(mt))
+    {
+        osc::msgbuilder & mb = thread_builder();
+        if (mb.start(*mt) && mb.add_float(percent))
         {
-            (void) lo_send_from             /* "/nsm/client/progress" "f"   */
-            (
-                address(), server(), LO_TT_IMMEDIATE_2,
-                CSTR(message), OPTR(pattern), percent
-            );
-            nsm::outgoing_msg(message, pattern, std::to_string(percent));
+            if (send_built(address(), mb) >= 0)
+            {
+                if (util::verbose())            /* skip std::to_string()    */
+                {
+                    nsm::outgoing_msg
+                    (
+                        mt->path(), mt->types(), std::to_string(percent)
+                    );
+                }
+
+                return;
+            }
         }
     }
-    return result;
+
+    std::string message;
+    std::string pattern;
+    bool ok = nsm::client_msg(osc::tag::cliprogress, message, pattern);
+    if (ok)
+    {
+        (void) osc::lowrapper::send(address(), message, percent);
+        nsm::outgoing_msg(message, pattern, std::to_string(percent));
+    }
 }
 
 /**
@@ -668,7 +967,7 @@ nsmbase::send_announcement
     std::string pattern;
     bool result = lo_is_valid();
     if (result)
-        result = nsm::server_msg(osc::tag::guiannounce, message, pattern);
+        result = nsm::server_msg(osc::tag::srvannounce, message, pattern);
 
     if (result)
     {
@@ -696,6 +995,197 @@ nsmbase::send_announcement
     return result;
 }
 
+/**
+ *  Sends the announcement and returns at once. The announce completes when
+ *  the server opens the session, which sets is_active(true); when the
+ *  server returns an error for the announce; or when announce_timeout()
+ *  passes. Note that, if nsmclient::queue_commands() is on, the open is
+ *  done only when the application dispatches the queued commands.
+ *
+ * \param appname
+ *      The "nick-name" of the application.
+ *
+ * \param exename
+ *      Usually argv[0].
+ *
+ * \param capabilities
+ *      The session features the application supports.
+ *
+ * \param cb
+ *      An optional function to call on completion, with the result.
+ *
+ * \param userdata
+ *      The data to pass to the callback.
+ *
+ * \return
+ *      Returns a future that becomes true when the announce succeeds, or
+ *      false when it fails. It is ready at once if another announce is
+ *      pending or the announcement could not be sent.
+ */
+
+std::future<bool>
+nsmbase::announce_async
+(
+    const std::string & appname,
+    const std::string & exename,
+    const std::string & capabilities,
+    announce_callback cb,
+    void * userdata
+)
+{
+    auto busy = [] ()
+    {
+        std::promise<bool> p;
+        p.set_value(false);
+        util::error_message("NSM announce already pending");
+        return p.get_future();
+    };
+    /*
+     * The previous watchdog, if any, has seen its announce complete, and
+     * is on its way out. Join it before marking the new announce pending;
+     * otherwise it could see "pending" again and time out the new one.
+     * The watchdog mutex is held until the new watchdog is started, so
+     * that two callers cannot join the same thread.
+     */
+
+    std::unique_lock<std::mutex> wdlock(m_watchdog_mutex);
+    if (announce_state() == announce_status::pending)
+        return busy();
+
+    if (m_announce_watchdog.joinable())
+        m_announce_watchdog.join();
+
+    std::future<bool> result;
+    {
+        std::lock_guard<std::mutex> lock(m_announce_mutex);
+        if (m_announce_status == announce_status::pending)
+            return busy();                  /* another thread got there     */
+
+        m_announce_status = announce_status::pending;
+        m_announce_promise = std::promise<bool>();
+        m_announce_callback = cb;
+        m_announce_userdata = userdata;
+        result = m_announce_promise.get_future();
+    }
+    if (send_announcement(appname, exename, capabilities))
+    {
+        m_announce_watchdog = std::thread
+        (
+            &nsmbase::announce_watchdog, this, m_announce_timeout_ms
+        );
+    }
+    else
+    {
+        wdlock.unlock();                    /* the callback may re-announce */
+        finish_announce(false);
+    }
+
+    return result;
+}
+
+/**
+ *  Sets the announce timeout used by the next announce_async().
+ *
+ * \param ms
+ *      The timeout in milliseconds. It must be positive; otherwise nothing
+ *      would ever end an announce that gets no answer.
+ *
+ * \return
+ *      Returns false, and keeps the current timeout, if ms is not positive.
+ */
+
+bool
+nsmbase::announce_timeout (int ms)
+{
+    bool result = ms > 0;
+    if (result)
+        m_announce_timeout_ms = ms;
+    else
+        util::error_message("NSM announce timeout must be positive");
+
+    return result;
+}
+
+announce_status
+nsmbase::announce_state () const
+{
+    std::lock_guard<std::mutex> lock(m_announce_mutex);
+    return m_announce_status;
+}
+
+/**
+ *  Blocks until the pending announce completes.
+ *
+ * \param timeoutms
+ *      The longest wait, in milliseconds. If negative, wait until the
+ *      announce completes (the watchdog, if any, ends it).
+ *
+ * \return
+ *      Returns true if the announce is no longer pending.
+ */
+
+bool
+nsmbase::wait_announce (int timeoutms)
+{
+    std::unique_lock<std::mutex> lock(m_announce_mutex);
+    auto done = [this] ()
+    {
+        return m_announce_status != announce_status::pending;
+    };
+    if (timeoutms < 0)
+    {
+        m_announce_cond.wait(lock, done);
+        return true;
+    }
+    return m_announce_cond.wait_for
+    (
+        lock, std::chrono::milliseconds(timeoutms), done
+    );
+}
+
+/**
+ *  Completes a pending announce, fulfilling the future, waking waiters, and
+ *  calling the callback (outside of the lock). Does nothing if no announce
+ *  is pending, so it can be called for every is_active(true).
+ */
+
+void
+nsmbase::finish_announce (bool success)
+{
+    announce_callback cb = nullptr;
+    void * userdata = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_announce_mutex);
+        if (m_announce_status != announce_status::pending)
+            return;
+
+        m_announce_status = success ?
+            announce_status::succeeded : announce_status::failed ;
+
+        m_announce_promise.set_value(success);
+        cb = m_announce_callback;
+        userdata = m_announce_userdata;
+    }
+    m_announce_cond.notify_all();
+    if (not_nullptr(cb))
+        cb(success, userdata);
+}
+
+/**
+ *  Runs in its own thread, started by announce_async(), and fails the
+ *  announce if it is still pending after the timeout.
+ */
+
+void
+nsmbase::announce_watchdog (int timeoutms)
+{
+    if (! wait_announce(timeoutms))
+    {
+        util::error_message("Timed out waiting for NSM");
+        finish_announce(false);
+    }
+}
+
 /*
  * Generic server reply.  Not sure we ever get this one.
  * But see nsmcontroller::osc_handler()'s "/reply" clause.
@@ -761,7 +1251,10 @@ nsmbase::open_session ()
     if (result)
     {
         m_dirty_count = 0;
-        m_dirty = false;
+        {
+            std::lock_guard<std::mutex> lock(m_notify_mutex);
+            m_notify.set_dirty(false);
+        }
         m_nsm_file.clear();
     }
     return result;
@@ -796,7 +1289,10 @@ nsmbase::save_session ()
     if (result)
     {
         m_dirty_count = 0;
-        m_dirty = false;
+        {
+            std::lock_guard<std::mutex> lock(m_notify_mutex);
+            m_notify.set_dirty(false);
+        }
 
         /*
          * Done by caller: m_nsm_file.clear() ???
@@ -903,6 +1399,13 @@ nsmbase::send
 bool
 nsmbase::send_from_client (osc::tag t)
 {
+    const osc::msgtemplate * mt = client_template(t);
+    if (not_nullptr(mt) && send_template(*mt) >= 0)
+    {
+        nsm::outgoing_msg(mt->path(), mt->types(), "Sent");
+        return true;
+    }
+
     std::string message;
     std::string pattern;
     bool result = nsm::client_msg(t, message, pattern);
@@ -921,6 +1424,10 @@ nsmbase::send_from_client
     const std::string & s3
 )
 {
+    const osc::msgtemplate * mt = client_template(t);
+    if (not_nullptr(mt) && send_template(*mt, s1, s2, s3) >= 0)
+        return true;
+
     std::string message;
     std::string pattern;
     bool result = nsm::client_msg(t, message, pattern);
@@ -934,7 +1441,8 @@ nsmbase::send_from_client
 
 /**
  *  A wrapper function for easier trouble-shooting. The last three arguments are
- *  optional.
+ *  optional.  If the pattern is "", "s", "ss", or "sss", the message goes
+ *  through lowrapper::send_strings(), which avoids liblo's allocations.
  */
 
 int
@@ -948,7 +1456,14 @@ nsmbase::send_from
 )
 {
     int result = (-1);
-    if (s1.empty())
+    bool allstrings = pattern.size() <= 3 &&
+        pattern.find_first_not_of('s') == std::string::npos;
+
+    if (allstrings)
+    {
+        result = send_strings(address(), message, pattern, s1, s2, s3);
+    }
+    else if (s1.empty())
     {
         result = lo_send_from
         (
@@ -991,13 +1506,26 @@ nsmbase::send_from
     }
     if (result != (-1))
     {
-        std::string msg = "OSC message sent " + message + pattern;
-        util::session_message(msg);
+        if (! allstrings)               /* send_strings() records its own   */
+        {
+            osc::trace_record
+            (
+                osc::trace_dir::out, CSTR(message), CSTR(pattern),
+                address(), std::uint32_t(result)
+            );
+            stats().sent(CSTR(message), std::uint64_t(result));
+        }
+        if (util::verbose())
+        {
+            std::string msg = "OSC message sent " + message + pattern;
+            util::session_message(msg);
+        }
     }
     else
     {
         std::string msg = "OSC message FAILURE " + message + pattern;
         util::error_message(msg);
+        stats().send_failed();
     }
     return result;
 }
@@ -1190,6 +1718,12 @@ incoming_msg
     }
 }
 
+/**
+ *  Shows an outgoing message, but only in verbose mode. The sends
+ *  themselves are recorded in the binary trace (see osc/trace.hpp), which
+ *  is cheap enough to leave on.
+ */
+
 void
 outgoing_msg
 (
@@ -1198,11 +1732,14 @@ outgoing_msg
     const std::string & data
 )
 {
-    util::info_printf
-    (
-        "%s-->[%s] %s",
-        V(message), V(pattern), V(data)
-    );
+    if (util::verbose())
+    {
+        util::info_printf
+        (
+            "%s-->[%s] %s",
+            V(message), V(pattern), V(data)
+        );
+    }
 }
 
 lib66::tokenization
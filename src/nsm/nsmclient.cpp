@@ -25,7 +25,7 @@
  * \library       nsm66 application
  * \author        Chris Ahlstrom
  * \date          2020-03-01
- * \updates       2025-04-24
+ * \updates       2026-10-14
  * \license       GNU GPLv2 or above
  *
  *  nsmclient is an Non Session Manager (NSM) OSC client agent.  The NSM API
@@ -169,6 +169,16 @@
  *
  *      Functions and headers from cfg66 and lib66 are declared in these
  *      header files.
+ *
+ *  Command queueing:
+ *
+ *      The OSC handlers below run in the liblo server thread. If
+ *      queue_commands(true) has been called, the open, save, loaded,
+ *      label, show, and hide commands are pushed to a wait-free queue, and
+ *      the command_fd() eventfd is signalled. The application then calls
+ *      dispatch_commands() from its own thread, which calls the virtual
+ *      functions there, or pops the commands itself. Then the application
+ *      needs no locking between its session code and its other threads.
  */
 
 #include "c_macros.h"                   /* not_nullptr() macro              */
@@ -179,13 +189,25 @@
 #include "util/msgfunctions.hpp"        /* util::info_printf()              */
 #include "util/strfunctions.hpp"        /* V() macro                        */
 
+#if defined PLATFORM_LINUX
+#include <cstdint>                      /* std::uint64_t                    */
+#include <sys/eventfd.h>                /* eventfd()                        */
+#include <unistd.h>                     /* ::read(), ::write(), ::close()   */
+#endif
+
 namespace nsm
 {
 
 /*--------------------------------------------------------------------------
- * OSC nsmclient handler static functions
+ * OSC nsmclient handlers
  *--------------------------------------------------------------------------*/
 
+/*
+ *  Except for osc_nsm_broadcast(), which takes any arguments, these are
+ *  typed handlers (see osc/typedmethod.hpp): the arguments arrive decoded,
+ *  as string views into the message, and the types have been checked.
+ */
+
 /**
  *  A handler for osc::tag::replyex =  { "/reply" + "ssss" }
  *
@@ -198,30 +220,28 @@ namespace nsm
  *  reply.
  */
 
-int
-nsmclient::osc_nsm_announce_reply
+bool
+nsmclient::on_announce_reply
 (
-    const char * path,
-    const char * types,
-    lo_arg ** argv,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
+    const osc::message_info & info,
+    const char * replied,
+    std::string_view mesg,
+    std::string_view manager,
+    std::string_view capabilities
 )
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
-
-    if (nsm::is_gui_announce(&argv[0]->s))      /* check the /reply path    */
+    if (nsm::is_gui_announce(replied))          /* the /reply path          */
     {
-        nsm::incoming_msg("Announce Reply", path, types);
-        pnsmc->announce_reply(&argv[1]->s, &argv[2]->s, &argv[3]->s);
+        nsm::incoming_msg("Announce Reply", info.mi_path, info.mi_types);
+        announce_reply
+        (
+            std::string(mesg), std::string(manager), std::string(capabilities)
+        );
     }
     else
-        nsm::incoming_msg("Basic Reply", path, types);
+        nsm::incoming_msg("Basic Reply", info.mi_path, info.mi_types);
 
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -230,24 +250,31 @@ nsmclient::osc_nsm_announce_reply
  *  See nsmclient::open() for more information.
  */
 
-int
-nsmclient::osc_nsm_open
+bool
+nsmclient::on_open
 (
-    const char * path,
-    const char * types,
-    lo_arg ** argv,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
+    const osc::message_info & info,
+    std::string_view pathname,
+    std::string_view displayname,
+    std::string_view clientid
 )
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
-
-    nsm::incoming_msg("Open", path, types);
-    pnsmc->open(&argv[0]->s, &argv[1]->s, &argv[2]->s);
-    return osc::osc_msg_handled();
+    nsm::incoming_msg("Open", info.mi_path, info.mi_types);
+    if
+    (
+        ! post_command
+        (
+            session_command::kind::open, pathname, displayname, clientid
+        )
+    )
+    {
+        open
+        (
+            std::string(pathname), std::string(displayname),
+            std::string(clientid)
+        );
+    }
+    return true;
 }
 
 /**
@@ -258,24 +285,14 @@ nsmclient::osc_nsm_open
  *  not much to do in this base class.
  */
 
-int
-nsmclient::osc_nsm_save
-(
-    const char * path,
-    const char * types,
-    lo_arg ** /* argv */,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
-)
+bool
+nsmclient::on_save (const osc::message_info & info)
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
+    nsm::incoming_msg("Save", info.mi_path, info.mi_types);
+    if (! post_command(session_command::kind::save))
+        save();                     /* a virtual function   */
 
-    nsm::incoming_msg("Save", path, types);
-    pnsmc->save();                  /* a virtual function   */
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -285,24 +302,14 @@ nsmclient::osc_nsm_save
  *  See nsmclient::loaded() for more information.
  */
 
-int
-nsmclient::osc_nsm_session_loaded
-(
-    const char * path,
-    const char * types,
-    lo_arg ** /* argv */,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
-)
+bool
+nsmclient::on_loaded (const osc::message_info & info)
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
+    nsm::incoming_msg("Session Loaded", info.mi_path, info.mi_types);
+    if (! post_command(session_command::kind::loaded))
+        loaded();
 
-    nsm::incoming_msg("Session Loaded", path, types);
-    pnsmc->loaded();
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -326,24 +333,14 @@ nsmclient::osc_nsm_session_loaded
  *  osc::tag::guiswitch.
  */
 
-int
-nsmclient::osc_nsm_label
-(
-    const char * path,
-    const char * types,
-    lo_arg ** argv,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
-)
+bool
+nsmclient::on_label (const osc::message_info & info, std::string_view text)
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
+    nsm::incoming_msg("Label", info.mi_path, info.mi_types);
+    if (! post_command(session_command::kind::label, text))
+        label(std::string(text));   /* a virtual function   */
 
-    nsm::incoming_msg("Label", path, types);
-    pnsmc->label(std::string(&argv[0]->s));         /* a virtual function */
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -363,24 +360,14 @@ nsmclient::osc_nsm_label
  *  to show itself.
  */
 
-int
-nsmclient::osc_nsm_show
-(
-    const char * path,
-    const char * types,
-    lo_arg ** /* argv */,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
-)
+bool
+nsmclient::on_show (const osc::message_info & info)
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (is_nullptr(pnsmc))
-        return osc::osc_msg_unhandled();
+    nsm::incoming_msg("Show", info.mi_path, info.mi_types);
+    if (! post_command(session_command::kind::show, info.mi_path))
+        show(info.mi_path);         /* a virtual function   */
 
-    nsm::incoming_msg("Show", path, types);
-    pnsmc->show(path);                  /* a virtual function   */
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -408,24 +395,14 @@ nsmclient::osc_nsm_show
  *  Also see osc_nsm_show() above.
  */
 
-int
-nsmclient::osc_nsm_hide
-(
-    const char * path,
-    const char * types,
-    lo_arg ** /* argv */,
-    int /* argc */,
-    lo_message /* msg */,
-    void * user_data
-)
+bool
+nsmclient::on_hide (const osc::message_info & info)
 {
-    nsmbase * pnsmc = static_cast<nsmbase *>(user_data);
-    if (pnsmc == NULL)
-        return osc::osc_msg_unhandled();
+    nsm::incoming_msg("Hide", info.mi_path, info.mi_types);
+    if (! post_command(session_command::kind::hide, info.mi_path))
+        hide(info.mi_path);
 
-    nsm::incoming_msg("Hide", path, types);
-    pnsmc->hide(path);
-    return osc::osc_msg_handled();
+    return true;
 }
 
 /**
@@ -468,14 +445,202 @@ nsmclient::nsmclient
     const std::string & nsmfile,
     const std::string & nsmext
 ) :
-    nsmbase             (nsmurl, nsmfile, nsmext)
+    nsmbase             (nsmurl, nsmfile, nsmext),
+    m_hidden            (false),
+    m_commands          (),
+    m_queueing          (false),
+    m_command_fd        (-1),
+    m_commands_dropped  (0)
 {
     // no code so far
 }
 
 nsmclient::~nsmclient ()
 {
-    // no code so far
+    /*
+     * The OSC thread must be gone before the queue is freed.
+     */
+
+    m_queueing = false;
+    stop_thread();
+#if defined PLATFORM_LINUX
+    if (m_command_fd >= 0)
+        (void) ::close(m_command_fd);
+#endif
+}
+
+/**
+ *  Turns command queueing on or off. It can be called before or after
+ *  initialize(). While it is on, the OSC thread does not call open(),
+ *  save(), loaded(), label(), show(), or hide(); the application must call
+ *  dispatch_commands() or pop_command() from one thread of its choice.
+ *
+ * \param flag
+ *      If true, queue the commands.
+ *
+ * \param capacity
+ *      The size of the queue, used only when it is first created.
+ *
+ * \return
+ *      Returns false if the queue could not be created.
+ */
+
+bool
+nsmclient::queue_commands (bool flag, std::size_t capacity)
+{
+    if (flag && ! m_commands)
+    {
+        m_commands.reset
+        (
+            new (std::nothrow) osc::spscqueue<session_command>(capacity)
+        );
+        if (! m_commands)
+            return false;
+
+#if defined PLATFORM_LINUX
+        m_command_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    }
+    m_queueing = flag;                  /* publishes the queue to OSC side  */
+    return true;
+}
+
+/**
+ *  Called in the OSC thread to queue a command, if queueing. If the queue
+ *  is full, the command is dropped, counted, and logged.
+ *
+ * \return
+ *      Returns true if the command was taken by the queue, in which case
+ *      the caller must not handle it.
+ */
+
+bool
+nsmclient::post_command
+(
+    session_command::kind k,
+    std::string_view text,
+    std::string_view displayname,
+    std::string_view clientid
+)
+{
+    if (! m_queueing)
+        return false;
+
+    session_command cmd;
+    cmd.sc_kind = k;
+    cmd.sc_text = text;
+    cmd.sc_display_name = displayname;
+    cmd.sc_client_id = clientid;
+    if (m_commands->push(std::move(cmd)))
+    {
+        stats().queue_depth(osc::metric_queue::commands, m_commands->size());
+#if defined PLATFORM_LINUX
+        if (m_command_fd >= 0)
+        {
+            std::uint64_t one = 1;
+            ssize_t rc = ::write(m_command_fd, &one, sizeof one);
+            (void) rc;
+        }
+#endif
+    }
+    else
+    {
+        ++m_commands_dropped;
+        util::error_message("NSM command queue full, command dropped");
+    }
+    return true;
+}
+
+/**
+ *  Pops the next queued command. It does no system calls, and so can be
+ *  called from a realtime thread. Only one thread may pop commands.
+ *
+ * \return
+ *      Returns false if there are no commands waiting.
+ */
+
+bool
+nsmclient::pop_command (session_command & cmd)
+{
+    return m_commands && m_commands->pop(cmd);
+}
+
+/**
+ *  Resets the command_fd() eventfd, so that poll(2) no longer reports it
+ *  as readable. Call it before popping the commands, so that a command
+ *  queued in the meantime signals the descriptor again.
+ */
+
+void
+nsmclient::acknowledge_commands ()
+{
+#if defined PLATFORM_LINUX
+    if (m_command_fd >= 0)
+    {
+        std::uint64_t count;
+        ssize_t rc = ::read(m_command_fd, &count, sizeof count);
+        (void) rc;
+    }
+#endif
+}
+
+/**
+ *  Acknowledges and pops all of the queued commands, calling the matching
+ *  virtual function for each, in the caller's thread. Then it sends any
+ *  dirty state or progress that is due; see flush_notifications().
+ *
+ * \return
+ *      Returns the number of commands handled.
+ */
+
+int
+nsmclient::dispatch_commands ()
+{
+    int result = 0;
+    session_command cmd;
+    acknowledge_commands();
+    while (pop_command(cmd))
+    {
+        switch (cmd.sc_kind)
+        {
+            case session_command::kind::open:
+
+                open(cmd.sc_text, cmd.sc_display_name, cmd.sc_client_id);
+                break;
+
+            case session_command::kind::save:
+
+                save();
+                break;
+
+            case session_command::kind::loaded:
+
+                loaded();
+                break;
+
+            case session_command::kind::label:
+
+                label(cmd.sc_text);
+                break;
+
+            case session_command::kind::show:
+
+                show(cmd.sc_text);
+                break;
+
+            case session_command::kind::hide:
+
+                hide(cmd.sc_text);
+                break;
+
+            default:
+
+                break;
+        }
+        ++result;
+    }
+    (void) flush_notifications();       /* after any save's clean state     */
+    return result;
 }
 
 /**
@@ -489,15 +654,27 @@ nsmclient::initialize ()
     bool result = nsmbase::initialize();
     if (result)
     {
-        add_thread_method(osc::tag::replyex, osc_nsm_announce_reply);
-        add_thread_method(osc::tag::cliopen, osc_nsm_open);
-        add_thread_method(osc::tag::clisave, osc_nsm_save);
-        add_thread_method(osc::tag::cliloaded, osc_nsm_session_loaded);
-        add_thread_method(osc::tag::clilabel, osc_nsm_label);
-        add_thread_method(osc::tag::clishow, osc_nsm_show);
-        add_thread_method(osc::tag::clihide, osc_nsm_hide);
-        add_thread_method(osc::tag::null, osc_nsm_broadcast);
-        start_thread();
+        using osc::tag;
+        using self = nsmclient;
+        result =
+            add_typed_thread_method<&self::on_announce_reply>
+            (
+                tag::replyex, this
+            ) &&
+            add_typed_thread_method<&self::on_open>(tag::cliopen, this) &&
+            add_typed_thread_method<&self::on_save>(tag::clisave, this) &&
+            add_typed_thread_method<&self::on_loaded>(tag::cliloaded, this) &&
+            add_typed_thread_method<&self::on_label>(tag::clilabel, this) &&
+            add_typed_thread_method<&self::on_show>(tag::clishow, this) &&
+            add_typed_thread_method<&self::on_hide>(tag::clihide, this);
+
+        if (result)
+        {
+            add_thread_method(tag::null, osc_nsm_broadcast, this);
+            start_thread();
+        }
+        else
+            util::error_message("Could not add the client OSC handlers");
     }
     return result;
 }
@@ -724,7 +901,10 @@ nsmclient::handle_broadcast
  *  argv[0]).
  *
  *  We wait on the reply from NSM, which is flagged by an atomic boolean in
- *  the open() function.
+ *  the open() function. The wait is done on a condition variable that the
+ *  OSC thread signals, so there is no polling delay. It times out after
+ *  announce_timeout() milliseconds. See nsmbase::announce_async() for the
+ *  non-blocking version.
  *
 \verbatim
     /nsm/server/announce s:application_name s:capabilities s:executable_name
@@ -753,22 +933,20 @@ nsmclient::announce
     const std::string & capabilities    /* e.g. ":switch:dirty:"            */
 )
 {
-    bool result = send_announcement(appname, exename, capabilities);
-    if (result)
+    const int s_dispatch_ms = 10;
+    std::future<bool> done = announce_async(appname, exename, capabilities);
+    if (queue_commands())
     {
-        int count = 12;
-        while (! is_active())           /* this is an atomic boolean check  */
-        {
-            (void) msg_check(1000);
-            if (--count == 0)
-            {
-                errprint("Timed out waiting for NSM");
-                result = false;
-                break;
-            }
-        }
+        /*
+         * The open() that completes the announce is queued for us.
+         */
+
+        while (! wait_announce(s_dispatch_ms))
+            (void) dispatch_commands();
+
+        (void) dispatch_commands();
     }
-    return result;
+    return done.get();
 }
 
 /*
@@ -27,7 +27,7 @@
  * \library       nsmctl application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-21
- * \updates       2026-02-26
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -72,10 +72,22 @@ nsmcontroller::nsmcontroller
     m_osc_server            (),
     m_daemon_list           (alldaemons),
     m_session_list          (),
+    m_session_mutex         (),
+    m_list_sources          (),
+    m_session_list_gaps     (0),
+    m_batched_list          (false),
     m_clients_pack          (),
+    m_clients_mutex         (),
     m_last_ping_response    (0),
-    m_ping_timeout          (10),
     m_ping_count            (pingct),
+    m_ping_stats            (),
+    m_ping_mutex            (),
+    m_ping_interval_ms      (1000),
+    m_ping_reply_timeout_ms (1000),
+    m_fanout                (),
+    m_fanout_mutex          (),
+    m_fanout_timeout_ms     (10000),
+    m_fanout_reported       (true),
     m_app_name              (appname),
     m_exe_name              (exename),
     m_capabilities          (capabilities),
@@ -85,8 +97,19 @@ nsmcontroller::nsmcontroller
     // deactivate();
 }
 
+/**
+ *  Stops the OSC thread and waits for it, as the endpoint destructor does
+ *  not, and the thread's handlers use this object.
+ */
+
+nsmcontroller::~nsmcontroller ()
+{
+    if (deactivate())
+        m_osc_server->stop();
+}
+
 void
-nsmcontroller::log_status (const std::string & s, bool iserror)
+nsmcontroller::log_status (std::string_view s, bool iserror)
 {
     time_t now = time(NULL);
     struct tm * tm = localtime(&now);
@@ -187,8 +210,14 @@ nsmcontroller::send_server_message
         {
             result = true;
             util::info_message("Refreshing session list");
+            {
+                std::lock_guard<std::mutex> lock(m_session_mutex);
+                m_session_list.clear();
+                m_list_sources.clear();
+                m_session_list_gaps = 0;
+            }
             for (const auto & d : m_daemon_list)
-                m_osc_server->send(d.addr(), msgstr);
+                request_session_list(d.addr());
         }
         else if (msg == osc::tag::srvnew)           /* create a new session */
         {
@@ -231,6 +260,7 @@ nsmcontroller::send_client_message
     const std::string & clientname
 )
 {
+    std::lock_guard<std::recursive_mutex> lock(m_clients_mutex);
     nsmctlclient * c = client_by_name(clientname);
     bool result = not_nullptr(c);
     if (result)
@@ -242,52 +272,266 @@ nsmcontroller::send_client_message
 }
 
 /**
- *  The original clients_pack was an FLTK container (disclaimer, we know
- *  nothing about FLTK). Here, we have a map of IDs and client names.
- *  The client IDs are of the form "nXYZT".
+ *  Sends a command to a set of clients at once, without waiting for the
+ *  answers, and starts tracking them. Any previous fan-out is forgotten.
+ *  Call fanout_tick() from the control loop, or fanout_wait(), to collect
+ *  the answers.
+ *
+ * \param msg
+ *      The command, such as osc::tag::guisave.
+ *
+ * \param clients
+ *      The client names or IDs. If empty, all clients get the command.
  *
- *  Note the C++17 allows the find() and end() check to be together
- *  in the if() clause.
+ * \param timeoutms
+ *      How long the clients have to answer. If 0, the value set by
+ *      fanout_timeout() is used.
+ *
+ * \return
+ *      Returns the number of clients the command was sent to.
  */
 
-nsmctlclient *
-nsmcontroller::client_by_id (const std::string & id) const
-{
-    nsmctlclient * result = nullptr;
-#if defined PLATFORM_CPP_17
-    if (auto c = m_clients_pack.find(id); c != m_clients_pack.end())
-        result = c->second;
-#else
-    auto c = m_clients_pack.find(id);
-    if (c != m_clients_pack.end())
-        result = c->second;
-#endif
+int
+nsmcontroller::send_clients_message
+(
+    osc::tag msg,
+    const lib66::tokenization & clients,
+    int timeoutms
+)
+{
+    std::lock_guard<std::recursive_mutex> clock(m_clients_mutex);
+    std::vector<clientregistry::handle> targets;
+    if (clients.empty())
+    {
+        for (const auto & c : m_clients_pack)
+            targets.push_back(m_clients_pack.find_id(c.client_id()));
+    }
+    else
+    {
+        for (const auto & name : clients)
+        {
+            clientregistry::handle h = m_clients_pack.find_id(name);
+            if (h == clientregistry::c_no_handle)
+                h = m_clients_pack.find_name(name);
+
+            if (h != clientregistry::c_no_handle)
+                targets.push_back(h);
+            else
+                util::error_message("Client not found", name);
+        }
+    }
+
+    /*
+     * All of the clients are entered before the first send, as the first
+     * answers can come in while the rest are being sent.
+     */
+
+    {
+        std::lock_guard<std::mutex> lock(m_fanout_mutex);
+        m_fanout.start
+        (
+            msg, fanout::clock::now(),
+            timeoutms > 0 ? timeoutms : m_fanout_timeout_ms
+        );
+        for (auto h : targets)
+        {
+            const nsmctlclient * c = m_clients_pack.get(h);
+            m_fanout.add(c->client_id(), c->client_name());
+        }
+        m_fanout_reported = false;
+    }
+
+    int result = 0;
+    for (auto h : targets)
+    {
+        nsmctlclient * c = m_clients_pack.get(h);
+        if (c->send_client_message(msg))
+            ++result;
+    }
     return result;
 }
 
 /**
- *  Brute-force lookup. It takes advantage of the fact that
- *  the nsmctlclient has a a name memeber.
+ *  Expires the clients that have not answered in time, and logs the
+ *  summary once the fan-out is over. Call it regularly from the control
+ *  loop.
+ *
+ * \return
+ *      Returns true while some clients have yet to answer.
  */
 
-nsmctlclient *
-nsmcontroller::client_by_name (const std::string & name) const
+bool
+nsmcontroller::fanout_tick ()
+{
+    fanout_expire(fanout::clock::now());
+
+    std::lock_guard<std::mutex> lock(m_fanout_mutex);
+    return m_fanout.active();
+}
+
+/**
+ *  Waits until every client has answered or the deadline has passed.
+ *
+ * \return
+ *      Returns true if every client answered with success.
+ */
+
+bool
+nsmcontroller::fanout_wait ()
+{
+    const int s_slice_ms = 10;
+    while (fanout_tick())
+        osc_wait(s_slice_ms);
+
+    std::lock_guard<std::mutex> lock(m_fanout_mutex);
+    int total = int(m_fanout.entries().size());
+    return m_fanout.count(fanout::state::done) == total;
+}
+
+/**
+ *  The aggregate progress of the latest fan-out, from 0 to 1.
+ */
+
+float
+nsmcontroller::fanout_progress () const
+{
+    std::lock_guard<std::mutex> lock(m_fanout_mutex);
+    return m_fanout.total_progress();
+}
+
+/**
+ *  Gets a copy of the latest fan-out, with the per-client latencies.
+ *
+ * \return
+ *      Returns false if no fan-out has been started.
+ */
+
+bool
+nsmcontroller::fanout_status (fanout & f) const
+{
+    std::lock_guard<std::mutex> lock(m_fanout_mutex);
+    bool result = m_fanout.started();
+    if (result)
+        f = m_fanout;
+
+    return result;
+}
+
+/**
+ *  Passes a client message from nsmd to the fan-out. A finished save also
+ *  records the latency in the client.
+ */
+
+void
+nsmcontroller::fanout_message
+(
+    osc::tag msgtag,
+    nsmctlclient * c,
+    std::string_view value,
+    float p,
+    fanout::clock::time_point t
+)
 {
-    nsmctlclient * result = nullptr;
-    for (auto c : m_clients_pack)
+    bool finished = false;
+    long us = (-1);
+    bool issave = false;
     {
-        if (c.second->client_name() == name)
+        std::lock_guard<std::mutex> lock(m_fanout_mutex);
+        if (msgtag == osc::tag::guistatus)
+        {
+            std::string status { value };
+            finished = m_fanout.status(c->client_id(), status, t);
+        }
+        else if (msgtag == osc::tag::guivisible)
+            finished = m_fanout.visible(c->client_id(), t);
+        else if (msgtag == osc::tag::guiprogress)
+            (void) m_fanout.progress(c->client_id(), p);
+        else if (msgtag == osc::tag::guiswitch)
+            (void) m_fanout.client_switch(c->client_id(), std::string(value));
+
+        if (finished)
         {
-            result = c.second;
-            break;
+            const fanout::entry * e = m_fanout.client(c->client_id());
+            us = m_fanout.latency_us(*e);
+            issave = m_fanout.command() == osc::tag::guisave ||
+                m_fanout.command() == osc::tag::guidirty;
         }
     }
-    return result;
+    if (finished)
+    {
+        if (issave)
+            c->save_latency_us(us);
+
+        if (util::verbose())
+        {
+            util::info_printf("%s answered after %ld us", V(c->info()), us);
+        }
+        fanout_expire(t);                   /* logs the end of the fan-out */
+    }
+}
+
+/**
+ *  Expires the stragglers, and once nobody is pending, logs the summary.
+ */
+
+void
+nsmcontroller::fanout_expire (fanout::clock::time_point t)
+{
+    std::string report;
+    std::vector<std::string> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_fanout_mutex);
+        if (m_fanout.expire(t) > 0)
+        {
+            for (const auto & e : m_fanout.entries())
+            {
+                if (e.fe_state == fanout::state::expired)
+                    expired.push_back(e.fe_client_name);
+            }
+        }
+        if (! m_fanout_reported && ! m_fanout.active())
+        {
+            m_fanout_reported = true;
+            report = m_fanout.report();
+        }
+    }
+    for (const auto & name : expired)
+        log_status("Client did not answer in time: " + name, true);
+
+    if (! report.empty())
+        log_status(report);
+}
+
+/**
+ *  The original clients_pack was an FLTK container (disclaimer, we know
+ *  nothing about FLTK). Here, we have a registry of clients, indexed by
+ *  the client IDs (of the form "nXYZT") and by the client names.
+ *
+ *  The pointer returned is good only until a client is added or removed,
+ *  so the caller must hold lock_clients() while it uses the pointer.
+ */
+
+nsmctlclient *
+nsmcontroller::client_by_id (const std::string & id)
+{
+    return m_clients_pack.by_id(id);
+}
+
+/**
+ *  Names need not be unique; this returns the first client registered with
+ *  the name.
+ */
+
+nsmctlclient *
+nsmcontroller::client_by_name (const std::string & name)
+{
+    return m_clients_pack.by_name(name);
 }
 
 void
 nsmcontroller::client_stopped (const std::string & id)
 {
+    std::lock_guard<std::recursive_mutex> lock(m_clients_mutex);
     nsmctlclient * c = client_by_id(id);
     if (not_nullptr(c))
         c->stopped(true);
@@ -301,12 +545,13 @@ nsmcontroller::client_stopped (const std::string & id)
 void
 nsmcontroller::client_quit (const std::string & id)
 {
-    auto cit = m_clients_pack.find(id);
-    if (cit != m_clients_pack.end())
+    std::lock_guard<std::recursive_mutex> lock(m_clients_mutex);
+    clientregistry::handle h = m_clients_pack.find_id(id);
+    nsmctlclient * c = m_clients_pack.get(h);
+    if (not_nullptr(c))
     {
-        util::info_message(cit->second->info("Erased"));
-        delete cit->second;
-        m_clients_pack.erase(cit);
+        util::info_message(c->info("Erased"));
+        (void) m_clients_pack.remove(h);
     }
 }
 
@@ -323,46 +568,36 @@ nsmcontroller::client_new
 )
 {
     bool result = false;
-    nsmctlclient * c = client_by_id(client_id);
-    if (not_nullptr(c))
+    std::lock_guard<std::recursive_mutex> lock(m_clients_mutex);
+    clientregistry::handle h = m_clients_pack.find_id(client_id);
+    if (h != clientregistry::c_no_handle)
     {
-        c->name(client_name);
-        result = true;
+        result = m_clients_pack.client_name(h, client_name);
     }
     else
     {
-        c = new (std::nothrow) nsmctlclient
+        h = m_clients_pack.add
         (
-            m_osc_server.get(), m_daemon_list,
-            client_id, "", client_name
+            nsmctlclient
+            (
+                m_osc_server.get(), m_daemon_list,
+                client_id, "", client_name
+            )
         );
-        if (not_nullptr(c))
+        if (h != clientregistry::c_no_handle)
         {
-            auto p = std::make_pair(client_id, c);
-            auto r = m_clients_pack.insert(p);
-            if (r.second)
-            {
-                util::info_printf
-                (
-                    "New client: ID %s, name %s",
-                    V(client_id), V(client_name)
-                );
-                result = true;
-            }
-            else
-            {
-                util::warn_printf
-                (
-                    "Could not insert client: ID %s, name %s",
-                    V(client_id), V(client_name)
-                );
-            }
+            util::info_printf
+            (
+                "New client: ID %s, name %s",
+                V(client_id), V(client_name)
+            );
+            result = true;
         }
         else
         {
-            util::error_printf
+            util::warn_printf
             (
-                "Could not create client: ID %s, name %s",
+                "Could not insert client: ID %s, name %s",
                 V(client_id), V(client_name)
             );
         }
@@ -370,11 +605,40 @@ nsmcontroller::client_new
     return result;
 }
 
+/**
+ *  Changes the ID of a client, as requested by /nsm/gui/client/switch.
+ */
+
+bool
+nsmcontroller::client_switch
+(
+    const std::string & client_id,
+    const std::string & new_id
+)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_clients_mutex);
+    clientregistry::handle h = m_clients_pack.find_id(client_id);
+    bool result = m_clients_pack.client_id(h, new_id);
+    if (! result)
+    {
+        util::warn_printf
+        (
+            "Could not switch client ID %s to %s", V(client_id), V(new_id)
+        );
+    }
+    return result;
+}
+
+/**
+ *  The caller holds lock_clients(), as the client comes from the registry.
+ *  A "removed" status erases the client, so c is not valid afterward.
+ */
+
 void
 nsmcontroller::client_pending_command
 (
     nsmctlclient * c,
-    const std::string & command
+    std::string_view command
 )
 {
     if (not_nullptr(c))
@@ -382,7 +646,7 @@ nsmcontroller::client_pending_command
         if (command == "removed")
             client_quit(c->client_id());
         else
-            c->pending_command(command);
+            c->pending_command(std::string(command));
     }
 }
 
@@ -406,148 +670,396 @@ nsmcontroller::deactivate ()
 {
     bool result = bool(m_osc_server);
     if (result)
+    {
         m_osc_server->active(false);
+        m_osc_server->wakeup();         /* do not wait for the OSC thread   */
+    }
 
     return result;
 }
 
+/**
+ *  Pings all of the daemons m_ping_count times, waiting for the replies
+ *  to each round, up to the reply timeout. It returns as soon as all of
+ *  the daemons have replied, rather than waiting a second per round.
+ *
+ * \return
+ *      Returns false if there are no daemons, or if a daemon did not reply
+ *      in a round.
+ */
+
 bool
 nsmcontroller::ping ()
 {
+    const int s_slice_ms = 10;
     bool result = ! m_daemon_list.empty();
-    if (result)
+    for (int i = 0; result && i < m_ping_count; ++i)
     {
-        m_last_ping_response = time(NULL);
-        for (int i = 0; i < m_ping_count; ++i)
-        {
-            for (const auto & d : m_daemon_list)
-                m_osc_server->send(d.addr(), "/osc/ping"); /* osc::tag::ping */
+        auto deadline = pingstats::clock::now() +
+            std::chrono::milliseconds(m_ping_reply_timeout_ms);
 
-            if (m_last_ping_response > 0)
-            {
-                if ((time(NULL) - m_last_ping_response) > m_ping_timeout)
-                {
-                    log_status("Server not responding...", true);  /* error */
-                    result = false;
-                    break;
-                }
-                else
-                    log_status("Server responds");
-            }
-            osc_wait(1000);
+        (void) send_pings(true);
+        while (pings_outstanding() && pingstats::clock::now() < deadline)
+            osc_wait(s_slice_ms);
+
+        (void) send_pings(false);           /* expires the stragglers      */
+        if (pings_lost())
+        {
+            log_status("Server not responding...", true);  /* error */
+            result = false;
         }
+        else
+            log_status("Server responds");
     }
     return result;
 }
 
 /**
- *  See add_method in nsm66d. This is similar. Note that the userdata
- *  parameter is always NULL here, and the argument-description is
- *  stored in a osc::method object created in endpoint::add_method().
+ *  The non-blocking ping scheduler. Call it regularly (e.g. every 10 to
+ *  100 ms) from the control loop. It declares the pings that have waited
+ *  longer than the reply timeout lost, then sends a new ping to each
+ *  daemon whose ping interval has passed. The replies are timed by the OSC
+ *  handler.
  *
- *  We would like to generalize it somehow.
+ * \return
+ *      Returns true if there are daemons and none of them has lost its
+ *      latest ping.
  */
 
-void
-nsmcontroller::add_method
-(
-    osc::tag t,
-    osc::method_handler f,
-    const std::string & argument_description
-)
+bool
+nsmcontroller::ping_tick ()
 {
-    std::string msg, pattern;
-    if (osc::tag_lookup(t, msg, pattern))
+    bool result = ! m_daemon_list.empty();
+    if (result)
     {
-        (void) m_osc_server->add_method     /* OSC server is osc::endpoint  */
-        (
-            msg, pattern, f, NULL, argument_description
-        );
+        (void) send_pings(false);
+        result = ! pings_lost();
     }
+    return result;
 }
 
 /**
- *  In endpoint, we already add the oscreply and error tags, plus. generic,
- *  sigconnect, sigcreated, sigdisconnect, sighello, siglist, sigremoved,
- *  sigrenamed, and srvreply.
- *
- *  These are the original messages.
- *
- *  "/error",                           "sis",  "msg"   (done in lowrapper)
- *  "/reply",                           "ss",   "msg"   (done in lowrapper)
- *  "/reply",                           "s",    ""
- *  "/nsm/server/broadcast",            NULL,   "msg"
- *  "/nsm/gui/server_announce",         "s",    "msg"
- *  "/nsm/gui/server/message",          "s",    "msg"
- *  "/nsm/gui/gui_announce",            "s",    "msg"
- *  "/nsm/gui/session/session",         "s",    "path,display_name"
- *  "/nsm/gui/session/name",            "ss",   "path,display_name"
- *  "/nsm/gui/client/new",              "ss",   "path,display_name"
- *  "/nsm/gui/client/status",           "ss",   "path,display_name"
- *  "/nsm/gui/client/switch",           "ss",   "path,display_name"
- *  "/nsm/gui/client/progress",         "sf",   "path,display_name"
- *  "/nsm/gui/client/dirty",            "si",   "path,display_name"
- *  "/nsm/gui/client/has_optional_gui", "s",    "path,display_name"
- *  "/nsm/gui/client/gui_visible",      "si",   "path,display_name"
- *  "/nsm/gui/client/label",            "ss",   "path,display_name"
- *
- *  endpoint::init() adds the /error and /reply methods plus a set of
- *  /signal/xxxx methods, and a /reply with a NULL type-specification
- *  and a generic NULL+NULL method.
- *
- *  Here we add support for "/nsm/gui/session/root", which is not
- *  in the original NSM controller.
- *
- * \param portname
- *      This parameter defaults to "". Otherwise, it can be set (for
- *      example) to the looked-up address of a server port, such as
- *      "osc.udp://mlsleno:11086/".
+ *  Gets a copy of the ping statistics of a daemon.
  *
  * \return
- *      Returns true if the OSC server could be initialized.
+ *      Returns false if the daemon has never been pinged.
  */
 
 bool
-nsmcontroller::init_osc (const std::string & portname)
+nsmcontroller::ping_stats (const std::string & url, pingstats & stats) const
 {
-    m_osc_server.reset(new (std::nothrow) osc::endpoint());
-    bool result = bool(m_osc_server);
-    if (result)
-        result = m_osc_server->init(LO_UDP, portname, true);
-
+    std::lock_guard<std::mutex> lock(m_ping_mutex);
+    auto it = m_ping_stats.find(url);
+    bool result = it != m_ping_stats.end();
     if (result)
-    {
-        const std::string msg { "msg" };
-        const std::string pd { "path,display_name" };
-        m_osc_server->owner(this);
+        stats = it->second;
 
-        add_method(osc::tag::error,             osc_handler, msg);
-        add_method(osc::tag::reply,             osc_handler, msg);
-        add_method(osc::tag::replyex,           osc_handler, msg);
-        add_method(osc::tag::srvreply,          osc_handler, msg);
-        add_method(osc::tag::srvbroadcast,      osc_broadcast_handler, msg);
-        add_method(osc::tag::guisrvannounce,    osc_handler, msg);
-        add_method(osc::tag::srvmessage,        osc_handler, msg);
-        add_method(osc::tag::gui_announce,      osc_handler, msg);  /* "s"  */
-        add_method(osc::tag::guisession,        osc_handler, pd);
-        add_method(osc::tag::guisessionname,    osc_handler, pd);
-        add_method(osc::tag::guinew,            osc_handler, pd);
-        add_method(osc::tag::guistatus,         osc_handler, pd);
-        add_method(osc::tag::guiswitch,         osc_handler, pd);
-        add_method(osc::tag::guiprogress,       osc_handler, pd);
-        add_method(osc::tag::guidirty,          osc_handler, pd);
-        add_method(osc::tag::guioption,         osc_handler, pd);
-        add_method(osc::tag::guivisible,        osc_handler, pd);
-        add_method(osc::tag::guilabel,          osc_handler, pd);
-        add_method(osc::tag::sessionroot,       osc_handler, pd);
-        m_osc_server->start();
-    }
-    else
-    {
-        /*
-         * should we delete m_osc_server and null that pointer here????
-         */
-    }
+    return result;
+}
+
+/**
+ *  Expires the overdue pings, then sends new pings where needed. The
+ *  timestamp is taken just before each send.
+ *
+ * \param force
+ *      If true, ping every daemon that has no outstanding ping, whatever
+ *      the interval.
+ *
+ * \return
+ *      Returns the number of pings sent.
+ */
+
+int
+nsmcontroller::send_pings (bool force)
+{
+    const long timeoutus = long(m_ping_reply_timeout_ms) * 1000;
+    const auto interval = std::chrono::milliseconds(m_ping_interval_ms);
+    int result = 0;
+    for (const auto & d : m_daemon_list)
+    {
+        bool dosend = false;
+        bool lost = false;
+        {
+            std::lock_guard<std::mutex> lock(m_ping_mutex);
+            pingstats & ps = m_ping_stats[d.url()];
+            auto now = pingstats::clock::now();
+            lost = ps.expire(now, timeoutus);
+            if (! ps.outstanding())
+            {
+                dosend = force || ps.sent_count() == 0 ||
+                    now - ps.sent_time() >= interval;
+
+                if (dosend)
+                    ps.sent(now);
+            }
+        }
+        if (lost)
+            log_status("Ping lost: " + d.url(), true);
+
+        if (dosend)
+        {
+            m_osc_server->send(d.addr(), "/osc/ping"); /* osc::tag::ping */
+            ++result;
+        }
+    }
+    return result;
+}
+
+bool
+nsmcontroller::pings_outstanding () const
+{
+    std::lock_guard<std::mutex> lock(m_ping_mutex);
+    for (const auto & sp : m_ping_stats)
+    {
+        if (sp.second.outstanding())
+            return true;
+    }
+    return false;
+}
+
+/**
+ *  True if any daemon has lost its latest ping.
+ */
+
+bool
+nsmcontroller::pings_lost () const
+{
+    std::lock_guard<std::mutex> lock(m_ping_mutex);
+    for (const auto & d : m_daemon_list)
+    {
+        auto it = m_ping_stats.find(d.url());
+        if (it != m_ping_stats.end() && it->second.consecutive_lost() > 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ *  Matches a ping reply to a daemon by the port of the source address, and
+ *  also by host name if several daemons use that port, then records the
+ *  round-trip time.
+ */
+
+void
+nsmcontroller::ping_reply (lo_address source, pingstats::clock::time_point t)
+{
+    if (is_nullptr(source))
+        return;
+
+    const char * port = lo_address_get_port(source);
+    const char * host = lo_address_get_hostname(source);
+    const daemon * match = nullptr;
+    for (const auto & d : m_daemon_list)
+    {
+        if (is_nullptr_2(d.addr(), port))
+            continue;
+
+        const char * dport = lo_address_get_port(d.addr());
+        if (not_nullptr(dport) && strcmp(dport, port) == 0)
+        {
+            const char * dhost = lo_address_get_hostname(d.addr());
+            bool samehost = not_nullptr_2(dhost, host) &&
+                strcmp(dhost, host) == 0;
+
+            if (is_nullptr(match) || samehost)
+                match = &d;
+
+            if (samehost)
+                break;
+        }
+    }
+
+    long us = (-1);
+    if (not_nullptr(match))
+    {
+        std::lock_guard<std::mutex> lock(m_ping_mutex);
+        us = m_ping_stats[match->url()].replied(t);
+        m_last_ping_response = time(NULL);
+    }
+    if (us >= 0)
+    {
+        if (m_osc_server)
+            m_osc_server->stats().ping_rtt(std::uint64_t(us));
+
+        util::info_printf
+        (
+            "Ping reply from %s after %ld us", V(match->url()), us
+        );
+    }
+    else if (not_nullptr(match))
+        util::warn_message("Late ping reply from", match->url());
+    else
+        util::warn_message("Ping reply from unknown daemon");
+}
+
+/**
+ *  See add_method in nsm66d. This is similar. Note that the userdata
+ *  parameter is always NULL here, and the argument-description is
+ *  stored in a osc::method object created in endpoint::add_method().
+ *
+ *  We would like to generalize it somehow.
+ */
+
+void
+nsmcontroller::add_method
+(
+    osc::tag t,
+    osc::method_handler f,
+    const std::string & argument_description
+)
+{
+    std::string msg, pattern;
+    if (osc::tag_lookup(t, msg, pattern))
+    {
+        (void) m_osc_server->add_method     /* OSC server is osc::endpoint  */
+        (
+            msg, pattern, f, NULL, argument_description
+        );
+    }
+}
+
+/**
+ *  In endpoint, we already add the oscreply and error tags, plus. generic,
+ *  sigconnect, sigcreated, sigdisconnect, sighello, siglist, sigremoved,
+ *  sigrenamed, and srvreply.
+ *
+ *  These are the original messages.
+ *
+ *  "/error",                           "sis",  "msg"   (done in lowrapper)
+ *  "/reply",                           "ss",   "msg"   (done in lowrapper)
+ *  "/reply",                           "s",    ""
+ *  "/nsm/server/broadcast",            NULL,   "msg"
+ *  "/nsm/gui/server_announce",         "s",    "msg"
+ *  "/nsm/gui/server/message",          "s",    "msg"
+ *  "/nsm/gui/gui_announce",            "s",    "msg"
+ *  "/nsm/gui/session/session",         "s",    "path,display_name"
+ *  "/nsm/gui/session/name",            "ss",   "path,display_name"
+ *  "/nsm/gui/client/new",              "ss",   "path,display_name"
+ *  "/nsm/gui/client/status",           "ss",   "path,display_name"
+ *  "/nsm/gui/client/switch",           "ss",   "path,display_name"
+ *  "/nsm/gui/client/progress",         "sf",   "path,display_name"
+ *  "/nsm/gui/client/dirty",            "si",   "path,display_name"
+ *  "/nsm/gui/client/has_optional_gui", "s",    "path,display_name"
+ *  "/nsm/gui/client/gui_visible",      "si",   "path,display_name"
+ *  "/nsm/gui/client/label",            "ss",   "path,display_name"
+ *
+ *  endpoint::init() adds the /error and /reply methods plus a set of
+ *  /signal/xxxx methods, and a /reply with a NULL type-specification
+ *  and a generic NULL+NULL method.
+ *
+ *  Here we add support for "/nsm/gui/session/root", which is not
+ *  in the original NSM controller.
+ *
+ * \param portname
+ *      This parameter defaults to "". Otherwise, it can be set (for
+ *      example) to the looked-up address of a server port, such as
+ *      "osc.udp://mlsleno:11086/" or "osc.unix:///run/user/1000/nsmd.osc".
+ *      Then the controller uses the protocol of that URL, with its own
+ *      port or socket. If empty, the protocol of the first daemon is
+ *      used, and UDP if there is none. A liblo server can only talk to
+ *      peers of its own protocol.
+ *
+ * \return
+ *      Returns true if the OSC server could be initialized.
+ */
+
+bool
+nsmcontroller::init_osc (const std::string & portname)
+{
+    int proto = LO_UDP;
+    std::string port { portname };
+    if (osc::is_osc_url(portname))
+    {
+        proto = osc::url_protocol(portname);    /* a server's URL: match  */
+        port.clear();                           /* it, with our own port  */
+    }
+    else if (! m_daemon_list.empty())
+        proto = osc::url_protocol(m_daemon_list.front().url());
+
+    m_osc_server.reset(new (std::nothrow) osc::endpoint());
+    bool result = bool(m_osc_server);
+    if (result)
+        result = m_osc_server->init(proto, port, true);
+
+    if (result)
+    {
+        const std::string msg { "msg" };
+        const std::string pd { "path,display_name" };
+        const std::string batch { "index,last,names" };
+        m_osc_server->owner(this);
+
+        add_method(osc::tag::error,             osc_handler, msg);
+        add_method(osc::tag::reply,             osc_handler, msg);
+        add_method(osc::tag::replyex,           osc_handler, msg);
+        add_method(osc::tag::srvreply,          osc_handler, msg);
+        add_method(osc::tag::srvbroadcast,      osc_broadcast_handler, msg);
+        add_method(osc::tag::replylist,         osc_handler, batch);
+
+        using osc::tag;
+        using self = nsmcontroller;
+        osc::endpoint & ep = *m_osc_server;
+        result =
+            ep.add_typed_method<&self::on_server_message>
+            (
+                tag::srvmessage, this, msg
+            ) &&
+            ep.add_typed_method<&self::on_session>(tag::guisession, this, pd) &&
+            ep.add_typed_method<&self::on_session_name>
+            (
+                tag::guisessionname, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_session_root>
+            (
+                tag::sessionroot, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_gui_announce>
+            (
+                tag::gui_announce, this, msg
+            ) &&
+            ep.add_typed_method<&self::on_server_announce>
+            (
+                tag::guisrvannounce, this, msg
+            ) &&
+            ep.add_typed_method<&self::on_client_new>(tag::guinew, this, pd) &&
+            ep.add_typed_method<&self::on_client_status>
+            (
+                tag::guistatus, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_progress>
+            (
+                tag::guiprogress, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_dirty>
+            (
+                tag::guidirty, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_visible>
+            (
+                tag::guivisible, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_label>
+            (
+                tag::guilabel, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_option>
+            (
+                tag::guioption, this, pd
+            ) &&
+            ep.add_typed_method<&self::on_client_switch>
+            (
+                tag::guiswitch, this, pd
+            );
+    }
+    if (result)
+    {
+        m_osc_server->start();
+    }
+    else
+    {
+        /*
+         * should we delete m_osc_server and null that pointer here????
+         */
+    }
     return result;
 }
 
@@ -656,7 +1168,7 @@ nsmcontroller::osc_broadcast_handler
     osc::osc_msg_summary
     (
         "nsmcontroller::osc_broadcast_handler",
-        path, types, argv, argc, userdata
+        path, types, argv, argc, userdata, msg
     );
     if (argc > 0)                       /* need at least one argument...    */
         return 0;
@@ -672,22 +1184,22 @@ nsmcontroller::osc_broadcast_handler
         return (-1);
     }
     util::info_message("Relaying OSC broadcast", path);
+
+    /*
+     * The source URL is made once per message, and each daemon's URL
+     * was made when its address was set; the message is then serialized
+     * once for all of the daemons.
+     */
+
+    static thread_local std::vector<lo_address> s_dests;
+    std::string source = osc::address_url(lo_message_get_source(msg));
+    s_dests.clear();
     for (const auto & d : ctrler->m_daemon_list)
     {
-        char * u1 = lo_address_get_url(d.addr());
-        if (not_nullptr(u1))
-        {
-            char * u2 = lo_address_get_url(lo_message_get_source(msg));
-            if (not_nullptr(u2))
-            {
-                if (strcmp(u1, u2) != 0)
-                    ept->send(d.addr(), path, msg);
-
-                free(u2);
-            }
-            free(u1);
-        }
+        if (not_nullptr(d.addr()) && d.addr_url() != source)
+            s_dests.push_back(d.addr());
     }
+    (void) ept->send_to_all(s_dests, path, msg);
     return 0;
 }
 
@@ -707,6 +1219,10 @@ nsmcontroller::osc_broadcast_handler
  *       5. "/reply" + "s"                      [osc::tag::srvreply]
  *          argv[0]->s = "/osc/ping", a ping response. Pings are
  *          done continuously.
+ *
+ *  Only the "/reply" and "/error" messages, whose typespecs vary, and the
+ *  session-list batches come here now. The "/nsm/gui/..." messages, each
+ *  with one typespec, go to the typed handlers below.
  */
 
 int
@@ -718,12 +1234,13 @@ nsmcontroller::osc_handler
     lo_message msg, void * userdata
 )
 {
+    auto replytime = pingstats::clock::now();   /* before any logging   */
     nsmcontroller * ctrler = nullptr;
     osc::endpoint * ept = static_cast<osc::endpoint *>(userdata);
     osc::osc_msg_summary
     (
         "nsmcontroller::osc_handler",
-        path, types, argv, argc, userdata
+        path, types, argv, argc, userdata, msg
     );
     if (not_nullptr(ept))
     {
@@ -735,67 +1252,27 @@ nsmcontroller::osc_handler
         return osc::osc_msg_unhandled();
     }
 
-    std::string msgpath { path };
-    std::string msgtypes { types };
-    std::string s { argc > 0 ? osc::string_from_lo_arg(argv[0]) : "" };
-    std::string s1 { argc > 1 ? osc::string_from_lo_arg(argv[1]) : "" };
-    osc::tag msgtag = osc::tag_reverse_lookup(msgpath, msgtypes);
-    if (msgtag == osc::tag::srvmessage)
-    {
-        ctrler->log_status(s);
-    }
-    else if (msgtag == osc::tag::sessionroot)
-    {
-        /*
-         * This section is an addition to the original NSM controller code.
-         */
+    /*
+     * Views of the path and string arguments, good for the duration of the
+     * call; a std::string is made only where one is stored or is a key.
+     */
 
-        // TODO
-    }
-    else if (msgtag == osc::tag::guisession)
-    {
-        ctrler->add_session_to_list(s);
-    }
-    else if (msgtag == osc::tag::guiannounce)
-    {
-        /*
-         * A pre-existing server is replying to our GUI announce message.
-         * In the original, NSM_Controller is derived from Fl_Group,
-         * which provides the activate() function:
-         *
-         *      ctrler->activate()
-         */
+    std::string_view msgpath { path };
+    std::string_view msgtypes { types };
+    std::string_view s { "" }, s1 { "" };
+    if (argc > 0 && types[0] == 's')
+        s = osc::view_from_lo_arg(argv[0]);
 
-        ept->active(true);
+    if (argc > 1 && types[1] == 's')
+        s1 = osc::view_from_lo_arg(argv[1]);
 
-        lo_address nsm_addr = lo_message_get_source(msg);
-        ept->send(nsm_addr, "/nsm/server/list");   // osc::tag::srvlist
-    }
-    else if (msgtag == osc::tag::guisrvannounce)
+    osc::tag msgtag = osc::tag_reverse_lookup(path, types);
+    if (msgpath == osc::tag_message(osc::tag::replylist))
     {
-        /*
-         * It must be a server we launched. Similar note about activate()
-         * as above. Note the path is "/nsm/gui/server_announce".
-         */
-
-        util::status_message("Controller recv'd", msgpath);
-        ept->active(true);
-
-        const char * url = lo_address_get_url(lo_message_get_source(msg));
-        lo_address addr = lo_address_new_from_url(url);
-        daemon d(url, addr, true);
-        ctrler->m_daemon_list.push_back(d);
-        ept->send(d.addr(), "/nsm/server/list");   // osc::tag::srvlist
-    }
-    else if (osc::tag_reverse_lookup(msgpath, "ss") == osc::tag::guisessionname)
-    {
-        if (s.empty())
-        {
-            util::warn_message("No session name");
-            ctrler->session_name("None");
-        }
-        else
-            ctrler->session_name(s);
+        ctrler->add_sessions_to_list
+        (
+            lo_message_get_source(msg), argv, argc, types
+        );
     }
     else if (msgtag == osc::tag::error)
     {
@@ -805,24 +1282,24 @@ nsmcontroller::osc_handler
          * function as well.
          */
 
-        if (std::string(types) != "sis")
+        if (msgtypes != "sis")
         {
             util::error_message("Error types received is not 'sis'");
             return osc::osc_msg_unhandled();
         }
         if (argc >= 3)
         {
-            std::string pathmsg { osc::string_from_lo_arg(argv[0]) };
-            std::string errmsg { osc::string_from_lo_arg(argv[2]) };
+            const char * pathmsg = &argv[0]->s;
+            const char * errmsg = &argv[2]->s;
             int err = argv[1]->i;
             if (err != 0)
             {
                 util::error_printf
                 (
                     "Command %s failed with error %d: %s",
-                    V(pathmsg), err, V(errmsg)
+                    pathmsg, err, errmsg
                 );
-                if (pathmsg == std::string("/nsm/server/announce"))
+                if (s == osc::tag_message(osc::tag::srvannounce))
                 {
                     util::error_message("Failed to register with NSM", errmsg);
                     ept->active(false);
@@ -830,7 +1307,7 @@ nsmcontroller::osc_handler
             }
         }
     }
-    else if (msgpath == "/reply" && /* argc > 3 && */ msgtypes.front() == 's')
+    else if (msgpath == "/reply" && /* argc > 3 && */ types[0] == 's')
     {
         if (msgtag == osc::tag::replyex)
         {
@@ -843,91 +1320,465 @@ nsmcontroller::osc_handler
                 util::status_printf
                 (
                     "Server hello '%s' from NSM %s with caps %s",
-                    V(s1), V(osc::string_from_lo_arg(argv[2])),
-                    V(osc::string_from_lo_arg(argv[3]))
+                    s1.data(), &argv[2]->s, &argv[3]->s
                 );
             }
         }
         else if (msgtag == osc::tag::reply)
         {
             ctrler->log_status(s1);
-            util::info_printf("%s says %s", V(s), V(s1));
+            util::info_printf("%s says %s", s.data(), s1.data());
         }
         else if (s == osc::tag_message(osc::tag::srvlist))
         {
-            ctrler->add_session_to_list(s1);
+            ctrler->add_session_to_list         /* empty: end of the list   */
+            (
+                lo_message_get_source(msg), s1
+            );
         }
         else if (s == osc::tag_message(osc::tag::oscping))
         {
-            int t = int(time(NULL));
-            int delta = t - int(ctrler->m_last_ping_response);
-            std::string dtext = std::to_string(delta);
-            ctrler->m_last_ping_response = time_t(t);
-            util::info_printf
-            (
-                "Received ping response after %s seconds", V(dtext)
-            );
+            ctrler->ping_reply(lo_message_get_source(msg), replytime);
         }
     }
-    if (util::strncompare(path, "/nsm/gui/client/"))
+    return osc::osc_msg_handled();
+}
+
+/**
+ *  A handler for osc::tag::srvmessage = { "/nsm/gui/server/message" + "s" }.
+ */
+
+bool
+nsmcontroller::on_server_message (std::string_view text)
+{
+    log_status(text);
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guisession = { "/nsm/gui/session/session" + "s" }.
+ */
+
+bool
+nsmcontroller::on_session
+(
+    const osc::message_info & info,
+    std::string_view name
+)
+{
+    add_session_to_list(lo_message_get_source(info.mi_msg), name);
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guisessionname = { "/nsm/gui/session/name" +
+ *  "ss" }.
+ */
+
+bool
+nsmcontroller::on_session_name (std::string_view name, std::string_view path)
+{
+    (void) path;
+    if (name.empty())
     {
-        if (msgtag == osc::tag::guinew)
-        {
-             if (! ctrler->client_new(s, s1))
-                 return osc::osc_msg_unhandled();
-        }
-        else
+        util::warn_message("No session name");
+        session_name("None");
+    }
+    else
+        session_name(name);
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::sessionroot = { "/nsm/gui/session/root" + "s" }.
+ *  This message is an addition to the original NSM controller code.
+ */
+
+bool
+nsmcontroller::on_session_root (std::string_view root)
+{
+    (void) root;                        /* TODO */
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::gui_announce = { "/nsm/gui/gui_announce" + "s" }.
+ *  A pre-existing server is replying to our GUI announce message. In the
+ *  original, NSM_Controller is derived from Fl_Group, which provides the
+ *  activate() function: ctrler->activate().
+ */
+
+bool
+nsmcontroller::on_gui_announce
+(
+    const osc::message_info & info,
+    std::string_view hello
+)
+{
+    (void) hello;
+    m_osc_server->active(true);
+    request_session_list(lo_message_get_source(info.mi_msg));
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guisrvannounce = { "/nsm/gui/server_announce" +
+ *  "s" }. It must be a server we launched. Similar note about activate()
+ *  as above.
+ */
+
+bool
+nsmcontroller::on_server_announce
+(
+    const osc::message_info & info,
+    std::string_view hello
+)
+{
+    (void) hello;
+    util::status_message("Controller recv'd", info.mi_path);
+    m_osc_server->active(true);
+
+    const char * url = lo_address_get_url(lo_message_get_source(info.mi_msg));
+    lo_address addr = lo_address_new_from_url(url);
+    daemon d(url, addr, true);
+    m_daemon_list.push_back(d);
+    request_session_list(d.addr());
+    return true;
+}
+
+/**
+ *  The common part of the "/nsm/gui/client/..." handlers: finds the client
+ *  by ID and counts the message against a pending fan-out. The caller holds
+ *  lock_clients() while using the client returned.
+ *
+ * \return
+ *      Returns the client, or nullptr if the ID is unknown.
+ */
+
+nsmctlclient *
+nsmcontroller::client_message
+(
+    osc::tag msgtag,
+    std::string_view id,
+    std::string_view value,
+    float p
+)
+{
+    auto replytime = pingstats::clock::now();
+    nsmctlclient * c = client_by_id(std::string(id));
+    if (not_nullptr(c))
+    {
+        fanout_message(msgtag, c, value, p, replytime);
+    }
+    else
+    {
+        util::info_printf
+        (
+            "Message '%s' from unknown client '%s'",
+            V(osc::tag_message(msgtag)), std::string(id).c_str()
+        );
+    }
+    return c;
+}
+
+/**
+ *  A handler for osc::tag::guinew = { "/nsm/gui/client/new" + "ss" }.
+ */
+
+bool
+nsmcontroller::on_client_new (std::string_view id, std::string_view name)
+{
+    return client_new(std::string(id), std::string(name));
+}
+
+/**
+ *  A handler for osc::tag::guistatus = { "/nsm/gui/client/status" + "ss" }.
+ */
+
+bool
+nsmcontroller::on_client_status (std::string_view id, std::string_view status)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guistatus, id, status);
+    if (not_nullptr(c))
+        client_pending_command(c, status);
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guiprogress = { "/nsm/gui/client/progress" +
+ *  "sf" }.
+ */
+
+bool
+nsmcontroller::on_client_progress (std::string_view id, float progress)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guiprogress, id, "", progress);
+    if (not_nullptr(c))
+        c->progress(progress);
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guidirty = { "/nsm/gui/client/dirty" + "si" }.
+ */
+
+bool
+nsmcontroller::on_client_dirty (std::string_view id, int isdirty)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guidirty, id, "");
+    if (not_nullptr(c))
+        c->dirty(bool(isdirty));
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guivisible = { "/nsm/gui/client/gui_visible" +
+ *  "si" }.
+ */
+
+bool
+nsmcontroller::on_client_visible (std::string_view id, int isvisible)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guivisible, id, "");
+    if (not_nullptr(c))
+        c->gui_visible(bool(isvisible));
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guilabel = { "/nsm/gui/client/label" + "ss" }.
+ */
+
+bool
+nsmcontroller::on_client_label (std::string_view id, std::string_view label)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guilabel, id, label);
+    if (not_nullptr(c))
+        c->client_label(std::string(label));
+
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guioption = { "/nsm/gui/client/has_optional_gui"
+ *  + "s" }.
+ */
+
+bool
+nsmcontroller::on_client_option (std::string_view id)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guioption, id, "");
+    if (not_nullptr(c))
+    {
+        // c->has_optional_gui();
+        util::warn_message("on_client_option()", "No optional GUI");
+    }
+    return true;
+}
+
+/**
+ *  A handler for osc::tag::guiswitch = { "/nsm/gui/client/switch" + "ss" }.
+ */
+
+bool
+nsmcontroller::on_client_switch (std::string_view id, std::string_view newid)
+{
+    auto lock = lock_clients();
+    nsmctlclient * c = client_message(osc::tag::guiswitch, id, newid);
+    if (not_nullptr(c))
+        (void) client_switch(std::string(id), std::string(newid));
+
+    return true;
+}
+
+/**
+ *  Adds one session name from a "/reply" to "/nsm/server/list". nsmd ends
+ *  the list with an empty name, which ends that daemon's list only.
+ */
+
+void
+nsmcontroller::add_session_to_list (lo_address source, std::string_view name)
+{
+    std::string url = osc::numeric_address_url(source);
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    if (name.empty())
+        m_list_sources[url].ls_done = true;
+    else
+        m_session_list.emplace_back(name);
+}
+
+/**
+ *  Adds a batch of session names from an "/nsm66/reply/list" message; see
+ *  lowrapper::send_batched() for the layout. The batch index is checked
+ *  against the one expected from that daemon; a missing batch is reported
+ *  and counted, and the list goes on from the batch that arrived.
+ */
+
+void
+nsmcontroller::add_sessions_to_list
+(
+    lo_address source,
+    lo_arg ** argv, int argc,
+    const char * types
+)
+{
+    if (argc < 2 || is_nullptr(types) || types[0] != 'i' || types[1] != 'i')
+    {
+        util::error_message("Bad session list batch");
+        return;
+    }
+
+    std::string url = osc::numeric_address_url(source);
+    int index = argv[0]->i;
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    list_source & ls = m_list_sources[url];
+    if (ls.ls_done)
+    {
+        util::warn_printf
+        (
+            "Session list batch %d from %s after its last", index, V(url)
+        );
+        return;
+    }
+    if (index != ls.ls_next_batch)
+    {
+        ++m_session_list_gaps;
+        util::error_printf
+        (
+            "Session list from %s: batch %d expected, batch %d received",
+            V(url), ls.ls_next_batch, index
+        );
+    }
+    ls.ls_next_batch = index + 1;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (types[i] == 's')
+            m_session_list.push_back(osc::string_from_lo_arg(argv[i]));
+    }
+    if (argv[1]->i != 0)
+        ls.ls_done = true;
+}
+
+/**
+ *  Gets the session names that have arrived since the caller last looked,
+ *  so that a long list can be shown as it comes in. Usage:
+ *
+\verbatim
+        std::size_t have = 0;
+        lib66::tokenization names;
+        while (! ctrler.session_list_done())
         {
-            nsmctlclient * c = ctrler->client_by_id(s);
-            if (not_nullptr(c))
-            {
-                if (msgtag == osc::tag::guistatus)
-                {
-                    ctrler->client_pending_command(c, s1);
-                }
-                else if ( msgtag == osc::tag::guiprogress)
-                {
-                    c->progress(argv[1]->f);
-                }
-                else if (msgtag == osc::tag::guidirty)
-                {
-                    c->dirty(bool(argv[1]->i));
-                }
-                else if (msgtag == osc::tag::guivisible)
-                {
-                    c->gui_visible(bool(argv[1]->i));
-                }
-                else if (msgtag == osc::tag::guilabel)
-                {
-                    c->client_label(s1);
-                }
-                else if (msgtag == osc::tag::guioption)
-                {
-                    // c->has_optional_gui();
-                    util::warn_message("osc_handler()", "No optional GUI");
-                }
-                else if (msgtag == osc::tag::guiswitch)
-                {
-                    c->client_id(s1);
-                }
-            }
-            else
-            {
-                util::info_printf
-                (
-                    "Message '%s' from unknown client '%s'", V(path), V(s)
-                );
-            }
+            ctrler.osc_wait(10);
+            have = ctrler.get_sessions(have, names);  // shows names[...]
         }
+\endverbatim
+ *
+ * \param from
+ *      The number of names the caller already has.
+ *
+ * \param [out] names
+ *      The names from that point on are appended.
+ *
+ * \return
+ *      Returns the number of names the caller now has, to pass next time.
+ */
+
+std::size_t
+nsmcontroller::get_sessions
+(
+    std::size_t from,
+    lib66::tokenization & names
+) const
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    std::size_t count = m_session_list.size();
+    for (std::size_t i = from; i < count; ++i)
+        names.push_back(m_session_list[i]);
+
+    return count > from ? count : from ;
+}
+
+std::size_t
+nsmcontroller::session_count () const
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    return m_session_list.size();
+}
+
+/**
+ *  True once every daemon asked for its list has sent the end of it.
+ */
+
+bool
+nsmcontroller::session_list_done () const
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    if (m_list_sources.empty())
+        return false;
+
+    for (const auto & ls : m_list_sources)
+    {
+        if (! ls.second.ls_done)
+            return false;
     }
-    return osc::osc_msg_handled();
+    return true;
+}
+
+/**
+ *  The number of batches found missing or out of order since the list was
+ *  last asked for.
+ */
+
+int
+nsmcontroller::session_list_gaps () const
+{
+    std::lock_guard<std::mutex> lock(m_session_mutex);
+    return m_session_list_gaps;
+}
+
+/**
+ *  Asks a daemon for its sessions, in batches if batched_list() is set, and
+ *  starts tracking its part of the list. The daemon's address is usually
+ *  made from a URL with a host name, while its replies come from a numeric
+ *  host, so both sides are keyed by osc::numeric_address_url().
+ */
+
+void
+nsmcontroller::request_session_list (lo_address a)
+{
+    osc::tag t = m_batched_list ? osc::tag::srvlistbatch : osc::tag::srvlist ;
+    std::string url = osc::numeric_address_url(a);
+    {
+        std::lock_guard<std::mutex> lock(m_session_mutex);
+        m_list_sources[url] = list_source{ 0, false };
+    }
+    m_osc_server->send(a, osc::tag_message(t));
 }
 
+/**
+ *  The whole list as one string, one indented name per line. For a long
+ *  list, get_sessions() is better.
+ */
+
 std::string
 nsmcontroller::get_session_list () const
 {
+    lib66::tokenization names;
+    (void) get_sessions(0, names);
+
     std::string result;
-    for (const auto & s : m_session_list)
+    for (const auto & s : names)
     {
         result += "    ";
         result += s;
@@ -27,7 +27,7 @@
  * \library       nsmctl application
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-21
- * \updates       2025-03-29
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -62,6 +62,7 @@ namespace nsm
 daemon::daemon () :
     m_url       (),
     m_addr      (nullptr),
+    m_addr_url  (),
     m_is_child  (false)
 {
     // no code
@@ -75,6 +76,7 @@ daemon::daemon
 ) :
     m_url       (url),
     m_addr      (addr),
+    m_addr_url  (osc::address_url(addr)),
     m_is_child  (ischild)
 {
     // no code
@@ -93,13 +95,14 @@ nsmctlclient::nsmctlclient
     const std::string & client_name
 ) :
     m_osc_server    (oscserver),
-    m_daemon_list   (daemonlist),
+    m_daemon_list   (&daemonlist),
     m_client_id     (client_id),
     m_client_label  (client_label),
     m_client_name   (client_name),
     m_progress      (0.0),
     m_dirty         (false),
-    m_visible       (false)
+    m_visible       (false),
+    m_save_latency_us (-1)
 {
     stopped(false);
 }
@@ -163,7 +166,7 @@ nsmctlclient::send_client_message (osc::tag o)
             if (result)
             {
                 util::info_message("Sending save");
-                for (const auto & d : m_daemon_list)
+                for (const auto & d : *m_daemon_list)
                     m_osc_server->send(d.addr(), msg, m_client_id);
             }
         }
@@ -171,35 +174,35 @@ nsmctlclient::send_client_message (osc::tag o)
         {
             result = true;
             util::info_message("Sending show GUIs");
-            for (const auto & d : m_daemon_list)
+            for (const auto & d : *m_daemon_list)
                     m_osc_server->send(d.addr(), msg, m_client_id);
         }
         else if (o == osc::tag::guihide)
         {
             result = true;
             util::info_message("Sending hide GUIs");
-            for (const auto & d : m_daemon_list)
+            for (const auto & d : *m_daemon_list)
                 m_osc_server->send(d.addr(), msg, m_client_id);
         }
         else if (o == osc::tag::guiremove)
         {
             result = true;
             util::info_message("Sending remove");
-            for (const auto & d : m_daemon_list)
+            for (const auto & d : *m_daemon_list)
                 m_osc_server->send(d.addr(), msg, m_client_id);
         }
         else if (o == osc::tag::guiresume)
         {
             result = true;
             util::info_message("Sending resume");
-            for (const auto & d : m_daemon_list)
+            for (const auto & d : *m_daemon_list)
                 m_osc_server->send(d.addr(), msg, m_client_id);
         }
         else if (o == osc::tag::guistop)
         {
             result = true;
             util::info_message("Sending stop");
-            for (const auto & d : m_daemon_list)
+            for (const auto & d : *m_daemon_list)
                 m_osc_server->send(d.addr(), msg, m_client_id);
         }
     }
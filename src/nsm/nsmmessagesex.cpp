@@ -7,7 +7,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom
  * \date          2020-08-21
- * \updates       2025-04-23
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -75,6 +75,8 @@
  *      -#  null.
  */
 
+#include <cstring>                      /* std::strcmp()                    */
+
 #include "nsm/nsmmessagesex.hpp"        /* nsm66::nsm::tag, etc.            */
 
 namespace nsm
@@ -106,13 +108,14 @@ url ()
  *  These definitions are in the osc/message.cpp module.
  *
  *  The rest of these free functions provide easy lookup of the various messages
- *  and their patterns.
+ *  and their patterns.  The tag categories are hashed sets, so that each
+ *  lookup is a hash probe plus a map lookup, not a linear search.
  */
 
 bool
 client_msg (osc::tag t, std::string & message, std::string & pattern)
 {
-    static osc::taglist s_client_tags
+    static const osc::tagset s_client_tags
     {
         osc::tag::cliclean,
         osc::tag::clidirty,
@@ -137,7 +140,7 @@ client_msg (osc::tag t, std::string & message, std::string & pattern)
 bool
 server_msg (osc::tag t, std::string & message, std::string & pattern)
 {
-    static osc::taglist s_server_tags
+    static const osc::tagset s_server_tags
     {
         osc::tag::sigreply,
         osc::tag::srvabort,
@@ -147,6 +150,7 @@ server_msg (osc::tag t, std::string & message, std::string & pattern)
         osc::tag::srvclose,
         osc::tag::srvduplicate,
         osc::tag::srvlist,
+        osc::tag::srvlistbatch,
         osc::tag::srvnew,
         osc::tag::srvopen,
         osc::tag::srvquit,
@@ -174,11 +178,23 @@ get_visibility_msg (bool isvisible)
 }
 
 bool
-is_gui_announce (const std::string & s)
+is_gui_announce (std::string_view s)
 {
     return s == osc::tag_message(osc::tag::gui_announce);
 }
 
+/**
+ *  For a string argument straight from an OSC message, so that the caller
+ *  need not make a std::string from it.
+ */
+
+bool
+is_gui_announce (const char * s)
+{
+    return not_nullptr(s) &&
+        std::strcmp(s, osc::tag_message(osc::tag::gui_announce).c_str()) == 0;
+}
+
 #if defined USE_THIS_CODE
 
 /*
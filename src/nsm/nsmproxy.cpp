@@ -27,7 +27,7 @@
  * \library       nsmproxy class
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-03-06
- * \updates       2025-03-08
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v3 or above
  *
@@ -40,7 +40,10 @@
 #include <cstdlib>                      /* std::getenv(), std::rand()       */
 
 #include "cpp_types.hpp"                /* lib66::tokenization alias        */
+#include "nsm/launcher.hpp"             /* nsm66: nsm::launcher class       */
+#include "nsm/helpers.hpp"              /* nsm::write_file_atomically()     */
 #include "nsm/nsmproxy.hpp"             /* nsm66: nsm::nsmproxy class       */
+#include "nsm/snapshot.hpp"             /* nsm66: nsm::snapshot_writer etc. */
 #include "osc/lowrapper.hpp"            /* nsm66: LO_TT_IMMEDIATE_2 etc.    */
 #include "osc/messages.hpp"             /* nsm66: osc::tag enumeration      */
 #include "util/msgfunctions.hpp"        /* cfg66: util::info_message() ...  */
@@ -50,6 +53,26 @@
 namespace nsm
 {
 
+namespace
+{
+
+/**
+ *  The tags of the fields of a proxy snapshot. Never renumber these; add
+ *  new ones at the end.
+ */
+
+enum proxy_field : std::uint16_t
+{
+    pf_executable = 1,
+    pf_arguments,
+    pf_config_file,
+    pf_save_signal,
+    pf_stop_signal,
+    pf_label
+};
+
+}           // namespace (anonymous)
+
 /*
  *  To do.
  */
@@ -150,42 +173,35 @@ nsmproxy::start ()
         return false;
     }
 
-    int pid;
-    if (! (pid = fork()))
+    launch_spec spec;
+    spec.ls_executable = m_executable;
+    spec.ls_arguments = m_arguments;
+    spec.ls_log_file = "error.log";
+    spec.ls_environment.push_back
+    (
+        std::string(ENV_NSM_CLIENT_ID) + "=" + m_nsm_client_id
+    );
+    spec.ls_environment.push_back
+    (
+        std::string(ENV_NSM_SESSION_NSM) + "=" + m_nsm_display_name
+    );
+    if (! m_config_file.empty())
     {
-        std::string cmd;
-        if (m_arguments.empty())
-        {
-            cmd = util::string_asprintf
-            (
-                "exec %s > error.log 2>&1", V(m_executable)
-            );
-        }
-        else
-        {
-            cmd = util::string_asprintf
-            (
-                "exec %s %s > error.log 2>&1",
-                V(m_executable), V(m_arguments)
-            );
-        }
-
-        char * args [] =
-        {
-            strdup("/bin/sh"), strdup("-c"), STR(cmd), NULL
-        };
-        setenv("ENV_NSM_CLIENT_ID", CSTR(m_nsm_client_id), 1);
-        setenv("ENV_NSM_SESSION_NAME", CSTR(m_nsm_display_name), 1);
-        if (! m_config_file.empty())
-            setenv( "ENV_NSM_CONFIG_FILE", CSTR(m_config_file), 1);
+        spec.ls_environment.push_back
+        (
+            std::string(ENV_NSM_CONFIG_FILE) + "=" + m_config_file
+        );
+    }
+    spec.ls_unset.push_back(ENV_NSM_URL);
+    util::info_message("Launching ", m_executable);
 
-        unsetenv("NSM_URL");
-        util::info_message("Launching ", m_executable);
-        if (execvp("/bin/sh", args) == (-1))
-        {
-            util::warn_printf("Error starting process: %s", strerror(errno));
-            exit(1);
-        }
+    std::string errmsg;
+    int pid = int(launcher::spawn(spec, errmsg));
+    if (pid < 0)
+    {
+        util::warn_printf("Error starting process: %s", V(errmsg));
+        m_client_error = errmsg;
+        pid = 0;
     }
     m_pid = pid;
     return m_pid > 0;
@@ -234,62 +250,58 @@ nsmproxy::save ()
  *
  * We will eventually add comment-lines at the top and bottom of
  * this file.
+ *
+ *  If binary is true, a snapshot (see snapshot.hpp) is written instead,
+ *  to NSM_SNAPSHOT_FILE_NAME. It is checksummed and loads with one read,
+ *  but is not for human eyes. Either file is replaced atomically.
  */
 
 bool
-nsmproxy::dump (const std::string & path)
+nsmproxy::dump (const std::string & path, bool binary)
 {
-    std::string fname = util::string_asprintf
-    (
-        "%s/%s", V(path), NSM_CONFIG_FILE_NAME
-    );
-    std::string fdata;
-    if (! m_executable.empty())
+    std::string errmsg;
+    bool result;
+    if (binary)
     {
-        std::string data = util::string_asprintf
-        (
-            "executable\n\t%s\n", V(m_executable)
-        );
-        fdata += data;
+        snapshot_writer w(snapshot_kind::proxy);
+        w.add(pf_executable, m_executable);
+        w.add(pf_arguments, m_arguments);
+        w.add(pf_config_file, m_config_file);
+        w.add(pf_save_signal, std::int32_t(m_save_signal));
+        w.add(pf_stop_signal, std::int32_t(m_stop_signal));
+        w.add(pf_label, m_label);
+        result = w.write(path + "/" + NSM_SNAPSHOT_FILE_NAME, errmsg);
     }
-    if (! m_arguments.empty())
+    else
     {
-        std::string data = util::string_asprintf
-        (
-            "arguments\n\t%s\n", V(m_arguments)
-        );
-        fdata += data;
-    }
-    if (! m_config_file.empty())
-    {
-        std::string data = util::string_asprintf
-        (
-            "config file\n\t%s\n", V(m_config_file)
-        );
-        fdata += data;
-    }
-    std::string sigdata = util::string_asprintf
-    (
-        "save signal\n\t%i\n" "stop signal\n\t%i\n",
-        m_save_signal, m_stop_signal
-    );
-    if (! m_label.empty())
-    {
-        std::string data = util::string_asprintf
-        (
-            "label\n\t%s\n", V(m_label)
-        );
-        fdata += data;
-    }
+        std::string fdata;
+        auto item = [&fdata] (const char * name, const std::string & value)
+        {
+            fdata += name;
+            fdata += "\n\t";
+            fdata += value;
+            fdata += "\n";
+        };
+        if (! m_executable.empty())
+            item("executable", m_executable);
 
-    bool result = util::file_write_string(fname, fdata);
-    if (! result)
-    {
-        util::error_message
-        (
-            "Error opening file for saving", strerror(errno)
-        );
+        if (! m_arguments.empty())
+            item("arguments", m_arguments);
+
+        if (! m_config_file.empty())
+            item("config file", m_config_file);
+
+        item("save signal", std::to_string(m_save_signal));
+        item("stop signal", std::to_string(m_stop_signal));
+        if (! m_label.empty())
+            item("label", m_label);
+
+        std::string fname = path + "/" + NSM_CONFIG_FILE_NAME;
+        result = write_file_atomically(fname, fdata, errmsg);
     }
+    if (! result)
+        util::error_message("Error saving proxy configuration", errmsg);
+
     return result;
 }
 
@@ -298,11 +310,17 @@ nsmproxy::dump (const std::string & path)
  *  lines and process them. Note that util::file_read_lines() skips
  *  comments and empty lines, and here is set to trim white space at both
  *  ends.
+ *
+ *  A binary snapshot written by dump() is recognized by its magic bytes,
+ *  and is loaded with restore_snapshot() instead.
  */
 
 bool
 nsmproxy::restore (const std::string & path)
 {
+    if (is_snapshot_file(path))
+        return restore_snapshot(path);
+
     lib66::tokenization lines;
     bool result = util::file_read_lines(path, lines, true); /* trim white   */
     if (result)
@@ -338,6 +356,70 @@ nsmproxy::restore (const std::string & path)
     return result;
 }
 
+/**
+ *  Loads a binary snapshot. Nothing is changed unless its header and
+ *  checksum are good.
+ */
+
+bool
+nsmproxy::restore_snapshot (const std::string & filename)
+{
+    snapshot_reader r;
+    bool result = r.load(filename, snapshot_kind::proxy);
+    if (result)
+    {
+        std::uint16_t tag;
+        std::string_view value;
+        util::info_message("Loading snapshot", filename);
+        while (r.next(tag, value))
+        {
+            switch (tag)
+            {
+                case pf_executable:
+
+                    m_executable = std::string(value);
+                    break;
+
+                case pf_arguments:
+
+                    m_arguments = std::string(value);
+                    break;
+
+                case pf_config_file:
+
+                    m_config_file = std::string(value);
+                    break;
+
+                case pf_save_signal:
+
+                    m_save_signal = snapshot_reader::to_int(value);
+                    break;
+
+                case pf_stop_signal:
+
+                    m_stop_signal = snapshot_reader::to_int(value);
+                    break;
+
+                case pf_label:
+
+                    m_label = std::string(value);
+                    break;
+
+                default:
+
+                    break;                      /* a newer field, skip it   */
+            }
+        }
+        result = r.error_message().empty();
+    }
+    if (result)
+        start();
+    else
+        util::error_message("Bad proxy snapshot", r.error_message());
+
+    return result;
+}
+
 /*
  * Similar to the send() functions in the endpoint class.
  */
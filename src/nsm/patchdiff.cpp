@@ -0,0 +1,373 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          patchdiff.cpp
+ *
+ *    This module keeps the connections to make and break to restore a
+ *    saved patch set.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  A connection is keyed by its source and destination port IDs, packed
+ *  into 64 bits. Each port has a list of the keys of its desired and live
+ *  connections, so an event for one port only looks at that port's
+ *  connections.
+ */
+
+#include <algorithm>                    /* std::sort()                      */
+
+#include "nsm/patchdiff.hpp"            /* nsm::patch_diff class            */
+
+namespace nsm
+{
+
+patch_diff::patch_diff () :
+    m_names             (),
+    m_desired           (),
+    m_desired_by_port   (),
+    m_present           (),
+    m_live              (),
+    m_live_by_port      (),
+    m_to_make           (),
+    m_to_break          ()
+{
+    // no code
+}
+
+void
+patch_diff::clear ()
+{
+    m_names.clear();
+    m_desired.clear();
+    m_desired_by_port.clear();
+    m_present.clear();
+    m_live.clear();
+    m_live_by_port.clear();
+    m_to_make.clear();
+    m_to_break.clear();
+}
+
+/**
+ *  Sets the saved connections. A duplex ("||") patch line yields a
+ *  connection each way. The pending work is rebuilt against the current
+ *  live state.
+ */
+
+void
+patch_diff::set_desired (const patch_graph & saved)
+{
+    m_desired.clear();
+    m_desired_by_port.clear();
+    for (const auto & e : saved.edges())
+    {
+        id left = import_port(saved, e.e_left);
+        id right = import_port(saved, e.e_right);
+        if (e.e_direction != patch_direction::left)
+            add_desired(make_key(left, right));
+
+        if (e.e_direction != patch_direction::right)
+            add_desired(make_key(right, left));
+    }
+    rebuild();
+}
+
+/**
+ *  Sets the live state from a snapshot. Every port of the graph exists,
+ *  even those without connections (see patch_graph::add_port()), and the
+ *  edges are the live connections. As in set_desired(), a duplex edge is a
+ *  connection each way.
+ */
+
+void
+patch_diff::set_live (const patch_graph & live)
+{
+    m_present.assign(m_names.port_count(), 0);
+    m_live.clear();
+    m_live_by_port.clear();
+    for (id p = 0; p < id(live.port_count()); ++p)
+    {
+        id q = import_port(live, p);
+        if (q >= id(m_present.size()))
+            m_present.resize(q + 1, 0);
+
+        m_present[q] = 1;
+    }
+    for (const auto & e : live.edges())
+    {
+        id left = import_port(live, e.e_left);
+        id right = import_port(live, e.e_right);
+        if (e.e_direction != patch_direction::left)
+            add_live(make_key(left, right));
+
+        if (e.e_direction != patch_direction::right)
+            add_live(make_key(right, left));
+    }
+    rebuild();
+}
+
+/**
+ *  Gets the ID of a port from its full "client:port" name, as JACK gives
+ *  it, adding it if new.
+ */
+
+patch_diff::id
+patch_diff::port (std::string_view fullname)
+{
+    std::string_view clientname, portname;
+    (void) split_client_port(fullname, clientname, portname);
+    return m_names.add_port(clientname, portname);
+}
+
+void
+patch_diff::port_registered (std::string_view fullname)
+{
+    port_registered(port(fullname));
+}
+
+void
+patch_diff::port_unregistered (std::string_view fullname)
+{
+    port_unregistered(port(fullname));
+}
+
+void
+patch_diff::connected
+(
+    std::string_view source, std::string_view destination
+)
+{
+    connected(port(source), port(destination));
+}
+
+void
+patch_diff::disconnected
+(
+    std::string_view source, std::string_view destination
+)
+{
+    disconnected(port(source), port(destination));
+}
+
+/**
+ *  A port appeared. Its desired connections whose other port exists become
+ *  work to do.
+ */
+
+void
+patch_diff::port_registered (id p)
+{
+    if (present(p))
+        return;
+
+    if (p >= id(m_present.size()))
+        m_present.resize(p + 1, 0);
+
+    m_present[p] = 1;
+    auto d = m_desired_by_port.find(p);
+    if (d != m_desired_by_port.end())
+    {
+        for (key k : d->second)
+            reevaluate(k);
+    }
+}
+
+/**
+ *  A port went away, and with it its live connections. Pending work that
+ *  involves it is dropped.
+ */
+
+void
+patch_diff::port_unregistered (id p)
+{
+    if (! present(p))
+        return;
+
+    m_present[p] = 0;
+    auto lv = m_live_by_port.find(p);
+    if (lv != m_live_by_port.end())
+    {
+        std::vector<key> keys(lv->second.begin(), lv->second.end());
+        for (key k : keys)
+        {
+            (void) remove_live(k);          /* from the other port, too     */
+            reevaluate(k);
+        }
+    }
+    auto d = m_desired_by_port.find(p);
+    if (d != m_desired_by_port.end())
+    {
+        for (key k : d->second)
+            reevaluate(k);
+    }
+}
+
+void
+patch_diff::connected (id source, id destination)
+{
+    port_registered(source);                /* a connection implies ports   */
+    port_registered(destination);
+
+    key k = make_key(source, destination);
+    add_live(k);
+    reevaluate(k);
+}
+
+void
+patch_diff::disconnected (id source, id destination)
+{
+    key k = make_key(source, destination);
+    (void) remove_live(k);
+    reevaluate(k);
+}
+
+/**
+ *  Hands out the pending work, sorted by port ID, and clears it. A
+ *  connection comes back only if a later event makes it needed again,
+ *  e.g. its port is re-registered or it is disconnected.
+ */
+
+void
+patch_diff::take (connections & tomake, connections & tobreak)
+{
+    auto fill = [] (keyset & ks, connections & out)
+    {
+        std::vector<key> keys(ks.begin(), ks.end());
+        std::sort(keys.begin(), keys.end());
+        out.clear();
+        out.reserve(keys.size());
+        for (key k : keys)
+            out.push_back(connection{ source_of(k), destination_of(k) });
+
+        ks.clear();
+    };
+    fill(m_to_make, tomake);
+    fill(m_to_break, tobreak);
+}
+
+patch_diff::id
+patch_diff::import_port (const patch_graph & g, id p)
+{
+    const patch_graph::port & pt = g.port_at(p);
+    return m_names.add_port(g.name(pt.pt_client), g.name(pt.pt_name));
+}
+
+bool
+patch_diff::present (id p) const
+{
+    return p < id(m_present.size()) && m_present[p] != 0;
+}
+
+bool
+patch_diff::managed (id p) const
+{
+    return m_desired_by_port.find(p) != m_desired_by_port.end();
+}
+
+void
+patch_diff::add_desired (key k)
+{
+    if (m_desired.insert(k).second)
+    {
+        m_desired_by_port[source_of(k)].push_back(k);
+        m_desired_by_port[destination_of(k)].push_back(k);
+    }
+}
+
+void
+patch_diff::add_live (key k)
+{
+    if (m_live.insert(k).second)
+    {
+        m_live_by_port[source_of(k)].insert(k);
+        m_live_by_port[destination_of(k)].insert(k);
+    }
+}
+
+/**
+ *  Removes a live connection from the live set and from the sets of both
+ *  of its ports. A port's set is dropped when it becomes empty.
+ */
+
+bool
+patch_diff::remove_live (key k)
+{
+    bool result = m_live.erase(k) > 0;
+    if (result)
+    {
+        for (id p : { source_of(k), destination_of(k) })
+        {
+            auto lv = m_live_by_port.find(p);
+            if (lv != m_live_by_port.end())
+            {
+                lv->second.erase(k);
+                if (lv->second.empty())
+                    m_live_by_port.erase(lv);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ *  Puts one connection in, or takes it out of, the pending sets, according
+ *  to the current state.
+ */
+
+void
+patch_diff::reevaluate (key k)
+{
+    id s = source_of(k);
+    id d = destination_of(k);
+    bool desired = m_desired.count(k) > 0;
+    bool live = m_live.count(k) > 0;
+    if (desired && ! live && present(s) && present(d))
+        m_to_make.insert(k);
+    else
+        m_to_make.erase(k);
+
+    if (live && ! desired && managed(s) && managed(d))
+        m_to_break.insert(k);
+    else
+        m_to_break.erase(k);
+}
+
+void
+patch_diff::rebuild ()
+{
+    m_to_make.clear();
+    m_to_break.clear();
+    for (key k : m_desired)
+        reevaluate(k);
+
+    for (key k : m_live)
+        reevaluate(k);
+}
+
+}           // namespace nsm
+
+/*
+ * patchdiff.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
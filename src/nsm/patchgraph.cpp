@@ -0,0 +1,239 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          patchgraph.cpp
+ *
+ *    This module builds a patch_graph from a .jackpatch file.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See extract_patch_line() and extract_client_port() in helpers.cpp for
+ *  the format of a patch line, including the a2j names with the extra
+ *  colon.
+ */
+
+#include <fstream>                      /* std::ifstream                    */
+
+#include "nsm/patchgraph.hpp"           /* nsm::patch_graph class           */
+
+namespace nsm
+{
+
+patch_graph::patch_graph () :
+    m_names     (),
+    m_name_ids  (),
+    m_ports     (),
+    m_port_ids  (),
+    m_edges     (),
+    m_bad_lines (0),
+    m_error     ()
+{
+    // no code
+}
+
+void
+patch_graph::clear ()
+{
+    m_name_ids.clear();
+    m_names.clear();
+    m_port_ids.clear();
+    m_ports.clear();
+    m_edges.clear();
+    m_bad_lines = 0;
+    m_error.clear();
+}
+
+/**
+ *  Reads a .jackpatch file, adding its connections to the graph. Blank
+ *  lines are ignored; bad lines are skipped and counted.
+ *
+ * \return
+ *      Returns false if the file could not be opened or had a bad line;
+ *      see error_message().
+ */
+
+bool
+patch_graph::load (const std::string & filename)
+{
+    std::ifstream file(filename);
+    if (! file)
+    {
+        if (m_error.empty())
+            m_error = filename + ": cannot open";
+
+        return false;
+    }
+
+    std::string line;                   /* reused; grows to the longest     */
+    int linenumber = 0;
+    int badbefore = m_bad_lines;
+    while (std::getline(file, line))
+    {
+        ++linenumber;
+        std::string_view v = trim_view(line);
+        if (v.empty())
+            continue;
+
+        if (! add_line(v))
+        {
+            if (m_error.empty())
+            {
+                m_error = filename + ":" + std::to_string(linenumber) +
+                    ": bad patch '" + std::string(v) + "'";
+            }
+        }
+    }
+    return m_bad_lines == badbefore;
+}
+
+/**
+ *  Parses one patch line, "client:port |> client:port", and adds its ports
+ *  and connection.
+ *
+ * \return
+ *      Returns false, and counts a bad line, if the line cannot be parsed.
+ */
+
+bool
+patch_graph::add_line (std::string_view line)
+{
+    std::string_view left, right;
+    patch_direction d = split_patch_line(line, left, right);
+    bool result = d != patch_direction::error;
+    std::string_view lclient, lport, rclient, rport;
+    if (result)
+    {
+        result = split_client_port(left, lclient, lport) &&
+            split_client_port(right, rclient, rport);
+    }
+    if (result)
+        add_edge(add_port(lclient, lport), add_port(rclient, rport), d);
+    else
+        ++m_bad_lines;
+
+    return result;
+}
+
+/**
+ *  Gets the ID of a name, adding the name if it is new.
+ */
+
+patch_graph::id
+patch_graph::intern (std::string_view name)
+{
+    auto n = m_name_ids.find(name);
+    if (n != m_name_ids.end())
+        return n->second;
+
+    id result = id(m_names.size());
+    m_names.emplace_back(name);
+    m_name_ids.emplace(std::string_view(m_names.back()), result);
+    return result;
+}
+
+patch_graph::id
+patch_graph::find_name (std::string_view name) const
+{
+    auto n = m_name_ids.find(name);
+    return n != m_name_ids.end() ? n->second : c_no_id ;
+}
+
+/**
+ *  Gets the ID of a port, adding the port (and its names) if it is new.
+ */
+
+patch_graph::id
+patch_graph::add_port (std::string_view clientname, std::string_view portname)
+{
+    id c = intern(clientname);
+    id p = intern(portname);
+    std::uint64_t key = port_key(c, p);
+    auto pt = m_port_ids.find(key);
+    if (pt != m_port_ids.end())
+        return pt->second;
+
+    id result = id(m_ports.size());
+    m_ports.push_back(port{ c, p });
+    m_port_ids.emplace(key, result);
+    return result;
+}
+
+patch_graph::id
+patch_graph::find_port
+(
+    std::string_view clientname, std::string_view portname
+) const
+{
+    id c = find_name(clientname);
+    id p = find_name(portname);
+    if (c == c_no_id || p == c_no_id)
+        return c_no_id;
+
+    auto pt = m_port_ids.find(port_key(c, p));
+    return pt != m_port_ids.end() ? pt->second : c_no_id ;
+}
+
+void
+patch_graph::add_edge (id left, id right, patch_direction d)
+{
+    m_edges.push_back(edge{ left, right, d });
+}
+
+/**
+ *  Rebuilds "client:port" for a port.
+ */
+
+std::string
+patch_graph::port_fullname (id p) const
+{
+    const port & pt = m_ports[p];
+    std::string result = m_names[pt.pt_client];
+    result += ':';
+    result += m_names[pt.pt_name];
+    return result;
+}
+
+/**
+ *  Rebuilds a patch line, in the form written by jackpatch.
+ */
+
+std::string
+patch_graph::edge_line (const edge & e) const
+{
+    const char * separator = " |> ";
+    if (e.e_direction == patch_direction::left)
+        separator = " <| ";
+    else if (e.e_direction == patch_direction::duplex)
+        separator = " || ";
+
+    return port_fullname(e.e_left) + separator + port_fullname(e.e_right);
+}
+
+}           // namespace nsm
+
+/*
+ * patchgraph.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
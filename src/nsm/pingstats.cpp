@@ -0,0 +1,200 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          pingstats.cpp
+ *
+ *    This module records ping round-trip times and losses.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ */
+
+#include "nsm/pingstats.hpp"            /* nsm::pingstats class             */
+
+namespace nsm
+{
+
+pingstats::pingstats () :
+    m_sent              (0),
+    m_received          (0),
+    m_lost              (0),
+    m_late              (0),
+    m_consecutive_lost  (0),
+    m_outstanding       (false),
+    m_sent_time         (),
+    m_reply_time        (),
+    m_last_us           (0),
+    m_min_us            (0),
+    m_max_us            (0),
+    m_total_us          (0.0),
+    m_histogram         ()
+{
+    m_histogram.fill(0);
+}
+
+/**
+ *  Records the sending of a ping. If one is still outstanding, it is
+ *  replaced; the caller should call expire() first.
+ */
+
+void
+pingstats::sent (clock::time_point t)
+{
+    ++m_sent;
+    m_outstanding = true;
+    m_sent_time = t;
+}
+
+/**
+ *  Records a reply.
+ *
+ * \return
+ *      Returns the round-trip time in microseconds, or -1 if no ping was
+ *      outstanding (a late reply).
+ */
+
+long
+pingstats::replied (clock::time_point t)
+{
+    m_reply_time = t;
+    m_consecutive_lost = 0;
+    if (! m_outstanding)
+    {
+        ++m_late;
+        return (-1);
+    }
+
+    long us = long
+    (
+        std::chrono::duration_cast<std::chrono::microseconds>
+        (
+            t - m_sent_time
+        ).count()
+    );
+    if (us < 0)
+        us = 0;
+
+    m_outstanding = false;
+    ++m_received;
+    m_last_us = us;
+    if (m_received == 1 || us < m_min_us)
+        m_min_us = us;
+
+    if (us > m_max_us)
+        m_max_us = us;
+
+    m_total_us += double(us);
+    ++m_histogram[bucket(us)];
+    return us;
+}
+
+/**
+ *  Counts the outstanding ping as lost if it has waited too long.
+ *
+ * \return
+ *      Returns true if the ping was just declared lost.
+ */
+
+bool
+pingstats::expire (clock::time_point t, long timeoutus)
+{
+    if (m_outstanding && t - m_sent_time >= std::chrono::microseconds(timeoutus))
+    {
+        m_outstanding = false;
+        ++m_lost;
+        ++m_consecutive_lost;
+        return true;
+    }
+    return false;
+}
+
+/**
+ *  Finds the histogram bucket for a round-trip time.
+ */
+
+int
+pingstats::bucket (long rttus)
+{
+    int result = 0;
+    long limit = c_first_bucket_us;
+    while (rttus >= limit && result < c_bucket_count - 1)
+    {
+        limit <<= 1;
+        ++result;
+    }
+    return result;
+}
+
+/**
+ *  The upper limit (exclusive) of a bucket, in microseconds. The last
+ *  bucket has no limit, and -1 is returned for it.
+ */
+
+long
+pingstats::bucket_limit (int b)
+{
+    if (b < 0 || b >= c_bucket_count - 1)
+        return (-1);
+
+    return c_first_bucket_us << b;
+}
+
+/**
+ *  Estimates a percentile of the round-trip time from the histogram.
+ *
+ * \param p
+ *      The percentile, from 0 to 100.
+ *
+ * \return
+ *      Returns the upper limit of the bucket holding the percentile, or the
+ *      maximum RTT if it is in the last bucket, or 0 if there are no
+ *      replies.
+ */
+
+long
+pingstats::percentile (double p) const
+{
+    if (m_received == 0)
+        return 0;
+
+    double wanted = p / 100.0 * double(m_received);
+    unsigned long count = 0;
+    for (int b = 0; b < c_bucket_count; ++b)
+    {
+        count += m_histogram[b];
+        if (count > 0 && double(count) >= wanted)
+        {
+            long limit = bucket_limit(b);
+            return limit < 0 || limit > m_max_us ? m_max_us : limit ;
+        }
+    }
+    return m_max_us;
+}
+
+}           // namespace nsm
+
+/*
+ * pingstats.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,300 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          sessionfile.cpp
+ *
+ *    This module maps the session.nsm file for parsing, and replaces it
+ *    atomically when saving.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Here is a sample session.nsm file:
+ *
+ *      Data-Storage:nsm-data:nQPEJ
+ *      JACKPatch:jackpatch:nLWNW
+ *      seq66:qseq66:nPSLM
+ */
+
+#include <cerrno>                       /* errno                            */
+#include <cstring>                      /* std::memchr(), std::strerror()   */
+#include <fcntl.h>                      /* open(2), O_RDONLY                */
+#include <sys/mman.h>                   /* mmap(2), munmap(2)               */
+#include <sys/stat.h>                   /* fstat(2)                         */
+#include <unistd.h>                     /* close(2)                         */
+#include <unordered_map>                /* std::unordered_map<>             */
+
+#include "nsm/sessionfile.hpp"          /* nsm::sessionfile class           */
+
+namespace nsm
+{
+
+namespace
+{
+
+bool
+valid_field (const std::string & s)
+{
+    return ! s.empty() && s.find_first_of(":\n") == std::string::npos;
+}
+
+}           // namespace (anonymous)
+
+sessionfile::sessionfile (const std::string & filename) :
+    m_filename      (filename),
+    m_data          (nullptr),
+    m_size          (0),
+    m_loaded        (false),
+    m_position      (0),
+    m_line          (0),
+    m_error         (),
+    m_error_line    (0)
+{
+    // no code
+}
+
+sessionfile::~sessionfile ()
+{
+    close();
+}
+
+void
+sessionfile::close ()
+{
+    if (m_data != nullptr)
+        (void) ::munmap(const_cast<char *>(m_data), m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_loaded = false;
+    rewind();
+}
+
+bool
+sessionfile::fail (const std::string & msg)
+{
+    m_error = msg;
+    return false;
+}
+
+/**
+ *  Maps the file. An empty file is loaded, but has no entries.
+ *
+ * \return
+ *      Returns false if the file cannot be opened or mapped; see
+ *      error_message().
+ */
+
+bool
+sessionfile::load ()
+{
+    close();
+    int fd = ::open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return fail(m_filename + ": " + std::strerror(errno));
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        int ec = errno;
+        (void) ::close(fd);
+        return fail(m_filename + ": " + std::strerror(ec));
+    }
+    if (st.st_size > 0)
+    {
+        void * p = ::mmap
+        (
+            nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0
+        );
+        if (p == MAP_FAILED)
+        {
+            int ec = errno;
+            (void) ::close(fd);
+            return fail(m_filename + ": " + std::strerror(ec));
+        }
+        (void) ::madvise(p, std::size_t(st.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(p);
+        m_size = std::size_t(st.st_size);
+    }
+    (void) ::close(fd);                 /* the mapping stays valid          */
+    m_loaded = true;
+    return true;
+}
+
+/**
+ *  Splits "name:exe:id" into its three fields. None may be empty, and
+ *  there must be exactly two colons.
+ */
+
+bool
+sessionfile::parse_line (std::string_view line, entry & e)
+{
+    std::size_t c1 = line.find(':');
+    if (c1 == std::string_view::npos || c1 == 0)
+        return false;
+
+    std::size_t c2 = line.find(':', c1 + 1);
+    if (c2 == std::string_view::npos || c2 == c1 + 1 || c2 + 1 >= line.size())
+        return false;
+
+    if (line.find(':', c2 + 1) != std::string_view::npos)
+        return false;
+
+    e.e_client_name = line.substr(0, c1);
+    e.e_client_exe = line.substr(c1 + 1, c2 - c1 - 1);
+    e.e_client_id = line.substr(c2 + 1);
+    return true;
+}
+
+/**
+ *  Gets the next entry. Blank lines are skipped.
+ *
+ * \param [out] e
+ *      The entry, as views into the mapping.
+ *
+ * \return
+ *      Returns false at the end of the file, or at a malformed line. In the
+ *      latter case, error_line() is non-zero and error_message() tells why;
+ *      parsing does not continue past the bad line.
+ */
+
+bool
+sessionfile::next (entry & e)
+{
+    while (m_position < m_size)
+    {
+        const char * start = m_data + m_position;
+        const char * nl = static_cast<const char *>
+        (
+            std::memchr(start, '\n', m_size - m_position)
+        );
+        std::size_t len = nl != nullptr ?
+            std::size_t(nl - start) : m_size - m_position ;
+
+        m_position += nl != nullptr ? len + 1 : len ;
+        ++m_line;
+
+        std::string_view line = trim_view(std::string_view(start, len));
+        if (line.empty())
+            continue;
+
+        if (parse_line(line, e))
+            return true;
+
+        m_error_line = m_line;
+        m_position = m_size;
+        return fail
+        (
+            m_filename + ":" + std::to_string(m_line) +
+            ": expected 'name:exe:id', got '" + std::string(line) + "'"
+        );
+    }
+    return false;
+}
+
+/**
+ *  Writes the entries, in order, replacing the file. Lines of entries that
+ *  are unchanged from the loaded file are copied as they are. The file
+ *  need not exist or have been loaded. After a write, the new file is
+ *  loaded, which invalidates any views from before.
+ *
+ * \param entries
+ *      The clients of the session. Each field must be non-empty and must
+ *      not contain a colon or a newline.
+ *
+ * \param [out] changed
+ *      Set to true if the file was written, or false if its contents were
+ *      already the same.
+ *
+ * \return
+ *      Returns false on an error; see error_message().
+ */
+
+bool
+sessionfile::save (const session_triplets & entries, bool & changed)
+{
+    changed = false;
+    std::unordered_map<std::string_view, std::string_view> oldlines;
+    std::size_t pos = 0;
+    while (pos < m_size)                /* index the old lines by client ID */
+    {
+        std::string_view rest(m_data + pos, m_size - pos);
+        std::size_t nl = rest.find('\n');
+        std::string_view raw = rest.substr(0, nl);
+        pos += nl != std::string_view::npos ? nl + 1 : rest.size() ;
+
+        entry e;
+        std::string_view line = trim_view(raw);
+        if (parse_line(line, e))
+            (void) oldlines.emplace(e.e_client_id, line);
+    }
+
+    std::string out;
+    out.reserve(m_size + 64);
+    for (const auto & t : entries)
+    {
+        bool ok = valid_field(t.st_client_name) &&
+            valid_field(t.st_client_exe) && valid_field(t.st_client_id);
+
+        if (! ok)
+            return fail("Bad session entry for client '" + t.st_client_id + "'");
+
+        entry e;
+        auto old = oldlines.find(t.st_client_id);
+        if
+        (
+            old != oldlines.end() && parse_line(old->second, e) &&
+            e.e_client_name == t.st_client_name &&
+            e.e_client_exe == t.st_client_exe
+        )
+        {
+            out.append(old->second);
+        }
+        else
+        {
+            out += t.st_client_name;
+            out += ':';
+            out += t.st_client_exe;
+            out += ':';
+            out += t.st_client_id;
+        }
+        out += '\n';
+    }
+    if (m_loaded && out == contents())
+        return true;
+
+    std::string errmsg;
+    if (! write_file_atomically(m_filename, out, errmsg))
+        return fail(errmsg);
+
+    changed = true;
+    return load();
+}
+
+}           // namespace nsm
+
+/*
+ * sessionfile.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
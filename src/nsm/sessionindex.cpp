@@ -0,0 +1,466 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          sessionindex.cpp
+ *
+ *    This module keeps an index of the sessions under the session root.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See sessionindex.hpp. A directory holding a session.nsm is a session,
+ *  and is not walked further: its sub-directories belong to its clients,
+ *  and watching them would multiply the inotify watches for nothing.
+ *  Hidden directories and symbolic links are not followed either.
+ */
+
+#include <cstdint>                      /* std::uint32_t                    */
+#include <dirent.h>                     /* opendir(3), readdir(3)           */
+#include <sys/stat.h>                   /* stat(2), lstat(2)                */
+#include <unistd.h>                     /* close(2), read(2)                */
+
+#include "platform_macros.h"            /* PLATFORM_LINUX                   */
+#include "nsm/sessionfile.hpp"          /* nsm::sessionfile class           */
+#include "nsm/sessionindex.hpp"         /* nsm::sessionindex class          */
+#include "util/msgfunctions.hpp"        /* util::warn_message()             */
+
+#if defined PLATFORM_LINUX
+#include <sys/inotify.h>                /* inotify_init1(2), etc.           */
+#endif
+
+namespace nsm
+{
+
+namespace
+{
+
+const char * const s_session_file = "session.nsm";
+
+std::string
+join (const std::string & relative, const std::string & name)
+{
+    return relative.empty() ? name : relative + "/" + name ;
+}
+
+bool
+is_group_prefix (const std::string & name, const std::string & prefix)
+{
+    return name.compare(0, prefix.length(), prefix) == 0;
+}
+
+}           // namespace (anonymous)
+
+sessionindex::sessionindex (const std::string & root) :
+    m_root          (root),
+    m_sessions      (),
+    m_inotify_fd    (-1),
+    m_watches       (),
+    m_rescan        (true),
+    m_scan_count    (0)
+{
+    while (m_root.length() > 1 && m_root.back() == '/')
+        m_root.pop_back();
+}
+
+sessionindex::~sessionindex ()
+{
+    close_watches();
+}
+
+/**
+ *  Reads what the index keeps about a session.
+ *
+ * \param path
+ *      The full path of the session directory.
+ *
+ * \param name
+ *      The session name, the path relative to the session root.
+ *
+ * \param [out] info
+ *      Filled in if the directory holds a session.nsm.
+ *
+ * \return
+ *      Returns false if there is no readable session.nsm file.
+ */
+
+bool
+sessionindex::read_session
+(
+    const std::string & path,
+    const std::string & name,
+    session_info & info
+)
+{
+    std::string filename = path + "/" + s_session_file;
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0 || ! S_ISREG(st.st_mode))
+        return false;
+
+    sessionfile sf(filename);
+    bool result = sf.load();
+    if (result)
+    {
+        sessionfile::entry e;
+        int count = 0;
+        while (sf.next(e))
+            ++count;
+
+        info.si_name = name;
+        info.si_path = path;
+        info.si_mtime = std::time_t(st.st_mtime);
+        info.si_client_count = count;
+    }
+    return result;
+}
+
+/**
+ *  Walks the whole session root, forgetting what was known, and sets up
+ *  the inotify watches afresh.
+ *
+ * \return
+ *      Returns false if the root cannot be read.
+ */
+
+bool
+sessionindex::scan ()
+{
+    close_watches();
+    m_sessions.clear();
+    m_rescan = false;
+#if defined PLATFORM_LINUX
+    m_inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    if (m_inotify_fd < 0)
+        m_rescan = true;                    /* walk at every refresh()      */
+
+    ++m_scan_count;
+
+    struct stat st;
+    bool result = ::stat(m_root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    if (result)
+        walk("");
+    else
+        util::warn_message("Cannot read session root", m_root);
+
+    return result;
+}
+
+/**
+ *  Brings the index up to date from the inotify events, or by walking the
+ *  root again if the events cannot be trusted.
+ *
+ * \return
+ *      Returns the number of sessions added, changed, or removed. After a
+ *      full walk, it is the number of sessions.
+ */
+
+int
+sessionindex::refresh ()
+{
+    int result = 0;
+#if defined PLATFORM_LINUX
+    alignas(struct inotify_event) char buffer[8192];
+    while (m_inotify_fd >= 0 && ! m_rescan)
+    {
+        ssize_t rc = ::read(m_inotify_fd, buffer, sizeof buffer);
+        if (rc <= 0)
+            break;
+
+        for (ssize_t i = 0; i < rc; )
+        {
+            const struct inotify_event * ev =
+                reinterpret_cast<const struct inotify_event *>(buffer + i);
+
+            i += ssize_t(sizeof(struct inotify_event) + ev->len);
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                m_rescan = true;
+                break;
+            }
+
+            auto w = m_watches.find(ev->wd);
+            if (w == m_watches.end())
+                continue;
+
+            std::string relative = w->second;
+            if (ev->mask & IN_IGNORED)
+            {
+                m_watches.erase(w);
+                continue;
+            }
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                if (relative.empty())
+                    m_rescan = true;            /* the root itself went     */
+
+                continue;
+            }
+
+            std::string name = ev->len > 0 ? ev->name : "" ;
+            if (name == s_session_file)
+            {
+                if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                {
+                    if (update(relative))
+                        ++result;
+                }
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    result += int(m_sessions.erase(relative));
+                }
+            }
+            else if ((ev->mask & IN_ISDIR) && ! name.empty() && name[0] != '.')
+            {
+                if (m_sessions.count(relative) > 0)
+                    continue;                   /* a client's directory     */
+
+                std::string child = join(relative, name);
+                std::size_t before = m_sessions.size();
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    walk(child);
+                    result += int(m_sessions.size() - before);
+                }
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    drop(child);
+                    result += int(before - m_sessions.size());
+                }
+            }
+        }
+    }
+#endif
+    if (m_rescan)
+    {
+        (void) scan();
+        result = int(m_sessions.size());
+    }
+    return result;
+}
+
+/**
+ *  The names of the sessions, in order.
+ *
+ * \param group
+ *      If not empty, only the sessions in that directory (at any depth)
+ *      are listed.
+ */
+
+lib66::tokenization
+sessionindex::list (const std::string & group) const
+{
+    lib66::tokenization result;
+    if (group.empty())
+    {
+        result.reserve(m_sessions.size());
+        for (const auto & s : m_sessions)
+            result.push_back(s.first);
+    }
+    else
+    {
+        std::string prefix = group + "/";
+        auto it = m_sessions.lower_bound(prefix);
+        for ( ; it != m_sessions.end(); ++it)
+        {
+            if (! is_group_prefix(it->first, prefix))
+                break;
+
+            result.push_back(it->first);
+        }
+    }
+    return result;
+}
+
+/**
+ *  Finds the sessions whose names contain the text. The pointers are
+ *  valid until the next refresh() or scan().
+ */
+
+sessionindex::matches
+sessionindex::search (const std::string & text) const
+{
+    matches result;
+    for (const auto & s : m_sessions)
+    {
+        if (s.first.find(text) != std::string::npos)
+            result.push_back(&s.second);
+    }
+    return result;
+}
+
+const session_info *
+sessionindex::find (const std::string & name) const
+{
+    auto it = m_sessions.find(name);
+    return it != m_sessions.end() ? &it->second : nullptr ;
+}
+
+/**
+ *  Watches and reads a directory, and, unless it is a session, walks its
+ *  sub-directories. The watch is added before the directory is read, so
+ *  that nothing created meanwhile is missed.
+ */
+
+void
+sessionindex::walk (const std::string & relative)
+{
+    std::string path = full_path(relative);
+    DIR * dir = ::opendir(path.c_str());
+    if (dir == nullptr)
+        return;
+
+    add_watch(relative);
+    if (! relative.empty())
+        (void) update(relative);
+
+    if (m_sessions.count(relative) == 0)
+    {
+        while (const struct dirent * de = ::readdir(dir))
+        {
+            if (de->d_name[0] == '.')
+                continue;                   /* ".", "..", and hidden ones   */
+
+            bool isdir = de->d_type == DT_DIR;
+            if (de->d_type == DT_UNKNOWN)
+            {
+                struct stat st;
+                std::string p = path + "/" + de->d_name;
+                isdir = ::lstat(p.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+            }
+            if (isdir)
+                walk(join(relative, de->d_name));
+        }
+    }
+    (void) ::closedir(dir);
+}
+
+/**
+ *  Puts an inotify watch on a directory. If there are no watches left
+ *  (see /proc/sys/fs/inotify/max_user_watches), the index falls back to
+ *  walking the root at every refresh().
+ */
+
+void
+sessionindex::add_watch (const std::string & relative)
+{
+#if defined PLATFORM_LINUX
+    if (m_inotify_fd < 0 || m_rescan)
+        return;
+
+    const std::uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_TO |
+        IN_MOVED_FROM | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF |
+        IN_ONLYDIR | IN_DONT_FOLLOW;
+
+    std::string path = full_path(relative);
+    int wd = ::inotify_add_watch(m_inotify_fd, path.c_str(), mask);
+    if (wd >= 0)
+    {
+        m_watches[wd] = relative;
+    }
+    else
+    {
+        util::warn_message("Cannot watch session directory", path);
+        m_rescan = true;
+    }
+#else
+    (void) relative;
+#endif
+}
+
+/**
+ *  Forgets a directory that was removed or moved away: the session there,
+ *  if any, the sessions below it, and their watches.
+ */
+
+void
+sessionindex::drop (const std::string & relative)
+{
+    std::string prefix = relative + "/";
+    (void) m_sessions.erase(relative);
+    auto it = m_sessions.lower_bound(prefix);
+    while (it != m_sessions.end() && is_group_prefix(it->first, prefix))
+        it = m_sessions.erase(it);
+
+    auto w = m_watches.begin();
+    while (w != m_watches.end())
+    {
+        if (w->second == relative || is_group_prefix(w->second, prefix))
+        {
+#if defined PLATFORM_LINUX
+            (void) ::inotify_rm_watch(m_inotify_fd, w->first);
+#endif
+            w = m_watches.erase(w);
+        }
+        else
+            ++w;
+    }
+}
+
+/**
+ *  Reads a session again.
+ *
+ * \return
+ *      Returns true if the session was added, changed, or removed.
+ */
+
+bool
+sessionindex::update (const std::string & relative)
+{
+    session_info info;
+    if (read_session(full_path(relative), relative, info))
+    {
+        auto it = m_sessions.find(relative);
+        bool result = it == m_sessions.end() ||
+            it->second.si_mtime != info.si_mtime ||
+            it->second.si_client_count != info.si_client_count;
+
+        m_sessions[relative] = info;
+        return result;
+    }
+    return m_sessions.erase(relative) > 0;
+}
+
+std::string
+sessionindex::full_path (const std::string & relative) const
+{
+    return relative.empty() ? m_root : m_root + "/" + relative ;
+}
+
+void
+sessionindex::close_watches ()
+{
+    m_watches.clear();
+    if (m_inotify_fd >= 0)
+    {
+        (void) ::close(m_inotify_fd);
+        m_inotify_fd = (-1);
+    }
+}
+
+}           // namespace nsm
+
+/*
+ * sessionindex.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
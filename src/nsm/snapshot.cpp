@@ -0,0 +1,402 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          snapshot.cpp
+ *
+ *    This module writes and reads the binary snapshot files.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  See snapshot.hpp for the layout.
+ */
+
+#include <array>                        /* std::array<>                     */
+#include <cerrno>                       /* errno                            */
+#include <cstring>                      /* std::memcmp(), std::strerror()   */
+#include <fcntl.h>                      /* open(2), O_RDONLY                */
+#include <sys/stat.h>                   /* fstat(2)                         */
+#include <unistd.h>                     /* read(2), close(2)                */
+
+#include "nsm/helpers.hpp"              /* nsm::write_file_atomically()     */
+#include "nsm/snapshot.hpp"             /* nsm::snapshot_writer, _reader    */
+
+namespace nsm
+{
+
+namespace
+{
+
+const char s_magic [] = "NSM66SNP";     /* 8 characters, no null            */
+const std::size_t s_magic_size = 8;
+const std::size_t s_header_size = 24;
+const std::size_t s_field_header_size = 6;
+
+void
+put_16 (std::string & out, std::uint16_t v)
+{
+    out += char(v & 0xFF);
+    out += char((v >> 8) & 0xFF);
+}
+
+void
+put_32 (std::string & out, std::uint32_t v)
+{
+    out += char(v & 0xFF);
+    out += char((v >> 8) & 0xFF);
+    out += char((v >> 16) & 0xFF);
+    out += char((v >> 24) & 0xFF);
+}
+
+std::uint16_t
+get_16 (const char * p)
+{
+    const unsigned char * u = reinterpret_cast<const unsigned char *>(p);
+    return std::uint16_t(u[0] | (u[1] << 8));
+}
+
+std::uint32_t
+get_32 (const char * p)
+{
+    const unsigned char * u = reinterpret_cast<const unsigned char *>(p);
+    return std::uint32_t(u[0]) | (std::uint32_t(u[1]) << 8) |
+        (std::uint32_t(u[2]) << 16) | (std::uint32_t(u[3]) << 24);
+}
+
+}           // namespace (anonymous)
+
+/**
+ *  The usual CRC-32 (IEEE 802.3, as in zlib), table-driven.
+ */
+
+std::uint32_t
+crc32 (std::string_view data)
+{
+    static const std::array<std::uint32_t, 256> s_table = []
+    {
+        std::array<std::uint32_t, 256> t {};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1 ;
+
+            t[i] = c;
+        }
+        return t;
+    }();
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (char ch : data)
+        c = s_table[(c ^ std::uint8_t(ch)) & 0xFF] ^ (c >> 8);
+
+    return c ^ 0xFFFFFFFFu;
+}
+
+/**
+ *  Checks only the magic bytes, so that a caller can tell a snapshot from
+ *  a text file.
+ */
+
+bool
+is_snapshot_file (const std::string & filename)
+{
+    bool result = false;
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        char magic[s_magic_size];
+        result = ::read(fd, magic, s_magic_size) == ssize_t(s_magic_size) &&
+            std::memcmp(magic, s_magic, s_magic_size) == 0;
+
+        (void) ::close(fd);
+    }
+    return result;
+}
+
+/*--------------------------------------------------------------------------
+ * snapshot_writer
+ *--------------------------------------------------------------------------*/
+
+snapshot_writer::snapshot_writer (snapshot_kind k) :
+    m_kind      (k),
+    m_payload   ()
+{
+    // no code
+}
+
+void
+snapshot_writer::add (std::uint16_t tag, std::string_view value)
+{
+    put_16(m_payload, tag);
+    put_32(m_payload, std::uint32_t(value.size()));
+    m_payload.append(value.data(), value.size());
+}
+
+void
+snapshot_writer::add (std::uint16_t tag, std::int32_t value)
+{
+    std::string v;
+    put_32(v, std::uint32_t(value));
+    add(tag, v);
+}
+
+/**
+ *  Returns the complete file contents, header and payload.
+ */
+
+std::string
+snapshot_writer::data () const
+{
+    std::string result;
+    result.reserve(s_header_size + m_payload.size());
+    result.append(s_magic, s_magic_size);
+    put_32(result, c_snapshot_version);
+    put_32(result, std::uint32_t(m_kind));
+    put_32(result, std::uint32_t(m_payload.size()));
+    put_32(result, crc32(m_payload));
+    result += m_payload;
+    return result;
+}
+
+bool
+snapshot_writer::write
+(
+    const std::string & filename, std::string & errmsg
+) const
+{
+    return write_file_atomically(filename, data(), errmsg);
+}
+
+/*--------------------------------------------------------------------------
+ * snapshot_reader
+ *--------------------------------------------------------------------------*/
+
+snapshot_reader::snapshot_reader () :
+    m_buffer    (),
+    m_position  (0),
+    m_error     ()
+{
+    // no code
+}
+
+bool
+snapshot_reader::fail (const std::string & msg)
+{
+    m_error = msg;
+    m_buffer.clear();
+    m_position = 0;
+    return false;
+}
+
+/**
+ *  Reads the whole file with one read(2), then checks it; see parse().
+ */
+
+bool
+snapshot_reader::load (const std::string & filename, snapshot_kind k)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return fail(filename + ": " + std::strerror(errno));
+
+    struct stat st;
+    std::string buffer;
+    bool ok = ::fstat(fd, &st) == 0;
+    if (ok)
+    {
+        buffer.resize(std::size_t(st.st_size));
+        ssize_t rc = ::read(fd, &buffer[0], buffer.size());
+        ok = rc == ssize_t(buffer.size());
+    }
+    int ec = errno;
+    (void) ::close(fd);
+    if (! ok)
+    {
+        std::string reason = ec != 0 ? std::strerror(ec) : "short read" ;
+        return fail(filename + ": " + reason);
+    }
+
+    bool result = parse(std::move(buffer), k);
+    if (! result)
+        m_error = filename + ": " + m_error;
+
+    return result;
+}
+
+/**
+ *  Checks the magic, version, kind, length, and checksum of a snapshot.
+ *
+ * \return
+ *      Returns true if the snapshot is good; the fields can then be got
+ *      with next().
+ */
+
+bool
+snapshot_reader::parse (std::string buffer, snapshot_kind k)
+{
+    m_buffer = std::move(buffer);
+    m_position = s_header_size;
+    m_error.clear();
+    if (m_buffer.size() < s_header_size)
+        return fail("too short for a snapshot");
+
+    const char * p = m_buffer.data();
+    if (std::memcmp(p, s_magic, s_magic_size) != 0)
+        return fail("not a snapshot");
+
+    if (get_32(p + 8) != c_snapshot_version)
+        return fail("unsupported snapshot version");
+
+    if (get_32(p + 12) != std::uint32_t(k))
+        return fail("wrong kind of snapshot");
+
+    std::uint32_t length = get_32(p + 16);
+    if (length != m_buffer.size() - s_header_size)
+        return fail("snapshot length mismatch");
+
+    std::string_view payload(p + s_header_size, length);
+    if (get_32(p + 20) != crc32(payload))
+        return fail("snapshot checksum mismatch");
+
+    return true;
+}
+
+/**
+ *  Gets the next field.
+ *
+ * \return
+ *      Returns false at the end of the payload, or if a field runs past
+ *      it (which the checksum makes unlikely); in the latter case an error
+ *      message is set.
+ */
+
+bool
+snapshot_reader::next (std::uint16_t & tag, std::string_view & value)
+{
+    if (m_position >= m_buffer.size())
+        return false;
+
+    if (m_buffer.size() - m_position < s_field_header_size)
+        return fail("truncated snapshot field");
+
+    const char * p = m_buffer.data() + m_position;
+    std::uint32_t length = get_32(p + 2);
+    std::size_t remaining = m_buffer.size() - m_position - s_field_header_size;
+    if (length > remaining)
+        return fail("truncated snapshot field");
+
+    tag = get_16(p);
+    value = std::string_view(p + s_field_header_size, length);
+    m_position += s_field_header_size + length;
+    return true;
+}
+
+std::int32_t
+snapshot_reader::to_int (std::string_view value)
+{
+    return value.size() == 4 ? std::int32_t(get_32(value.data())) : 0 ;
+}
+
+/*--------------------------------------------------------------------------
+ * Session entries
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+enum session_field : std::uint16_t
+{
+    sf_client_name = 1,                 /* starts a new entry               */
+    sf_client_exe,
+    sf_client_id
+};
+
+}           // namespace (anonymous)
+
+/**
+ *  Writes session entries as a snapshot, as a faster, checked alternative
+ *  to session.nsm.
+ */
+
+bool
+write_session_snapshot
+(
+    const std::string & filename,
+    const session_triplets & entries,
+    std::string & errmsg
+)
+{
+    snapshot_writer w(snapshot_kind::session);
+    for (const auto & t : entries)
+    {
+        w.add(sf_client_name, t.st_client_name);
+        w.add(sf_client_exe, t.st_client_exe);
+        w.add(sf_client_id, t.st_client_id);
+    }
+    return w.write(filename, errmsg);
+}
+
+bool
+read_session_snapshot
+(
+    const std::string & filename,
+    session_triplets & entries,
+    std::string & errmsg
+)
+{
+    snapshot_reader r;
+    entries.clear();
+    bool result = r.load(filename, snapshot_kind::session);
+    if (result)
+    {
+        std::uint16_t tag;
+        std::string_view value;
+        while (r.next(tag, value))
+        {
+            if (tag == sf_client_name)
+            {
+                entries.emplace_back();
+                entries.back().st_client_name = std::string(value);
+            }
+            else if (entries.empty())
+                continue;
+            else if (tag == sf_client_exe)
+                entries.back().st_client_exe = std::string(value);
+            else if (tag == sf_client_id)
+                entries.back().st_client_id = std::string(value);
+        }
+        result = r.error_message().empty();
+    }
+    if (! result)
+        errmsg = r.error_message();
+
+    return result;
+}
+
+}           // namespace nsm
+
+/*
+ * snapshot.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
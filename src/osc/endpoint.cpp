@@ -27,7 +27,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-04-23
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -50,12 +50,49 @@
  *          -   "/reply" + "ss" [reply]
  *          -   "/reply" + "s" [srvreplyex]
  *          -   "/reply" + "ssss" [replyex] NEW!
+ *
+ * Indices:
+ *
+ *  The peer and signal lists are shadowed by hashed indices (by peer name,
+ *  by peer address key, and by signal path), so that the lookups done for
+ *  every "/signal/..." message and every reply do not walk the lists.
+ *  Every function that adds, removes, or renames a peer or signal must
+ *  keep the indices in sync.
+ *
+ * Batching:
+ *
+ *  When batching is on, signal::value() and send_feedback() queue the
+ *  values instead of sending one datagram per peer per value. flush()
+ *  sends all the queued values as a bundle per peer, keeping only the
+ *  latest value for each path.
+ *
+ * Event loops:
+ *
+ *  An application with its own poll(2) or epoll(7) loop does not need to
+ *  call start(). It adds socket_fd() to its set, waits with next_timeout()
+ *  as the timeout, and calls dispatch_ready() when the descriptor is
+ *  readable or the timeout passes. Otherwise, run() (in the OSC thread)
+ *  does the same using epoll, and wakeup() interrupts it.
  */
 
+#include <algorithm>                    /* std::remove()                    */
+#include <cstring>                      /* std::strcmp()                    */
+#include <string_view>                  /* std::string_view                 */
+
 #include "osc/endpoint.hpp"             /* osc::endpoint class              */
+#include "osc/trace.hpp"                /* osc::trace_finish()              */
 #include "util/msgfunctions.hpp"        /* util::info_message(), _print()   */
 #include "util/strfunctions.hpp"        /* util::strncompare()              */
 
+#if defined PLATFORM_LINUX
+#include <cerrno>                       /* errno, EINTR                     */
+#include <cstdint>                      /* std::uint64_t                    */
+#include <sys/epoll.h>                  /* epoll_create1(), epoll_wait()    */
+#include <sys/socket.h>                 /* getsockname(), SO_REUSEPORT      */
+#include <sys/eventfd.h>                /* eventfd()                        */
+#include <unistd.h>                     /* ::read(), ::write(), ::close()   */
+#endif
+
 /*
  * CLANG and LO_TT_IMMEDIATE:
  *
@@ -74,12 +111,33 @@ endpoint::endpoint () :
     lowrapper       (),
     m_owner         (nullptr),
     m_thread        (),
+    m_peer_pool     (),
+    m_signal_pool   (),
     m_peers         (),
+    m_peer_destinations (),
+    m_peer_names    (),
+    m_peer_addresses(),
     m_signals       (),
+    m_signal_paths  (),
     m_methods       (),
     m_learning_path (),
     m_translations  (),
+    m_translation_sources       (),
+    m_translation_cursor        (),
+    m_translation_cursor_index  (-1),
     m_name          (),
+    m_time_to_die   (false),
+    m_batching      (false),
+    m_flush_interval_ms (0),
+    m_pending_mutex     (),
+    m_pending_values    (),
+    m_pending_paths     (),
+    m_last_flush        (std::chrono::steady_clock::now()),
+    m_held_mutex        (),
+    m_held_outputs      (),
+    m_wake_fd           (-1),
+    m_shards            (),
+    m_mailbox           (),
     m_peer_scan_complete_userdata       (),
     m_peer_signal_notification_userdata (),
     m_peer_scan_complete_callback       (),
@@ -88,6 +146,11 @@ endpoint::endpoint () :
     /*
      * util::debug_printf("endpoint @ %p", this);
      */
+
+#if defined PLATFORM_LINUX
+    m_wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_mailbox.wake_fd(m_wake_fd);
+#endif
 }
 
 /*
@@ -96,10 +159,17 @@ endpoint::endpoint () :
 
 endpoint::~endpoint ()
 {
-    for (auto & mp : m_methods)
-        delete mp;
-
+    stop_shards();
+    for (auto p : m_peers)
+    {
+        if (not_nullptr(p->p_addr))
+            lo_address_free(p->p_addr);
+    }
     m_methods.clear();
+#if defined PLATFORM_LINUX
+    if (m_wake_fd >= 0)
+        (void) ::close(m_wake_fd);
+#endif
 }
 
 /*
@@ -215,6 +285,10 @@ endpoint::add_methods (void * userdata)
         osc::tag::sigreply, &endpoint::osc_reply, userdata
     );
     add_osc_method
+    (
+        osc::tag::stats, &endpoint::osc_stats, userdata
+    );
+    add_osc_method
     (
         osc::tag::generic, &endpoint::osc_generic, userdata
     );
@@ -226,12 +300,18 @@ endpoint::add_methods (void * userdata)
      */
 }
 
+/**
+ *  Still a linear search, since the list is arbitrary, but it compares the
+ *  cached address key of each peer instead of asking liblo for the ports.
+ */
+
 osc::signal *
 endpoint::find_target_by_peer_address (signal_list * lst, lo_address addr )
 {
+    std::string key = address_key(addr);
     for (const auto & s : *lst)
     {
-        if (address_matches(addr, s->m_peer->p_addr))
+        if (not_nullptr(s->m_peer) && s->m_peer->p_addr_key == key)
             return s;
     }
     return nullptr;
@@ -240,23 +320,78 @@ endpoint::find_target_by_peer_address (signal_list * lst, lo_address addr )
 osc::signal *
 endpoint::find_peer_signal_by_path (peer * p, const std::string & path)
 {
-    for (const auto & s : p->p_signals)
-    {
-        if (s->path() == path)
-            return s;
-    }
-    return nullptr;
+    auto it = p->p_signal_index.find(path);
+    return it != p->p_signal_index.end() ? it->second : nullptr ;
 }
 
 osc::signal *
 endpoint::find_signal_by_path (const std::string & path)
 {
-    for (const auto & s : m_signals)
+    auto it = m_signal_paths.find(path);
+    return it != m_signal_paths.end() ? it->second : nullptr ;
+}
+
+/**
+ *  Adds a signal to the peer's list and index. If the path is already
+ *  indexed, the first signal keeps the index entry, as in a list search.
+ */
+
+void
+endpoint::add_peer_signal (peer * p, signal * s)
+{
+    p->p_signals.push_back(s);
+    (void) p->p_signal_index.emplace(s->path(), s);
+}
+
+/**
+ *  Removes a signal from the peer's list and index. Does not delete it.
+ *  If another signal of the peer has the same path, it takes over the
+ *  index entry, so that it can still be found.
+ */
+
+void
+endpoint::remove_peer_signal (peer * p, signal * s)
+{
+    signal_list & sl = p->p_signals;
+    sl.erase(std::remove(sl.begin(), sl.end(), s), sl.end());
+
+    auto it = p->p_signal_index.find(s->path());
+    if (it != p->p_signal_index.end() && it->second == s)
     {
-        if (s->path() == path)
-            return s;
+        p->p_signal_index.erase(it);
+        for (auto o : sl)
+        {
+            if (o->path() == s->path())
+            {
+                (void) p->p_signal_index.emplace(o->path(), o);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ *  Removes the signal's path from the endpoint's path index, if the entry
+ *  refers to this signal. The next signal in m_signals with the same path,
+ *  if any, takes over the entry.
+ */
+
+void
+endpoint::unindex_signal_path (signal * s)
+{
+    auto it = m_signal_paths.find(s->path());
+    if (it != m_signal_paths.end() && it->second == s)
+    {
+        m_signal_paths.erase(it);
+        for (auto o : m_signals)
+        {
+            if (o != s && o->path() == s->path())
+            {
+                (void) m_signal_paths.emplace(o->path(), o);
+                break;
+            }
+        }
     }
-    return nullptr;
 }
 
 /**
@@ -300,14 +435,17 @@ endpoint::handle_hello
         lo_address addr = lo_address_new_from_url(CSTR(peer_url));
         if (address_matches(addr, p->p_addr))
         {
-            free(addr);
+            lo_address_free(addr);
             return;
         }
-        if (p->p_addr)
-            free(p->p_addr);
+        unindex_peer_address(p);
+        if (not_nullptr(p->p_addr))
+            lo_address_free(p->p_addr);
 
         util::info_message("Scanning peer", peer_name);
         p->p_addr = addr;
+        index_peer_address(p);
+        refresh_peer_destinations();
         p->p_scanning = true;
         send(p->p_addr, tag_message(tag::siglist));
     }
@@ -329,10 +467,13 @@ endpoint::osc_sig_hello
 (
     const char * path, const char * types,
     lo_arg ** argv, int argc,
-    lo_message /*msg*/, void * userdata
+    lo_message msg, void * userdata
 )
 {
-    osc_msg_summary("endpoint::osc_sig_hello", path, types, argv, argc, userdata);
+    osc_msg_summary
+    (
+        "endpoint::osc_sig_hello", path, types, argv, argc, userdata, msg
+    );
     if (argc >= 2)
     {
         endpoint * ep = static_cast<endpoint *>(userdata);
@@ -356,12 +497,12 @@ endpoint::osc_sig_disconnect
 (
     const char * path, const char * types,
     lo_arg ** argv, int argc,
-    lo_message /*msg*/, void * userdata
+    lo_message msg, void * userdata
 )
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_disconnect", path, types, argv, argc, userdata
+        "endpoint::osc_sig_disconnect", path, types, argv, argc, userdata, msg
     );
     if (argc >= 2)
     {
@@ -408,12 +549,12 @@ endpoint::osc_sig_connect
 (
     const char * path, const char * types,
     lo_arg ** argv, int argc,
-    lo_message /*msg*/, void * userdata
+    lo_message msg, void * userdata
 )
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_connect", path, types, argv, argc, userdata
+        "endpoint::osc_sig_connect", path, types, argv, argc, userdata, msg
     );
     if (argc >= 2)
     {
@@ -464,7 +605,7 @@ endpoint::osc_sig_removed
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_removed", path, types, argv, argc, userdata
+        "endpoint::osc_sig_removed", path, types, argv, argc, userdata, msg
     );
     if (argc >= 1)
     {
@@ -476,7 +617,7 @@ endpoint::osc_sig_removed
             return osc_msg_unhandled();
         }
 
-        peer * p = ep->find_peer_by_address(lo_message_get_source(msg));
+        peer * p = ep->find_peer_by_address(message_source(msg));
         if (is_nullptr(p))
         {
             util::warn_message("Signal-removed message from unknown peer");
@@ -500,8 +641,8 @@ endpoint::osc_sig_removed
                 o, signal::removed, ep->m_peer_signal_userdata
             );
         }
-        p->p_signals.remove(o);
-        delete o;
+        remove_peer_signal(p, o);
+        ep->m_signal_pool.destroy(o);
     }
     return osc_msg_handled();
 }
@@ -516,7 +657,7 @@ endpoint::osc_sig_created
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_created", path, types, argv, argc, userdata
+        "endpoint::osc_sig_created", path, types, argv, argc, userdata, msg
     );
     if (argc >= 5)
     {
@@ -532,7 +673,7 @@ endpoint::osc_sig_created
         const float min = argv[2]->f;
         const float max = argv[3]->f;
         const float default_value = argv[4]->f;
-        peer * p = ep->find_peer_by_address(lo_message_get_source(msg));
+        peer * p = ep->find_peer_by_address(message_source(msg));
         if (is_nullptr(p))
         {
             util::warn_message("Signal creation message from unknown peer");
@@ -545,12 +686,12 @@ endpoint::osc_sig_created
         else if (direction == "out")
             dir = signal::output;
 
-        signal * s = new (std::nothrow) signal(name, dir);
+        signal * s = ep->m_signal_pool.create(name, dir);
         if (not_nullptr(s))
         {
             s->m_peer = p;
             s->set_parameter_limits(min, max, default_value);
-            p->p_signals.push_back(s);
+            add_peer_signal(p, s);
             util::info_printf
             (
                 "Peer %s created signal %s (%s %f %f %f)",
@@ -578,7 +719,7 @@ endpoint::osc_sig_renamed
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_renamed", path, types, argv, argc, userdata
+        "endpoint::osc_sig_renamed", path, types, argv, argc, userdata, msg
     );
     if (argc >= 2)
     {
@@ -591,7 +732,7 @@ endpoint::osc_sig_renamed
             return osc_msg_unhandled();
         }
 
-        peer * p = ep->find_peer_by_address(lo_message_get_source(msg));
+        peer * p = ep->find_peer_by_address(message_source(msg));
         if (is_nullptr(p))
         {
             util::warn_message("Signal-rename message from unknown peer");
@@ -610,7 +751,9 @@ endpoint::osc_sig_renamed
             "Signal %s renamed to %s", V(o->m_path), V(new_name)
         );
         ep->rename_translation_source(o->m_path, new_name);
+        remove_peer_signal(p, o);
         o->m_path = new_name;
+        add_peer_signal(p, o);
     }
     return osc_msg_handled();
 }
@@ -634,7 +777,7 @@ endpoint::osc_sig_handler
 {
     osc_msg_summary
     (
-        "endpoint::osc_sig_handler", path, types, argv, argc, userdata
+        "endpoint::osc_sig_handler", path, types, argv, argc, userdata, msg
     );
     if (argc >= 1)
     {
@@ -646,15 +789,15 @@ endpoint::osc_sig_handler
         }
 
         float f = 0.0;
-        if (std::string(types) == "f" )     /* accept the float value       */
+        if (not_nullptr(types) && std::strcmp(types, "f") == 0)
         {
-            f = argv[0]->f;
+            f = argv[0]->f;                 /* accept the float value       */
         }
         else if (is_nullptr(types) || types[0] == 0)
         {
             o->m_endpoint->send
             (
-                lo_message_get_source(msg), tag_message(tag::reply),
+                message_source(msg), tag_message(tag::reply),
                 path, o->value()
             );
             return osc_msg_handled();
@@ -662,6 +805,7 @@ endpoint::osc_sig_handler
         else
             return osc_msg_unhandled();
 
+        std::lock_guard<std::mutex> lock(o->m_handler_mutex);
         o->m_value = f;
         if (o->m_handler)
             o->m_handler(f, o->m_user_data);
@@ -672,31 +816,86 @@ endpoint::osc_sig_handler
 /**
  *  This function originally created an array of string pointers while
  *  traversing the translation map looking for matches to path.
- *  We will use a vector of strings, lib66::tokenization.
+ *  We will use a vector of strings, lib66::tokenization. The sources for
+ *  the path are found via the reverse index.
  */
 
 lib66::tokenization
 endpoint::get_connections (const std::string & path)
 {
     lib66::tokenization result;
-    for (const auto & t : m_translations)
+    auto range = m_translation_sources.equal_range(path);
+    for (auto it = range.first; it != range.second; ++it)
+        result.push_back(it->second);
+
+    return result;
+}
+
+/**
+ *  Adds the destination-to-source entry to the reverse index.
+ */
+
+void
+endpoint::link_translation (const std::string & src, const std::string & dst)
+{
+    (void) m_translation_sources.emplace(dst, src);
+}
+
+/**
+ *  Removes the destination-to-source entry from the reverse index.
+ */
+
+void
+endpoint::unlink_translation (const std::string & src, const std::string & dst)
+{
+    auto range = m_translation_sources.equal_range(dst);
+    for (auto it = range.first; it != range.second; ++it)
     {
-        if (t.second.m_path == path)
-            result.push_back(t.first);
+        if (it->second == src)
+        {
+            m_translation_sources.erase(it);
+            break;
+        }
     }
-    return result;
 }
 
 void
 endpoint::clear_translations ()
 {
-    m_translations.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_held_mutex);     /* find_gate()  */
+        m_translations.clear();
+    }
+    m_translation_sources.clear();
+    reset_translation_cursor();
 }
 
+/**
+ *  Adds (or re-targets) the translation of source path \a a to the
+ *  destination path \a b.
+ */
+
 void
 endpoint::add_translation (const std::string & a, const std::string & b)
 {
-    m_translations[a].m_path = b;
+    translation_map::iterator i = m_translations.find(a);
+    if (i != m_translations.end())
+    {
+        if (i->second.m_path == b)
+            return;
+
+        unlink_translation(a, i->second.m_path);
+        i->second.m_path = b;
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_held_mutex);
+            m_translations[a].m_path = b;
+        }
+        reset_translation_cursor();             /* ordinals have shifted    */
+    }
+    link_translation(a, b);
 }
 
 void
@@ -704,9 +903,23 @@ endpoint::del_translation (const std::string & a)
 {
     translation_map::iterator i = m_translations.find(a);
     if (i != m_translations.end())
-        m_translations.erase(i);
+    {
+        unlink_translation(a, i->second.m_path);
+        {
+            std::lock_guard<std::mutex> lock(m_held_mutex);
+            m_translations.erase(i);
+        }
+        reset_translation_cursor();
+    }
 }
 
+/**
+ *  Changes the destination of the translations going to path \a a so that
+ *  they go to path \a b.  The original code stopped at the first
+ *  translation found, which left the other sources pointing to a path
+ *  that no longer exists after a signal rename; all of them are moved now.
+ */
+
 void
 endpoint::rename_translation_destination
 (
@@ -714,12 +927,21 @@ endpoint::rename_translation_destination
     const std::string & b
 )
 {
-    for (auto & t : m_translations)
+    if (a == b)
+        return;
+
+    lib66::tokenization sources = get_connections(a);
+    if (! sources.empty())
     {
-        if (t.second.m_path == a)
+        m_translation_sources.erase(a);
+        for (const auto & src : sources)
         {
-            t.second.m_path = b;
-            break;                          // is this okay?
+            translation_map::iterator i = m_translations.find(src);
+            if (i != m_translations.end())
+            {
+                i->second.m_path = b;
+                link_translation(src, b);
+            }
         }
     }
 }
@@ -734,37 +956,61 @@ endpoint::rename_translation_source
     translation_map::iterator i = m_translations.find(a);
     if (i != m_translations.end())
     {
-        m_translations[b] = m_translations[a];
-        m_translations.erase(i);
+        translation_destination td = i->second;
+        td.m_output_gate.reset();               /* held under the old path  */
+        unlink_translation(a, td.m_path);
+        {
+            std::lock_guard<std::mutex> lock(m_held_mutex);
+            m_translations.erase(i);
+        }
+
+        translation_map::iterator j = m_translations.find(b);
+        if (j != m_translations.end())
+            unlink_translation(b, j->second.m_path);
+
+        {
+            std::lock_guard<std::mutex> lock(m_held_mutex);
+            m_translations[b] = td;
+        }
+        link_translation(b, td.m_path);
+        reset_translation_cursor();
     }
 }
 
 int
 endpoint::ntranslations ()
 {
-    return m_translations.size();
+    return int(m_translations.size());
 }
 
+/**
+ *  Gets the n'th translation. Since callers enumerate the translations
+ *  from 0 to ntranslations() - 1, the last position is cached and the
+ *  search starts from there when possible.
+ */
+
 bool
 endpoint::get_translation
 (
     int n, std::string & from, std::string & to
 )
 {
-    bool result = false;
-    int j = 0;
-    for (const auto & t : m_translations)
+    if (n < 0 || n >= ntranslations())
+        return false;
+
+    if (m_translation_cursor_index < 0 || n < m_translation_cursor_index)
     {
-        if (j == n)
-        {
-            from = t.first;
-            to = t.second.m_path;
-            result = true;
-            break;
-        }
-        ++j;
+        m_translation_cursor = m_translations.begin();
+        m_translation_cursor_index = 0;
     }
-    return result;
+    while (m_translation_cursor_index < n)
+    {
+        ++m_translation_cursor;
+        ++m_translation_cursor_index;
+    }
+    from = m_translation_cursor->first;
+    to = m_translation_cursor->second.m_path;
+    return true;
 }
 
 int
@@ -777,7 +1023,7 @@ endpoint::osc_generic
     endpoint * ep = static_cast<endpoint *>(userdata);
     osc_msg_summary
     (
-        "endpoint::osc_generic", path, types, argv, argc, userdata
+        "endpoint::osc_generic", path, types, argv, argc, userdata, msg
     );
     if (is_nullptr(ep))
     {
@@ -788,48 +1034,51 @@ endpoint::osc_generic
     {
         if (! ep->m_learning_path.empty())
         {
-            ep->add_translation(path, ep->m_learning_path);
+            std::string destination = ep->m_learning_path;
+            ep->m_learning_path.clear();
+            ep->add_translation(path, destination);
             util::info_printf
             (
                 "Learned translation \"%s\" -> \"%s\"",
-                path, V(ep->m_learning_path)
+                path, V(destination)
             );
-            ep->m_learning_path.clear();
             return osc_msg_handled();
         }
 
-        std::string ppath = std::string(path);
         translation_map::iterator i = ep->m_translations.find(path);
         if (i != ep->m_translations.end())
         {
-            std::string dpath = i->second.m_path;
-            if (std::string(types) == "f")
+            if (std::strcmp(types, "f") == 0)
                 i->second.m_current_value = argv[0]->f;
 
             i->second.m_suppress_feedback = true;
-            lo_send_message(ep->address(), CSTR(dpath), msg);
+            lo_send_message(ep->address(), CSTR(i->second.m_path), msg);
             return osc_msg_handled();
         }
-        if (ppath.back() != '/')
-            return osc_msg_unhandled();
 
-        for (const auto & m : ep->m_methods)        /* a list of pointers   */
+        std::string_view ppath(path);
+        if (ppath.empty() || ppath.back() != '/')
         {
-            if (m->path().empty())
-                continue;
+            ep->stats().unhandled();
+            return osc_msg_unhandled();
+        }
 
-            if (util::strncompare(m->path(), ppath, ppath.length()))
+        /*
+         * A directory query: only the subtree under the path is visited.
+         */
+
+        const std::string spath(ppath);
+        lo_address source = message_source(msg);
+        ep->m_methods.for_each_prefix
+        (
+            ppath, [ep, source, &spath] (const method & m)
             {
-                ep->send
-                (
-                    lo_message_get_source(msg), tag_message(tag::reply),
-                    path, m->path()
-                );
+                ep->send(source, tag_message(tag::reply), spath, m.path());
             }
-        }
+        );
         ep->send
         (
-            lo_message_get_source(msg), tag_message(tag::srvreply), path
+            message_source(msg), tag_message(tag::srvreply), path
         );
     }
     return osc_msg_handled();
@@ -891,7 +1140,10 @@ endpoint::osc_reply
 )
 {
     endpoint * ep = static_cast<endpoint *>(userdata);
-    osc_msg_summary("endpoint::osc_reply", path, types, argv, argc, userdata);
+    osc_msg_summary
+    (
+        "endpoint::osc_reply", path, types, argv, argc, userdata, msg
+    );
     if (is_nullptr(ep))
     {
         util::error_message("osc_reply()", "null endpoint");
@@ -901,7 +1153,7 @@ endpoint::osc_reply
     std::string sigcmd = &argv[0]->s;
     if (argc > 0 && sigcmd == tag_message(tag::siglist))
     {
-        peer * p = ep->find_peer_by_address(lo_message_get_source(msg));
+        peer * p = ep->find_peer_by_address(message_source(msg));
         if (is_nullptr(p))
         {
             util::warn_message("Input list reply from unknown peer");
@@ -939,12 +1191,12 @@ endpoint::osc_reply
             else if (directionname == "out")
                 dir = signal::output;
 
-            s = new (std::nothrow) signal(pathname, dir);
+            s = ep->m_signal_pool.create(pathname, dir);
             if (not_nullptr(s))
             {
                 s->m_peer = p;
                 s->set_parameter_limits(argv[3]->f, argv[4]->f, argv[5]->f);
-                p->p_signals.push_back(s);
+                add_peer_signal(p, s);
                 if (ep->m_peer_signal_callback)
                 {
                     ep->m_peer_signal_callback
@@ -971,7 +1223,7 @@ endpoint::osc_signal_lister
     endpoint * ep = static_cast<endpoint *>(userdata);
     osc_msg_summary
     (
-        "endpoint::osc_signal_lister", path, types, argv, argc, userdata
+        "endpoint::osc_signal_lister", path, types, argv, argc, userdata, msg
     );
     if (is_nullptr(ep))
     {
@@ -992,18 +1244,82 @@ endpoint::osc_signal_lister
             const parameter_limits & pl = o->get_parameter_limits();
             ep->send
             (
-                lo_message_get_source(msg), tag_message(tag::reply),
+                message_source(msg), tag_message(tag::reply),
                 path, o->path(),
                 o->m_direction == signal::input ? "in" : "out",
                 pl.pl_min, pl.pl_max, pl.pl_default_value
             );
         }
     }
-    ep->send(lo_message_get_source(msg), tag_message(tag::srvreply),
+    ep->send(message_source(msg), tag_message(tag::srvreply),
     path);
     return osc_msg_handled();
 }
 
+/**
+ *  Answers "/nsm66/stats" (osc::tag::stats) with one bundle of
+ *  "/nsm66/reply/stats" (osc::tag::replystats) messages, one per row of the
+ *  stats() snapshot, then a row of kind "end". See osc/metrics.hpp for the
+ *  rows. Only a known peer gets an answer, since the answer is much bigger
+ *  than the question, and the source of a datagram is easily forged.
+ */
+
+int
+endpoint::osc_stats
+(
+    const char * path, const char * types,
+    lo_arg ** argv, int argc,
+    lo_message msg, void * userdata
+)
+{
+    endpoint * ep = static_cast<endpoint *>(userdata);
+    osc_msg_summary
+    (
+        "endpoint::osc_stats", path, types, argv, argc, userdata, msg
+    );
+    if (is_nullptr(ep))
+    {
+        util::error_message("osc_stats()", "null endpoint");
+        return osc_msg_unhandled();
+    }
+
+    lo_address source = message_source(msg);
+    if (is_nullptr(ep->find_peer_by_address(source)))
+    {
+        util::warn_message("Stats query from unknown peer ignored");
+        return osc_msg_handled();
+    }
+
+    lo_bundle b = lo_bundle_new(LO_TT_IMMEDIATE_2);
+    if (is_nullptr(b))
+        return osc_msg_handled();
+
+    const std::string & reply = tag_message(tag::replystats);
+    metric_rows rows = ep->stats().snapshot();
+    rows.push_back({ "end", "", 0, 0 });
+    for (const auto & r : rows)
+    {
+        lo_message m = lo_message_new();
+        if (is_nullptr(m))
+            break;
+
+        lo_message_add_string(m, CSTR(r.mr_kind));
+        lo_message_add_string(m, CSTR(r.mr_name));
+        lo_message_add_int64(m, r.mr_a);
+        lo_message_add_int64(m, r.mr_b);
+        lo_bundle_add_message(b, CSTR(reply), m);
+    }
+
+    int rc = lo_send_bundle_from(source, ep->server(), b);
+    if (rc >= 0)
+        ep->stats().sent(tag::replystats, std::uint64_t(rc));
+    else
+        ep->stats().send_failed();
+
+    lo_bundle_free_recursive(b);                /* frees the messages too   */
+    return osc_msg_handled();
+}
+
 /**
  *  Static function.
  */
@@ -1016,6 +1332,33 @@ endpoint::address_matches (lo_address addr1, lo_address addr2)
     return purl == url;
 }
 
+/**
+ *  Static function. Creates the canonical key for an address, used for the
+ *  peer-address index. Like address_matches(), it ignores the host name,
+ *  because the source address of an incoming message holds a numeric host,
+ *  while a peer's address is made from a URL, which usually holds a host
+ *  name.  The protocol is added to keep UDP and TCP peers apart.
+ *
+ * \return
+ *      Returns a string such as "1/14143" (LO_UDP is 1). If the address
+ *      is null, an empty string is returned.
+ */
+
+std::string
+endpoint::address_key (lo_address addr)
+{
+    std::string result;
+    if (not_nullptr(addr))
+    {
+        const char * port = lo_address_get_port(addr);
+        result = std::to_string(lo_address_get_protocol(addr));
+        result += '/';
+        if (not_nullptr(port))
+            result += port;
+    }
+    return result;
+}
+
 #if defined USE_LIST_PEER_SIGNALS
 
 /**
@@ -1045,29 +1388,65 @@ endpoint::list_peer_signals (void * v)
 peer *
 endpoint::find_peer_by_address (lo_address addr)
 {
-    std::string url = lo_address_get_port(addr);
-    peer * p = nullptr;
-    for (const auto & mp : m_peers)
-    {
-        std::string purl = lo_address_get_port(mp->p_addr);
-        if (purl == url)
-        {
-            p = mp;     /* *i; */
-            break;
-        }
-    }
-    return p;
+    auto it = m_peer_addresses.find(address_key(addr));
+    return it != m_peer_addresses.end() ? it->second : nullptr ;
 }
 
 peer *
 endpoint::find_peer_by_name (const std::string & name)
 {
-    for (const auto & mp : m_peers)
+    auto it = m_peer_names.find(name);
+    return it != m_peer_names.end() ? it->second : nullptr ;
+}
+
+/**
+ *  Recalculates the peer's address key and adds it to the address index.
+ *  As with the old list search, the first peer with a given key wins.
+ */
+
+void
+endpoint::index_peer_address (peer * p)
+{
+    p->p_addr_key = address_key(p->p_addr);
+    (void) m_peer_addresses.emplace(p->p_addr_key, p);
+}
+
+/**
+ *  Rebuilds the array of peer addresses used by send_value() and flush().
+ *  Called when a peer is added or its address changes, which is rare.
+ */
+
+void
+endpoint::refresh_peer_destinations ()
+{
+    m_peer_destinations.clear();
+    for (auto p : m_peers)
+        m_peer_destinations.push_back(p->p_addr);
+}
+
+/**
+ *  Removes the peer's address key from the address index, if the key
+ *  refers to this peer. Another peer with the same key, if any, takes over
+ *  the entry.
+ */
+
+void
+endpoint::unindex_peer_address (peer * p)
+{
+    auto it = m_peer_addresses.find(p->p_addr_key);
+    if (it != m_peer_addresses.end() && it->second == p)
     {
-        if (name == mp->p_name)
-            return mp;
+        m_peer_addresses.erase(it);
+        for (auto op : m_peers)
+        {
+            if (op != p && op->p_addr_key == p->p_addr_key)
+            {
+                (void) m_peer_addresses.emplace(op->p_addr_key, op);
+                break;
+            }
+        }
     }
-    return nullptr;
+    p->p_addr_key.clear();
 }
 
 /**
@@ -1170,13 +1549,34 @@ endpoint::add_method
         server(), OPTR(path), OPTR(typespec),
         handler, userdata
     );
-    method * md = new (std::nothrow) method;
+    method * md = new (std::nothrow)
+        method(path, typespec, argument_description);
+
     if (not_nullptr(md))
+        m_methods.insert(md);
+
+    return md;
+}
+
+/**
+ *  Lists a method added elsewhere (see add_typed_method()) for the directory
+ *  queries, without adding a handler.
+ */
+
+method *
+endpoint::list_method
+(
+    osc::tag t,
+    const std::string & argument_description
+)
+{
+    method * md = nullptr;
+    std::string msg, pattern;
+    if (tag_lookup(t, msg, pattern))
     {
-        md->m_path = path;
-        md->m_typespec = typespec;
-        md->m_documentation = argument_description;
-        m_methods.push_back(md);
+        md = new (std::nothrow) method(msg, pattern, argument_description);
+        if (not_nullptr(md))
+            m_methods.insert(md);
     }
     return md;
 }
@@ -1207,10 +1607,15 @@ endpoint::add_signal
         o->m_endpoint = this;
         o->set_parameter_limits(min, max, default_value);
         m_signals.push_back(o);
+        {
+            std::lock_guard<std::mutex> lock(m_held_mutex);
+            (void) m_signal_paths.emplace(o->m_path, o);
+        }
         lo_server_add_method
         (
             server(), OPTR(o->m_path), NULL, osc_sig_handler, o
         );
+        share_signal(o);
         for (const auto & mp : m_peers)
         {
             send
@@ -1227,40 +1632,30 @@ endpoint::add_signal
 #if defined USE_DEL_METHOD
 
 /**
- *  lo_server_del_method() returns void.
- *
- *  This is a weird one. We tried to use the following, but could not
- *  erase the entry:
- *
- *      for (auto m : m_methods)
+ *  lo_server_del_method() returns void. The method is also removed from
+ *  the trie, which deletes it.
  */
 
 void
 endpoint::del_method (const std::string & path, const std::string & typespec)
 {
     lo_server_del_method(server(), OPTR(path), OPTR(typespec));
-    for (method_list::iterator i = m_methods.begin(); i != m_methods.end(); ++i)
-    {
-        method * p = *i;
-        if (p->path().empty())
-            continue;
-
-        if (path == p->path() && typespec == p->typespec())
-        {
-            delete p;
-            (void) m_methods.erase(i);
-            break;
-        }
-    }
+    (void) m_methods.remove(path, typespec);
 }
 
+/**
+ *  The method is deleted by the trie, so it must not be used afterward.
+ */
+
 void
 endpoint::del_method (method * m)
 {
-    lo_server_del_method(server(), m->path(), m->typespec());
-    delete m;
-    m_methods.remove(m);
-}
+    if (not_nullptr(m))
+    {
+        lo_server_del_method(server(), OPTR(m->path()), OPTR(m->typespec()));
+        (void) m_methods.remove(m);
+    }
+}
 
 #endif
 
@@ -1274,14 +1669,25 @@ void
 endpoint::del_signal (signal * o)
 {
     lo_server_del_method(server(), OPTR(o->path()), NULL);
+    unshare_signal(o->path(), true);            /* the signal is going away */
     for (const auto & mp : m_peers)
         send(mp->p_addr, tag_message(tag::sigremoved), OPTR(o->path()));
 
     /*
      * FIXME: clear loopback connections first!
+     *
+     * The index is changed under the held-value lock, so that flush_held()
+     * cannot find the gate of a signal being deleted.
      */
 
-    m_signals.remove(o);
+    {
+        std::lock_guard<std::mutex> lock(m_held_mutex);
+        unindex_signal_path(o);
+    }
+    m_signals.erase
+    (
+        std::remove(m_signals.begin(), m_signals.end(), o), m_signals.end()
+    );
 }
 
 /**
@@ -1296,46 +1702,456 @@ endpoint::learn (const std::string & path)
 }
 
 /**
- *  if there's a translation with a destination of 'path', then send feedback
- *  for it to all peers.
+ *  Tells each shard about a new (or renamed) signal, so that it handles
+ *  the signal's messages itself.
+ */
+
+void
+endpoint::share_signal (signal * s)
+{
+    for (auto & sp : m_shards)
+    {
+        shard * shp = sp.get();
+        shp->post([shp, s] () { shp->add_signal(s); });
+    }
+}
+
+/**
+ *  Tells each shard to forget a signal path.
+ *
+ * \param wait
+ *      If true, this function returns only when every shard has dropped
+ *      the path, which must be done before the signal is deleted.
+ */
+
+void
+endpoint::unshare_signal (const std::string & path, bool wait)
+{
+    for (auto & sp : m_shards)
+    {
+        shard * shp = sp.get();
+        mailbox::command c = [shp, path] () { shp->del_signal(path); };
+        if (wait)
+            shp->call(c);
+        else
+            shp->post(c);
+    }
+}
+
+/**
+ *  Dispatches a message that a shard received and handed over, with its
+ *  sender's URL, as if it had arrived at the endpoint socket. The handlers
+ *  get the sender through message_source().
+ */
+
+void
+endpoint::dispatch_handed_over
+(
+    const std::string & bytes,
+    const std::string & url
+)
+{
+    lo_address source = url.empty() ?
+        nullptr : lo_address_new_from_url(url.c_str()) ;
+
+    std::vector<char> data(bytes.begin(), bytes.end());
+    metrics::scope bind(&stats());
+    message_source_override(source);
+    (void) lo_server_dispatch_data(server(), data.data(), data.size());
+    message_source_override(nullptr);
+    if (not_nullptr(source))
+        lo_address_free(source);
+}
+
+/**
+ *  If there are translations with a destination of 'path', then send
+ *  feedback for them to all peers. The reverse index yields the source
+ *  paths directly. If the signal at 'path' has a deadband or rate limit,
+ *  the feedback of each translation follows it too.
  */
 
 void
 endpoint::send_feedback (const std::string & path, float v)
 {
-    for (auto & t : m_translations)
+    const parameter_limits * pl = nullptr;
+    auto s = m_signal_paths.find(path);
+    if (s != m_signal_paths.end())
+    {
+        const parameter_limits & limits = s->second->get_parameter_limits();
+        if (has_output_policy(limits))
+            pl = &limits;
+    }
+
+    auto range = m_translation_sources.equal_range(path);
+    for (auto it = range.first; it != range.second; ++it)
     {
-        if (t.second.m_path == path)                        /* found it */
+        translation_map::iterator t = m_translations.find(it->second);
+        if (t == m_translations.end())
+            continue;
+
+        translation_destination & td = t->second;
+        if (! td.m_suppress_feedback && td.m_current_value != v)
         {
-            if
-            (
-                ! t.second.m_suppress_feedback &&
-                t.second.m_current_value != v
-            )
-            {
-                const std::string & spath = t.first;
-                for (const auto & mp : m_peers)
-                    send(mp->p_addr, OPTR(spath), v);
+            if (not_nullptr(pl))
+                send_gated(t->first, v, td.m_output_gate, *pl, true);
+            else
+                send_value(t->first, v);
 
-                t.second.m_current_value = v;
-            }
-            t.second.m_suppress_feedback = false;
+            td.m_current_value = v;
+        }
+        td.m_suppress_feedback = false;
+    }
+}
+
+/**
+ *  Sends a float value on a path to all peers, or queues it if batching
+ *  is on.
+ */
+
+void
+endpoint::send_value (const std::string & path, float v)
+{
+    if (m_batching)
+    {
+        queue_value(path, v);
+    }
+    else
+        (void) send_to_all(m_peer_destinations, path, v);
+}
 
-            /* break; ??? */
+/**
+ *  Sends a value subject to the deadband and rate limit of the given
+ *  limits. A value that comes too soon is held in the gate, and the path
+ *  is noted so that flush_held() sends the latest value when the rate
+ *  allows. The send is done under the lock, so that a held value cannot
+ *  overtake a newer one.
+ *
+ * \param feedback
+ *      True if the path is the source path of a translation, false if it
+ *      is the path of a signal. This tells flush_held() where the gate is.
+ */
+
+void
+endpoint::send_gated
+(
+    const std::string & path, float v,
+    output_gate & gate, const parameter_limits & pl,
+    bool feedback
+)
+{
+    auto now = std::chrono::steady_clock::now();
+    bool newhold = false;
+    {
+        std::lock_guard<std::mutex> lock(m_held_mutex);
+        bool washolding = gate.holding();
+        output_gate::verdict vd = gate.offer(pl, v, now);
+        if (vd == output_gate::verdict::send)
+        {
+            gate.sent(v, now);
+            send_value(path, v);
+        }
+        else if (vd == output_gate::verdict::hold && ! washolding)
+        {
+            m_held_outputs.push_back({ path, feedback, gate.due(pl) });
+            newhold = true;
         }
     }
+    if (newhold)
+        wakeup();                       /* run() must see the new deadline  */
+}
+
+/**
+ *  Forgets the state of a gate, such as a held value, when its signal is
+ *  renamed or its limits change.
+ */
+
+void
+endpoint::reset_gate (output_gate & gate)
+{
+    std::lock_guard<std::mutex> lock(m_held_mutex);
+    gate.reset();
+}
+
+/**
+ *  Finds the gate of a held value. Called with m_held_mutex locked.
+ *
+ * \return
+ *      Returns null if the signal or translation no longer exists.
+ */
+
+output_gate *
+endpoint::find_gate (const std::string & path, bool feedback)
+{
+    if (feedback)
+    {
+        auto t = m_translations.find(path);
+        return t != m_translations.end() ? &t->second.m_output_gate : nullptr ;
+    }
+
+    auto s = m_signal_paths.find(path);
+    return s != m_signal_paths.end() ? &s->second->m_output_gate : nullptr ;
+}
+
+/**
+ *  Sends the held values whose time has come: the trailing edge of the
+ *  rate limits. A held value that was replaced by a sent one, or whose
+ *  signal is gone, is just forgotten.
+ *
+ * \return
+ *      Returns the number of values sent.
+ */
+
+int
+endpoint::flush_held ()
+{
+    int result = 0;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_held_mutex);
+    auto it = m_held_outputs.begin();
+    while (it != m_held_outputs.end())
+    {
+        if (it->ho_due > now)
+        {
+            ++it;
+            continue;
+        }
+
+        output_gate * gate = find_gate(it->ho_path, it->ho_feedback);
+        if (not_nullptr(gate) && gate->holding())
+        {
+            float v = gate->held_value();
+            gate->sent(v, now);
+            send_value(it->ho_path, v);
+            ++result;
+        }
+        it = m_held_outputs.erase(it);
+    }
+    return result;
+}
+
+/**
+ *  Queues a value for the next flush(). If the path is already queued, only
+ *  its value is updated, so a burst of changes to one path goes out once.
+ */
+
+void
+endpoint::queue_value (const std::string & path, float v)
+{
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    auto it = m_pending_paths.find(path);
+    if (it != m_pending_paths.end())
+    {
+        m_pending_values[it->second].second = v;
+    }
+    else
+    {
+        m_pending_paths.emplace(path, m_pending_values.size());
+        m_pending_values.emplace_back(path, v);
+        stats().queue_depth(metric_queue::values, m_pending_values.size());
+    }
+}
+
+/**
+ *  Turns batching on or off. Turning it off flushes any queued values.
+ *
+ * \param flag
+ *      If true, output values are queued until flush() is called.
+ *
+ * \param flushms
+ *      If greater than 0, run() and wait() call flush() once this many
+ *      milliseconds have passed since the last flush. If 0 (the default),
+ *      the caller must call flush(), for example once per processing tick.
+ */
+
+void
+endpoint::batching (bool flag, int flushms)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        m_last_flush = std::chrono::steady_clock::now();
+    }
+    m_flush_interval_ms = flushms > 0 ? flushms : 0 ;
+    if (flag)
+    {
+        m_batching = true;
+    }
+    else if (m_batching)
+    {
+        m_batching = false;
+        (void) flush();
+    }
+    wakeup();                           /* run() must see the new deadline  */
+}
+
+/**
+ *  Sends the queued values to every peer, as bundles of float messages.
+ *  A bundle is sent early if it reaches s_max_bundle_size bytes, to stay
+ *  well under the UDP datagram limit.
+ *
+ * \return
+ *      Returns the number of bundles sent.
+ */
+
+int
+endpoint::flush () const
+{
+    static const std::size_t s_max_bundle_size = 8192;
+    pending_list values;
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        values.swap(m_pending_values);
+        m_pending_paths.clear();
+        m_last_flush = std::chrono::steady_clock::now();
+    }
+
+    int result = 0;
+    if (values.empty() || m_peer_destinations.empty())
+        return result;
+
+    /*
+     * The bundles are built once, then sent to each peer.
+     */
+
+    std::vector<lo_bundle> bundles;
+    lo_bundle b = nullptr;
+    for (const auto & pv : values)
+    {
+        if (is_nullptr(b))
+            b = lo_bundle_new(LO_TT_IMMEDIATE_2);
+
+        lo_message m = lo_message_new();
+        lo_message_add_float(m, pv.second);
+        lo_bundle_add_message(b, OPTR(pv.first), m);
+        if (lo_bundle_length(b) >= s_max_bundle_size)
+        {
+            bundles.push_back(b);
+            b = nullptr;
+        }
+    }
+    if (not_nullptr(b))
+        bundles.push_back(b);
+
+    /*
+     * Each bundle is serialized once, into a per-thread buffer, and the
+     * bytes are sent to every peer. A peer that cannot take raw bytes
+     * (e.g. over TCP) gets the bundle through liblo.
+     */
+
+    static thread_local std::vector<char> s_buffer;
+    endpoint * self = const_cast<endpoint *>(this);     /* for send_raw()   */
+    for (auto bp : bundles)
+    {
+        std::size_t size = lo_bundle_length(bp);
+        if (size > s_buffer.size())
+            s_buffer.resize(size);
+
+        bool serialized = size > 0 && not_nullptr
+        (
+            lo_bundle_serialise(bp, s_buffer.data(), &size)
+        );
+        for (auto addr : m_peer_destinations)
+        {
+            int rc = serialized ?
+                self->send_raw(addr, s_buffer.data(), size) : (-1) ;
+
+            if (rc < 0)
+                rc = lo_send_bundle_from(addr, server(), bp);
+
+            if (rc >= 0)
+                ++result;
+        }
+        lo_bundle_free_recursive(bp);
+    }
+
+    return result;
+}
+
+/**
+ *  Sends the held values that are due (see flush_held()), then calls
+ *  flush() if batching with a flush interval, and the interval has passed.
+ *  They are in that order so that the held values go out with the batch.
+ *
+ *  This function is const, as it is called by run() and wait(), but the
+ *  held values are sent through the non-const send_value().
+ */
+
+void
+endpoint::flush_if_due () const
+{
+    (void) const_cast<endpoint *>(this)->flush_held();
+    int interval = m_flush_interval_ms;
+    if (m_batching && interval > 0)
+    {
+        std::chrono::steady_clock::time_point last;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            last = m_last_flush;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - last;
+        if (elapsed >= std::chrono::milliseconds(interval))
+            (void) flush();
+    }
+}
+
+/**
+ *  Provides the timeout to use when waiting for messages, shortened so that
+ *  a flush, or a held value (see flush_held()), that is due is not held up
+ *  by a quiet OSC port. Applications that run their own event loop use
+ *  this as their poll timeout.
+ *
+ * \param timeout
+ *      The longest wait wanted, in milliseconds. If negative (the default),
+ *      the wait is not limited.
+ *
+ * \return
+ *      Returns the timeout, or the milliseconds until the next flush or
+ *      held value, if less. If negative, there is no deadline.
+ */
+
+int
+endpoint::next_timeout (int timeout) const
+{
+    auto now = std::chrono::steady_clock::now();
+    auto shorten = [&timeout, now] (std::chrono::steady_clock::time_point due)
+    {
+        int remaining = 0;
+        if (due > now)
+        {
+            remaining = int
+            (
+                std::chrono::ceil<std::chrono::milliseconds>(due - now).count()
+            );
+        }
+        if (timeout < 0 || remaining < timeout)
+            timeout = remaining;
+    };
+    int interval = m_flush_interval_ms;
+    if (m_batching && interval > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        shorten(m_last_flush + std::chrono::milliseconds(interval));
+    }
+
+    std::lock_guard<std::mutex> lock(m_held_mutex);
+    for (const auto & ho : m_held_outputs)
+        shorten(ho.ho_due);
+
+    return timeout;
 }
 
 peer *
 endpoint::add_peer (const std::string & name, const std::string & url)
 {
-    peer * p = new (std::nothrow) peer;
+    peer * p = m_peer_pool.create();
     if (not_nullptr(p))
     {
         util::info_printf("Adding peer %s@%s...", V(name), V(url));
         p->p_name = name;
         p->p_addr = lo_address_new_from_url(CSTR(url));
         m_peers.push_back(p);
+        (void) m_peer_names.emplace(name, p);
+        index_peer_address(p);
+        refresh_peer_destinations();
     }
     else
         util::error_printf("Could not add peer %s@%s...", V(name), V(url));
@@ -1379,10 +2195,18 @@ endpoint::osc_thread ()
     run();
 }
 
+/**
+ *  Starts the OSC thread, which runs run().
+ *
+ * \param attr
+ *      The scheduling, CPU affinity, and stack settings for the thread.
+ *      The default leaves them to the system.
+ */
+
 void
-endpoint::start ()
+endpoint::start (const thread_attributes & attr)
 {
-    if (! m_thread.clone(&endpoint::osc_thread, this))
+    if (! m_thread.clone(&endpoint::osc_thread, this, attr))
         util::error_message("Could not create OSC thread");
 
     /*
@@ -1390,9 +2214,102 @@ endpoint::start ()
      */
 }
 
+/**
+ *  Starts the OSC thread plus extra receive threads (shards), each with its
+ *  own socket on the endpoint's UDP port, using SO_REUSEPORT. The kernel
+ *  sends all of the datagrams of a given peer to the same socket. See the
+ *  shard module for what a shard handles itself.
+ *
+ *  Call this after the signals have been added (they can also be added
+ *  later) and instead of start(). The application's methods need not run
+ *  in the shards; they are still called in the OSC thread.
+ *
+ * \param receivers
+ *      The number of receive threads in all, including the OSC thread.
+ *
+ * \param attr
+ *      The scheduling, affinity, and stack settings for all of the threads.
+ *
+ * \return
+ *      Returns true if the shards started. Otherwise (e.g. for a TCP
+ *      endpoint, or if receivers is less than 2), only the OSC thread is
+ *      started, as by start().
+ */
+
+bool
+endpoint::start_sharded (int receivers, const thread_attributes & attr)
+{
+    bool result = false;
+#if defined PLATFORM_LINUX
+    int sfd = socket_fd();
+    bool udp = not_nullptr(server()) &&
+        lo_server_get_protocol(server()) == LO_UDP;
+
+    if (receivers > 1 && m_shards.empty() && sfd >= 0 && udp)
+    {
+        struct sockaddr_storage ss;
+        struct sockaddr * sa = reinterpret_cast<struct sockaddr *>(&ss);
+        socklen_t length = sizeof ss;
+        int on = 1;
+        result =
+            ::getsockname(sfd, sa, &length) == 0 &&
+            ::setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) == 0;
+
+        for (int i = 1; result && i < receivers; ++i)
+        {
+            std::unique_ptr<shard> sp(new (std::nothrow) shard(this, i));
+            result = sp && sp->open(sa, length);
+            if (result)
+            {
+                for (auto s : m_signals)
+                    sp->add_signal(s);              /* not running yet      */
+
+                m_shards.push_back(std::move(sp));
+            }
+        }
+        if (result)
+        {
+            for (auto & sp : m_shards)
+            {
+                if (! sp->start(attr))
+                    result = false;
+            }
+        }
+        if (! result)
+        {
+            util::warn_message("OSC sharding failed, using one thread");
+            stop_shards();
+            on = 0;
+            (void) ::setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on);
+        }
+    }
+#else
+    (void) receivers;
+#endif
+    start(attr);
+    return result;
+}
+
+/**
+ *  Stops and deletes the shards. Messages they handed over, but not yet
+ *  dispatched, are still in the mailbox, and are run by the next
+ *  dispatch.
+ */
+
+void
+endpoint::stop_shards ()
+{
+    for (auto & sp : m_shards)
+        sp->stop();
+
+    m_shards.clear();
+}
+
 void
 endpoint::stop ()
 {
+    stop_shards();
+    wakeup();
     m_thread.join();                    /* lo_server_thread_stop(m_st);     */
 }
 
@@ -1421,48 +2338,192 @@ endpoint::check () const
  *      lo_server_recv_noblock(lo_server, timeout) receives a message,
  *      dispatches it to a matching method, if found,
  *      and returns the number of bytes in the message.
+ *
+ *  The dispatching is limited by the receive_budget(), if set, so that a
+ *  flood of signal traffic cannot starve the caller. See receive_pending()
+ *  and budget_exhausted().
  */
 
 void
 endpoint::wait (int timeout) const
 {
-    const int s_recv_timeout = 0;           /* return immediately           */
+    timeout = next_timeout(timeout);
+    (void) m_mailbox.drain();
     if (not_nullptr(server()) && lo_server_wait(server(), timeout))
     {
-        for (;;)
-        {
-            int count = lo_server_recv_noblock(server(), s_recv_timeout);
-            if (count == 0)
-                break;
-
-            if (! active())
-                break;
+        int count = receive_ready(server(), 0, true);
+        (void) count;
 
 #if defined PLATFORM_DEBUG
-            util::info_printf("Recv'd %d bytes", count);
+        util::info_printf("Recv'd %d messages", count);
 #endif
-        }
     }
+    flush_if_due();
 }
 
 /**
- *  Process events forever. Does lo_server_recv() block?
+ *  Receives and dispatches the messages waiting at the server, without
+ *  blocking, then does any flush that is due. This is the function to call
+ *  when the application's event loop finds socket_fd() readable, or when
+ *  the next_timeout() has passed.
+ *
+ * \param maxcount
+ *      The most messages to dispatch in this call, so that a flood of
+ *      messages cannot starve the rest of the application's loop. Any
+ *      remaining messages stay readable. Zero (the default) uses the
+ *      receive_budget(), if any; see lowrapper.
+ *
+ * \return
+ *      Returns the number of messages dispatched.
+ */
+
+int
+endpoint::dispatch_ready (int maxcount) const
+{
+    (void) m_mailbox.drain();
+
+    int result = receive_ready(server(), maxcount);
+    flush_if_due();
+    return result;
+}
+
+/**
+ *  Interrupts an epoll-based run(), so that it checks active() and the
+ *  flush deadline at once. Call it after active(false), or after turning on
+ *  batching from another thread. It is safe to call from any thread.
+ */
+
+void
+endpoint::wakeup () const
+{
+#if defined PLATFORM_LINUX
+    if (m_wake_fd >= 0)
+    {
+        std::uint64_t one = 1;
+        ssize_t rc = ::write(m_wake_fd, &one, sizeof one);
+        (void) rc;
+    }
+#endif
+}
+
+/**
+ *  Process events until the endpoint is no longer active. On Linux this
+ *  sleeps in epoll_wait() until a message arrives, the flush deadline
+ *  passes, or wakeup() is called. Otherwise, or if epoll cannot be used,
+ *  it falls back to polling liblo every 100 ms.
  */
 
 void
 endpoint::run () const
+{
+#if defined PLATFORM_LINUX
+    if (run_epoll())
+        return;
+#endif
+
+    run_polling();
+}
+
+/**
+ *  The original loop, which polls with a 100 ms timeout.
+ */
+
+void
+endpoint::run_polling () const
 {
     const int s_recv_timeout = 100;
+    metrics::scope bind(&stats());
     for (;;)
     {
         // lo_server_recv(server());
 
-        lo_server_recv_noblock(server(), s_recv_timeout);
+        int timeout = next_timeout(s_recv_timeout);
+        if (lo_server_recv_noblock(server(), timeout) > 0)
+            trace_finish();
+
+        (void) m_mailbox.drain();
+
+        flush_if_due();
         if (! active())
             break;
     }
 }
 
+/**
+ *  The epoll(7) loop. As with run_polling(), the first wait is limited to
+ *  100 ms, so that the loop ends soon if the endpoint is not active. After
+ *  that, it waits without a timeout, except for the flush deadline.
+ *
+ *  For TCP, the sockets of the accepted connections are inside liblo and
+ *  cannot be added to the epoll set, so a TCP server keeps a short timeout.
+ *
+ * \return
+ *      Returns false if epoll could not be set up, or failed, in which case
+ *      the caller falls back to run_polling().
+ */
+
+bool
+endpoint::run_epoll () const
+{
+#if defined PLATFORM_LINUX
+    const int s_first_timeout = 100;
+    const int s_tcp_timeout = 10;
+    int sfd = socket_fd();
+    if (sfd < 0)
+        return false;
+
+    int efd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (efd < 0)
+        return false;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = sfd;
+    bool result = ::epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &ev) == 0;
+    if (result && m_wake_fd >= 0)
+    {
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wake_fd;
+        result = ::epoll_ctl(efd, EPOLL_CTL_ADD, m_wake_fd, &ev) == 0;
+    }
+    if (result)
+    {
+        bool tcp = lo_server_get_protocol(server()) == LO_TCP;
+        int idle = tcp ? s_tcp_timeout : (-1) ;
+        int timeout = s_first_timeout;
+        for (;;)
+        {
+            struct epoll_event events[2];
+            int n = ::epoll_wait(efd, events, 2, next_timeout(timeout));
+            if (n < 0 && errno != EINTR)
+            {
+                util::error_message("epoll_wait() failed, polling instead");
+                result = false;
+                break;
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                if (events[i].data.fd == m_wake_fd)
+                {
+                    std::uint64_t count;
+                    ssize_t rc = ::read(m_wake_fd, &count, sizeof count);
+                    (void) rc;
+                }
+            }
+            (void) dispatch_ready();
+            if (! active())
+                break;
+
+            timeout = idle;
+        }
+    }
+    (void) ::close(efd);
+    return result;
+#else
+    return false;
+#endif
+}
+
 }           // namespace osc
 
 /*
@@ -27,7 +27,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-26
- * \updates       2025-04-23
+ * \updates       2026-10-15
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -35,10 +35,20 @@
  *  endpoint class.
  */
 
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <cstddef>                      /* offsetof()                       */
+#include <cstdlib>                      /* std::getenv()                    */
+#include <cstring>                      /* std::strcmp()                    */
+#include <netdb.h>                      /* getaddrinfo(3), freeaddrinfo(3)  */
+#include <netinet/in.h>                 /* sockaddr_in, sockaddr_in6        */
+#include <sys/socket.h>                 /* sendto(2), getsockname(2)        */
+#include <sys/un.h>                     /* sockaddr_un for AF_UNIX          */
 #include <unistd.h>                     /* getpid()                         */
+#include <unordered_map>                /* std::unordered_map               */
 
 #include "nsm/nsmcodes.hpp"             /* nsm::error & nsm::command enums  */
 #include "osc/lowrapper.hpp"            /* osc::lowwrapper base class       */
+#include "osc/trace.hpp"                /* osc::trace_record(), etc.        */
 #include "util/msgfunctions.hpp"        /* util::info_message(), _print()   */
 #include "util/strfunctions.hpp"        /* util::strncompare(), CSTR(), ... */
 
@@ -75,6 +85,114 @@ lowrapper_const_cast (void * p)
     return static_cast<lowrapper *>(p);
 }
 
+/**
+ *  Returned by lowrapper::send_built() when it cannot send the message,
+ *  so that the caller falls back to liblo. Distinct from liblo's -1.
+ */
+
+const int c_not_sent = (-2);
+
+/**
+ *  A destination address resolved for sendto(2).
+ */
+
+struct resolved_address
+{
+    sockaddr_storage ra_addr;
+    socklen_t ra_length;
+};
+
+/**
+ *  Looks up (and caches) the socket address for the destination, in the
+ *  address family of the socket, or builds the sockaddr_un of a
+ *  Unix-domain destination. The cache is per thread, so no locking is
+ *  needed. It is keyed by the socket, protocol, host, and port, not by the
+ *  lo_address pointer, so that the short-lived message-source addresses
+ *  of replies also hit it. It is cleared if it grows large. A numeric host
+ *  is converted without a name-service query, so that a miss does not
+ *  block the send.
+ */
+
+const resolved_address *
+resolve_address (lo_address to, int fd)
+{
+    using address_cache = std::unordered_map<std::string, resolved_address>;
+    static thread_local address_cache s_cache;
+    static thread_local std::string s_key;
+    const char * host = lo_address_get_hostname(to);
+    const char * port = lo_address_get_port(to);
+    if (is_nullptr_2(host, port))
+        return nullptr;
+
+    int protocol = lo_address_get_protocol(to);
+    s_key.clear();                      /* keeps the capacity       */
+    s_key += std::to_string(fd);
+    s_key += '\0';
+    s_key += char('0' + protocol);
+    s_key += host;
+    s_key += '\0';
+    s_key += port;
+
+    auto it = s_cache.find(s_key);
+    if (it != s_cache.end())
+        return &it->second;
+
+    if (protocol == LO_UNIX)
+    {
+        /*
+         * The "port" of a Unix-domain address is the socket path.
+         */
+
+        sockaddr_un sa;
+        std::size_t len = std::strlen(port);
+        if (len == 0 || len >= sizeof sa.sun_path)
+            return nullptr;
+
+        if (s_cache.size() >= 256)
+            s_cache.clear();
+
+        std::memset(&sa, 0, sizeof sa);
+        sa.sun_family = AF_UNIX;
+        std::memcpy(sa.sun_path, port, len);
+
+        resolved_address & ra = s_cache[s_key];
+        std::memcpy(&ra.ra_addr, &sa, sizeof sa);
+        ra.ra_length = socklen_t(offsetof(sockaddr_un, sun_path) + len + 1);
+        return &ra;
+    }
+
+    sockaddr_storage local;
+    socklen_t locallen = sizeof local;
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&local), &locallen) != 0)
+        return nullptr;
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_family = local.ss_family;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (local.ss_family == AF_INET6)
+        hints.ai_flags = AI_V4MAPPED;
+
+    addrinfo * ai = nullptr;
+    int basicflags = hints.ai_flags;
+    hints.ai_flags = basicflags | AI_NUMERICHOST | AI_NUMERICSERV;
+    if (getaddrinfo(host, port, &hints, &ai) != 0 || is_nullptr(ai))
+    {
+        ai = nullptr;
+        hints.ai_flags = basicflags;
+        if (getaddrinfo(host, port, &hints, &ai) != 0 || is_nullptr(ai))
+            return nullptr;
+    }
+    if (s_cache.size() >= 256)
+        s_cache.clear();
+
+    resolved_address & ra = s_cache[s_key];
+    std::memcpy(&ra.ra_addr, ai->ai_addr, ai->ai_addrlen);
+    ra.ra_length = socklen_t(ai->ai_addrlen);
+    freeaddrinfo(ai);
+    return &ra;
+}
+
 }           // namespace anonymous
 
 /*
@@ -85,7 +203,12 @@ lowrapper::lowrapper () :
     m_server        (),             /* accessor: server()               */
     m_address       (),             /* accessor: address()              */
     m_port_name     (),
-    m_active        (false)
+    m_active        (false),
+    m_budget_messages   (0),
+    m_budget_us         (0),
+    m_budget_exhausted  (0),
+    m_receive_pending   (false),
+    m_metrics           ()
 {
     /*
      * util::debug_printf("lowrapper @ %p", this);
@@ -121,6 +244,8 @@ lowrapper::url () const
     {
         result = std::string(u);
         free(u);
+        if (url_protocol(result) == LO_UNIX)
+            result = unix_url(unix_socket_path(result));    /* canonical    */
     }
     return result;
 }
@@ -161,8 +286,11 @@ lowrapper::url () const
  *      lo_server_new_with_proto() states that If using UDP, then NULL
  *      may be passed to find an unused port. Otherwise a decimal port
  *      number or service name or may be passed. If using UNIX domain
- *      sockets then a socket path should be passed here. An example
- *      is "osc.udp://mlsleno:11086/". The default value is "".
+ *      sockets then a socket path should be passed here. The port name
+ *      can also be a full URL, such as "osc.udp://mlsleno:11086/" or
+ *      "osc.unix:///run/user/1000/nsm66.osc"; then its protocol replaces
+ *      proto, and its port (or socket path) is used. The default value
+ *      is "".
  *
  * \param usethis
  *      If true, the "this" pointer of this object is used in adding
@@ -180,7 +308,16 @@ lowrapper::init
     bool usethis
 )
 {
-    const char * portptr = CPTR(portname);              /* null or c_str()  */
+    std::string port { portname };
+    if (is_osc_url(portname))                           /* a full URL       */
+    {
+        proto = url_protocol(portname);
+        port = extract_port_number(portname);
+    }
+    if (proto == LO_UNIX && port.empty())
+        port = make_unix_socket_path();
+
+    const char * portptr = CPTR(port);                  /* null or c_str()  */
     util::info_message("Creating OSC server", portname);
     m_server = lo_server_new_with_proto                 /* server()         */
     (
@@ -188,12 +325,14 @@ lowrapper::init
     );
     if (not_nullptr(server()))
     {
-        char * u = lo_server_get_url(server());         /* compare to url() */
-        if (not_nullptr(u))
+        if (proto == LO_TCP)
+            (void) lo_server_max_msg_size(server(), c_tcp_max_msg_size);
+
+        std::string u = url();
+        if (! u.empty())
         {
-            util::status_message("OSC URL", std::string(u));
-            address(lo_address_new_from_url(u));
-            free(u);
+            util::status_message("OSC URL", u);
+            address(lo_address_new_from_url(u.c_str()));
         }
         if (not_nullptr(address()))
         {
@@ -291,6 +430,499 @@ lowrapper::add_methods (void * userdata)
  *  to verify that the lo_address is not null.
  */
 
+/**
+ *  Provides the file descriptor of the server's socket, so that the
+ *  application can add it to its own poll(2) or epoll(7) set, and call
+ *  endpoint::dispatch_ready() when it is readable.
+ *
+ *  For a TCP server, this is the listening socket; the sockets of the
+ *  accepted connections are held inside liblo. See endpoint::run().
+ *
+ * \return
+ *      Returns the descriptor, or -1 if there is no server.
+ */
+
+int
+lowrapper::socket_fd () const
+{
+    return not_nullptr(server()) ? lo_server_get_socket_fd(server()) : (-1) ;
+}
+
+/**
+ *  Sets the receive budget used by endpoint::wait(), dispatch_ready(), and
+ *  nsmbase::msg_check().
+ *
+ * \param maxmessages
+ *      The most messages to dispatch per call. Zero or less means no limit.
+ *
+ * \param maxus
+ *      The most microseconds to spend dispatching per call. It is checked
+ *      after each message, so one slow handler can exceed it. Zero or less
+ *      means no limit.
+ */
+
+void
+lowrapper::receive_budget (int maxmessages, int maxus)
+{
+    m_budget_messages = maxmessages > 0 ? maxmessages : 0 ;
+    m_budget_us = maxus > 0 ? maxus : 0 ;
+}
+
+/**
+ *  Receives and dispatches the messages waiting at a server, without
+ *  blocking, until none are left or the receive budget runs out. Then it
+ *  updates receive_pending() and, if the budget ran out while messages
+ *  were still waiting, budget_exhausted(). The messages are counted in
+ *  stats(), along with the time taken to handle each one.
+ *
+ * \param srv
+ *      The server to read. The nsmbase class uses its own server, and so
+ *      this is a parameter.
+ *
+ * \param maxcount
+ *      If greater than zero, overrides the message part of the budget.
+ *
+ * \param stopifinactive
+ *      If true, stop early if a handler made us inactive.
+ *
+ * \return
+ *      Returns the number of messages dispatched.
+ */
+
+int
+lowrapper::receive_ready
+(
+    lo_server srv, int maxcount, bool stopifinactive
+) const
+{
+    const int s_recv_timeout = 0;           /* return immediately           */
+    using clock = std::chrono::steady_clock;
+    int result = 0;
+    bool limited = false;
+    if (is_nullptr(srv))
+        return result;
+
+    if (maxcount <= 0)
+        maxcount = m_budget_messages;
+
+    clock::time_point deadline;
+    if (m_budget_us > 0)
+        deadline = clock::now() + std::chrono::microseconds(m_budget_us);
+
+    metrics::scope bind(&m_metrics);        /* for osc_msg_summary()        */
+    for (;;)
+    {
+        if (maxcount > 0 && result >= maxcount)
+        {
+            limited = true;
+            break;
+        }
+        clock::time_point start = clock::now();
+        int count = lo_server_recv_noblock(srv, s_recv_timeout);
+        if (count <= 0)
+            break;
+
+        trace_finish();                     /* handler times for the trace  */
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>
+        (
+            clock::now() - start
+        );
+        m_metrics.handler_time(std::uint64_t(us.count()));
+        ++result;
+        if (stopifinactive && ! active())
+            break;
+
+        if (m_budget_us > 0 && clock::now() >= deadline)
+        {
+            limited = true;
+            break;
+        }
+    }
+
+    bool pending = limited && lo_server_wait(srv, 0) != 0;
+    m_receive_pending = pending;
+    if (pending)
+        ++m_budget_exhausted;
+
+    return result;
+}
+
+/**
+ *  The message builder for the calling thread. Each thread (e.g. the OSC
+ *  thread and the application thread) gets its own, so there is no
+ *  locking, and the buffer is reused by every send from that thread.
+ */
+
+msgbuilder &
+lowrapper::thread_builder ()
+{
+    static thread_local msgbuilder s_builder;
+    return s_builder;
+}
+
+/**
+ *  Sends a message built by msgbuilder with one sendto(2) on the server's
+ *  socket, so that the source address is our server, as with
+ *  lo_send_from(). Only datagrams (UDP and Unix-domain) are supported
+ *  here.
+ *
+ * \return
+ *      Returns the number of bytes sent, or c_not_sent (-2) if the message
+ *      could not be sent this way.  In that case the caller should try
+ *      liblo, which also reports any real error.
+ */
+
+int
+lowrapper::send_built (lo_address to, const msgbuilder & mb)
+{
+    if (! mb.complete())
+        return c_not_sent;
+
+    return send_raw(to, mb.data(), mb.size(), mb.message_tag());
+}
+
+/**
+ *  Sends bytes already in OSC wire format with one sendto(2) on the
+ *  server's socket. This is the tail end of send_built(), also used to
+ *  send one serialization to many destinations.
+ *
+ * \param t
+ *      The tag of the message, if the caller knows it, for the metrics.
+ *      Otherwise it is looked up from the path at the start of the data.
+ *
+ * \return
+ *      Returns the number of bytes sent, or c_not_sent (-2).
+ */
+
+int
+lowrapper::send_raw
+(
+    lo_address to, const char * data, std::size_t size, tag t
+)
+{
+    if (is_nullptr_2(to, server()) || is_nullptr(data) || size == 0)
+        return c_not_sent;
+
+    int proto = lo_server_get_protocol(server());
+    if (proto != LO_UDP && proto != LO_UNIX)
+        return c_not_sent;
+
+    if (lo_address_get_protocol(to) != proto)
+        return c_not_sent;
+
+    int fd = lo_server_get_socket_fd(server());
+    if (fd < 0)
+        return c_not_sent;
+
+    const resolved_address * ra = resolve_address(to, fd);
+    if (is_nullptr(ra))
+        return c_not_sent;
+
+    ssize_t rc = ::sendto
+    (
+        fd, data, size, 0,
+        reinterpret_cast<const sockaddr *>(&ra->ra_addr), ra->ra_length
+    );
+    if (rc < 0)
+        return c_not_sent;
+
+    trace_record(trace_dir::out, data, nullptr, to, std::uint32_t(rc));
+    if (t != tag::illegal)
+        m_metrics.sent(t, std::uint64_t(rc));
+    else
+        m_metrics.sent(data, std::uint64_t(rc)); /* data starts with path   */
+    return int(rc);
+}
+
+/**
+ *  Sends one message to a number of destinations, serializing it only
+ *  once. The serialized bytes are kept in a per-thread buffer that only
+ *  grows. Destinations that cannot take the raw bytes (e.g. TCP) get the
+ *  message through liblo, as send() does.
+ *
+ * \param dests
+ *      The destination addresses. Null entries are skipped.
+ *
+ * \param path
+ *      The OSC path of the message.
+ *
+ * \param msg
+ *      The message to relay. It is not modified.
+ *
+ * \return
+ *      Returns the number of destinations to which the message was sent.
+ */
+
+int
+lowrapper::send_to_all
+(
+    const std::vector<lo_address> & dests,
+    const std::string & path, lo_message msg
+)
+{
+    static thread_local std::vector<char> s_buffer;
+    int result = 0;
+    if (dests.empty() || is_nullptr(msg))
+        return result;
+
+    std::size_t size = lo_message_length(msg, OPTR(path));
+    if (size > s_buffer.size())
+        s_buffer.resize(size);
+
+    bool serialized = size > 0 && not_nullptr
+    (
+        lo_message_serialise(msg, OPTR(path), s_buffer.data(), &size)
+    );
+    for (auto a : dests)
+    {
+        if (is_nullptr(a))
+            continue;
+
+        int rc = serialized ? send_raw(a, s_buffer.data(), size) : c_not_sent ;
+        if (rc == c_not_sent)
+        {
+            rc = lo_send_message_from(a, server(), OPTR(path), msg);
+            if (rc >= 0)
+            {
+                trace_record
+                (
+                    trace_dir::out, OPTR(path), nullptr, a, std::uint32_t(rc)
+                );
+                m_metrics.sent(OPTR(path), std::uint64_t(rc));
+            }
+            else
+                m_metrics.send_failed();
+        }
+
+        if (rc >= 0)
+            ++result;
+    }
+    return result;
+}
+
+/**
+ *  Sends one float value to a number of destinations, building the
+ *  message only once.
+ *
+ * \return
+ *      Returns the number of destinations to which the value was sent.
+ */
+
+int
+lowrapper::send_to_all
+(
+    const std::vector<lo_address> & dests,
+    const std::string & path, float v
+)
+{
+    int result = 0;
+    if (dests.empty())
+        return result;
+
+    msgbuilder & mb = thread_builder();
+    bool built = mb.start(OPTR(path), "f") && mb.add_float(v);
+    for (auto a : dests)
+    {
+        if (is_nullptr(a))
+            continue;
+
+        int rc = built ? send_built(a, mb) : c_not_sent ;
+        if (rc == c_not_sent)
+        {
+            rc = lo_send_from
+            (
+                a, server(), LO_TT_IMMEDIATE_2, OPTR(path), "f", v
+            );
+            if (rc >= 0)
+            {
+                trace_record
+                (
+                    trace_dir::out, OPTR(path), "f", a, std::uint32_t(rc)
+                );
+                m_metrics.sent(OPTR(path), std::uint64_t(rc));
+            }
+            else
+                m_metrics.send_failed();
+        }
+        if (rc >= 0)
+            ++result;
+    }
+    return result;
+}
+
+/**
+ *  Sends a list of strings in as few messages as fit the transport, rather
+ *  than one message per item. Each message has the types "ii" followed by
+ *  one 's' per item: the batch index, 1 if it is the last batch (else 0),
+ *  then the items. An empty list is sent as one empty, last batch, so the
+ *  receiver always learns that the list is complete.
+ *
+ * \param to
+ *      The destination.
+ *
+ * \param path
+ *      The OSC path, such as "/nsm66/reply/list" (osc::tag::replylist).
+ *
+ * \param items
+ *      The strings to send, e.g. session names.
+ *
+ * \param maxbytes
+ *      The largest message to make. If 0, c_stream_batch_bytes is used
+ *      over TCP and c_datagram_batch_bytes otherwise. An item too long for
+ *      a batch gets a batch of its own.
+ *
+ * \return
+ *      Returns the number of messages sent, or -1 if a send failed.
+ */
+
+int
+lowrapper::send_batched
+(
+    lo_address to, const std::string & path,
+    const lib66::tokenization & items,
+    std::size_t maxbytes
+)
+{
+    if (is_nullptr(to) || path.empty())
+        return (-1);
+
+    if (maxbytes == 0)
+    {
+        maxbytes = lo_address_get_protocol(to) == LO_TCP ?
+            c_stream_batch_bytes : c_datagram_batch_bytes ;
+    }
+
+    std::size_t next = 0;
+    int index = 0;
+    int result = 0;
+    do
+    {
+        std::size_t first = next;
+        next = batch_end(items, first, path.length(), maxbytes);
+
+        lo_message m = lo_message_new();
+        if (is_nullptr(m))
+            return (-1);
+
+        bool last = next >= items.size();
+        lo_message_add_int32(m, index++);
+        lo_message_add_int32(m, last ? 1 : 0);
+        for (std::size_t i = first; i < next; ++i)
+            lo_message_add_string(m, items[i].c_str());
+
+        int rc = lo_send_message_from(to, server(), path.c_str(), m);
+        lo_message_free(m);
+        if (rc < 0)
+        {
+            m_metrics.send_failed();
+            return (-1);
+        }
+        trace_record
+        (
+            trace_dir::out, path.c_str(), nullptr, to, std::uint32_t(rc)
+        );
+        m_metrics.sent(path.c_str(), std::uint64_t(rc));
+        ++result;
+    } while (next < items.size());
+
+    return result;
+}
+
+/**
+ *  Sends a message whose arguments are all strings, up to three of them.
+ *  This covers most of the NSM messages (see nsmbase::send_from()).
+ *
+ * \param types
+ *      The type-tag string: "", "s", "ss", or "sss". The number of 's'
+ *      characters tells how many of the values are sent.
+ *
+ * \return
+ *      Returns the number of bytes sent, or -1 on an error, as with
+ *      lo_send_from().
+ */
+
+int
+lowrapper::send_strings
+(
+    lo_address to, const std::string & path, const std::string & types,
+    const std::string & v1,
+    const std::string & v2,
+    const std::string & v3
+)
+{
+    std::size_t count = types.size();
+    if (count > 3 || types.find_first_not_of('s') != std::string::npos)
+    {
+        util::error_message("Unsupported string-send types", types);
+        return (-1);
+    }
+
+    msgbuilder & mb = thread_builder();
+    bool ok = mb.start(OPTR(path), CSTR(types));
+    if (ok && count > 0)
+        ok = mb.add_string(v1);
+
+    if (ok && count > 1)
+        ok = mb.add_string(v2);
+
+    if (ok && count > 2)
+        ok = mb.add_string(v3);
+
+    if (ok)
+    {
+        int rc = send_built(to, mb);
+        if (rc != c_not_sent)
+            return rc;
+    }
+
+    int result;
+    const char * p = OPTR(path);
+    const char * t = CSTR(types);
+    switch (count)
+    {
+        case 0:
+
+            result = lo_send_from(to, server(), LO_TT_IMMEDIATE_2, p, t);
+            break;
+
+        case 1:
+
+            result = lo_send_from
+            (
+                to, server(), LO_TT_IMMEDIATE_2, p, t, CSTR(v1)
+            );
+            break;
+
+        case 2:
+
+            result = lo_send_from
+            (
+                to, server(), LO_TT_IMMEDIATE_2, p, t, CSTR(v1), CSTR(v2)
+            );
+            break;
+
+        default:
+
+            result = lo_send_from
+            (
+                to, server(), LO_TT_IMMEDIATE_2, p, t,
+                CSTR(v1), CSTR(v2), CSTR(v3)
+            );
+            break;
+    }
+    if (result >= 0)
+    {
+        trace_record(trace_dir::out, p, t, to, std::uint32_t(result));
+        m_metrics.sent(p, std::uint64_t(result));
+    }
+    return result;
+}
+
+/**
+ *  Sends a list of float, integer, and string values. The message builder
+ *  is tried first; the liblo bundle is the fallback.
+ */
+
 int
 lowrapper::send
 (
@@ -298,8 +930,62 @@ lowrapper::send
     osc_value_list & values
 )
 {
+    static const std::size_t s_max_types = 31;
+    if (values.size() <= s_max_types)
+    {
+        char types[s_max_types + 1];
+        std::size_t n = 0;
+        for (const auto & v : values)
+            types[n++] = v.type();
+
+        types[n] = 0;
+
+        msgbuilder & mb = thread_builder();
+        bool ok = mb.start(OPTR(path), types);
+        for (const auto & v : values)
+        {
+            if (! ok)
+                break;
+
+            const osc_value * ov = &v;
+            switch (ov->type())
+            {
+                case 'f':
+                    ok = mb.add_float
+                    (
+                        static_cast<const osc_float *>(ov)->value()
+                    );
+                    break;
+
+                case 'i':
+                    ok = mb.add_int32
+                    (
+                        static_cast<const osc_int *>(ov)->value()
+                    );
+                    break;
+
+                case 's':
+                    ok = mb.add_string
+                    (
+                        static_cast<const osc_string *>(ov)->value_ptr()
+                    );
+                    break;
+
+                default:
+                    ok = false;
+                    break;
+            }
+        }
+        if (ok)
+        {
+            int rc = send_built(to, mb);
+            if (rc != c_not_sent)
+                return rc;
+        }
+    }
+
     lo_message m = lo_message_new();
-    for (auto i : values)
+    for (const auto & i : values)
     {
         const osc_value * ov = &i;
         switch (ov->type())
@@ -353,12 +1039,26 @@ lowrapper::send
 int
 lowrapper::send (lo_address to, const std::string & path)
 {
+    msgbuilder & mb = thread_builder();
+    if (mb.start(OPTR(path), ""))
+    {
+        int rc = send_built(to, mb);
+        if (rc != c_not_sent)
+            return rc;
+    }
     return lo_send_from(to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "");
 }
 
 int
 lowrapper::send (lo_address to, const std::string & path, int v)
 {
+    msgbuilder & mb = thread_builder();
+    if (mb.start(OPTR(path), "i") && mb.add_int32(v))
+    {
+        int rc = send_built(to, mb);
+        if (rc != c_not_sent)
+            return rc;
+    }
     return lo_send_from(to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "i", v);
 }
 
@@ -377,6 +1077,13 @@ lowrapper::send
 int
 lowrapper::send (lo_address to, const std::string & path, float v)
 {
+    msgbuilder & mb = thread_builder();
+    if (mb.start(OPTR(path), "f") && mb.add_float(v))
+    {
+        int rc = send_built(to, mb);
+        if (rc != c_not_sent)
+            return rc;
+    }
     return lo_send_from(to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "f", v);
 }
 
@@ -389,10 +1096,7 @@ lowrapper::send (lo_address to, const std::string & path, double v)
 int
 lowrapper::send (lo_address to, const std::string & path, const std::string & v)
 {
-    return lo_send_from
-    (
-        to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "s", CSTR(v)
-    );
+    return send_strings(to, path, "s", v);
 }
 
 int
@@ -415,11 +1119,7 @@ lowrapper::send
     const std::string & v1, const std::string & v2
 )
 {
-    return lo_send_from
-    (
-        to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "ss",
-        CSTR(v1), CSTR(v2)
-    );
+    return send_strings(to, path, "ss", v1, v2);
 }
 
 int
@@ -429,11 +1129,7 @@ lowrapper::send
     const std::string & v1, const std::string & v2, const std::string & v3
 )
 {
-    return lo_send_from
-    (
-        to, server(), LO_TT_IMMEDIATE_2, OPTR(path), "sss",
-        CSTR(v1), CSTR(v2), CSTR(v3)
-    );
+    return send_strings(to, path, "sss", v1, v2, v3);
 }
 
 int
@@ -737,7 +1433,7 @@ lowrapper::error_send
     const std::string & errmsg, int errcode
 )
 {
-    lo_address to = lo_message_get_source(msg);
+    lo_address to = message_source(msg);
 #if defined USE_OLD_CODE
     lo_send_from
     (
@@ -805,7 +1501,7 @@ lowrapper::reply_send (const std::string & reply)
 void
 lowrapper::reply_send (lo_message msg, const std::string & reply)
 {
-    lo_address to = lo_message_get_source(msg);
+    lo_address to = message_source(msg);
     reply_send(to, reply);
 }
 
@@ -1014,7 +1710,7 @@ lowrapper::osc_reply
     int result { osc_msg_unhandled() };
     osc_msg_summary
     (
-        "lowrapper::osc_reply", path, types, argv, argc, userdata
+        "lowrapper::osc_reply", path, types, argv, argc, userdata, msg
     );
     if (argc == 0)                          // is NULL bereft of arguments?
     {
@@ -1055,14 +1751,20 @@ lowrapper::osc_reply
 /**
  *  Extracts the port number, as a string, from the port name, such as
  *  "osc.udp://mlsleno:17439/". Useful when using the --lookup option
- *  rather than the --osc-port option.
+ *  rather than the --osc-port option. For an "osc.unix://" URL, the
+ *  "port" is the socket path, which is what lo_server_new_with_proto()
+ *  wants; the digits in the path are not a port number.
  */
 
 std::string
 extract_port_number (const std::string & portspec)
 {
     std::string result;
-    if (! portspec.empty())
+    if (url_protocol(portspec) == LO_UNIX)
+    {
+        result = unix_socket_path(portspec);
+    }
+    else if (! portspec.empty())
     {
         auto pos0 = portspec.find_first_of("0123456789");
         if (pos0 != std::string::npos)
@@ -1075,27 +1777,378 @@ extract_port_number (const std::string & portspec)
 }
 
 /**
- *  Provides a brief description of an incoming message in a callback.
- *  Requires the -i / --investigate option to be used.
+ *  True if the string is an OSC URL, such as "osc.udp://host:1234/",
+ *  rather than a bare port number or socket path.
+ */
+
+bool
+is_osc_url (const std::string & url)
+{
+    return util::strncompare(url, "osc.") &&
+        url.find("://") != std::string::npos;
+}
+
+/**
+ *  Gets the liblo protocol of an OSC URL from its scheme, without making
+ *  an lo_address.
+ *
+ * \return
+ *      Returns LO_TCP for "osc.tcp://", LO_UNIX for "osc.unix://", and
+ *      LO_UDP for anything else, the liblo default.
+ */
+
+int
+url_protocol (const std::string & url)
+{
+    if (util::strncompare(url, "osc.tcp://"))
+        return LO_TCP;
+    else if (util::strncompare(url, "osc.unix://"))
+        return LO_UNIX;
+    else
+        return LO_UDP;
+}
+
+/**
+ *  Gets the socket path of an "osc.unix://" URL. liblo writes these URLs
+ *  with an empty host, as "osc.unix:///tmp/lo_abc", but some versions add
+ *  a slash; the leading slashes are folded into one.
+ *
+ * \return
+ *      Returns the path, or an empty string if the URL is not an
+ *      "osc.unix://" URL or has no path.
+ */
+
+std::string
+unix_socket_path (const std::string & url)
+{
+    static const std::string s_scheme { "osc.unix://" };
+    std::string result;
+    if (util::strncompare(url, s_scheme))
+    {
+        auto pos = url.find('/', s_scheme.length());    /* skip any host    */
+        if (pos != std::string::npos)
+        {
+            pos = url.find_first_not_of('/', pos);
+            if (pos != std::string::npos)
+                result = "/" + url.substr(pos);
+        }
+    }
+    return result;
+}
+
+/**
+ *  Makes the canonical URL of a Unix-domain socket path, as used in
+ *  daemon files and NSM_URL, e.g. "osc.unix:///run/user/1000/nsm66.osc".
+ */
+
+std::string
+unix_url (const std::string & path)
+{
+    std::string result { "osc.unix://" };
+    if (path.empty() || path[0] != '/')
+        result += "/";
+
+    result += path;
+    return result;
+}
+
+/**
+ *  Makes a socket path for a Unix-domain OSC server that was given no
+ *  path, in $XDG_RUNTIME_DIR (or /tmp), unique to this process. A stale
+ *  file of that name, left by an earlier process with the same PID, is
+ *  removed so that bind(2) does not fail.
+ *
+ * \return
+ *      Returns a path such as "/run/user/1000/nsm66-4242-1.osc".
+ */
+
+std::string
+make_unix_socket_path ()
+{
+    static std::atomic<int> s_count { 0 };
+    const char * dir = std::getenv("XDG_RUNTIME_DIR");
+    std::string result { is_nullptr(dir) || dir[0] == 0 ? "/tmp" : dir };
+    result += "/nsm66-" + std::to_string(int(::getpid())) + "-" +
+        std::to_string(++s_count) + ".osc";
+
+    (void) ::unlink(result.c_str());
+    return result;
+}
+
+/**
+ *  Finds the end of the next batch of lowrapper::send_batched(): the
+ *  items from first on that fit, with the path, the two integers, and the
+ *  type-tag string, in maxbytes of OSC wire format. At least one item is
+ *  taken, even if it does not fit.
+ *
+ * \param items
+ *      All of the items.
+ *
+ * \param first
+ *      The index of the first item of the batch.
+ *
+ * \param pathlength
+ *      The length of the OSC path.
+ *
+ * \param maxbytes
+ *      The size limit of a message.
+ *
+ * \return
+ *      Returns the index one past the last item of the batch.
+ */
+
+std::size_t
+batch_end
+(
+    const lib66::tokenization & items,
+    std::size_t first,
+    std::size_t pathlength,
+    std::size_t maxbytes
+)
+{
+    auto padded = [] (std::size_t len)          /* OSC-string size          */
+    {
+        return (len + 1 + 3) & ~std::size_t(3);
+    };
+    const std::size_t fixed = padded(pathlength) + 8;       /* path, 2 ints */
+    std::size_t strbytes = 0;
+    std::size_t result = first;
+    for ( ; result < items.size(); ++result)
+    {
+        std::size_t count = result - first + 1;             /* ",ii" + 's's */
+        std::size_t s = strbytes + padded(items[result].length());
+        if (count > 1 && fixed + padded(3 + count) + s > maxbytes)
+            break;
+
+        strbytes = s;
+    }
+    return result;
+}
+
+/**
+ *  Makes the URL of an address, in the same form as lo_address_get_url(),
+ *  but without the malloc()/free() pair. Used to compare the source of a
+ *  message with known addresses.
+ *
+ * \return
+ *      Returns the URL, such as "osc.udp://127.0.0.1:17439/", or an empty
+ *      string if the address is null.
+ */
+
+std::string
+address_url (lo_address a)
+{
+    std::string result;
+    if (is_nullptr(a))
+        return result;
+
+    const char * host = lo_address_get_hostname(a);
+    const char * port = lo_address_get_port(a);
+    int protocol = lo_address_get_protocol(a);
+    if (protocol == LO_UNIX)
+        return unix_url(not_nullptr(port) ? port : "");   /* socket path  */
+
+    std::string h = not_nullptr(host) ? host : "" ;
+    result = protocol == LO_TCP ? "osc.tcp://" : "osc.udp://" ;
+    if (h.find(':') != std::string::npos)
+        result += "[" + h + "]";            /* IPv6 literal                 */
+    else
+        result += h;
+
+    result += ":";
+    if (not_nullptr(port))
+        result += port;
+
+    result += "/";
+    return result;
+}
+
+/**
+ *  Makes the URL of an address as address_url() does, but with the host
+ *  resolved to its numeric form, as liblo reports the source of a message.
+ *  An address made from a URL such as "osc.udp://myhost:16133/" can then
+ *  be compared with the sources of the replies from that host. IPv4 is
+ *  tried first, as liblo does, and an IPv4-mapped IPv6 address is given as
+ *  plain IPv4. A numeric host costs no lookup.
+ *
+ * eturn
+ *      Returns the URL, such as "osc.udp://192.168.1.5:16133/". If the host
+ *      cannot be resolved, the result of address_url() is returned.
+ */
+
+std::string
+numeric_address_url (lo_address a)
+{
+    if (is_nullptr(a) || lo_address_get_protocol(a) == LO_UNIX)
+        return address_url(a);
+
+    const char * host = lo_address_get_hostname(a);
+    const char * port = lo_address_get_port(a);
+    if (is_nullptr_2(host, port))
+        return address_url(a);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_socktype = lo_address_get_protocol(a) == LO_TCP ?
+        SOCK_STREAM : SOCK_DGRAM ;
+
+    addrinfo * ai = nullptr;
+    bool ok = false;
+    for (int family : { AF_INET, AF_UNSPEC })
+    {
+        hints.ai_family = family;
+        hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+        ok = getaddrinfo(host, port, &hints, &ai) == 0 && not_nullptr(ai);
+        if (! ok)
+        {
+            hints.ai_flags = AI_NUMERICSERV;
+            ok = getaddrinfo(host, port, &hints, &ai) == 0 && not_nullptr(ai);
+        }
+        if (ok)
+            break;
+    }
+    if (! ok)
+        return address_url(a);
+
+    sockaddr_storage ss;
+    socklen_t length = socklen_t(ai->ai_addrlen);
+    std::memcpy(&ss, ai->ai_addr, ai->ai_addrlen);
+    freeaddrinfo(ai);
+    if (ss.ss_family == AF_INET6)
+    {
+        const sockaddr_in6 * s6 = reinterpret_cast<const sockaddr_in6 *>(&ss);
+        if (IN6_IS_ADDR_V4MAPPED(&s6->sin6_addr))
+        {
+            sockaddr_in s4;
+            std::memset(&s4, 0, sizeof s4);
+            s4.sin_family = AF_INET;
+            s4.sin_port = s6->sin6_port;
+            std::memcpy(&s4.sin_addr, &s6->sin6_addr.s6_addr[12], 4);
+            std::memcpy(&ss, &s4, sizeof s4);
+            length = socklen_t(sizeof s4);
+        }
+    }
+
+    char numhost[NI_MAXHOST];
+    int rc = getnameinfo
+    (
+        reinterpret_cast<const sockaddr *>(&ss), length,
+        numhost, sizeof numhost, nullptr, 0, NI_NUMERICHOST
+    );
+    if (rc != 0)
+        return address_url(a);
+
+    std::string h = numhost;
+    std::string result = lo_address_get_protocol(a) == LO_TCP ?
+        "osc.tcp://" : "osc.udp://" ;
+
+    if (h.find(':') != std::string::npos)
+        result += "[" + h + "]";            /* IPv6 literal                 */
+    else
+        result += h;
+
+    result += ":";
+    result += port;
+    result += "/";
+    return result;
+}
+
+/**
+ *  The source to report for messages dispatched in the calling thread, if
+ *  not null. See message_source_override().
+ */
+
+namespace
+{
+
+thread_local lo_address s_source_override = nullptr;
+
+}           // namespace anonymous
+
+/**
+ *  Gets the sender of a message. Handlers use this instead of calling
+ *  lo_message_get_source() directly, so that a message handed over from
+ *  another thread (see osc::shard) is answered at its real sender.
+ *
+ * \param msg
+ *      The message being handled.
+ *
+ * \return
+ *      Returns the override address, if set in this thread, or else the
+ *      source of the message. Can be null.
+ */
+
+lo_address
+message_source (lo_message msg)
+{
+    if (not_nullptr(s_source_override))
+        return s_source_override;
+
+    return not_nullptr(msg) ? lo_message_get_source(msg) : nullptr ;
+}
+
+/**
+ *  Sets the address returned by message_source() in the calling thread,
+ *  while a handed-over message is dispatched. Set it back to null
+ *  afterward. The caller owns the address.
+ */
+
+void
+message_source_override (lo_address a)
+{
+    s_source_override = a;
+}
+
+/**
+ *  Records an incoming message in the trace (see osc/trace.hpp) and in the
+ *  metrics bound to this thread (see metrics::scope), and, if the -i /
+ *  --investigate option is used, provides a brief description of it. The
+ *  text is formatted only in that case, since it is too slow to do for
+ *  every message.
+ *
+ * \param msg
+ *      The message itself, if available, for the sender and size in the
+ *      trace. The default is null.
  */
 
 void
 osc_msg_summary
 (
-    const std::string & funcname,
-    const std::string & path, const char * types,
-    lo_arg ** argv, int argc, void * userdata
+    const char * funcname,
+    const char * path, const char * types,
+    lo_arg ** argv, int argc, void * userdata,
+    lo_message msg
 )
 {
+    metrics * stats = metrics::current();
+    bool tracing = trace_enabled();
+    if (tracing || not_nullptr(stats))
+    {
+        std::uint32_t bytes = 0;
+        if (not_nullptr_2(msg, path))
+            bytes = std::uint32_t(lo_message_length(msg, path));
+
+        if (not_nullptr(stats))
+            stats->received(path, bytes);
+
+        if (tracing)
+        {
+            lo_address source = not_nullptr(msg) ?
+                message_source(msg) : nullptr ;
+
+            trace_record(trace_dir::in, path, types, source, bytes);
+        }
+    }
     if (util::investigate())
     {
-        std::string typefix = not_nullptr(types) ? types : "NULL" ;
+        const char * typefix = not_nullptr(types) ? types : "NULL" ;
+        const char * pathfix = not_nullptr(path) ? path : "NULL" ;
         if (util::investigate())
         {
             util::debug_printf
             (
                 "%s(\"%s\"+\"%s\", args %d, user %p)",
-                V(funcname), V(path), V(typefix), argc, userdata
+                funcname, pathfix, typefix, argc, userdata
             );
         }
         else
@@ -1103,7 +2156,7 @@ osc_msg_summary
             util::debug_printf
             (
                 "%s(\"%s\"+\"%s\", args %d)",
-                V(funcname), V(path), V(typefix), argc
+                funcname, pathfix, typefix, argc
             );
         }
         if (argc > 0)
@@ -7,16 +7,21 @@
  * \library       nsm66
  * \author        Chris Ahlstrom
  * \date          2025-02-12
- * \updates       2025-04-23
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
  *
  *  This file is a lean version of the nsm namespace's module nsmmessagesex, used by
  *  the applications, not the "nsm" library from Seq66.
+ *
+ *  The inverse lookups (message + pattern to tag) go through hashed indices
+ *  built on first use from the all_messages() table, rather than walking
+ *  the whole table with string compares for every incoming message.
  */
 
 #include <algorithm>                    /* std::find() for vector range     */
+#include <cstring>                      /* std::strcmp()                    */
 #include <iomanip>                      /* std::setw() manipulator          */
 #include <sstream>                      /* std::stringstream                */
 
@@ -53,6 +58,26 @@ namespace osc
  *                  message in either application. These are the two
  *                  applications that don't use the osc::endpoint class.
  *
+ * /nsm66/reply/list
+ *
+ *      An nsm66 extension, the answer to "/nsm66/server/list". It carries
+ *      many session names per message, rather than one "/reply" per
+ *      session:
+ *
+ *          "ii" + "s"...  osc::tag::replylist: the batch index, 1 if it
+ *                  is the last batch (else 0), then the names. The types
+ *                  vary, so the pattern is NIL. See
+ *                  lowrapper::send_batched().
+ *
+ * /nsm66/reply/stats
+ *
+ *      An nsm66 extension, the answer to "/nsm66/stats". There is one
+ *      message per row of the metrics snapshot (see osc/metrics.hpp):
+ *
+ *          "sshh"  osc::tag::replystats: the kind, the name, and the two
+ *                  values of the row. The last message has the kind
+ *                  "end". The pattern is NIL, as for replylist.
+ *
  * /error
  *
  *      There is only one variety of error response:
@@ -158,6 +183,8 @@ all_messages ()
         { tag::proxyupdate,    { "/nsm/proxy/update",                 ""        } },
         { tag::reply,          { "/reply",                            "ss"      } },
         { tag::replyex,        { "/reply",                            "ssss"    } },
+        { tag::replylist,      { "/nsm66/reply/list",                 NIL       } },
+        { tag::replystats,     { "/nsm66/reply/stats",                NIL       } },
         { tag::sessionlist,    { "/nsm/session/list",                 "?"       } },
         { tag::sessionname,    { "/nsm/session/name",                 "ss"      } },
         { tag::sessionroot,    { "/nsm/gui/session/root",             "s"       } },
@@ -176,12 +203,14 @@ all_messages ()
         { tag::srvclose,       { "/nsm/server/close",                 ""        } },
         { tag::srvduplicate,   { "/nsm/server/duplicate",             "s"       } },
         { tag::srvlist,        { "/nsm/server/list",                  ""        } },
+        { tag::srvlistbatch,   { "/nsm66/server/list",                ""        } },
         { tag::srvmessage,     { "/nsm/gui/server/message",           "s"       } },
         { tag::srvnew,         { "/nsm/server/new",                   "s"       } },
         { tag::srvopen,        { "/nsm/server/open",                  "s"       } },
         { tag::srvquit,        { "/nsm/server/quit",                  ""        } },
         { tag::srvreply,       { "/reply",                            "s"       } },
         { tag::srvsave,        { "/nsm/server/save",                  ""        } },
+        { tag::stats,          { "/nsm66/stats",                      ""        } },
         { tag::stripbynumber,  { "",                                  ""        } }
     };
     return s_all_messages;
@@ -277,6 +306,26 @@ tag_lookup
     return result;
 }
 
+/**
+ *  Similar to the taglist overload, but the membership test is a hash
+ *  lookup instead of a linear search.
+ */
+
+bool
+tag_lookup
+(
+    const tagset & ts,
+    tag t, std::string & message,
+    std::string & pattern
+)
+{
+    bool result = ts.find(t) != ts.end();
+    if (result)
+        result = tag_lookup(t, message, pattern);
+
+    return result;
+}
+
 /**
  *  This tag lookup is useful when all we want is the message
  *  string (the path) for the given tag.
@@ -293,8 +342,85 @@ tag_message (tag t)
     return s_empty;
 }
 
+/*
+ *  Support for the hashed inverse lookups.
+ */
+
+namespace       // anonymous
+{
+
+/**
+ *  Builds the key for the (message, pattern) index.  A null character
+ *  separates the two parts; it can appear in neither an OSC path nor an
+ *  OSC typespec.
+ */
+
+std::string
+make_index_key (const std::string & message, const std::string & pattern)
+{
+    std::string result;
+    result.reserve(message.size() + pattern.size() + 1);
+    result += message;
+    result += '\0';
+    result += pattern;
+    return result;
+}
+
+/**
+ *  Builds the (message, pattern) index of the all_messages() table, or the
+ *  message-only index if \a usepattern is false. The table is a std::map
+ *  ordered by tag, and emplace() does not replace an existing key, so a
+ *  duplicated key (e.g. "/nsm/gui/gui_announce" + "") yields the lowest
+ *  tag, just as the linear search did.
+ */
+
+reverse_index
+build_index (bool usepattern)
+{
+    reverse_index result;
+    const lookup & table = all_messages();
+    result.reserve(table.size());
+    for (const auto & m : table)
+    {
+        const messagepair & mp = m.second;
+        if (usepattern)
+            result.emplace(make_index_key(mp.msg_text, mp.msg_pattern), m.first);
+        else
+            result.emplace(mp.msg_text, m.first);
+    }
+    return result;
+}
+
+/**
+ *  The index used when a pattern is specified.  Being a function-static
+ *  object, its creation is thread-safe.
+ */
+
+const reverse_index &
+message_pattern_index ()
+{
+    static const reverse_index s_index = build_index(true);
+    return s_index;
+}
+
+/**
+ *  The side index used for the "?" wildcard pattern, which matches on the
+ *  message only.
+ */
+
+const reverse_index &
+message_index ()
+{
+    static const reverse_index s_index = build_index(false);
+    return s_index;
+}
+
+}               // namespace anonymous
+
 /**
  *  Inverse lookup.  Given the message and pattern names, return the tag.
+ *  If the table is the all_messages() table, the hashed indices are used.
+ *  Otherwise, the table is searched linearly.
  *
  * \param table
  *      The particular category of <tag, message, pattern> items to
@@ -319,25 +445,46 @@ tag_reverse_lookup
 )
 {
     tag result = tag::illegal;
-    for (const auto & m : table)
+    if (&table == &all_messages())
     {
-        bool match = m.second.msg_text == message;
-        if (match)
+        if (pattern == "?")
         {
-            if (pattern != "?")
-                match = m.second.msg_pattern == pattern;
+            const reverse_index & ri = message_index();
+            auto it = ri.find(message);
+            if (it != ri.end())
+                result = it->second;
         }
-        if (match)
+        else
         {
-            result = m.first;
-            break;
+            const reverse_index & ri = message_pattern_index();
+            auto it = ri.find(make_index_key(message, pattern));
+            if (it != ri.end())
+                result = it->second;
+        }
+    }
+    else
+    {
+        for (const auto & m : table)
+        {
+            bool match = m.second.msg_text == message;
+            if (match)
+            {
+                if (pattern != "?")
+                    match = m.second.msg_pattern == pattern;
+            }
+            if (match)
+            {
+                result = m.first;
+                break;
+            }
         }
     }
     return result;
 }
 
 /**
- *  Inverse lookup, using the "all-message" lookup table.
+ *  Inverse lookup, using the "all-message" lookup table, and hence the
+ *  hashed indices.
  *
  * \param message
  *      The OSC message, such as "/nsm/gui/announce".
@@ -356,6 +503,46 @@ tag_reverse_lookup
     return tag_reverse_lookup(all_messages(), message, pattern);
 }
 
+/**
+ *  Inverse lookup for the path and typespec handed to a liblo handler.
+ *  The index key is built in a per-thread buffer, so that this lookup does
+ *  not allocate once the buffer has grown to the longest key.
+ *
+ * \param message
+ *      The OSC message, such as "/nsm/gui/client/status".
+ *
+ * \param pattern
+ *      The value pattern, such as "ss". If "?", only the message is
+ *      matched.
+ *
+ * \return
+ *      Returns the tag found, or tag::illegal.
+ */
+
+tag
+tag_reverse_lookup (const char * message, const char * pattern)
+{
+    tag result = tag::illegal;
+    if (not_nullptr_2(message, pattern))
+    {
+        thread_local std::string s_key;
+        bool usepattern = std::strcmp(pattern, "?") != 0;
+        const reverse_index & ri = usepattern ?
+            message_pattern_index() : message_index() ;
+
+        s_key.assign(message);
+        if (usepattern)
+        {
+            s_key += '\0';
+            s_key += pattern;
+        }
+        auto it = ri.find(s_key);
+        if (it != ri.end())
+            result = it->second;
+    }
+    return result;
+}
+
 /**
  *  This map of names and tags is useful in specifying options for
  *  the nsmctl application. The "gui" tags also require a client name
@@ -381,12 +568,24 @@ static tagmap s_tag_names =
     {   "add",          { false, tag::srvadd         } }
 };
 
+/**
+ *  The hashed copy of s_tag_names used by the name lookups.
+ */
+
+static const tagindex &
+tag_name_index ()
+{
+    static const tagindex s_tag_index(s_tag_names.begin(), s_tag_names.end());
+    return s_tag_index;
+}
+
 tag
 tag_name_lookup (const std::string & name)
 {
     tag result = tag::illegal;
-    auto it = s_tag_names.find(name);
-    if (it != s_tag_names.end())
+    const tagindex & ti = tag_name_index();
+    auto it = ti.find(name);
+    if (it != ti.end())
         result = it->second.osc_tag;
 
     return result;
@@ -396,8 +595,9 @@ bool
 tag_name_is_client (const std::string & name)
 {
     bool result = false;
-    auto it = s_tag_names.find(name);
-    if (it != s_tag_names.end())
+    const tagindex & ti = tag_name_index();
+    auto it = ti.find(name);
+    if (it != ti.end())
         result = it->second.is_client_tag;
 
     return result;
@@ -19,7 +19,7 @@
  */
 
 /**
- * \file          method.hpp
+ * \file          method.cpp
  *
  *    This module refactors the method class to replace C code with
  *    C++ code.
@@ -27,20 +27,285 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-03-20
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
- *   To do.
+ *  Also see method_trie in method.hpp.
  */
 
-#include "osc/method.hpp"               /* osc::method class                */
+#include <algorithm>                    /* std::min()                       */
+
+#include "osc/method.hpp"               /* osc::method, osc::method_trie    */
 
 namespace osc
 {
-    // the simple code is defined in the header file
+
+/*
+ *  The simple method code is defined in the header file.
+ */
+
+method_trie::method_trie () :
+    m_root  (),
+    m_count (0)
+{
+    // no code
+}
+
+method_trie::~method_trie ()
+{
+    clear();
+}
+
+/**
+ *  Finds where a child starting with the given character is, or would
+ *  go, in the sorted children of a node.
+ */
+
+std::size_t
+method_trie::child_index (const node & n, char c)
+{
+    std::size_t lo = 0;
+    std::size_t hi = n.n_children.size();
+    while (lo < hi)
+    {
+        std::size_t mid = (lo + hi) / 2;
+        if (n.n_children[mid]->n_label[0] < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
 }
 
+/**
+ *  Adds a method, taking ownership of it. A node is split if the path
+ *  leaves its label part way. A duplicate path and typespec is kept, as
+ *  liblo does.
+ */
+
+void
+method_trie::insert (method * m)
+{
+    if (m == nullptr)
+        return;
+
+    node * n = &m_root;
+    std::string_view rest = m->path();
+    while (! rest.empty())
+    {
+        std::size_t i = child_index(*n, rest[0]);
+        bool found = i < n->n_children.size() &&
+            n->n_children[i]->n_label[0] == rest[0];
+
+        if (! found)
+        {
+            auto leaf = std::make_unique<node>();
+            leaf->n_label = std::string(rest);
+            node * p = leaf.get();
+            n->n_children.insert(n->n_children.begin() + i, std::move(leaf));
+            n = p;
+            break;
+        }
+
+        node * c = n->n_children[i].get();
+        const std::string & label = c->n_label;
+        std::size_t common = 0;
+        std::size_t limit = std::min(label.size(), rest.size());
+        while (common < limit && label[common] == rest[common])
+            ++common;
+
+        if (common < label.size())
+        {
+            auto mid = std::make_unique<node>();
+            mid->n_label = label.substr(0, common);
+            c->n_label.erase(0, common);
+            mid->n_children.push_back(std::move(n->n_children[i]));
+            n->n_children[i] = std::move(mid);
+            c = n->n_children[i].get();
+        }
+        n = c;
+        rest.remove_prefix(common);
+    }
+    n->n_methods.push_back(m);
+    ++m_count;
+}
+
+/**
+ *  Finds the node whose path is exactly the one given.
+ */
+
+const method_trie::node *
+method_trie::find_node (std::string_view path) const
+{
+    const node * n = &m_root;
+    while (! path.empty())
+    {
+        std::size_t i = child_index(*n, path[0]);
+        if (i == n->n_children.size())
+            return nullptr;
+
+        const node * c = n->n_children[i].get();
+        if (path.substr(0, c->n_label.size()) != c->n_label)
+            return nullptr;
+
+        path.remove_prefix(c->n_label.size());
+        n = c;
+    }
+    return n;
+}
+
+/**
+ *  Finds the top node of the subtree holding all of the paths that start
+ *  with the prefix. The prefix can end part way into the label of that
+ *  node.
+ */
+
+const method_trie::node *
+method_trie::prefix_node (std::string_view prefix) const
+{
+    const node * n = &m_root;
+    while (! prefix.empty())
+    {
+        std::size_t i = child_index(*n, prefix[0]);
+        if (i == n->n_children.size())
+            return nullptr;
+
+        const node * c = n->n_children[i].get();
+        std::string_view label = c->n_label;
+        if (prefix.size() <= label.size())
+            return label.substr(0, prefix.size()) == prefix ? c : nullptr ;
+
+        if (prefix.substr(0, label.size()) != label)
+            return nullptr;
+
+        prefix.remove_prefix(label.size());
+        n = c;
+    }
+    return n;
+}
+
+/**
+ *  Looks up the method for a path and typespec. Nothing is allocated.
+ *
+ * \return
+ *      Returns the method, or null if there is none.
+ */
+
+method *
+method_trie::find (std::string_view path, std::string_view typespec) const
+{
+    const node * n = find_node(path);
+    if (n != nullptr)
+    {
+        for (method * m : n->n_methods)
+        {
+            if (m->typespec() == typespec)
+                return m;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ *  Removes and deletes a method. On the way back up, an empty node is
+ *  removed, and a node left with no methods and one child is merged with
+ *  the child, so that the trie stays compressed.
+ *
+ * \param target
+ *      If not null, the method to remove; otherwise the first one with the
+ *      typespec is removed.
+ */
+
+bool
+method_trie::remove_from
+(
+    node & n, std::string_view path,
+    std::string_view typespec, const method * target
+)
+{
+    if (path.empty())
+    {
+        for (auto it = n.n_methods.begin(); it != n.n_methods.end(); ++it)
+        {
+            method * m = *it;
+            bool match = target != nullptr ?
+                m == target : m->typespec() == typespec ;
+
+            if (match)
+            {
+                (void) n.n_methods.erase(it);
+                delete m;
+                --m_count;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t i = child_index(n, path[0]);
+    if (i == n.n_children.size())
+        return false;
+
+    node * c = n.n_children[i].get();
+    std::size_t len = c->n_label.size();
+    if (path.substr(0, len) != c->n_label)
+        return false;
+
+    bool result = remove_from(*c, path.substr(len), typespec, target);
+    if (result && c->n_methods.empty())
+    {
+        if (c->n_children.empty())
+        {
+            (void) n.n_children.erase(n.n_children.begin() + i);
+        }
+        else if (c->n_children.size() == 1)
+        {
+            std::unique_ptr<node> only = std::move(c->n_children[0]);
+            only->n_label.insert(0, c->n_label);
+            n.n_children[i] = std::move(only);
+        }
+    }
+    return result;
+}
+
+bool
+method_trie::remove (std::string_view path, std::string_view typespec)
+{
+    return remove_from(m_root, path, typespec, nullptr);
+}
+
+bool
+method_trie::remove (method * m)
+{
+    return m != nullptr && remove_from(m_root, m->path(), "", m);
+}
+
+void
+method_trie::delete_methods (node & n)
+{
+    for (method * m : n.n_methods)
+        delete m;
+
+    n.n_methods.clear();
+    for (auto & c : n.n_children)
+        delete_methods(*c);
+}
+
+/**
+ *  Deletes all of the methods.
+ */
+
+void
+method_trie::clear ()
+{
+    delete_methods(m_root);
+    m_root.n_children.clear();
+    m_count = 0;
+}
+
+}           // namespace osc
+
 /*
  * method.cpp
  *
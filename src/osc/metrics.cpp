@@ -0,0 +1,432 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          metrics.cpp
+ *
+ *    This module provides the counters and histograms of osc::metrics.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ */
+
+#include "osc/metrics.hpp"              /* osc::metrics class               */
+
+namespace osc
+{
+
+namespace
+{
+
+/**
+ *  The metrics bound to this thread by metrics::scope.
+ */
+
+thread_local metrics * s_current_metrics = nullptr;
+
+/**
+ *  Raises an atomic maximum. A relaxed compare-exchange loop is enough,
+ *  as the value only grows.
+ */
+
+void
+raise_max (std::atomic<std::uint64_t> & m, std::uint64_t value)
+{
+    std::uint64_t old = m.load(std::memory_order_relaxed);
+    while (value > old)
+    {
+        if (m.compare_exchange_weak(old, value, std::memory_order_relaxed))
+            break;
+    }
+}
+
+const std::string &
+tag_row_name (tag t)
+{
+    static const std::string s_other = "other";
+    if (t == tag::illegal)
+        return s_other;
+
+    const std::string & result = tag_message(t);
+    return result.empty() ? s_other : result ;
+}
+
+}           // namespace anonymous
+
+/*------------------------------------------------------------------------
+ * histogram
+ *------------------------------------------------------------------------*/
+
+histogram::histogram () :
+    m_buckets   (),
+    m_count     (0),
+    m_sum       (0),
+    m_max       (0)
+{
+    reset();
+}
+
+/**
+ *  Finds the bucket of a time: the smallest n with us <= 2^n, limited to
+ *  the last bucket.
+ */
+
+int
+histogram::bucket_of (std::uint64_t us)
+{
+    int result = 0;
+    while (result < c_buckets - 1 && us > bucket_limit(result))
+        ++result;
+
+    return result;
+}
+
+void
+histogram::record (std::uint64_t us)
+{
+    m_buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+    raise_max(m_max, us);
+}
+
+void
+histogram::reset ()
+{
+    for (auto & b : m_buckets)
+        b.store(0, std::memory_order_relaxed);
+
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+/**
+ *  Estimates a percentile from the buckets.
+ *
+ * \param fraction
+ *      The fraction of the samples, such as 0.99.
+ *
+ * \return
+ *      Returns the upper limit of the bucket holding that sample, but no
+ *      more than the largest sample. Returns 0 if there are no samples.
+ */
+
+std::uint64_t
+histogram::percentile (double fraction) const
+{
+    std::uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    std::uint64_t target = std::uint64_t(double(total) * fraction);
+    if (target == 0)
+        target = 1;
+
+    std::uint64_t seen = 0;
+    std::uint64_t largest = max();
+    for (int b = 0; b < c_buckets; ++b)
+    {
+        seen += bucket(b);
+        if (seen >= target)
+        {
+            std::uint64_t limit = bucket_limit(b);
+            return limit < largest ? limit : largest ;
+        }
+    }
+    return largest;
+}
+
+/*------------------------------------------------------------------------
+ * metrics::scope
+ *------------------------------------------------------------------------*/
+
+metrics::scope::scope (metrics * m) :
+    m_previous  (bind(m))
+{
+    // no code
+}
+
+metrics::scope::~scope ()
+{
+    (void) bind(m_previous);
+}
+
+/*------------------------------------------------------------------------
+ * metrics
+ *------------------------------------------------------------------------*/
+
+metrics::metrics () :
+    m_tags              (),
+    m_send_failures     (0),
+    m_unhandled         (0),
+    m_queues            (),
+    m_handler_latency   (),
+    m_ping_rtt          ()
+{
+    reset();
+}
+
+/**
+ *  Gets the metrics bound to the calling thread, if any.
+ */
+
+metrics *
+metrics::current ()
+{
+    return s_current_metrics;
+}
+
+/**
+ *  Binds metrics to the calling thread until the next bind(). Use a scope
+ *  where possible; this is for threads whose loop is not ours, such as the
+ *  liblo server thread (see nsmbase::server_thread_init()).
+ *
+ * \param m
+ *      The metrics to bind, or null to unbind.
+ *
+ * \return
+ *      Returns the previous binding.
+ */
+
+metrics *
+metrics::bind (metrics * m)
+{
+    metrics * result = s_current_metrics;
+    s_current_metrics = m;
+    return result;
+}
+
+/**
+ *  Looks up the tag of an OSC path, by path only. The const char * lookup
+ *  does not allocate once its per-thread key has grown. Callers that know
+ *  the tag should pass it instead.
+ *
+ * \return
+ *      Returns tag::illegal for a null or unknown path, such as that of a
+ *      signal.
+ */
+
+tag
+metrics::path_tag (const char * path)
+{
+    return tag_reverse_lookup(path, "?");
+}
+
+void
+metrics::received (tag t, std::uint64_t bytes)
+{
+    int i = static_cast<int>(t);
+    if (i < 0 || i >= c_tag_count)
+        i = c_tag_count - 1;
+
+    m_tags[i].tc_in_messages.fetch_add(1, std::memory_order_relaxed);
+    m_tags[i].tc_in_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void
+metrics::sent (tag t, std::uint64_t bytes)
+{
+    int i = static_cast<int>(t);
+    if (i < 0 || i >= c_tag_count)
+        i = c_tag_count - 1;
+
+    m_tags[i].tc_out_messages.fetch_add(1, std::memory_order_relaxed);
+    m_tags[i].tc_out_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ *  Sets the current depth of a queue, normally just after a push.
+ */
+
+void
+metrics::queue_depth (metric_queue q, std::size_t depth)
+{
+    int i = static_cast<int>(q);
+    if (i < 0 || i >= static_cast<int>(metric_queue::count))
+        return;
+
+    m_queues[i].g_current.store(depth, std::memory_order_relaxed);
+    raise_max(m_queues[i].g_max, depth);
+}
+
+void
+metrics::reset ()
+{
+    for (auto & tc : m_tags)
+    {
+        tc.tc_in_messages.store(0, std::memory_order_relaxed);
+        tc.tc_in_bytes.store(0, std::memory_order_relaxed);
+        tc.tc_out_messages.store(0, std::memory_order_relaxed);
+        tc.tc_out_bytes.store(0, std::memory_order_relaxed);
+    }
+    for (auto & g : m_queues)
+    {
+        g.g_current.store(0, std::memory_order_relaxed);
+        g.g_max.store(0, std::memory_order_relaxed);
+    }
+    m_send_failures.store(0, std::memory_order_relaxed);
+    m_unhandled.store(0, std::memory_order_relaxed);
+    m_handler_latency.reset();
+    m_ping_rtt.reset();
+}
+
+std::uint64_t
+metrics::received_messages (tag t) const
+{
+    int i = static_cast<int>(t);
+    return i >= 0 && i < c_tag_count ?
+        m_tags[i].tc_in_messages.load(std::memory_order_relaxed) : 0 ;
+}
+
+std::uint64_t
+metrics::received_bytes (tag t) const
+{
+    int i = static_cast<int>(t);
+    return i >= 0 && i < c_tag_count ?
+        m_tags[i].tc_in_bytes.load(std::memory_order_relaxed) : 0 ;
+}
+
+std::uint64_t
+metrics::sent_messages (tag t) const
+{
+    int i = static_cast<int>(t);
+    return i >= 0 && i < c_tag_count ?
+        m_tags[i].tc_out_messages.load(std::memory_order_relaxed) : 0 ;
+}
+
+std::uint64_t
+metrics::sent_bytes (tag t) const
+{
+    int i = static_cast<int>(t);
+    return i >= 0 && i < c_tag_count ?
+        m_tags[i].tc_out_bytes.load(std::memory_order_relaxed) : 0 ;
+}
+
+std::uint64_t
+metrics::queue_max (metric_queue q) const
+{
+    int i = static_cast<int>(q);
+    return i >= 0 && i < static_cast<int>(metric_queue::count) ?
+        m_queues[i].g_max.load(std::memory_order_relaxed) : 0 ;
+}
+
+/**
+ *  Copies the metrics into rows; see metric_row. Tags that have seen no
+ *  traffic, and empty histogram buckets, are left out.
+ */
+
+metric_rows
+metrics::snapshot () const
+{
+    static const char * const s_queue_names [] =
+    {
+        "values", "mailbox", "commands"
+    };
+    metric_rows result;
+    for (int i = 0; i < c_tag_count; ++i)
+    {
+        const tag_counters & tc = m_tags[i];
+        std::uint64_t inmsgs =
+            tc.tc_in_messages.load(std::memory_order_relaxed);
+
+        std::uint64_t outmsgs =
+            tc.tc_out_messages.load(std::memory_order_relaxed);
+
+        const std::string & name = tag_row_name(static_cast<tag>(i));
+        if (inmsgs > 0)
+        {
+            std::uint64_t b = tc.tc_in_bytes.load(std::memory_order_relaxed);
+            result.push_back
+            (
+                { "in", name, std::int64_t(inmsgs), std::int64_t(b) }
+            );
+        }
+        if (outmsgs > 0)
+        {
+            std::uint64_t b = tc.tc_out_bytes.load(std::memory_order_relaxed);
+            result.push_back
+            (
+                { "out", name, std::int64_t(outmsgs), std::int64_t(b) }
+            );
+        }
+    }
+    result.push_back
+    (
+        { "counter", "send_failures", std::int64_t(send_failures()), 0 }
+    );
+    result.push_back
+    (
+        { "counter", "unhandled", std::int64_t(unhandled_count()), 0 }
+    );
+    for (int q = 0; q < static_cast<int>(metric_queue::count); ++q)
+    {
+        result.push_back
+        (
+            {
+                "queue", s_queue_names[q],
+                std::int64_t(m_queues[q].g_current.load()),
+                std::int64_t(m_queues[q].g_max.load())
+            }
+        );
+    }
+
+    const histogram * hists [] = { &m_handler_latency, &m_ping_rtt };
+    const char * const histnames [] = { "handler_us", "ping_us" };
+    for (int h = 0; h < 2; ++h)
+    {
+        const histogram & hg = *hists[h];
+        result.push_back
+        (
+            {
+                histnames[h], "count",
+                std::int64_t(hg.count()), std::int64_t(hg.sum())
+            }
+        );
+        result.push_back({ histnames[h], "max", std::int64_t(hg.max()), 0 });
+        for (int b = 0; b < histogram::c_buckets; ++b)
+        {
+            std::uint64_t n = hg.bucket(b);
+            if (n > 0)
+            {
+                bool last = b == histogram::c_buckets - 1;
+                std::uint64_t limit = histogram::bucket_limit(b);
+                std::string name = last ?
+                    std::string("le_inf") : "le_" + std::to_string(limit) ;
+
+                result.push_back
+                (
+                    { histnames[h], name, std::int64_t(n), std::int64_t(limit) }
+                );
+            }
+        }
+    }
+    return result;
+}
+
+}           // namespace osc
+
+/*
+ * metrics.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
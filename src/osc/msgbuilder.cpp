@@ -0,0 +1,254 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          msgbuilder.cpp
+ *
+ *    This module serializes OSC messages into a reusable buffer.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  The OSC wire format, in brief:
+ *
+ *      -   OSC-string: the characters, then 1 to 4 null bytes so that the
+ *          length is a multiple of 4.
+ *      -   The address pattern (path), as an OSC-string.
+ *      -   The type-tag string, ',' plus the types, as an OSC-string.
+ *      -   The arguments: 'i' is a big-endian 32-bit integer, 'f' is a
+ *          big-endian 32-bit IEEE float, and 's' is an OSC-string.
+ */
+
+#include <cstring>                      /* std::strlen(), std::memcpy()     */
+
+#include "osc/msgbuilder.hpp"           /* osc::msgbuilder class            */
+
+namespace osc
+{
+
+/**
+ *  Serializes the header of the message. If msgbuilder cannot build the
+ *  message, the template is left invalid, and the caller must use liblo.
+ *
+ * \param path
+ *      The OSC path, such as "/nsm/client/progress".
+ *
+ * \param types
+ *      The type-tag string, without the leading comma, such as "f".
+ */
+
+msgtemplate::msgtemplate
+(
+    const std::string & path,
+    const std::string & types,
+    tag t
+) :
+    m_path      (path),
+    m_types     (types),
+    m_header    (),
+    m_tag       (t)
+{
+    msgbuilder mb(path.size() + types.size() + 8);
+    if (mb.start(m_path.c_str(), m_types.c_str()))
+        m_header.assign(mb.data(), mb.data() + mb.size());
+}
+
+msgbuilder::msgbuilder (std::size_t reserve) :
+    m_buffer    (reserve),
+    m_size      (0),
+    m_types     (""),
+    m_next_type (0),
+    m_valid     (false),
+    m_tag       (tag::illegal)
+{
+    // no code
+}
+
+/**
+ *  Starts a new message, discarding the previous one (but not the buffer).
+ *
+ * \param path
+ *      The OSC path, which must start with a '/'.
+ *
+ * \param types
+ *      The type-tag string, without the leading comma. It must contain only
+ *      'i', 'f', and 's' characters. The pointer must remain valid until the
+ *      message is complete.
+ *
+ * \return
+ *      Returns false if the parameters cannot be handled here, in which
+ *      case the caller should fall back to liblo.
+ */
+
+bool
+msgbuilder::start (const char * path, const char * types)
+{
+    m_size = 0;
+    m_next_type = 0;
+    m_valid = false;
+    m_tag = tag::illegal;
+    if (path == nullptr || types == nullptr || path[0] != '/')
+        return false;
+
+    for (const char * t = types; *t != 0; ++t)
+    {
+        if (*t != 'i' && *t != 'f' && *t != 's')
+            return false;
+    }
+    m_types = types;
+    append_padded(path);
+
+    std::size_t tlen = std::strlen(types);
+    std::size_t padded = (tlen + 2 + 3) & ~std::size_t(3);  /* ',' and nul  */
+    char * dest = reserve(padded);
+    dest[0] = ',';
+    std::memcpy(dest + 1, types, tlen);
+    std::memset(dest + 1 + tlen, 0, padded - tlen - 1);
+    m_valid = true;
+    return true;
+}
+
+/**
+ *  Starts a new message from a template, copying its serialized path and
+ *  type-tag string, so that only the arguments are left to add.
+ *
+ * \param mt
+ *      The template. It must outlive the message, as its type-tag string
+ *      is used to check the arguments.
+ *
+ * \return
+ *      Returns false if the template is not valid.
+ */
+
+bool
+msgbuilder::start (const msgtemplate & mt)
+{
+    m_size = 0;
+    m_next_type = 0;
+    m_valid = false;
+    m_tag = mt.message_tag();
+    if (! mt.valid())
+        return false;
+
+    char * dest = reserve(mt.header_size());
+    std::memcpy(dest, mt.header(), mt.header_size());
+    m_types = mt.types().c_str();
+    m_valid = true;
+    return true;
+}
+
+bool
+msgbuilder::add_int32 (std::int32_t v)
+{
+    bool result = next_type('i');
+    if (result)
+        append_32(static_cast<std::uint32_t>(v));
+
+    return result;
+}
+
+bool
+msgbuilder::add_float (float v)
+{
+    bool result = next_type('f');
+    if (result)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        append_32(bits);
+    }
+    return result;
+}
+
+bool
+msgbuilder::add_string (const char * s)
+{
+    bool result = s != nullptr && next_type('s');
+    if (result)
+        append_padded(s);
+    else
+        m_valid = false;
+
+    return result;
+}
+
+/**
+ *  Checks that the next type in the type-tag string is the one being
+ *  added. A mismatch invalidates the message.
+ */
+
+bool
+msgbuilder::next_type (char t)
+{
+    if (m_valid && m_types[m_next_type] == t)
+    {
+        ++m_next_type;
+        return true;
+    }
+    m_valid = false;
+    return false;
+}
+
+/**
+ *  Makes room for count more bytes, growing the buffer if needed, and
+ *  returns a pointer to the start of the room.
+ */
+
+char *
+msgbuilder::reserve (std::size_t count)
+{
+    std::size_t needed = m_size + count;
+    if (needed > m_buffer.size())
+        m_buffer.resize(needed * 2);
+
+    char * result = m_buffer.data() + m_size;
+    m_size = needed;
+    return result;
+}
+
+void
+msgbuilder::append_padded (const char * s)
+{
+    std::size_t len = std::strlen(s);
+    std::size_t padded = (len + 1 + 3) & ~std::size_t(3);
+    char * dest = reserve(padded);
+    std::memcpy(dest, s, len);
+    std::memset(dest + len, 0, padded - len);
+}
+
+void
+msgbuilder::append_32 (std::uint32_t v)
+{
+    char * dest = reserve(4);
+    dest[0] = char((v >> 24) & 0xFF);
+    dest[1] = char((v >> 16) & 0xFF);
+    dest[2] = char((v >> 8) & 0xFF);
+    dest[3] = char(v & 0xFF);
+}
+
+}           // namespace osc
+
+/*
+ * msgbuilder.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
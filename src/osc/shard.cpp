@@ -0,0 +1,441 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          shard.cpp
+ *
+ *    This module provides the extra receive threads of a sharded
+ *    osc::endpoint, and the mailbox used to reach them.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  liblo has no way to create a server on a socket made by the caller, nor
+ *  to set SO_REUSEPORT. So the shard lets liblo create a UDP server on a
+ *  port of its own, then replaces that socket, using dup3(), by one bound
+ *  to the endpoint's port. liblo only knows the socket by its descriptor,
+ *  so from then on it receives from, and sends from, the shared port.
+ */
+
+#include <cstdlib>                      /* std::free()                      */
+#include <future>                       /* std::promise<>, std::future<>    */
+
+#include "c_macros.h"                   /* not_nullptr() macro              */
+#include "osc/endpoint.hpp"             /* osc::endpoint class              */
+#include "osc/shard.hpp"                /* osc::shard, osc::mailbox         */
+#include "util/msgfunctions.hpp"        /* util::error_printf()             */
+
+#if defined PLATFORM_LINUX
+#include <cerrno>                       /* errno, EINTR                     */
+#include <cstdint>                      /* std::uint64_t                    */
+#include <fcntl.h>                      /* O_CLOEXEC                        */
+#include <poll.h>                       /* ::poll()                         */
+#include <sys/eventfd.h>                /* eventfd()                        */
+#include <unistd.h>                     /* ::dup3(), ::read(), ::close()    */
+#endif
+
+namespace osc
+{
+
+namespace
+{
+
+void
+shard_error (int num, const char * msg, const char * path)
+{
+    util::error_printf
+    (
+        "OSC shard server error %d, path %s: %s", num,
+        not_nullptr(path) ? path : "none", not_nullptr(msg) ? msg : ""
+    );
+}
+
+}           // namespace anonymous
+
+/*-------------------------------------------------------------------------
+ * mailbox
+ *-------------------------------------------------------------------------*/
+
+mailbox::mailbox (int wakefd) :
+    m_mutex     (),
+    m_commands  (),
+    m_running   (),
+    m_pending   (false),
+    m_wake_fd   (wakefd)
+{
+    // no code
+}
+
+/**
+ *  Queues a command for the owning thread, and wakes it up. Can be called
+ *  from any thread, including the owning thread.
+ *
+ * \return
+ *      Returns the number of commands waiting, including this one, for the
+ *      queue-depth metric.
+ */
+
+std::size_t
+mailbox::post (command c)
+{
+    std::size_t result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_commands.push_back(std::move(c));
+        result = m_commands.size();
+        m_pending.store(true, std::memory_order_release);
+    }
+#if defined PLATFORM_LINUX
+    if (m_wake_fd >= 0)
+    {
+        std::uint64_t one = 1;
+        ssize_t rc = ::write(m_wake_fd, &one, sizeof one);
+        (void) rc;
+    }
+#endif
+    return result;
+}
+
+/**
+ *  Runs the commands posted so far, in order. Called only in the owning
+ *  thread. A command can post another one, which is run by the next
+ *  drain().
+ *
+ * \return
+ *      Returns the number of commands run.
+ */
+
+int
+mailbox::drain ()
+{
+    if (! pending())
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running.swap(m_commands);
+        m_pending.store(false, std::memory_order_release);
+    }
+
+    int result = int(m_running.size());
+    for (auto & c : m_running)
+        c();
+
+    m_running.clear();
+    return result;
+}
+
+/*-------------------------------------------------------------------------
+ * shard
+ *-------------------------------------------------------------------------*/
+
+shard::shard (endpoint * ep, int index) :
+    m_endpoint      (ep),
+    m_index         (index),
+    m_server        (nullptr),
+    m_signals       (),
+    m_wake_fd       (-1),
+    m_mailbox       (),
+    m_thread        (),
+    m_running       (false)
+{
+#if defined PLATFORM_LINUX
+    m_wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_mailbox.wake_fd(m_wake_fd);
+#endif
+}
+
+shard::~shard ()
+{
+    stop();
+    if (not_nullptr(m_server))
+        lo_server_free(m_server);
+
+#if defined PLATFORM_LINUX
+    if (m_wake_fd >= 0)
+        (void) ::close(m_wake_fd);
+#endif
+}
+
+/**
+ *  Creates the shard's socket, bound to the given address with
+ *  SO_REUSEPORT, and the liblo server that uses it. The endpoint socket
+ *  must also have SO_REUSEPORT set; see endpoint::start_sharded().
+ *
+ * \param addr
+ *      The address of the endpoint socket, from getsockname().
+ *
+ * \param length
+ *      The length of the address.
+ *
+ * \return
+ *      Returns true if the shard is ready to start.
+ */
+
+bool
+shard::open (const struct sockaddr * addr, socklen_t length)
+{
+    bool result = false;
+#if defined PLATFORM_LINUX
+    if (is_nullptr(addr) || not_nullptr(m_server))
+        return result;
+
+    int fd = ::socket(addr->sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return result;
+
+    int on = 1;
+    result =
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) == 0 &&
+        ::bind(fd, addr, length) == 0;
+
+    if (result)
+    {
+        m_server = lo_server_new_with_proto(nullptr, LO_UDP, shard_error);
+        result = not_nullptr(m_server);
+    }
+    if (result)
+    {
+        int lofd = lo_server_get_socket_fd(m_server);
+        result = lofd >= 0 && ::dup3(fd, lofd, O_CLOEXEC) >= 0;
+    }
+    (void) ::close(fd);
+    if (result)
+    {
+        (void) lo_server_add_method
+        (
+            m_server, NULL, NULL, &shard::osc_receive, this
+        );
+    }
+    else
+        util::error_printf("Cannot open OSC shard %d", m_index);
+#else
+    (void) addr;
+    (void) length;
+#endif
+    return result;
+}
+
+bool
+shard::start (const thread_attributes & attr)
+{
+    if (is_nullptr(m_server) || m_running)
+        return false;
+
+    m_running = true;
+    if (! m_thread.clone(&shard::shard_thread, this, attr))
+    {
+        m_running = false;
+        util::error_printf("Could not create OSC shard thread %d", m_index);
+    }
+    return m_running;
+}
+
+/**
+ *  Stops the thread and waits for it to end. Commands posted before the
+ *  thread ends are still run.
+ */
+
+void
+shard::stop ()
+{
+    if (m_running)
+    {
+        m_running = false;
+        m_mailbox.post([] () { });      /* wakes up the thread              */
+        m_thread.join();
+    }
+}
+
+void
+shard::post (mailbox::command c)
+{
+    m_mailbox.post(std::move(c));
+}
+
+/**
+ *  Posts a command and waits until the shard thread has run it, so that
+ *  the caller knows that the shard no longer refers to something being
+ *  deleted. If the shard is not running, the command is run here.
+ *
+ *  Must not be called in the shard thread, and, like stop(), is meant to
+ *  be called only in the thread that owns the endpoint.
+ */
+
+void
+shard::call (mailbox::command c)
+{
+    if (m_running)
+    {
+        std::promise<void> done;
+        std::future<void> finished = done.get_future();
+        m_mailbox.post
+        (
+            [&c, &done] ()
+            {
+                c();
+                done.set_value();
+            }
+        );
+        finished.wait();
+    }
+    else
+        c();
+}
+
+void
+shard::add_signal (signal * s)
+{
+    if (not_nullptr(s))
+        m_signals[s->path()] = s;
+}
+
+void
+shard::del_signal (const std::string & path)
+{
+    auto it = m_signals.find(path);
+    if (it != m_signals.end())
+        m_signals.erase(it);
+}
+
+void *
+shard::shard_thread (void * arg)
+{
+    shard * sp = static_cast<shard *>(arg);
+    sp->m_thread.name("OSC shard " + std::to_string(sp->m_index));
+    sp->run();
+    return nullptr;
+}
+
+/**
+ *  The receive loop. The mailbox is drained before the messages are
+ *  received, so that table changes posted by the endpoint apply first.
+ *  The number of messages per pass is limited so that a flood cannot hold
+ *  up the mailbox.
+ */
+
+void
+shard::run ()
+{
+#if defined PLATFORM_LINUX
+    const int s_timeout = 100;
+    const int s_budget = 256;
+    struct pollfd fds[2];
+    fds[0].fd = lo_server_get_socket_fd(m_server);
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wake_fd;
+    fds[1].events = POLLIN;
+
+    nfds_t count = m_wake_fd >= 0 ? 2 : 1 ;
+    metrics::scope bind(&m_endpoint->stats());
+    while (m_running)
+    {
+        fds[0].revents = fds[1].revents = 0;
+        int n = ::poll(fds, count, s_timeout);
+        if (n < 0 && errno != EINTR)
+        {
+            util::error_printf("OSC shard %d poll() failed", m_index);
+            break;
+        }
+        if (count == 2 && (fds[1].revents & POLLIN) != 0)
+        {
+            std::uint64_t value;
+            ssize_t rc = ::read(m_wake_fd, &value, sizeof value);
+            (void) rc;
+        }
+        (void) m_mailbox.drain();
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            for (int i = 0; i < s_budget; ++i)
+            {
+                if (lo_server_recv_noblock(m_server, 0) <= 0)
+                    break;
+            }
+        }
+    }
+    (void) m_mailbox.drain();
+#endif
+}
+
+/**
+ *  The one method of the shard's server. Signals are handled here, and all
+ *  else, including translations, is handed over to the endpoint.
+ */
+
+int
+shard::osc_receive
+(
+    const char * path, const char * types, lo_arg ** argv, int argc,
+    lo_message msg, void * userdata
+)
+{
+    shard * sp = static_cast<shard *>(userdata);
+    if (is_nullptr(sp) || is_nullptr(path))
+        return osc_msg_unhandled();
+
+    auto s = sp->m_signals.find(path);
+    if (s != sp->m_signals.end())
+    {
+        (void) endpoint::osc_sig_handler
+        (
+            path, types, argv, argc, msg, s->second
+        );
+        return osc_msg_handled();
+    }
+    sp->hand_over(path, msg);
+    return osc_msg_handled();
+}
+
+/**
+ *  Copies the message and its sender's URL, and posts them to the
+ *  endpoint, which dispatches the message to its own methods.
+ */
+
+void
+shard::hand_over (const char * path, lo_message msg)
+{
+    std::size_t size = 0;
+    void * data = lo_message_serialise(msg, path, nullptr, &size);
+    if (is_nullptr(data))
+        return;
+
+    std::string bytes(static_cast<const char *>(data), size);
+    std::free(data);
+
+    std::string url = address_url(lo_message_get_source(msg));
+    endpoint * ep = m_endpoint;
+    ep->post
+    (
+        [ep, bytes, url] ()
+        {
+            ep->dispatch_handed_over(bytes, url);
+        }
+    );
+}
+
+}           // namespace osc
+
+/*
+ * shard.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -27,7 +27,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-10-27
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
@@ -43,15 +43,16 @@ namespace osc
 {
 
 signal::signal (const std::string & path, direction dir) :
-    m_endpoint      (),
-    m_peer          (),
-    m_path          (path),
-    m_documentation (),
     m_value         (0.0f),
     m_direction     (dir),
     m_handler       (),
     m_user_data     (),
+    m_handler_mutex (),
+    m_endpoint      (),
+    m_peer          (),
+    m_path          (path),
     m_parameter_limits          (),
+    m_output_gate               (),
     m_connection_state_callback (),
     m_connection_state_userdata ()
 {
@@ -72,13 +73,40 @@ signal::~signal ( )
     }
 }
 
+/**
+ *  Sets the range of the signal and the policies for sending its values.
+ *  See parameter_limits. Calling it without the policy parameters turns
+ *  the policies off.
+ *
+ * \param deadband
+ *      The smallest change to send. Zero (the default) sends every change.
+ *
+ * \param relative
+ *      If true, the deadband is a fraction of the range, max - min.
+ *
+ * \param maxrate
+ *      The most values to send per second. Zero (the default) means no
+ *      limit.
+ */
+
 void
-signal::set_parameter_limits (float min, float max, float default_value)
+signal::set_parameter_limits
+(
+    float min, float max, float default_value,
+    float deadband, bool relative, int maxrate
+)
 {
     m_parameter_limits.pl_min = min;
     m_parameter_limits.pl_max = max;
     m_parameter_limits.pl_default_value = default_value;
+    m_parameter_limits.pl_deadband = deadband > 0.0f ? deadband : 0.0f ;
+    m_parameter_limits.pl_relative_deadband = relative;
+    m_parameter_limits.pl_max_rate = maxrate > 0 ? maxrate : 0 ;
     m_value = default_value;
+    if (not_nullptr(m_endpoint))
+        m_endpoint->reset_gate(m_output_gate);
+    else
+        m_output_gate.reset();
 }
 
 void
@@ -119,9 +147,24 @@ signal::rename (const std::string & path)
         );
     }
     m_endpoint->rename_translation_destination(m_path, newpath);
-    m_path = newpath;
+    m_endpoint->unshare_signal(m_path, false);
+
+    {
+        std::lock_guard<std::mutex> lock(m_endpoint->m_held_mutex);
+        m_endpoint->unindex_signal_path(this);
+        m_path = newpath;
+        m_output_gate.reset();                  /* held under the old path  */
+        (void) m_endpoint->m_signal_paths.emplace(m_path, this);
+    }
+    m_endpoint->share_signal(this);
 }
 
+/**
+ *  Sets the value, and sends it to the peers if this is an output signal.
+ *  Exact repeats are never sent. If the signal has a deadband or a rate
+ *  limit (see set_parameter_limits()), the endpoint applies them.
+ */
+
 void
 signal::value (float f)
 {
@@ -131,9 +174,109 @@ signal::value (float f)
     m_value = f;
     if (get_direction() == output )
     {
-        for (auto & p : m_endpoint->m_peers)
-            m_endpoint->send(p->p_addr, path(), f);
+        if (has_output_policy(m_parameter_limits))
+        {
+            m_endpoint->send_gated
+            (
+                path(), f, m_output_gate, m_parameter_limits, false
+            );
+        }
+        else
+            m_endpoint->send_value(path(), f);  /* can be batched       */
+    }
+}
+
+/*------------------------------------------------------------------------
+ * output_gate
+ *------------------------------------------------------------------------*/
+
+output_gate::output_gate () :
+    m_last_sent     (0.0f),
+    m_held_value    (0.0f),
+    m_has_sent      (false),
+    m_holding       (false),
+    m_last_time     ()
+{
+    // no code
+}
+
+/**
+ *  Decides what to do with a new value. A value inside the deadband of
+ *  the value last sent is dropped, and also cancels any held value, as
+ *  the peers already have a value close enough. A value that comes
+ *  sooner than the rate allows is held, replacing any held value.
+ *
+ *  The first value is always sent.
+ */
+
+output_gate::verdict
+output_gate::offer (const parameter_limits & pl, float v, clock::time_point now)
+{
+    if (m_has_sent)
+    {
+        float band = pl.pl_deadband;
+        if (pl.pl_relative_deadband)
+        {
+            float range = pl.pl_max - pl.pl_min;
+            if (range < 0.0f)
+                range = -range;
+
+            if (range > 0.0f)
+                band *= range;
+        }
+
+        float change = v - m_last_sent;
+        if (change < 0.0f)
+            change = -change;
+
+        if (band > 0.0f && change < band)
+        {
+            m_holding = false;
+            return verdict::drop;
+        }
+        if (pl.pl_max_rate > 0 && now < due(pl))
+        {
+            m_held_value = v;
+            m_holding = true;
+            return verdict::hold;
+        }
     }
+    m_holding = false;
+    return verdict::send;
+}
+
+/**
+ *  Notes that a value has been sent.
+ */
+
+void
+output_gate::sent (float v, clock::time_point now)
+{
+    m_last_sent = v;
+    m_has_sent = true;
+    m_holding = false;
+    m_last_time = now;
+}
+
+/**
+ *  The time at which the rate limit allows the next value.
+ */
+
+output_gate::clock::time_point
+output_gate::due (const parameter_limits & pl) const
+{
+    if (pl.pl_max_rate <= 0)
+        return m_last_time;
+
+    return m_last_time + std::chrono::microseconds(1000000 / pl.pl_max_rate);
+}
+
+void
+output_gate::reset ()
+{
+    m_last_sent = m_held_value = 0.0f;
+    m_has_sent = m_holding = false;
+    m_last_time = clock::time_point();
 }
 
 }           // namespace osc
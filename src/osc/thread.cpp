@@ -27,20 +27,99 @@
  * \library       nsm66
  * \author        Chris Ahlstrom and other authors; see documentation
  * \date          2025-02-05
- * \updates       2025-04-28
+ * \updates       2026-10-14
  * \version       $Revision$
  * \license       GNU GPL v2 or above
  *
- *   To do.
+ *  The current thread is kept in thread_local storage, which is much
+ *  cheaper to read than pthread_getspecific(). The attributes are applied
+ *  via pthread_attr_t in clone(), and via the pthread_set*() functions in
+ *  apply(). See thread_attributes in the header file.
  */
 
+#include <cerrno>                       /* EPERM                            */
+#include <climits>                      /* PTHREAD_STACK_MIN                */
+#include <cstring>                      /* std::strerror()                  */
+
 #include "c_macros.h"                   /* not_nullptr() macro              */
 #include "osc/thread.hpp"               /* osc::thread class                */
+#include "util/msgfunctions.hpp"        /* util::warn_printf()              */
+
+#if defined PLATFORM_LINUX
+#include <sys/mman.h>                   /* mlock()                          */
+#endif
 
 namespace osc
 {
 
-pthread_key_t thread::m_current = 0;
+namespace
+{
+
+/**
+ *  The amount of stack touched by lock_stack() where the stack bounds
+ *  cannot be obtained.
+ */
+
+const std::size_t c_prefault_bytes = 64 * 1024;
+
+int
+clamp_priority (int policy, int priority)
+{
+    int lo = sched_get_priority_min(policy);
+    int hi = sched_get_priority_max(policy);
+    if (priority < lo)
+        priority = lo;
+    else if (priority > hi)
+        priority = hi;
+
+    return priority;
+}
+
+/**
+ *  Touches c_prefault_bytes of the stack below the caller. The result is
+ *  returned only to keep the compiler from dropping the buffer.
+ */
+
+int
+prefault_stack ()
+{
+    volatile char buffer[c_prefault_bytes];
+    for (std::size_t i = 0; i < c_prefault_bytes; i += 1024)
+        buffer[i] = 0;
+
+    return buffer[0];
+}
+
+#if defined PLATFORM_LINUX
+
+/**
+ *  Fills a CPU set from a list of CPU numbers.
+ *
+ * \return
+ *      Returns true if at least one CPU number was in range.
+ */
+
+bool
+make_cpu_set (const std::vector<int> & cpus, cpu_set_t & cs)
+{
+    bool result = false;
+    CPU_ZERO(&cs);
+    for (int c : cpus)
+    {
+        if (c >= 0 && c < CPU_SETSIZE)
+        {
+            CPU_SET(c, &cs);
+            result = true;
+        }
+    }
+    return result;
+}
+
+#endif
+
+}           // namespace anonymous
+
+thread_local thread * thread::sm_current_thread = nullptr;
 
 thread::thread () :
     m_thread    (),
@@ -58,16 +137,23 @@ thread::thread (const std::string & name) :
     // no code
 }
 
+/**
+ *  Formerly created the pthread key for current(). Now current() uses
+ *  thread_local storage, so there is nothing to do, but this function is
+ *  kept for callers that still call it.
+ */
+
 void
 thread::init ()
 {
-    pthread_key_create(&m_current, NULL);
+    // no code
 }
 
 bool
 thread::is (const std::string & name)
 {
-    return thread::current()->name() != name;
+    thread * t = thread::current();
+    return not_nullptr(t) && t->name() == name;
 }
 
 /**
@@ -80,13 +166,120 @@ thread::set (const std::string & n)
     m_thread = pthread_self();
     m_name = n;
     m_running = true;
-    pthread_setspecific(m_current, static_cast<void *>(this));
+    sm_current_thread = this;
 }
 
 thread *
 thread::current ()
 {
-    return static_cast<thread *>(pthread_getspecific(m_current));
+    return sm_current_thread;
+}
+
+/**
+ *  Applies the attributes to the calling thread. The stack size cannot be
+ *  changed here, so it is ignored.
+ *
+ * \return
+ *      Returns true if every requested setting was applied.
+ */
+
+bool
+thread::apply (const thread_attributes & attr)
+{
+    bool result = true;
+    if (attr.realtime())
+        result = set_scheduling(attr.ta_policy, attr.ta_priority);
+
+    if (! attr.ta_cpus.empty())
+    {
+        if (! set_affinity(attr.ta_cpus))
+            result = false;
+    }
+    if (attr.ta_lock_stack)
+    {
+        if (! lock_stack())
+            result = false;
+    }
+    return result;
+}
+
+bool
+thread::set_scheduling (int policy, int priority)
+{
+    sched_param sp;
+    sp.sched_priority = clamp_priority(policy, priority);
+
+    int rcode = pthread_setschedparam(pthread_self(), policy, &sp);
+    bool result = rcode == 0;
+    if (! result)
+    {
+        util::warn_printf
+        (
+            "Cannot set thread priority %d: %s", sp.sched_priority,
+            std::strerror(rcode)
+        );
+    }
+    return result;
+}
+
+bool
+thread::set_affinity (const std::vector<int> & cpus)
+{
+    bool result = false;
+#if defined PLATFORM_LINUX
+    cpu_set_t cs;
+    if (make_cpu_set(cpus, cs))
+    {
+        int rcode = pthread_setaffinity_np(pthread_self(), sizeof cs, &cs);
+        result = rcode == 0;
+        if (! result)
+            util::warn_printf("Cannot set affinity: %s", std::strerror(rcode));
+    }
+    else
+        util::warn_message("No valid CPU in the affinity list");
+#else
+    (void) cpus;
+    util::warn_message("Thread affinity is not supported");
+#endif
+    return result;
+}
+
+/**
+ *  Locks the calling thread's stack into memory, so that it does not page
+ *  fault later. On Linux the whole stack is mlock()ed, which also faults
+ *  it in. Elsewhere, or if that fails, the top part of the stack is at
+ *  least touched.
+ */
+
+bool
+thread::lock_stack ()
+{
+    bool result = false;
+#if defined PLATFORM_LINUX
+    pthread_attr_t pa;
+    if (pthread_getattr_np(pthread_self(), &pa) == 0)
+    {
+        void * addr = nullptr;
+        std::size_t size = 0;
+        if (pthread_attr_getstack(&pa, &addr, &size) == 0)
+        {
+            result = mlock(addr, size) == 0;
+            if (! result)
+            {
+                util::warn_printf
+                (
+                    "Cannot lock %zu bytes of stack: %s",
+                    size, std::strerror(errno)
+                );
+            }
+        }
+        pthread_attr_destroy(&pa);
+    }
+#endif
+    if (! result)
+        (void) prefault_stack();
+
+    return result;
 }
 
 /*
@@ -100,9 +293,11 @@ thread::run_thread (void * arg)
     thread_data td = *tdptr;
     delete tdptr;                           /* delete (thread_data *) arg   */
 
-    pthread_setspecific(m_current, td.td_t);
-
     thread * threadptr = static_cast<thread *>(td.td_t);
+    sm_current_thread = threadptr;
+    if (td.td_lock_stack)
+        (void) lock_stack();
+
     threadptr->m_running = true;
 
     void * r = td.td_entry_point(td.td_arg);
@@ -120,8 +315,26 @@ thread::clear_thread ()
     m_thread = 0;                   /* m_thread = nullptr; */
 }
 
+/**
+ *  Creates the thread.
+ *
+ * \param ep
+ *      The function to run in the new thread.
+ *
+ * \param arg
+ *      The argument to pass to that function.
+ *
+ * \param attr
+ *      The scheduling, affinity, and stack settings. If the realtime
+ *      policy is refused for lack of privileges, the thread is created
+ *      without it.
+ *
+ * \return
+ *      Returns true if the thread was created.
+ */
+
 bool
-thread::clone (entry_point ep, void * arg)
+thread::clone (entry_point ep, void * arg, const thread_attributes & attr)
 {
     thread_data * td = new (std::nothrow) thread_data;
     bool result = not_nullptr(td);
@@ -130,9 +343,72 @@ thread::clone (entry_point ep, void * arg)
         td->td_entry_point = ep;
         td->td_arg = arg;
         td->td_t = this;
-        if (pthread_create(&m_thread, NULL, run_thread, td) != 0)
+        td->td_lock_stack = attr.ta_lock_stack;
+
+        int rcode = create(td, attr, true);
+        if (rcode == EPERM && attr.realtime())
+        {
+            util::warn_message("No realtime privileges, using default policy");
+            rcode = create(td, attr, false);
+        }
+        if (rcode != 0)
+        {
+            delete td;
             result = false;
+        }
+    }
+    return result;
+}
+
+/**
+ *  Sets up the pthread attributes and calls pthread_create().
+ *
+ * \param withsched
+ *      If false, the scheduling policy and priority are not set.
+ *
+ * \return
+ *      Returns the pthread_create() result, 0 for success.
+ */
+
+int
+thread::create
+(
+    thread_data * td,
+    const thread_attributes & attr,
+    bool withsched
+)
+{
+    if (attr.is_default())
+        return pthread_create(&m_thread, NULL, run_thread, td);
+
+    pthread_attr_t pa;
+    int result = pthread_attr_init(&pa);
+    if (result != 0)
+        return result;
+
+    if (attr.ta_stack_size > 0)
+    {
+        std::size_t size = attr.ta_stack_size;
+        if (size < std::size_t(PTHREAD_STACK_MIN))
+            size = std::size_t(PTHREAD_STACK_MIN);
+
+        (void) pthread_attr_setstacksize(&pa, size);
+    }
+    if (withsched && attr.realtime())
+    {
+        sched_param sp;
+        sp.sched_priority = clamp_priority(attr.ta_policy, attr.ta_priority);
+        (void) pthread_attr_setinheritsched(&pa, PTHREAD_EXPLICIT_SCHED);
+        (void) pthread_attr_setschedpolicy(&pa, attr.ta_policy);
+        (void) pthread_attr_setschedparam(&pa, &sp);
     }
+#if defined PLATFORM_LINUX
+    cpu_set_t cs;
+    if (! attr.ta_cpus.empty() && make_cpu_set(attr.ta_cpus, cs))
+        (void) pthread_attr_setaffinity_np(&pa, sizeof cs, &cs);
+#endif
+    result = pthread_create(&m_thread, &pa, run_thread, td);
+    pthread_attr_destroy(&pa);
     return result;
 }
 
@@ -176,7 +452,7 @@ thread::exit (void * retval)
 }           // namespace osc
 
 /*
- * thread.hpp
+ * thread.cpp
  *
  * vim: sw=4 ts=4 wm=4 et ft=cpp
  */
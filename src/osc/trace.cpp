@@ -0,0 +1,768 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          trace.cpp
+ *
+ *    This module records, dumps, and formats the binary OSC trace.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ *
+ *  Each ring is written only by the thread that owns it. The head is the
+ *  count of events ever written; the writer fills the slot, then publishes
+ *  it by storing the new head with release order. A reader copies the
+ *  slots, then reads the head again, and drops any slot that the writer
+ *  could have reached in the meantime. This is the usual lossy-ring
+ *  protocol, and a reader never blocks the writer.
+ *
+ *  The rings are static, so that a crash handler can write them without
+ *  allocating. A ring is claimed by a thread on its first event and freed
+ *  when the thread exits, keeping its events until another thread claims
+ *  it.
+ *
+ *  A dump file is a trace_file_header followed by trace_event structures,
+ *  in the byte order of the machine that wrote it, not sorted.
+ */
+
+#include <algorithm>                    /* std::sort()                      */
+#include <atomic>                       /* std::atomic<>                    */
+#include <cerrno>                       /* errno, EINTR                     */
+#include <csignal>                      /* sigaction(2), raise(3)           */
+#include <cstdio>                       /* std::snprintf()                  */
+#include <cstring>                      /* std::memcmp(), std::strncpy()    */
+#include <ctime>                        /* clock_gettime(2)                 */
+#include <fcntl.h>                      /* open(2), O_CLOEXEC               */
+#include <fstream>                      /* std::ifstream                    */
+#include <unistd.h>                     /* write(2), close(2)               */
+
+#include "osc/trace.hpp"                /* osc::trace_event, trace_record() */
+
+namespace osc
+{
+
+namespace
+{
+
+const char s_trace_magic [8] = { 'N', 'S', 'M', '6', '6', 'T', 'R', 'C' };
+const std::uint32_t s_trace_version = 1;
+const std::uint16_t s_trace_byte_order = 0x0102;
+const std::uint64_t s_ring_mask = c_trace_ring_size - 1;
+
+static_assert
+(
+    (c_trace_ring_size & s_ring_mask) == 0,
+    "c_trace_ring_size must be a power of 2"
+);
+
+/**
+ *  The start of a dump file.
+ */
+
+struct trace_file_header
+{
+    char th_magic[8];
+    std::uint32_t th_version;
+    std::uint16_t th_event_size;
+    std::uint16_t th_byte_order;
+};
+
+/**
+ *  One thread's ring. m_finished is the head as of the last
+ *  trace_finish(), and is used only by the owner.
+ */
+
+struct trace_ring
+{
+    std::atomic<std::uint64_t> m_head;
+    std::atomic<bool> m_in_use;
+    std::uint64_t m_finished;
+    trace_event m_events[c_trace_ring_size];
+};
+
+trace_ring s_rings[c_trace_max_rings];
+
+std::atomic<bool> s_enabled { true };
+
+char s_crash_file[256];
+
+/**
+ *  Claims a free ring for the calling thread, and frees it when the thread
+ *  exits. If all of the rings are in use, the thread does not trace.
+ */
+
+class ring_owner
+{
+
+private:
+
+    trace_ring * m_ring;
+    bool m_tried;
+
+public:
+
+    ring_owner () : m_ring (nullptr), m_tried (false)
+    {
+        // no code
+    }
+
+    ~ring_owner ()
+    {
+        if (m_ring != nullptr)
+            m_ring->m_in_use.store(false, std::memory_order_release);
+    }
+
+    trace_ring * ring ()
+    {
+        if (m_ring == nullptr && ! m_tried)
+        {
+            m_tried = true;
+            for (auto & r : s_rings)
+            {
+                bool expected = false;
+                if
+                (
+                    r.m_in_use.compare_exchange_strong
+                    (
+                        expected, true, std::memory_order_acq_rel
+                    )
+                )
+                {
+                    r.m_finished = r.m_head.load(std::memory_order_relaxed);
+                    m_ring = &r;
+                    break;
+                }
+            }
+        }
+        return m_ring;
+    }
+
+};          // class ring_owner
+
+trace_ring *
+this_ring ()
+{
+    static thread_local ring_owner s_owner;
+    return s_owner.ring();
+}
+
+std::uint8_t
+ring_index (const trace_ring & r)
+{
+    return std::uint8_t(&r - &s_rings[0]);
+}
+
+/**
+ *  The first slot that is safe to read, given the head read before the
+ *  copy and the head read after it. The slots from there up to the first
+ *  head are safe.
+ */
+
+std::uint64_t
+first_valid (std::uint64_t before, std::uint64_t after)
+{
+    std::uint64_t result = before > c_trace_ring_size ?
+        before - c_trace_ring_size : 0 ;
+
+    if (after >= c_trace_ring_size)
+    {
+        std::uint64_t reached = after - c_trace_ring_size + 1;
+        if (reached > result)
+            result = reached;
+    }
+    return result;
+}
+
+/**
+ *  The handler time of an incoming event is filled in by trace_finish()
+ *  after the event has been published, so that field, unlike the others,
+ *  is written while readers may copy it. It is always accessed atomically
+ *  (relaxed), without making trace_event itself non-copyable.
+ */
+
+inline void
+store_duration (trace_event & ev, std::uint32_t us)
+{
+    __atomic_store_n(&ev.te_duration_us, us, __ATOMIC_RELAXED);
+}
+
+inline std::uint32_t
+load_duration (const trace_event & ev)
+{
+    return __atomic_load_n(&ev.te_duration_us, __ATOMIC_RELAXED);
+}
+
+/**
+ *  Writes all of the buffer, retrying after signals and short writes.
+ *  Async-signal-safe.
+ */
+
+bool
+write_all (int fd, const void * data, std::size_t size)
+{
+    const char * p = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t rc = ::write(fd, p, size);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+        p += rc;
+        size -= std::size_t(rc);
+    }
+    return true;
+}
+
+std::uint32_t
+fnv1a (std::uint32_t h, const char * s)
+{
+    if (s != nullptr)
+    {
+        for ( ; *s != 0; ++s)
+        {
+            h ^= static_cast<unsigned char>(*s);
+            h *= 16777619u;
+        }
+    }
+    return h;
+}
+
+void
+crash_handler (int sig)
+{
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = ::open(s_crash_file, flags, 0644);
+    if (fd >= 0)
+    {
+        (void) trace_dump(fd);
+        (void) ::close(fd);
+    }
+    (void) ::raise(sig);                /* SA_RESETHAND: the default action */
+}
+
+}           // namespace (anonymous)
+
+/**
+ *  True if tracing is built in (NSM66_USE_TRACE).
+ */
+
+bool
+trace_compiled ()
+{
+#if defined NSM66_USE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ *  True if tracing is built in and has not been turned off.
+ */
+
+bool
+trace_enabled ()
+{
+    return trace_compiled() && s_enabled.load(std::memory_order_relaxed);
+}
+
+void
+trace_enable (bool flag)
+{
+    s_enabled.store(flag, std::memory_order_relaxed);
+}
+
+/**
+ *  The trace clock: CLOCK_MONOTONIC, in nanoseconds.
+ */
+
+std::uint64_t
+trace_clock ()
+{
+    struct timespec ts;
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::uint64_t(ts.tv_sec) * 1000000000u + std::uint64_t(ts.tv_nsec);
+}
+
+/**
+ *  Makes a peer number from the host name and port of an address. The
+ *  strings are kept inside the lo_address, so nothing is allocated.
+ *
+ * \return
+ *      Returns 0 for a null address.
+ */
+
+std::uint32_t
+trace_peer (lo_address a)
+{
+    if (a == nullptr)
+        return 0;
+
+    std::uint32_t h = fnv1a(2166136261u, lo_address_get_hostname(a));
+    h = fnv1a(h ^ ':', lo_address_get_port(a));
+    return h == 0 ? 1 : h ;
+}
+
+/**
+ *  Records one event in the calling thread's ring.
+ *
+ * \param direction
+ *      Whether the message was received or sent.
+ *
+ * \param t
+ *      The tag of the message, or tag::illegal if it is not an NSM message.
+ *
+ * \param peer
+ *      A number for the sender or receiver; see trace_peer().
+ *
+ * \param bytes
+ *      The size of the message in OSC wire format, if known.
+ *
+ * \param durationus
+ *      The time spent handling the message. For incoming messages, this is
+ *      normally left 0 and filled in by trace_finish().
+ */
+
+void
+trace_record
+(
+    trace_dir direction, tag t,
+    std::uint32_t peer, std::uint32_t bytes,
+    std::uint32_t durationus
+)
+{
+#if defined NSM66_USE_TRACE
+    if (! s_enabled.load(std::memory_order_relaxed))
+        return;
+
+    trace_ring * r = this_ring();
+    if (r == nullptr)
+        return;
+
+    std::uint64_t h = r->m_head.load(std::memory_order_relaxed);
+    trace_event & ev = r->m_events[h & s_ring_mask];
+    ev.te_time_ns = trace_clock();
+    ev.te_peer = peer;
+    ev.te_bytes = bytes;
+    store_duration(ev, durationus);
+    ev.te_tag = std::uint16_t(t);
+    ev.te_direction = std::uint8_t(direction);
+    ev.te_thread = ring_index(*r);
+    r->m_head.store(h + 1, std::memory_order_release);
+#else
+    (void) direction;
+    (void) t;
+    (void) peer;
+    (void) bytes;
+    (void) durationus;
+#endif
+}
+
+/**
+ *  Records an event, looking up the tag from the OSC path with the
+ *  const char * lookup, which does not allocate once its per-thread key
+ *  has grown to fit.
+ *
+ * \param types
+ *      Not yet used, since the tag is looked up on the path alone. It is
+ *      there so that reply and error variants can be told apart later.
+ */
+
+void
+trace_record
+(
+    trace_dir direction,
+    const char * path, const char * types,
+    lo_address peer, std::uint32_t bytes
+)
+{
+    (void) types;
+    if (! trace_enabled())
+        return;
+
+    tag t = path != nullptr ? tag_reverse_lookup(path, "?") : tag::illegal ;
+    trace_record(direction, t, trace_peer(peer), bytes);
+}
+
+/**
+ *  Fills in the handler time of the incoming events recorded by this
+ *  thread since the last call. The receive loops call this after each
+ *  lo_server_recv_noblock(), so that the time covers only the dispatch
+ *  of the message.
+ */
+
+void
+trace_finish ()
+{
+#if defined NSM66_USE_TRACE
+    if (! s_enabled.load(std::memory_order_relaxed))
+        return;
+
+    trace_ring * r = this_ring();
+    if (r == nullptr)
+        return;
+
+    std::uint64_t h = r->m_head.load(std::memory_order_relaxed);
+    std::uint64_t i = h > c_trace_ring_size ? h - c_trace_ring_size : 0 ;
+    if (r->m_finished > i)
+        i = r->m_finished;
+
+    if (i < h)
+    {
+        std::uint64_t now = trace_clock();
+        for ( ; i < h; ++i)
+        {
+            trace_event & ev = r->m_events[i & s_ring_mask];
+            bool incoming = ev.te_direction == std::uint8_t(trace_dir::in);
+            if (incoming && load_duration(ev) == 0 && now > ev.te_time_ns)
+            {
+                std::uint64_t us = (now - ev.te_time_ns) / 1000;
+                store_duration(ev, std::uint32_t(us));
+            }
+        }
+    }
+    r->m_finished = h;
+#endif
+}
+
+/**
+ *  Empties all of the rings. Meant for tests; events being recorded by
+ *  other threads at the same time may survive.
+ */
+
+void
+trace_reset ()
+{
+    for (auto & r : s_rings)
+    {
+        r.m_head.store(0, std::memory_order_release);
+    }
+}
+
+/**
+ *  Copies the events of all of the rings, sorted by time. The writers are
+ *  not stopped; events they overwrite during the copy are left out.
+ */
+
+std::vector<trace_event>
+trace_snapshot ()
+{
+    std::vector<trace_event> result;
+    for (auto & r : s_rings)
+    {
+        std::uint64_t before = r.m_head.load(std::memory_order_acquire);
+        if (before == 0)
+            continue;
+
+        std::uint64_t first = first_valid(before, before);
+        std::size_t start = result.size();
+        for (std::uint64_t i = first; i < before; ++i)
+        {
+            const trace_event & ev = r.m_events[i & s_ring_mask];
+            trace_event copy;
+            copy.te_time_ns = ev.te_time_ns;
+            copy.te_peer = ev.te_peer;
+            copy.te_bytes = ev.te_bytes;
+            copy.te_duration_us = load_duration(ev);
+            copy.te_tag = ev.te_tag;
+            copy.te_direction = ev.te_direction;
+            copy.te_thread = ev.te_thread;
+            result.push_back(copy);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t after = r.m_head.load(std::memory_order_relaxed);
+        std::uint64_t valid = first_valid(before, after);
+        if (valid > first)
+        {
+            std::size_t drop = std::size_t(valid - first);
+            if (drop > before - first)
+                drop = std::size_t(before - first);
+
+            result.erase
+            (
+                result.begin() + start, result.begin() + start + drop
+            );
+        }
+    }
+    std::sort
+    (
+        result.begin(), result.end(),
+        [] (const trace_event & a, const trace_event & b)
+        {
+            return a.te_time_ns < b.te_time_ns;
+        }
+    );
+    return result;
+}
+
+/**
+ *  Writes the header and the events of all of the rings to a descriptor.
+ *  Nothing is allocated or locked, so this can be called from a signal
+ *  handler. The events are not sorted; trace_read() sorts them.
+ */
+
+bool
+trace_dump (int fd)
+{
+    if (fd < 0)
+        return false;
+
+    trace_file_header th;
+    std::memcpy(th.th_magic, s_trace_magic, sizeof th.th_magic);
+    th.th_version = s_trace_version;
+    th.th_event_size = std::uint16_t(sizeof(trace_event));
+    th.th_byte_order = s_trace_byte_order;
+    bool result = write_all(fd, &th, sizeof th);
+    for (auto & r : s_rings)
+    {
+        if (! result)
+            break;
+
+        std::uint64_t h = r.m_head.load(std::memory_order_acquire);
+        std::uint64_t first = first_valid(h, h);
+        if (first == h)
+            continue;
+
+        std::size_t from = std::size_t(first & s_ring_mask);
+        std::size_t count = std::size_t(h - first);
+        std::size_t tail = c_trace_ring_size - from;
+        const std::size_t evsize = sizeof(trace_event);
+        if (count <= tail)
+        {
+            result = write_all(fd, &r.m_events[from], count * evsize);
+        }
+        else
+        {
+            result = write_all(fd, &r.m_events[from], tail * evsize);
+            if (result)
+                result = write_all(fd, &r.m_events[0], (count - tail) * evsize);
+        }
+    }
+    return result;
+}
+
+bool
+trace_dump (const std::string & filename)
+{
+    int fd = ::open
+    (
+        filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644
+    );
+    bool result = fd >= 0;
+    if (result)
+    {
+        result = trace_dump(fd);
+        if (::close(fd) != 0)
+            result = false;
+    }
+    return result;
+}
+
+/**
+ *  Installs handlers for the fatal signals (SIGSEGV, SIGBUS, SIGFPE,
+ *  SIGILL, and SIGABRT) that dump the trace to the given file, then let the
+ *  signal take its default action. This replaces any handlers the
+ *  application has for those signals, so it is not done automatically.
+ */
+
+bool
+trace_install_crash_dump (const std::string & filename)
+{
+    if (filename.empty() || filename.size() >= sizeof s_crash_file)
+        return false;
+
+    std::strncpy(s_crash_file, filename.c_str(), sizeof s_crash_file - 1);
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof sa);
+    sa.sa_handler = crash_handler;
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+
+    bool result = true;
+    const int sigs [] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    for (int s : sigs)
+    {
+        if (sigaction(s, &sa, nullptr) != 0)
+            result = false;
+    }
+    return result;
+}
+
+/**
+ *  Reads a dump file, for offline formatting. The events are sorted by
+ *  time.
+ *
+ * \param filename
+ *      The file written by trace_dump().
+ *
+ * \param [out] events
+ *      The events read. Cleared first.
+ *
+ * \param [out] errmsg
+ *      Set to the reason for a failure.
+ *
+ * \return
+ *      Returns true if the file was read.
+ */
+
+bool
+trace_read
+(
+    const std::string & filename,
+    std::vector<trace_event> & events,
+    std::string & errmsg
+)
+{
+    events.clear();
+    std::ifstream in(filename, std::ios::binary);
+    if (! in)
+    {
+        errmsg = "Cannot open trace file " + filename;
+        return false;
+    }
+
+    trace_file_header th;
+    bool result = bool(in.read(reinterpret_cast<char *>(&th), sizeof th));
+    if (result)
+    {
+        result = std::memcmp
+        (
+            th.th_magic, s_trace_magic, sizeof th.th_magic
+        ) == 0;
+    }
+
+    if (! result)
+    {
+        errmsg = "Not a trace file: " + filename;
+        return false;
+    }
+    if (th.th_byte_order != s_trace_byte_order)
+    {
+        errmsg = "Trace file has a different byte order: " + filename;
+        return false;
+    }
+    if
+    (
+        th.th_version != s_trace_version ||
+        th.th_event_size != sizeof(trace_event)
+    )
+    {
+        errmsg = "Unsupported trace file version: " + filename;
+        return false;
+    }
+
+    trace_event ev;
+    while (in.read(reinterpret_cast<char *>(&ev), sizeof ev))
+        events.push_back(ev);
+
+    if (in.gcount() != 0)
+    {
+        errmsg = "Trace file is truncated: " + filename;
+        result = false;
+    }
+    std::sort
+    (
+        events.begin(), events.end(),
+        [] (const trace_event & a, const trace_event & b)
+        {
+            return a.te_time_ns < b.te_time_ns;
+        }
+    );
+    return result;
+}
+
+/**
+ *  Formats one event as a line of text (without a newline), such as:
+ *
+\verbatim
+       12.345678901 T0 <-- /nsm/server/announce peer 1a2b3c4d 96 B 12 us
+\endverbatim
+ */
+
+std::string
+trace_format (const trace_event & ev)
+{
+    bool incoming = ev.te_direction == std::uint8_t(trace_dir::in);
+    tag t = tag(ev.te_tag);
+    std::string path = t == tag::illegal ? std::string() : tag_message(t) ;
+    if (path.empty())
+        path = "tag#" + std::to_string(unsigned(ev.te_tag));
+
+    char prefix[64];
+    (void) std::snprintf
+    (
+        prefix, sizeof prefix, "%9llu.%09llu T%u %s ",
+        (unsigned long long)(ev.te_time_ns / 1000000000u),
+        (unsigned long long)(ev.te_time_ns % 1000000000u),
+        unsigned(ev.te_thread), incoming ? "<--" : "-->"
+    );
+
+    char suffix[64];
+    if (incoming)
+    {
+        (void) std::snprintf
+        (
+            suffix, sizeof suffix, " peer %08x %u B %u us",
+            unsigned(ev.te_peer), unsigned(ev.te_bytes),
+            unsigned(ev.te_duration_us)
+        );
+    }
+    else
+    {
+        (void) std::snprintf
+        (
+            suffix, sizeof suffix, " peer %08x %u B",
+            unsigned(ev.te_peer), unsigned(ev.te_bytes)
+        );
+    }
+    return std::string(prefix) + path + suffix;
+}
+
+/**
+ *  Formats events one per line.
+ */
+
+std::string
+trace_format (const std::vector<trace_event> & events)
+{
+    std::string result;
+    for (const auto & ev : events)
+    {
+        result += trace_format(ev);
+        result += "\n";
+    }
+    return result;
+}
+
+}           // namespace osc
+
+/*
+ * trace.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -0,0 +1,107 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          typedmethod.cpp
+ *
+ *    This module provides the non-template helpers of the typed OSC
+ *    handlers.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-14
+ * \version       $Revision$
+ * \license       GNU GPL v2 or above
+ */
+
+#include "osc/lowrapper.hpp"            /* osc::osc_msg_summary()           */
+#include "osc/typedmethod.hpp"          /* osc::typed_handler<> template    */
+#include "util/msgfunctions.hpp"        /* util::error_message()            */
+
+namespace osc
+{
+
+/**
+ *  Traces the message, and describes it if --investigate is on, as the
+ *  other handlers do.
+ */
+
+void
+typed_method_summary
+(
+    const char * path, const char * types,
+    lo_arg ** argv, int argc, lo_message msg, void * userdata
+)
+{
+    osc_msg_summary("typed_handler", path, types, argv, argc, userdata, msg);
+}
+
+/**
+ *  Looks up the message and pattern of a tag, and makes sure that the
+ *  pattern is the typespec of the handler being registered for it.
+ *
+ * \param t
+ *      The tag of the message.
+ *
+ * \param typespec
+ *      The typespec made from the handler's parameters.
+ *
+ * \param [out] message
+ *      Set to the OSC path of the tag.
+ *
+ * \param [out] pattern
+ *      Set to the pattern of the tag.
+ *
+ * \return
+ *      Returns false, with an error message, if the tag is unknown or the
+ *      handler does not fit the message.
+ */
+
+bool
+typed_method_check
+(
+    tag t, const char * typespec,
+    std::string & message, std::string & pattern
+)
+{
+    bool result = tag_lookup(t, message, pattern);
+    if (result)
+    {
+        result = pattern == typespec;
+        if (! result)
+        {
+            util::error_message
+            (
+                "Typed handler does not fit", message + " " + pattern
+            );
+        }
+    }
+    else
+        util::error_message("Typed handler for unknown tag");
+
+    return result;
+}
+
+}           // namespace osc
+
+/*
+ * typedmethod.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
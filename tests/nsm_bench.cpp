@@ -0,0 +1,917 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          nsm_bench.cpp
+ *
+ *      Repeatable benchmarks of the paths of the nsm66 library that the
+ *      daemons and clients use the most, with the results in JSON.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \license       See above.
+ *
+ * Instructions:
+ *
+ *      Run from the project root (topmost directory), so that the sample
+ *      files are found, or via "meson test --benchmark":
+ *
+ *          ./build/tests/nsm_bench [--iterations N] [--repeat N]
+ *              [--filter text] [--output file.json]
+ *
+ *      Each benchmark runs once to warm up, then "repeat" times, each time
+ *      doing "iterations" operations (scaled down for the slow ones). The
+ *      best and the median time per operation are reported, in
+ *      nanoseconds. The inputs are generated with fixed contents, so that
+ *      the runs of two releases can be compared.
+ *
+ *      The network benchmarks use sockets on 127.0.0.1 only. The round
+ *      trip is between two plain lowrapper objects, and the raw fan-out of
+ *      one value to N destinations ("send_to_all_N") is measured with
+ *      lowrapper::send_to_all(). The endpoint fan-out cases go through
+ *      signal::value() on an endpoint with 8 peers: directly (the
+ *      endpoint's send_value()), with a deadband (send_gated()), and with
+ *      batching on, flushing once per value.
+ */
+
+#include <algorithm>                    /* std::sort()                      */
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <cstdio>                       /* std::remove()                    */
+#include <cstdlib>                      /* EXIT_SUCCESS, std::atol()        */
+#include <cstring>                      /* std::strcmp()                    */
+#include <fstream>                      /* std::ofstream                    */
+#include <iostream>                     /* std::cout                        */
+#include <netinet/in.h>                 /* sockaddr_in                      */
+#include <sstream>                      /* std::ostringstream               */
+#include <string>                       /* std::string                      */
+#include <sys/socket.h>                 /* socket(2), recv(2)               */
+#include <unistd.h>                     /* close(2)                         */
+#include <vector>                       /* std::vector<>                    */
+
+#include "nsm66.hpp"                    /* nsm66_version()                  */
+#include "cfg/appinfo.hpp"              /* cfg::set_client_name()           */
+#include "nsm/helpers.hpp"              /* nsm::parse_session_lines(), etc. */
+#include "osc/endpoint.hpp"             /* osc::endpoint, osc::signal       */
+#include "osc/lowrapper.hpp"            /* osc::lowrapper class             */
+#include "osc/messages.hpp"             /* osc::tag_reverse_lookup()        */
+#include "util/msgfunctions.hpp"        /* util::error_message()            */
+
+namespace
+{
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ *  A benchmark function does the given number of operations, and returns
+ *  a value made from the results, so that the work cannot be optimized
+ *  away. A negative value means the benchmark could not run.
+ */
+
+using bench_function = long (*) (long iterations);
+
+struct benchmark
+{
+    const char * b_name;
+    bench_function b_function;
+    long b_divisor;                     /* iterations / this for slow ones  */
+    long b_items;                       /* items handled per operation      */
+};
+
+struct bench_result
+{
+    std::string br_name;
+    long br_iterations;
+    long br_items;
+    double br_best_ns;
+    double br_median_ns;
+    bool br_ok;
+};
+
+const int s_session_clients = 1000;
+const int s_patch_lines = 5000;
+const std::string s_session_file { "/tmp/nsm66-bench-session.nsm" };
+const std::string s_patch_file { "/tmp/nsm66-bench.jackpatch" };
+
+/**
+ *  A UDP socket on 127.0.0.1 that receives and throws away the messages
+ *  sent by the send benchmarks.
+ */
+
+class udp_sink
+{
+
+private:
+
+    int m_fd;
+    std::string m_url;
+    lo_address m_address;
+
+public:
+
+    udp_sink () : m_fd (-1), m_url (), m_address (nullptr)
+    {
+        m_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_fd >= 0)
+        {
+            int size = 4 * 1024 * 1024;
+            (void) ::setsockopt
+            (
+                m_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof size
+            );
+
+            sockaddr_in sa;
+            socklen_t len = sizeof sa;
+            std::memset(&sa, 0, sizeof sa);
+            sa.sin_family = AF_INET;
+            sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            sa.sin_port = 0;
+            bool ok = ::bind
+            (
+                m_fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa
+            ) == 0 && ::getsockname
+            (
+                m_fd, reinterpret_cast<sockaddr *>(&sa), &len
+            ) == 0;
+            if (ok)
+            {
+                m_url = "osc.udp://127.0.0.1:" +
+                    std::to_string(ntohs(sa.sin_port)) + "/";
+
+                m_address = lo_address_new_from_url(m_url.c_str());
+            }
+        }
+    }
+
+    ~udp_sink ()
+    {
+        if (m_address != nullptr)
+            lo_address_free(m_address);
+
+        if (m_fd >= 0)
+            (void) ::close(m_fd);
+    }
+
+    lo_address address () const
+    {
+        return m_address;
+    }
+
+    /**
+     *  Reads and discards whatever has arrived.
+     */
+
+    void drain () const
+    {
+        char buffer[2048];
+        while (::recv(m_fd, buffer, sizeof buffer, MSG_DONTWAIT) > 0)
+        {
+            // no code
+        }
+    }
+
+};          // class udp_sink
+
+/**
+ *  An OSC server that answers "/bench/ping" with "/bench/pong", and counts
+ *  the pongs it gets. Only these two methods are added, so that nothing
+ *  else is run for the messages.
+ */
+
+class bench_peer : public osc::lowrapper
+{
+
+private:
+
+    long m_pongs;
+
+public:
+
+    bench_peer () : osc::lowrapper (), m_pongs (0)
+    {
+        // no code
+    }
+
+    long pongs () const
+    {
+        return m_pongs;
+    }
+
+    /**
+     *  Waits up to the timeout for messages, and handles them.
+     */
+
+    void pump (int timeoutms)
+    {
+        if (lo_server_wait(server(), timeoutms))
+            (void) receive_ready(server());
+    }
+
+protected:
+
+    virtual void add_methods (void * /*userdata*/) override
+    {
+        (void) lo_server_add_method
+        (
+            server(), "/bench/ping", "i", &bench_peer::osc_ping, this
+        );
+        (void) lo_server_add_method
+        (
+            server(), "/bench/pong", "i", &bench_peer::osc_pong, this
+        );
+    }
+
+private:
+
+    static int osc_ping
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** argv,
+        int /*argc*/, lo_message msg, void * userdata
+    )
+    {
+        bench_peer * p = static_cast<bench_peer *>(userdata);
+        (void) p->send(lo_message_get_source(msg), "/bench/pong", argv[0]->i);
+        return 0;
+    }
+
+    static int osc_pong
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+        int /*argc*/, lo_message /*msg*/, void * userdata
+    )
+    {
+        bench_peer * p = static_cast<bench_peer *>(userdata);
+        ++p->m_pongs;
+        return 0;
+    }
+
+};          // class bench_peer
+
+/**
+ *  The peers shared by the send benchmarks, made on first use.
+ */
+
+bench_peer &
+sender ()
+{
+    static bench_peer s_sender;
+    static bool s_ok = s_sender.init(LO_UDP);
+    (void) s_ok;
+    return s_sender;
+}
+
+udp_sink &
+sink ()
+{
+    static udp_sink s_sink;
+    return s_sink;
+}
+
+/*
+ *  Generated inputs.
+ */
+
+bool
+write_session_file ()
+{
+    std::ofstream out(s_session_file);
+    for (int i = 0; i < s_session_clients; ++i)
+    {
+        out << "Client-" << i << ":client-exe-" << (i % 17)
+            << ":n" << char('A' + i % 26) << char('A' + (i / 26) % 26)
+            << char('A' + (i / 676) % 26) << "X\n";
+    }
+    return bool(out);
+}
+
+bool
+write_patch_file ()
+{
+    static const char * const s_arrows [] = { "|>", "<|", "||" };
+    std::ofstream out(s_patch_file);
+    for (int i = 0; i < s_patch_lines; ++i)
+    {
+        out << "system-" << (i % 50) << ":capture_" << (i % 64)
+            << "         " << s_arrows[i % 3] << " "
+            << "seq66.n" << (i % 40) << ":a2j:Midi Through (capture): "
+            << "Midi Through Port-" << (i % 8) << "\n";
+    }
+    return bool(out);
+}
+
+/*
+ *  The benchmarks.
+ */
+
+long
+bench_tag_reverse_lookup (long iterations)
+{
+    static std::vector<std::string> s_paths;
+    if (s_paths.empty())
+    {
+        for (const auto & m : osc::all_messages())
+            s_paths.push_back(m.second.msg_text);
+    }
+    long result = 0;
+    std::size_t count = s_paths.size();
+    for (long i = 0; i < iterations; ++i)
+    {
+        const std::string & path = s_paths[std::size_t(i) % count];
+        result += long(osc::tag_reverse_lookup(path));
+    }
+
+    return result;
+}
+
+long
+bench_tag_reverse_lookup_pattern (long iterations)
+{
+    static std::vector<osc::messagepair> s_pairs;
+    if (s_pairs.empty())
+    {
+        for (const auto & m : osc::all_messages())
+            s_pairs.push_back(m.second);
+    }
+    long result = 0;
+    std::size_t count = s_pairs.size();
+    for (long i = 0; i < iterations; ++i)
+    {
+        const osc::messagepair & mp = s_pairs[std::size_t(i) % count];
+        result += long
+        (
+            osc::tag_reverse_lookup(mp.msg_text, mp.msg_pattern)
+        );
+    }
+    return result;
+}
+
+/**
+ *  Sends the same message to the sink a number of times, using one of the
+ *  lowrapper::send() overloads; see the callers.
+ */
+
+template <typename F>
+long
+bench_send (long iterations, F sendfunc)
+{
+    lo_address to = sink().address();
+    if (to == nullptr)
+        return (-1);
+
+    long result = 0;
+    for (long i = 0; i < iterations; ++i)
+    {
+        if (sendfunc(sender(), to, int(i)) >= 0)
+            ++result;
+
+        if ((i & 255) == 255)
+            sink().drain();
+    }
+    sink().drain();
+    return result;
+}
+
+long
+bench_send_int (long iterations)
+{
+    return bench_send
+    (
+        iterations, [] (bench_peer & s, lo_address to, int i)
+        {
+            return s.send(to, "/bench/int", i);
+        }
+    );
+}
+
+long
+bench_send_float (long iterations)
+{
+    return bench_send
+    (
+        iterations, [] (bench_peer & s, lo_address to, int i)
+        {
+            return s.send(to, "/bench/float", float(i) * 0.5f);
+        }
+    );
+}
+
+long
+bench_send_string (long iterations)
+{
+    static const std::string s_text { "A label of some length" };
+    return bench_send
+    (
+        iterations, [] (bench_peer & s, lo_address to, int /*i*/)
+        {
+            return s.send(to, "/nsm/client/label", s_text);
+        }
+    );
+}
+
+long
+bench_send_strings (long iterations)
+{
+    static const std::string s_v1 { "/nsm/server/announce" };
+    static const std::string s_v2 { "Howdy, what took you so long?" };
+    static const std::string s_v3 { "nsmd" };
+    return bench_send
+    (
+        iterations, [] (bench_peer & s, lo_address to, int /*i*/)
+        {
+            return s.send_strings(to, "/reply", "sss", s_v1, s_v2, s_v3);
+        }
+    );
+}
+
+long
+bench_send_announce (long iterations)
+{
+    static const std::string s_name { "Bench Client" };
+    static const std::string s_caps { ":switch:dirty:progress:" };
+    static const std::string s_exe { "nsm_bench" };
+    return bench_send
+    (
+        iterations, [] (bench_peer & s, lo_address to, int i)
+        {
+            return s.send
+            (
+                to, "/nsm/server/announce", s_name, s_caps, s_exe, 1, 2, i
+            );
+        }
+    );
+}
+
+/**
+ *  Client-to-server-to-client round trips over 127.0.0.1, one at a time,
+ *  between two bare lowrapper objects; no endpoint is involved.
+ */
+
+long
+bench_lowrapper_round_trip (long iterations)
+{
+    static bench_peer s_client;
+    static bench_peer s_server;
+    static bool s_ok = s_client.init(LO_UDP) && s_server.init(LO_UDP);
+    static lo_address s_to = s_ok ?
+        lo_address_new_from_url(s_server.url().c_str()) : nullptr ;
+
+    if (s_to == nullptr)
+        return (-1);
+
+    const int s_timeout_ms = 1000;
+    long start = s_client.pongs();
+    for (long i = 0; i < iterations; ++i)
+    {
+        long expected = s_client.pongs() + 1;
+        if (s_client.send(s_to, "/bench/ping", int(i)) < 0)
+            return (-1);
+
+        s_server.pump(s_timeout_ms);
+        s_client.pump(s_timeout_ms);
+        if (s_client.pongs() != expected)
+            return (-1);                                /* lost a message   */
+    }
+    return s_client.pongs() - start;
+}
+
+/**
+ *  Sends one float to N destinations per operation, with
+ *  lowrapper::send_to_all(); no signal is involved.
+ */
+
+long
+bench_send_to_all (long iterations, std::size_t peers)
+{
+    lo_address to = sink().address();
+    if (to == nullptr)
+        return (-1);
+
+    std::vector<lo_address> dests(peers, to);
+    long result = 0;
+    long drainevery = long(256 / peers) + 1;
+    for (long i = 0; i < iterations; ++i)
+    {
+        result += sender().send_to_all(dests, "/bench/signal", float(i));
+        if (i % drainevery == 0)
+            sink().drain();
+    }
+    sink().drain();
+    return result;
+}
+
+long
+bench_send_to_all_1 (long iterations)
+{
+    return bench_send_to_all(iterations, 1);
+}
+
+long
+bench_send_to_all_8 (long iterations)
+{
+    return bench_send_to_all(iterations, 8);
+}
+
+long
+bench_send_to_all_64 (long iterations)
+{
+    return bench_send_to_all(iterations, 64);
+}
+
+/**
+ *  An endpoint with s_endpoint_peers peers, all of them the sink, and one
+ *  output signal, made on first use. The peers are added the way a
+ *  "/signal/hello" adds them.
+ */
+
+const int s_endpoint_peers = 8;
+
+osc::endpoint &
+bench_endpoint ()
+{
+    static osc::endpoint s_endpoint;
+    return s_endpoint;
+}
+
+osc::signal *
+endpoint_signal ()
+{
+    osc::endpoint & s_endpoint = bench_endpoint();
+    static osc::signal * s_signal = nullptr;
+    static bool s_tried = false;
+    if (! s_tried)
+    {
+        s_tried = true;
+        lo_address to = sink().address();
+        if (to != nullptr && s_endpoint.init(LO_UDP))
+        {
+            char * url = lo_address_get_url(to);
+            s_endpoint.name("bench");
+            for (int i = 0; i < s_endpoint_peers; ++i)
+                s_endpoint.handle_hello("peer-" + std::to_string(i), url);
+
+            std::free(url);
+            s_signal = s_endpoint.add_signal
+            (
+                "/bench/out", osc::signal::output, 0.0f, 1.0e9f, 0.0f,
+                nullptr, nullptr
+            );
+            sink().drain();
+        }
+    }
+    return s_signal;
+}
+
+/**
+ *  Sets one value per operation through signal::value(). The deadband, if
+ *  any, is smaller than the step, so every value goes out.
+ *
+ * \param deadband
+ *      If not 0, the value goes through the endpoint's send_gated().
+ *
+ * \param batched
+ *      If true, batching is on and each value is flushed as a bundle.
+ */
+
+long
+bench_endpoint_fanout (long iterations, float deadband, bool batched)
+{
+    osc::signal * s = endpoint_signal();
+    if (s == nullptr)
+        return (-1);
+
+    osc::endpoint * ep = &bench_endpoint();
+    s->set_parameter_limits(0.0f, 1.0e9f, 0.0f, deadband);
+    if (batched)
+        ep->batching(true);
+
+    long result = 0;
+    long drainevery = long(256 / s_endpoint_peers) + 1;
+    for (long i = 0; i < iterations; ++i)
+    {
+        s->value(float(i + 1));
+        if (batched)
+            result += ep->flush();
+        else
+            ++result;
+
+        if (i % drainevery == 0)
+            sink().drain();
+    }
+    if (batched)
+        ep->batching(false);
+
+    sink().drain();
+    return result;
+}
+
+long
+bench_endpoint_fanout_direct (long iterations)
+{
+    return bench_endpoint_fanout(iterations, 0.0f, false);
+}
+
+long
+bench_endpoint_fanout_gated (long iterations)
+{
+    return bench_endpoint_fanout(iterations, 0.5f, false);
+}
+
+long
+bench_endpoint_fanout_batched (long iterations)
+{
+    return bench_endpoint_fanout(iterations, 0.0f, true);
+}
+
+long
+bench_parse_session_lines (long iterations)
+{
+    long result = 0;
+    for (long i = 0; i < iterations; ++i)
+    {
+        nsm::session_triplets trips;
+        std::string errmsg;
+        if (! nsm::parse_session_lines(s_session_file, trips, errmsg))
+            return (-1);
+
+        result += long(trips.size());
+    }
+    return result;
+}
+
+long
+bench_process_patch (long iterations)
+{
+    static std::vector<std::string> s_lines;
+    if (s_lines.empty())
+    {
+        std::ifstream in(s_patch_file);
+        std::string line;
+        while (std::getline(in, line))
+            s_lines.push_back(line);
+
+        if (s_lines.empty())
+            return (-1);
+    }
+
+    long result = 0;
+    std::string lc, lp, rc, rp;
+    for (long i = 0; i < iterations; ++i)
+    {
+        for (const auto & line : s_lines)
+        {
+            nsm::patch_direction d = nsm::process_patch(line, lc, lp, rc, rp);
+            if (d != nsm::patch_direction::error)
+                ++result;
+        }
+    }
+    return result;
+}
+
+/**
+ *  The benchmark table. The divisor scales down the iteration count of
+ *  the slower benchmarks, and the items are the number of messages,
+ *  clients, or lines handled in one operation.
+ */
+
+const benchmark s_benchmarks [] =
+{
+    { "tag_reverse_lookup",         bench_tag_reverse_lookup,          1,  1 },
+    { "tag_reverse_lookup_pattern", bench_tag_reverse_lookup_pattern,  1,  1 },
+    { "lowrapper_send_i",           bench_send_int,                   10,  1 },
+    { "lowrapper_send_f",           bench_send_float,                 10,  1 },
+    { "lowrapper_send_s",           bench_send_string,                10,  1 },
+    { "lowrapper_send_strings_sss", bench_send_strings,               10,  1 },
+    { "lowrapper_send_sssiii",      bench_send_announce,              10,  1 },
+    { "lowrapper_round_trip",       bench_lowrapper_round_trip,      100,  2 },
+    { "send_to_all_1",              bench_send_to_all_1,              10,  1 },
+    { "send_to_all_8",              bench_send_to_all_8,              50,  8 },
+    { "send_to_all_64",             bench_send_to_all_64,            200, 64 },
+    {
+        "endpoint_fanout_8",        bench_endpoint_fanout_direct,
+        50, s_endpoint_peers
+    },
+    {
+        "endpoint_fanout_8_gated",  bench_endpoint_fanout_gated,
+        50, s_endpoint_peers
+    },
+    {
+        "endpoint_fanout_8_batched", bench_endpoint_fanout_batched,
+        50, s_endpoint_peers
+    },
+    {
+        "parse_session_lines",      bench_parse_session_lines,
+        1000, s_session_clients
+    },
+    {
+        "process_patch",            bench_process_patch,
+        5000, s_patch_lines
+    }
+};
+
+/**
+ *  Runs one benchmark: once to warm up, then the given number of times.
+ */
+
+bench_result
+run_benchmark (const benchmark & b, long iterations, int repeat)
+{
+    bench_result result;
+    result.br_name = b.b_name;
+    result.br_iterations = iterations / b.b_divisor;
+    if (result.br_iterations < 1)
+        result.br_iterations = 1;
+
+    result.br_items = b.b_items;
+    result.br_best_ns = result.br_median_ns = 0.0;
+    result.br_ok = b.b_function(result.br_iterations) >= 0;   /* warm-up  */
+    if (! result.br_ok)
+        return result;
+
+    std::vector<double> times;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto t0 = bench_clock::now();
+        long check = b.b_function(result.br_iterations);
+        auto t1 = bench_clock::now();
+        if (check < 0)
+        {
+            result.br_ok = false;
+            return result;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>
+        (
+            t1 - t0
+        );
+        double ns = double(elapsed.count());
+        times.push_back(ns / double(result.br_iterations));
+    }
+    std::sort(times.begin(), times.end());
+    result.br_best_ns = times.front();
+    result.br_median_ns = times[times.size() / 2];
+    return result;
+}
+
+std::string
+json_report
+(
+    const std::vector<bench_result> & results,
+    long iterations, int repeat
+)
+{
+    std::ostringstream os;
+    os.setf(std::ios::fixed);
+    os.precision(1);
+    os  << "{\n"
+        << "  \"library\": \"nsm66\",\n"
+        << "  \"version\": \"" << nsm66_version() << "\",\n"
+        << "  \"iterations\": " << iterations << ",\n"
+        << "  \"repeat\": " << repeat << ",\n"
+        << "  \"benchmarks\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const bench_result & r = results[i];
+        double opspersec = r.br_best_ns > 0.0 ? 1.0e9 / r.br_best_ns : 0.0 ;
+        os  << "    {\n"
+            << "      \"name\": \"" << r.br_name << "\",\n"
+            << "      \"ok\": " << (r.br_ok ? "true" : "false") << ",\n"
+            << "      \"iterations\": " << r.br_iterations << ",\n"
+            << "      \"items_per_op\": " << r.br_items << ",\n"
+            << "      \"best_ns_per_op\": " << r.br_best_ns << ",\n"
+            << "      \"median_ns_per_op\": " << r.br_median_ns << ",\n"
+            << "      \"ops_per_sec\": " << opspersec << "\n"
+            << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+    return os.str();
+}
+
+const std::string s_help
+{
+    "nsm_bench: benchmarks of the nsm66 library, with JSON output.\n\n"
+    "  --iterations N   Operations per run of the fast benchmarks [200000].\n"
+    "  --repeat N       Timed runs of each benchmark; the best and the\n"
+    "                   median are reported [5].\n"
+    "  --filter text    Run only the benchmarks whose names contain text.\n"
+    "  --output file    Write the JSON there instead of to stdout.\n"
+    "  --list           List the benchmarks.\n"
+    "  --help           Show this help.\n"
+};
+
+}               // namespace anonymous
+
+/*
+ * main() routine
+ */
+
+int
+main (int argc, char * argv [])
+{
+    cfg::set_client_name("nsm66");                  /* for error_message()  */
+    cfg::set_app_version("0.1.0");
+
+    long iterations = 200000;
+    int repeat = 5;
+    std::string filter;
+    std::string outfile;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string opt = argv[i];
+        bool hasvalue = i + 1 < argc;
+        if (opt == "--help" || opt == "-h")
+        {
+            std::cout << s_help;
+            return EXIT_SUCCESS;
+        }
+        else if (opt == "--list")
+        {
+            for (const auto & b : s_benchmarks)
+                std::cout << b.b_name << "\n";
+
+            return EXIT_SUCCESS;
+        }
+        else if (opt == "--iterations" && hasvalue)
+            iterations = std::atol(argv[++i]);
+        else if (opt == "--repeat" && hasvalue)
+            repeat = std::atoi(argv[++i]);
+        else if (opt == "--filter" && hasvalue)
+            filter = argv[++i];
+        else if (opt == "--output" && hasvalue)
+            outfile = argv[++i];
+        else
+        {
+            util::error_message("Bad option", opt);
+            std::cerr << s_help;
+            return EXIT_FAILURE;
+        }
+    }
+    if (iterations < 1 || repeat < 1)
+    {
+        util::error_message("Iterations and repeat must be positive");
+        return EXIT_FAILURE;
+    }
+    if (! write_session_file() || ! write_patch_file())
+    {
+        util::error_message("Cannot write the generated input files");
+        return EXIT_FAILURE;
+    }
+
+    bool success = true;
+    std::vector<bench_result> results;
+    for (const auto & b : s_benchmarks)
+    {
+        bool skip = ! filter.empty() &&
+            std::string(b.b_name).find(filter) == std::string::npos;
+
+        if (skip)
+            continue;
+
+        results.push_back(run_benchmark(b, iterations, repeat));
+        if (! results.back().br_ok)
+        {
+            util::error_message("Benchmark failed", b.b_name);
+            success = false;
+        }
+    }
+    (void) std::remove(s_session_file.c_str());
+    (void) std::remove(s_patch_file.c_str());
+
+    std::string report = json_report(results, iterations, repeat);
+    if (outfile.empty())
+    {
+        std::cout << report;
+    }
+    else
+    {
+        std::ofstream out(outfile);
+        out << report;
+        if (! out)
+        {
+            util::error_message("Cannot write", outfile);
+            success = false;
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
+
+/*
+ * nsm_bench.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
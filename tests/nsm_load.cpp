@@ -0,0 +1,1342 @@
+/*
+ *  This file is part of nsm66.
+ *
+ *  nsm66 is free software; you can redistribute it and/or modify it under the
+ *  terms of the GNU General Public License as published by the Free Software
+ *  Foundation; either version 2 of the License, or (at your option) any later
+ *  version.
+ *
+ *  nsm66 is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with nsm66; if not, write to the Free Software Foundation, Inc., 59 Temple
+ *  Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * \file          nsm_load.cpp
+ *
+ *      A load generator: a simulated nsmd and N fake nsmclient objects in
+ *      one process, to find out how many clients nsm66 can handle.
+ *
+ * \library       nsm66
+ * \author        Chris Ahlstrom
+ * \date          2026-10-14
+ * \updates       2026-10-15
+ * \license       See above.
+ *
+ * Instructions:
+ *
+ *      ./build/tests/nsm_load [--clients 200,500,1000] [--duration S]
+ *          [--output file.json] [other options; see --help]
+ *
+ *      Each client count in the list is a separate run, with a fresh
+ *      server and clients. A run has these phases:
+ *
+ *      -#  The clients are made. Each is an nsm::nsmclient, with its own
+ *          liblo server thread, as in a real session.
+ *      -#  An nsm::nsmcontroller, as nsmctl uses, is attached to the
+ *          simulated server as its GUI.
+ *      -#  The clients announce, at the given rate. The simulated server
+ *          replies and sends "/nsm/client/open"; the time from the
+ *          announce to the open is the announce latency.
+ *      -#  For the given duration, the clients send progress, dirty and
+ *          clean states, and signals ("/nsm66/load/signal") at the
+ *          given rates. Meanwhile the server pings each client
+ *          ("/nsm66/load/ping", answered with "/nsm66/load/pong") and
+ *          asks it to save ("/nsm/client/save", answered with "/reply").
+ *          The ping and save times are the end-to-end latencies, through
+ *          the client's OSC thread and back.
+ *      -#  A short drain, then the counts are compared. A message is lost
+ *          if the client sent it (see osc::metrics) but the server did
+ *          not get it, or if the server sent a ping or save and did not
+ *          get the answer.
+ *
+ *      As nsmd does, the server tells the controller about each client:
+ *      "/nsm/gui/client/new" and "status" when it announces, "progress"
+ *      and "dirty" as the client sends them, and "status" again after
+ *      each save.
+ *
+ *      The "daemon" CPU is that of the simulated server's thread alone,
+ *      which does all of the session-manager work; the "controller" CPU
+ *      is that of the controller's OSC thread, found in /proc (Linux);
+ *      the process CPU includes all of the clients too.
+ *
+ *      A run is "healthy" if its loss and its 99th-percentile ping time
+ *      are within the limits. All traffic is UDP on 127.0.0.1.
+ *
+ *      Each client uses a socket and a thread, so large runs may need a
+ *      larger "ulimit -n".
+ */
+
+#include <algorithm>                    /* std::sort()                      */
+#include <atomic>                       /* std::atomic<>                    */
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <cstdint>                      /* std::uint32_t, std::int64_t      */
+#include <cstdlib>                      /* EXIT_SUCCESS, std::atof(), free  */
+#include <ctime>                        /* clock_gettime(2)                 */
+#include <dirent.h>                     /* opendir(3), readdir(3)           */
+#include <fstream>                      /* std::ofstream                    */
+#include <iostream>                     /* std::cout                        */
+#include <memory>                       /* std::unique_ptr<>                */
+#include <sstream>                      /* std::ostringstream               */
+#include <string>                       /* std::string                      */
+#include <sys/resource.h>               /* getrusage(2)                     */
+#include <thread>                       /* std::thread                      */
+#include <unistd.h>                     /* sysconf(3)                       */
+#include <unordered_map>                /* std::unordered_map<>             */
+#include <vector>                       /* std::vector<>                    */
+
+#include "c_macros.h"                   /* not_nullptr(), is_nullptr()      */
+#include "nsm66.hpp"                    /* nsm66_version()                  */
+#include "cfg/appinfo.hpp"              /* cfg::set_client_name()           */
+#include "nsm/nsmclient.hpp"            /* nsm::nsmclient class             */
+#include "nsm/nsmcontroller.hpp"        /* nsm::nsmcontroller class         */
+#include "osc/lowrapper.hpp"            /* osc::lowrapper class             */
+#include "osc/metrics.hpp"              /* osc::metrics class               */
+#include "util/msgfunctions.hpp"        /* util::error_message()            */
+
+namespace
+{
+
+using load_clock = std::chrono::steady_clock;
+using samples = std::vector<std::uint32_t>;     /* microseconds             */
+
+const char * const s_signal_path = "/nsm66/load/signal";
+const char * const s_ping_path = "/nsm66/load/ping";
+const char * const s_pong_path = "/nsm66/load/pong";
+
+/**
+ *  The settings of a run; see s_help.
+ */
+
+struct load_settings
+{
+    std::vector<int> ls_clients;
+    double ls_duration_s;
+    double ls_announce_rate;
+    double ls_progress_hz;
+    double ls_dirty_hz;
+    double ls_signal_hz;
+    double ls_ping_hz;
+    double ls_save_interval_s;
+    int ls_announce_timeout_ms;
+    int ls_drain_ms;
+    double ls_max_loss;
+    double ls_max_p99_ms;
+};
+
+/**
+ *  The outcome of one run.
+ */
+
+struct load_result
+{
+    int lr_clients;
+    int lr_started;
+    int lr_announced;
+    samples lr_announce_us;
+    samples lr_ping_us;
+    samples lr_save_us;
+    std::uint64_t lr_pings_sent;
+    std::uint64_t lr_saves_sent;
+    std::uint64_t lr_client_sent;       /* progress, dirty/clean, signals   */
+    std::uint64_t lr_server_received;
+    std::uint64_t lr_expected;          /* all of the messages above        */
+    std::uint64_t lr_lost;
+    std::uint64_t lr_send_failures;
+    double lr_seconds;
+    double lr_daemon_cpu;               /* percent of one CPU               */
+    double lr_controller_cpu;
+    double lr_process_cpu;
+    bool lr_healthy;
+};
+
+std::int64_t
+microseconds (load_clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+load_clock::duration
+period_of (double hz)
+{
+    return std::chrono::duration_cast<load_clock::duration>
+    (
+        std::chrono::duration<double>(hz > 0.0 ? 1.0 / hz : 0.0)
+    );
+}
+
+/**
+ *  The CPU time of the calling thread, or of the process, in seconds.
+ */
+
+double
+thread_cpu_seconds ()
+{
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+
+    return double(ts.tv_sec) + double(ts.tv_nsec) * 1.0e-9;
+}
+
+double
+process_cpu_seconds ()
+{
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0.0;
+
+    return double(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+        double(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1.0e-6;
+}
+
+/**
+ *  The IDs of the threads of this process, from /proc. The controller
+ *  does not show its OSC thread, so run_load() takes it to be the thread
+ *  that nsmcontroller::init_osc() adds.
+ */
+
+std::vector<long>
+thread_ids ()
+{
+    std::vector<long> result;
+    DIR * dir = ::opendir("/proc/self/task");
+    if (not_nullptr(dir))
+    {
+        while (const struct dirent * de = ::readdir(dir))
+        {
+            long tid = std::atol(de->d_name);
+            if (tid > 0)
+                result.push_back(tid);
+        }
+        (void) ::closedir(dir);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ *  The CPU time (user and system) of a thread of this process, in
+ *  seconds, from fields 14 and 15 of its /proc stat file. The fields
+ *  are counted after the command name, which can hold spaces.
+ */
+
+double
+task_cpu_seconds (long tid)
+{
+    std::ifstream f("/proc/self/task/" + std::to_string(tid) + "/stat");
+    std::string text;
+    if (! std::getline(f, text))
+        return 0.0;
+
+    std::size_t paren = text.rfind(')');
+    if (paren == std::string::npos)
+        return 0.0;
+
+    std::istringstream is(text.substr(paren + 1));
+    std::string field;
+    for (int i = 3; i < 14; ++i)
+        is >> field;
+
+    unsigned long long utime = 0, stime = 0;
+    if (! (is >> utime >> stime))
+        return 0.0;
+
+    return double(utime + stime) / double(sysconf(_SC_CLK_TCK));
+}
+
+/**
+ *  An exact percentile of the samples, which are sorted in place.
+ */
+
+std::uint32_t
+percentile (samples & s, double fraction)
+{
+    if (s.empty())
+        return 0;
+
+    std::sort(s.begin(), s.end());
+    std::size_t n = s.size();
+    std::size_t i = std::size_t(double(n) * fraction);
+    return s[i < n ? i : n - 1];
+}
+
+/**
+ *  The simulated nsmd. It runs on its own thread, which is the only one
+ *  that touches the clients and counters below, until it is stopped. It
+ *  answers the announces the way nsmd does, counts what the clients send,
+ *  and, while the load is on, sends the pings and saves.
+ */
+
+class sim_server : public osc::lowrapper
+{
+
+private:
+
+    struct sim_client
+    {
+        lo_address sc_address;
+        std::string sc_id;
+        load_clock::time_point sc_ping_due;
+        load_clock::time_point sc_ping_sent;
+        int sc_ping_seq;
+        bool sc_ping_outstanding;
+        load_clock::time_point sc_save_due;
+        load_clock::time_point sc_save_sent;
+        bool sc_save_outstanding;
+    };
+
+    load_settings m_settings;
+    std::vector<sim_client> m_clients;
+    std::unordered_map<std::string, int> m_by_port;
+    lo_address m_gui;                   /* the controller, once announced   */
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_loading;
+    std::uint64_t m_received;           /* progress, dirty/clean, signals   */
+    std::uint64_t m_pings_sent;
+    std::uint64_t m_saves_sent;
+    std::uint64_t m_unknown;
+    samples m_ping_us;
+    samples m_save_us;
+    double m_cpu_seconds;
+    double m_cpu_start;
+    bool m_was_loading;
+
+public:
+
+    sim_server (const load_settings & ls) :
+        osc::lowrapper      (),
+        m_settings          (ls),
+        m_clients           (),
+        m_by_port           (),
+        m_gui               (nullptr),
+        m_thread            (),
+        m_stop              (false),
+        m_loading           (false),
+        m_received          (0),
+        m_pings_sent        (0),
+        m_saves_sent        (0),
+        m_unknown           (0),
+        m_ping_us           (),
+        m_save_us           (),
+        m_cpu_seconds       (0.0),
+        m_cpu_start         (0.0),
+        m_was_loading       (false)
+    {
+        // no code
+    }
+
+    virtual ~sim_server ()
+    {
+        stop();
+        for (auto & c : m_clients)
+            lo_address_free(c.sc_address);
+
+        if (not_nullptr(m_gui))
+            lo_address_free(m_gui);
+    }
+
+    bool start ()
+    {
+        if (! init(LO_UDP))
+            return false;
+
+        m_thread = std::thread(&sim_server::run, this);
+        return true;
+    }
+
+    void stop ()
+    {
+        m_stop = true;
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void loading (bool flag)
+    {
+        m_loading = flag;
+    }
+
+    /*
+     * The rest may be called only after stop().
+     */
+
+    std::uint64_t received () const
+    {
+        return m_received;
+    }
+
+    std::uint64_t pings_sent () const
+    {
+        return m_pings_sent;
+    }
+
+    std::uint64_t saves_sent () const
+    {
+        return m_saves_sent;
+    }
+
+    samples & ping_times ()
+    {
+        return m_ping_us;
+    }
+
+    samples & save_times ()
+    {
+        return m_save_us;
+    }
+
+    double cpu_seconds () const
+    {
+        return m_cpu_seconds;
+    }
+
+protected:
+
+    virtual void add_methods (void * /*userdata*/) override;
+
+private:
+
+    void run ();
+    void start_load (load_clock::time_point now);
+    void send_due (load_clock::time_point now);
+    void announced (lo_address source);
+    void update_gui (const char * path, lo_arg ** argv, lo_message msg);
+    sim_client * find (lo_message msg);
+
+    static int osc_announce
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+    static int osc_gui_announce
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+    static int osc_counted
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+    static int osc_pong
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+    static int osc_reply
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+    static int osc_unknown
+    (
+        const char * path, const char * types, lo_arg ** argv,
+        int argc, lo_message msg, void * userdata
+    );
+
+};          // class sim_server
+
+void
+sim_server::add_methods (void * /*userdata*/)
+{
+    static const char * const s_counted [][2] =
+    {
+        { "/nsm/client/progress",   "f" },
+        { "/nsm/client/is_dirty",   ""  },
+        { "/nsm/client/is_clean",   ""  },
+        { s_signal_path,            "i" }
+    };
+    (void) lo_server_add_method
+    (
+        server(), "/nsm/server/announce", "sssiii",
+        &sim_server::osc_announce, this
+    );
+    (void) lo_server_add_method
+    (
+        server(), "/nsm/gui/gui_announce", "",
+        &sim_server::osc_gui_announce, this
+    );
+    for (const auto & c : s_counted)
+    {
+        (void) lo_server_add_method
+        (
+            server(), c[0], c[1], &sim_server::osc_counted, this
+        );
+    }
+    (void) lo_server_add_method
+    (
+        server(), s_pong_path, "i", &sim_server::osc_pong, this
+    );
+    (void) lo_server_add_method
+    (
+        server(), "/reply", "ss", &sim_server::osc_reply, this
+    );
+    (void) lo_server_add_method
+    (
+        server(), NULL, NULL, &sim_server::osc_unknown, this
+    );
+}
+
+/**
+ *  The server loop. It waits at most a millisecond for messages, so that
+ *  the pings and saves go out close to when they are due.
+ */
+
+void
+sim_server::run ()
+{
+    while (! m_stop)
+    {
+        if (lo_server_wait(server(), 1))
+            (void) receive_ready(server());
+
+        bool nowloading = m_loading;
+        auto now = load_clock::now();
+        if (nowloading && ! m_was_loading)
+        {
+            start_load(now);
+            m_cpu_start = thread_cpu_seconds();
+        }
+        else if (! nowloading && m_was_loading)
+        {
+            m_cpu_seconds = thread_cpu_seconds() - m_cpu_start;
+        }
+        m_was_loading = nowloading;
+        if (nowloading)
+            send_due(now);
+    }
+}
+
+/**
+ *  Spreads the first ping and save of each client across one period, so
+ *  that they do not all go out at once.
+ */
+
+void
+sim_server::start_load (load_clock::time_point now)
+{
+    auto pingperiod = period_of(m_settings.ls_ping_hz);
+    auto saveperiod = period_of
+    (
+        m_settings.ls_save_interval_s > 0.0 ?
+            1.0 / m_settings.ls_save_interval_s : 0.0
+    );
+    long count = long(m_clients.size());
+    for (long i = 0; i < count; ++i)
+    {
+        sim_client & c = m_clients[std::size_t(i)];
+        c.sc_ping_due = now + pingperiod * i / count;
+        c.sc_save_due = now + saveperiod * i / count;
+    }
+}
+
+void
+sim_server::send_due (load_clock::time_point now)
+{
+    auto pingperiod = period_of(m_settings.ls_ping_hz);
+    auto saveperiod = period_of
+    (
+        m_settings.ls_save_interval_s > 0.0 ?
+            1.0 / m_settings.ls_save_interval_s : 0.0
+    );
+    for (auto & c : m_clients)
+    {
+        if (m_settings.ls_ping_hz > 0.0 && now >= c.sc_ping_due)
+        {
+            c.sc_ping_due += pingperiod;
+            if (! c.sc_ping_outstanding)    /* else it counts as lost   */
+            {
+                ++c.sc_ping_seq;
+                c.sc_ping_sent = load_clock::now();
+                if (send(c.sc_address, s_ping_path, c.sc_ping_seq) >= 0)
+                    c.sc_ping_outstanding = true;
+            }
+            ++m_pings_sent;
+        }
+        if (m_settings.ls_save_interval_s > 0.0 && now >= c.sc_save_due)
+        {
+            c.sc_save_due += saveperiod;
+            if (! c.sc_save_outstanding)
+            {
+                c.sc_save_sent = load_clock::now();
+                if (send(c.sc_address, "/nsm/client/save") >= 0)
+                    c.sc_save_outstanding = true;
+            }
+            ++m_saves_sent;
+        }
+    }
+}
+
+/**
+ *  Adds the client, then replies as nsmd does: a "/reply" to the announce,
+ *  then the "/nsm/client/open". The controller, if any, is told of the
+ *  new client.
+ */
+
+void
+sim_server::announced (lo_address source)
+{
+    char * u = lo_address_get_url(source);
+    if (is_nullptr(u))
+        return;
+
+    lo_address a = lo_address_new_from_url(u);
+    std::free(u);                       /* liblo uses malloc()          */
+    if (is_nullptr(a))
+        return;
+
+    int index = int(m_clients.size());
+    std::string id = "n" + std::to_string(index);
+    sim_client c;
+    c.sc_address = a;
+    c.sc_id = id;
+    c.sc_ping_seq = 0;
+    c.sc_ping_outstanding = false;
+    c.sc_save_outstanding = false;
+    m_clients.push_back(c);
+    m_by_port[lo_address_get_port(a)] = index;
+    (void) send
+    (
+        a, "/reply", "/nsm/server/announce", "Welcome to the load test",
+        "nsm_load", ":server-control:"
+    );
+    (void) send(a, "/nsm/client/open", "/tmp/nsm-load/" + id, "load", id);
+    if (not_nullptr(m_gui))
+    {
+        (void) send(m_gui, "/nsm/gui/client/new", id, "nsm_load");
+        (void) send(m_gui, "/nsm/gui/client/status", id, "open");
+    }
+}
+
+/**
+ *  Passes a client's progress or dirty state on to the controller, as
+ *  nsmd does. Signals are not nsmd's business, and are not passed on.
+ */
+
+void
+sim_server::update_gui (const char * path, lo_arg ** argv, lo_message msg)
+{
+    sim_client * c = is_nullptr(m_gui) ? nullptr : find(msg) ;
+    if (is_nullptr(c))
+        return;
+
+    std::string p { path };
+    if (p == "/nsm/client/progress")
+        (void) send(m_gui, "/nsm/gui/client/progress", c->sc_id, argv[0]->f);
+    else if (p == "/nsm/client/is_dirty")
+        (void) send(m_gui, "/nsm/gui/client/dirty", c->sc_id, 1);
+    else if (p == "/nsm/client/is_clean")
+        (void) send(m_gui, "/nsm/gui/client/dirty", c->sc_id, 0);
+}
+
+sim_server::sim_client *
+sim_server::find (lo_message msg)
+{
+    lo_address source = lo_message_get_source(msg);
+    const char * port = not_nullptr(source) ?
+        lo_address_get_port(source) : nullptr ;
+
+    if (is_nullptr(port))
+        return nullptr;
+
+    auto it = m_by_port.find(port);
+    return it != m_by_port.end() ?
+        &m_clients[std::size_t(it->second)] : nullptr ;
+}
+
+int
+sim_server::osc_announce
+(
+    const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+    int /*argc*/, lo_message msg, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    lo_address source = lo_message_get_source(msg);
+    if (not_nullptr(source))
+        s->announced(source);
+
+    return 0;
+}
+
+/**
+ *  The controller's "/nsm/gui/gui_announce". It is answered with the
+ *  greeting, which makes the controller active.
+ */
+
+int
+sim_server::osc_gui_announce
+(
+    const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+    int /*argc*/, lo_message msg, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    lo_address source = lo_message_get_source(msg);
+    char * u = not_nullptr(source) ? lo_address_get_url(source) : nullptr ;
+    if (not_nullptr(u) && is_nullptr(s->m_gui))
+    {
+        s->m_gui = lo_address_new_from_url(u);
+        if (not_nullptr(s->m_gui))
+            (void) s->send(s->m_gui, "/nsm/gui/gui_announce", "hi");
+    }
+    std::free(u);
+    return 0;
+}
+
+int
+sim_server::osc_counted
+(
+    const char * path, const char * /*types*/, lo_arg ** argv,
+    int /*argc*/, lo_message msg, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    ++s->m_received;
+    s->update_gui(path, argv, msg);
+    return 0;
+}
+
+int
+sim_server::osc_pong
+(
+    const char * /*path*/, const char * /*types*/, lo_arg ** argv,
+    int /*argc*/, lo_message msg, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    sim_client * c = s->find(msg);
+    bool answer = not_nullptr(c) && c->sc_ping_outstanding &&
+        argv[0]->i == c->sc_ping_seq;
+
+    if (answer)
+    {
+        auto us = microseconds(load_clock::now() - c->sc_ping_sent);
+        c->sc_ping_outstanding = false;
+        s->m_ping_us.push_back(std::uint32_t(us));
+    }
+    return 0;
+}
+
+int
+sim_server::osc_reply
+(
+    const char * /*path*/, const char * /*types*/, lo_arg ** argv,
+    int /*argc*/, lo_message msg, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    sim_client * c = s->find(msg);
+    bool issave = std::string(&argv[0]->s) == "/nsm/client/save";
+    if (not_nullptr(c) && issave && c->sc_save_outstanding)
+    {
+        auto us = microseconds(load_clock::now() - c->sc_save_sent);
+        c->sc_save_outstanding = false;
+        s->m_save_us.push_back(std::uint32_t(us));
+        if (not_nullptr(s->m_gui))
+        {
+            (void) s->send
+            (
+                s->m_gui, "/nsm/gui/client/status", c->sc_id, "ready"
+            );
+        }
+    }
+    return 0;
+}
+
+int
+sim_server::osc_unknown
+(
+    const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+    int /*argc*/, lo_message /*msg*/, void * userdata
+)
+{
+    sim_server * s = static_cast<sim_server *>(userdata);
+    ++s->m_unknown;
+    return 0;
+}
+
+/**
+ *  A fake session client. It is a plain nsmclient, except that open()
+ *  does not set the process-wide client name (all of the clients share
+ *  the process), and it answers the server's pings. The driver thread
+ *  calls tick() to send the client's own traffic.
+ */
+
+class load_client : public nsm::nsmclient
+{
+
+private:
+
+    load_clock::time_point m_progress_due;
+    load_clock::time_point m_dirty_due;
+    load_clock::time_point m_signal_due;
+    float m_progress;
+    bool m_dirty_state;
+    int m_signal_seq;
+    std::uint64_t m_signals_sent;
+    load_clock::time_point m_announce_start;
+    std::atomic<std::int64_t> m_announce_us;
+
+public:
+
+    load_client (const std::string & url, int timeoutms) :
+        nsm::nsmclient      (url),
+        m_progress_due      (),
+        m_dirty_due         (),
+        m_signal_due        (),
+        m_progress          (0.0f),
+        m_dirty_state       (false),
+        m_signal_seq        (0),
+        m_signals_sent      (0),
+        m_announce_start    (),
+        m_announce_us       (-1)
+    {
+        (void) announce_timeout(timeoutms); /* the harness's own timeout    */
+    }
+
+    void start_announce ()
+    {
+        m_announce_start = load_clock::now();
+        (void) announce_async
+        (
+            "nsm_load", "nsm_load", ":dirty:progress:",
+            &load_client::announce_done, this
+        );
+    }
+
+    std::int64_t announce_us () const
+    {
+        return m_announce_us;
+    }
+
+    std::uint64_t signals_sent () const
+    {
+        return m_signals_sent;
+    }
+
+    void start_load (load_clock::time_point first);
+    void tick (const load_settings & ls, load_clock::time_point now);
+
+    virtual void open
+    (
+        const std::string & pathname,
+        const std::string & displayname,
+        const std::string & clientid
+    ) override
+    {
+        session_manager_path(pathname);
+        session_display_name(displayname);
+        session_client_id(clientid);
+        is_active(true);
+    }
+
+    virtual void handle_broadcast
+    (
+        const std::string & message,
+        const std::string & pattern,
+        const lib66::tokenization & argv
+    ) override;
+
+private:
+
+    static void announce_done (bool success, void * userdata);
+
+};          // class load_client
+
+void
+load_client::announce_done (bool success, void * userdata)
+{
+    load_client * c = static_cast<load_client *>(userdata);
+    if (success)
+    {
+        auto elapsed = load_clock::now() - c->m_announce_start;
+        c->m_announce_us = microseconds(elapsed);
+    }
+}
+
+void
+load_client::start_load (load_clock::time_point first)
+{
+    m_progress_due = m_dirty_due = m_signal_due = first;
+}
+
+/**
+ *  Sends whatever is due. The progress goes from 0 to 100 and around
+ *  again; the dirty state toggles, so that each tick sends one message.
+ */
+
+void
+load_client::tick (const load_settings & ls, load_clock::time_point now)
+{
+    if (ls.ls_progress_hz > 0.0 && now >= m_progress_due)
+    {
+        m_progress_due += period_of(ls.ls_progress_hz);
+        m_progress += 10.0f;
+        if (m_progress > 100.0f)
+            m_progress = 0.0f;
+
+        (void) progress(m_progress);
+    }
+    if (ls.ls_dirty_hz > 0.0 && now >= m_dirty_due)
+    {
+        m_dirty_due += period_of(ls.ls_dirty_hz);
+        m_dirty_state = ! m_dirty_state;
+        dirty(m_dirty_state);
+    }
+    if (ls.ls_signal_hz > 0.0 && now >= m_signal_due)
+    {
+        m_signal_due += period_of(ls.ls_signal_hz);
+        ++m_signal_seq;
+        if (osc::lowrapper::send(address(), s_signal_path, m_signal_seq) >= 0)
+            ++m_signals_sent;
+    }
+}
+
+void
+load_client::handle_broadcast
+(
+    const std::string & message,
+    const std::string & /*pattern*/,
+    const lib66::tokenization & argv
+)
+{
+    if (message == s_ping_path && argv.size() == 1)
+    {
+        int seq = std::atoi(argv[0].c_str());
+        (void) osc::lowrapper::send(address(), s_pong_path, seq);
+    }
+}
+
+/**
+ *  Does one run with the given number of clients.
+ */
+
+load_result
+run_load (const load_settings & ls, int clientcount)
+{
+    load_result result;
+    result.lr_clients = clientcount;
+    result.lr_started = result.lr_announced = 0;
+    result.lr_pings_sent = result.lr_saves_sent = 0;
+    result.lr_client_sent = result.lr_server_received = 0;
+    result.lr_expected = result.lr_lost = result.lr_send_failures = 0;
+    result.lr_seconds = result.lr_daemon_cpu = result.lr_process_cpu = 0;
+    result.lr_controller_cpu = 0;
+    result.lr_healthy = false;
+
+    sim_server srv(ls);
+    if (! srv.start())
+    {
+        util::error_message("Cannot start the simulated server");
+        return result;
+    }
+
+    /*
+     * The controller, before the clients, so that it hears of them all.
+     * Its address is freed only after it is gone.
+     */
+
+    std::string url = srv.url();
+    lo_address srvaddr = lo_address_new_from_url(url.c_str());
+    nsm::daemon_list daemons;
+    daemons.push_back(nsm::daemon(url, srvaddr));
+
+    std::unique_ptr<nsm::nsmcontroller> ctrler
+    (
+        new nsm::nsmcontroller(daemons)
+    );
+    std::vector<long> before = thread_ids();
+    long ctrltid = 0;
+    if (ctrler->init_osc())
+    {
+        for (long tid : thread_ids())
+        {
+            if (! std::binary_search(before.begin(), before.end(), tid))
+                ctrltid = tid;
+        }
+        ctrler->announce();
+    }
+    else
+        util::error_message("Cannot start the controller");
+
+    std::vector<std::unique_ptr<load_client>> clients;
+    for (int i = 0; i < clientcount; ++i)
+    {
+        std::unique_ptr<load_client> c(new load_client(url, ls.ls_announce_timeout_ms));
+        if (! c->initialize())
+        {
+            util::error_message("Client failed to start", std::to_string(i));
+            break;
+        }
+        clients.push_back(std::move(c));
+    }
+    result.lr_started = int(clients.size());
+
+    /*
+     * The announces, paced by the announce rate.
+     */
+
+    auto announcegap = period_of(ls.ls_announce_rate);
+    auto nextannounce = load_clock::now();
+    for (auto & c : clients)
+    {
+        if (ls.ls_announce_rate > 0.0)
+        {
+            std::this_thread::sleep_until(nextannounce);
+            nextannounce += announcegap;
+        }
+        c->start_announce();
+    }
+
+    auto deadline = load_clock::now() +
+        std::chrono::milliseconds(ls.ls_announce_timeout_ms);
+
+    for (auto & c : clients)
+    {
+        auto left = deadline - load_clock::now();
+        int ms = int(std::chrono::duration_cast<std::chrono::milliseconds>
+        (
+            left
+        ).count());
+        (void) c->wait_announce(ms > 0 ? ms : 0);
+        if (c->announce_us() >= 0)
+        {
+            ++result.lr_announced;
+            result.lr_announce_us.push_back(std::uint32_t(c->announce_us()));
+        }
+    }
+
+    /*
+     * The load. The driver (this thread) spreads the clients' first sends
+     * across a millisecond tick.
+     */
+
+    const auto tick = std::chrono::milliseconds(1);
+    auto start = load_clock::now();
+    auto end = start + std::chrono::duration_cast<load_clock::duration>
+    (
+        std::chrono::duration<double>(ls.ls_duration_s)
+    );
+    long count = long(clients.size());
+    for (long i = 0; i < count; ++i)
+    {
+        auto spread = std::chrono::milliseconds(1000) * i / (count * 4);
+        clients[std::size_t(i)]->start_load(start + spread);
+    }
+
+    double cpustart = process_cpu_seconds();
+    double ctrlstart = ctrltid > 0 ? task_cpu_seconds(ctrltid) : 0.0 ;
+    srv.loading(true);
+    for (auto now = start; now < end; now = load_clock::now())
+    {
+        for (auto & c : clients)
+        {
+            if (c->is_active())
+                c->tick(ls, now);
+        }
+        std::this_thread::sleep_until(now + tick);
+    }
+    srv.loading(false);
+    auto loadend = load_clock::now();
+    double cpuend = process_cpu_seconds();
+    double ctrlend = ctrltid > 0 ? task_cpu_seconds(ctrltid) : 0.0 ;
+    std::this_thread::sleep_for(std::chrono::milliseconds(ls.ls_drain_ms));
+    srv.stop();
+
+    /*
+     * The counts.
+     */
+
+    for (auto & c : clients)
+    {
+        const osc::metrics & m = c->stats();
+        result.lr_client_sent += m.sent_messages(osc::tag::cliprogress) +
+            m.sent_messages(osc::tag::clidirty) +
+            m.sent_messages(osc::tag::cliclean) + c->signals_sent();
+
+        result.lr_send_failures += m.send_failures();
+    }
+    result.lr_server_received = srv.received();
+    result.lr_pings_sent = srv.pings_sent();
+    result.lr_saves_sent = srv.saves_sent();
+    result.lr_ping_us = srv.ping_times();
+    result.lr_save_us = srv.save_times();
+    result.lr_expected = result.lr_client_sent + result.lr_pings_sent +
+        result.lr_saves_sent + std::uint64_t(clientcount);
+
+    std::uint64_t got = result.lr_server_received +
+        result.lr_ping_us.size() + result.lr_save_us.size() +
+        std::uint64_t(result.lr_announced);
+
+    result.lr_lost = result.lr_expected > got ? result.lr_expected - got : 0 ;
+    result.lr_seconds = double(microseconds(loadend - start)) * 1.0e-6;
+    if (result.lr_seconds > 0.0)
+    {
+        result.lr_daemon_cpu = srv.cpu_seconds() * 100.0 /
+            result.lr_seconds;
+
+        result.lr_controller_cpu = (ctrlend - ctrlstart) * 100.0 /
+            result.lr_seconds;
+
+        result.lr_process_cpu = (cpuend - cpustart) * 100.0 /
+            result.lr_seconds;
+    }
+
+    double loss = result.lr_expected > 0 ?
+        double(result.lr_lost) / double(result.lr_expected) : 1.0 ;
+
+    double p99ms = double(percentile(result.lr_ping_us, 0.99)) / 1000.0;
+    result.lr_healthy = result.lr_started == clientcount &&
+        result.lr_announced == clientcount && loss <= ls.ls_max_loss &&
+        (ls.ls_ping_hz <= 0.0 || p99ms <= ls.ls_max_p99_ms);
+
+    clients.clear();                    /* stop the client threads first    */
+    ctrler.reset();
+    lo_address_free(srvaddr);
+    return result;
+}
+
+void
+json_percentiles (std::ostringstream & os, const char * name, samples & s)
+{
+    os  << "      \"" << name << "\": { "
+        << "\"count\": " << s.size()
+        << ", \"p50\": " << percentile(s, 0.50)
+        << ", \"p90\": " << percentile(s, 0.90)
+        << ", \"p99\": " << percentile(s, 0.99)
+        << ", \"p999\": " << percentile(s, 0.999)
+        << ", \"max\": " << (s.empty() ? 0 : s.back())
+        << " },\n";
+}
+
+std::string
+json_report (const load_settings & ls, std::vector<load_result> & results)
+{
+    std::ostringstream os;
+    os.setf(std::ios::fixed);
+    os.precision(2);
+    int largest = 0;
+    for (const auto & r : results)
+    {
+        if (r.lr_healthy && r.lr_clients > largest)
+            largest = r.lr_clients;
+    }
+    os  << "{\n"
+        << "  \"library\": \"nsm66\",\n"
+        << "  \"version\": \"" << nsm66_version() << "\",\n"
+        << "  \"duration_s\": " << ls.ls_duration_s << ",\n"
+        << "  \"progress_hz\": " << ls.ls_progress_hz << ",\n"
+        << "  \"dirty_hz\": " << ls.ls_dirty_hz << ",\n"
+        << "  \"signal_hz\": " << ls.ls_signal_hz << ",\n"
+        << "  \"ping_hz\": " << ls.ls_ping_hz << ",\n"
+        << "  \"save_interval_s\": " << ls.ls_save_interval_s << ",\n"
+        << "  \"largest_healthy_clients\": " << largest << ",\n"
+        << "  \"runs\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        load_result & r = results[i];
+        double loss = r.lr_expected > 0 ?
+            double(r.lr_lost) / double(r.lr_expected) : 0.0 ;
+
+        os  << "    {\n"
+            << "      \"clients\": " << r.lr_clients << ",\n"
+            << "      \"started\": " << r.lr_started << ",\n"
+            << "      \"announced\": " << r.lr_announced << ",\n"
+            << "      \"healthy\": " << (r.lr_healthy ? "true" : "false")
+            << ",\n"
+            << "      \"seconds\": " << r.lr_seconds << ",\n";
+
+        json_percentiles(os, "announce_us", r.lr_announce_us);
+        json_percentiles(os, "ping_us", r.lr_ping_us);
+        json_percentiles(os, "save_us", r.lr_save_us);
+        os  << "      \"client_sent\": " << r.lr_client_sent << ",\n"
+            << "      \"server_received\": " << r.lr_server_received << ",\n"
+            << "      \"pings_sent\": " << r.lr_pings_sent << ",\n"
+            << "      \"saves_sent\": " << r.lr_saves_sent << ",\n"
+            << "      \"expected\": " << r.lr_expected << ",\n"
+            << "      \"lost\": " << r.lr_lost << ",\n"
+            << "      \"loss_percent\": " << loss * 100.0 << ",\n"
+            << "      \"send_failures\": " << r.lr_send_failures << ",\n"
+            << "      \"daemon_cpu_percent\": " << r.lr_daemon_cpu
+            << ",\n"
+            << "      \"controller_cpu_percent\": " << r.lr_controller_cpu
+            << ",\n"
+            << "      \"process_cpu_percent\": " << r.lr_process_cpu << "\n"
+            << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+    return os.str();
+}
+
+/**
+ *  A one-line summary of a run, for the console.
+ */
+
+std::string
+summary_line (load_result & r)
+{
+    std::ostringstream os;
+    os.setf(std::ios::fixed);
+    os.precision(1);
+    double loss = r.lr_expected > 0 ?
+        double(r.lr_lost) / double(r.lr_expected) : 0.0 ;
+
+    os  << r.lr_clients << " clients: "
+        << r.lr_announced << " announced; ping p50/p99 "
+        << double(percentile(r.lr_ping_us, 0.50)) / 1000.0 << "/"
+        << double(percentile(r.lr_ping_us, 0.99)) / 1000.0 << " ms; "
+        << "loss " << loss * 100.0 << "%; daemon CPU "
+        << r.lr_daemon_cpu << "%; controller CPU "
+        << r.lr_controller_cpu << "%; process CPU "
+        << r.lr_process_cpu << "% "
+        << (r.lr_healthy ? "[ok]" : "[OVERLOADED]");
+
+    return os.str();
+}
+
+bool
+parse_counts (const std::string & text, std::vector<int> & counts)
+{
+    counts.clear();
+    std::istringstream is(text);
+    std::string item;
+    while (std::getline(is, item, ','))
+    {
+        int n = std::atoi(item.c_str());
+        if (n < 1)
+            return false;
+
+        counts.push_back(n);
+    }
+    return ! counts.empty();
+}
+
+const std::string s_help
+{
+    "nsm_load: a simulated nsmd with N fake clients, to find the limits.\n\n"
+    "  --clients N,M,...   The client counts, one run each [200,500,1000].\n"
+    "  --duration S        Seconds of load per run [10].\n"
+    "  --announce-rate R   Announces per second; 0 is all at once [200].\n"
+    "  --progress-hz R     Progress messages per client per second [2].\n"
+    "  --dirty-hz R        Dirty/clean changes per client per second [0.5].\n"
+    "  --signal-hz R       Signals per client per second [10].\n"
+    "  --ping-hz R         Server pings per client per second [1].\n"
+    "  --save-interval S   Seconds between saves of a client; 0 is none [5].\n"
+    "  --max-loss P        The healthy limit of lost messages, percent [0.1].\n"
+    "  --max-p99 MS        The healthy limit of the p99 ping, ms [50].\n"
+    "  --output file       Also write the results there as JSON.\n"
+    "  --help              Show this help.\n"
+};
+
+}               // namespace anonymous
+
+/*
+ * main() routine
+ */
+
+int
+main (int argc, char * argv [])
+{
+    cfg::set_client_name("nsm66");                  /* for error_message()  */
+    cfg::set_app_version("0.1.0");
+
+    load_settings ls;
+    ls.ls_clients = { 200, 500, 1000 };
+    ls.ls_duration_s = 10.0;
+    ls.ls_announce_rate = 200.0;
+    ls.ls_progress_hz = 2.0;
+    ls.ls_dirty_hz = 0.5;
+    ls.ls_signal_hz = 10.0;
+    ls.ls_ping_hz = 1.0;
+    ls.ls_save_interval_s = 5.0;
+    ls.ls_announce_timeout_ms = 10000;
+    ls.ls_drain_ms = 500;
+    ls.ls_max_loss = 0.001;
+    ls.ls_max_p99_ms = 50.0;
+
+    std::string outfile;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string opt = argv[i];
+        bool hasvalue = i + 1 < argc;
+        if (opt == "--help" || opt == "-h")
+        {
+            std::cout << s_help;
+            return EXIT_SUCCESS;
+        }
+        else if (opt == "--clients" && hasvalue)
+        {
+            if (! parse_counts(argv[++i], ls.ls_clients))
+            {
+                util::error_message("Bad client counts", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (opt == "--duration" && hasvalue)
+            ls.ls_duration_s = std::atof(argv[++i]);
+        else if (opt == "--announce-rate" && hasvalue)
+            ls.ls_announce_rate = std::atof(argv[++i]);
+        else if (opt == "--progress-hz" && hasvalue)
+            ls.ls_progress_hz = std::atof(argv[++i]);
+        else if (opt == "--dirty-hz" && hasvalue)
+            ls.ls_dirty_hz = std::atof(argv[++i]);
+        else if (opt == "--signal-hz" && hasvalue)
+            ls.ls_signal_hz = std::atof(argv[++i]);
+        else if (opt == "--ping-hz" && hasvalue)
+            ls.ls_ping_hz = std::atof(argv[++i]);
+        else if (opt == "--save-interval" && hasvalue)
+            ls.ls_save_interval_s = std::atof(argv[++i]);
+        else if (opt == "--max-loss" && hasvalue)
+            ls.ls_max_loss = std::atof(argv[++i]) / 100.0;
+        else if (opt == "--max-p99" && hasvalue)
+            ls.ls_max_p99_ms = std::atof(argv[++i]);
+        else if (opt == "--output" && hasvalue)
+            outfile = argv[++i];
+        else
+        {
+            util::error_message("Bad option", opt);
+            std::cerr << s_help;
+            return EXIT_FAILURE;
+        }
+    }
+    if (ls.ls_duration_s <= 0.0)
+    {
+        util::error_message("The duration must be positive");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<load_result> results;
+    for (int n : ls.ls_clients)
+    {
+        results.push_back(run_load(ls, n));
+        std::cout << summary_line(results.back()) << std::endl;
+    }
+
+    bool success = true;
+    if (! outfile.empty())
+    {
+        std::ofstream out(outfile);
+        out << json_report(ls, results);
+        if (! out)
+        {
+            util::error_message("Cannot write", outfile);
+            success = false;
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE ;
+}
+
+/*
+ * nsm_load.cpp
+ *
+ * vim: sw=4 ts=4 wm=4 et ft=cpp
+ */
@@ -24,7 +24,7 @@
  * \library       nsm66
  * \author        Chris Ahlstrom
  * \date          2025-01-29
- * \updates       2025-03-20
+ * \updates       2026-10-15
  * \license       See above.
  *
  * Instructions:
@@ -34,14 +34,48 @@
  *      the following command:  ./build/tests/nsmtest [options].
  */
 
+#include <atomic>                       /* std::atomic<>                    */
+#include <chrono>                       /* std::chrono::steady_clock        */
+#include <cstdio>                       /* std::fopen(), std::remove()      */
 #include <cstdlib>                      /* EXIT_SUCCESS, EXIT_FAILURE       */
+#include <functional>                   /* std::function<>                  */
+#include <future>                       /* std::promise<>, std::future<>    */
 #include <iostream>                     /* std::cout                        */
+#include <memory>                       /* std::unique_ptr<>                */
+#include <mutex>                        /* std::mutex, std::lock_guard      */
 #include <string>                       /* std::string                      */
+#include <thread>                       /* std::thread                      */
+#include <vector>                       /* std::vector<> container          */
+#include <unistd.h>                     /* getpid()                         */
 
 #include "nsm66.hpp"                    /* nsm66_version()                  */
 #include "cfg/appinfo.hpp"              /* cfg::appinfo                     */
 #include "cli/parser.hpp"               /* cli::parser, etc.                */
+#include "nsm/clientregistry.hpp"       /* nsm::clientregistry class        */
+#include "nsm/daemonregistry.hpp"       /* nsm::daemonregistry class        */
+#include "nsm/fanout.hpp"               /* nsm::fanout class                */
 #include "nsm/helpers.hpp"              /* nsm::functions_to_test()         */
+#include "nsm/launcher.hpp"             /* nsm::split_arguments()           */
+#include "nsm/nsmcontroller.hpp"        /* nsm::nsmcontroller class         */
+#include "nsm/notifygate.hpp"           /* nsm::notifygate class            */
+#include "nsm/patchdiff.hpp"            /* nsm::patch_diff class            */
+#include "nsm/patchgraph.hpp"           /* nsm::patch_graph class           */
+#include "nsm/pingstats.hpp"            /* nsm::pingstats class             */
+#include "nsm/sessionfile.hpp"          /* nsm::sessionfile class           */
+#include "nsm/sessionindex.hpp"         /* nsm::sessionindex class          */
+#include "nsm/snapshot.hpp"             /* nsm::snapshot_writer & _reader   */
+#include "osc/endpoint.hpp"             /* osc::endpoint, osc::signal       */
+#include "osc/lowrapper.hpp"            /* osc::unix_socket_path(), etc.    */
+#include "osc/messages.hpp"             /* osc::tag_reverse_lookup()        */
+#include "osc/method.hpp"               /* osc::method_trie class           */
+#include "osc/metrics.hpp"              /* osc::metrics class               */
+#include "osc/msgbuilder.hpp"           /* osc::msgbuilder class            */
+#include "osc/pool.hpp"                 /* osc::pool<> template             */
+#include "osc/shard.hpp"                /* osc::mailbox class               */
+#include "osc/spscqueue.hpp"            /* osc::spscqueue<> template        */
+#include "osc/thread.hpp"               /* osc::thread, thread_attributes   */
+#include "osc/trace.hpp"                /* osc::trace_record(), etc.        */
+#include "osc/typedmethod.hpp"          /* osc::typed_handler<> template    */
 #include "util/filefunctions.hpp"       /* util::get_current_directory()    */
 #include "util/ftswalker.hpp"           /* util::get_current_directory()    */
 #include "util/msgfunctions.hpp"        /* util::error_message() etc.       */
@@ -68,6 +102,32 @@ enum class test
 #endif
     process_patch,                      /* nsm::process_patch()             */
     extract_patch_line,                 /* nsm::extract_patch_line()        */
+    reverse_lookup,                     /* osc::tag_reverse_lookup()        */
+    msgbuilder,                         /* osc::msgbuilder                  */
+    spscqueue,                          /* osc::spscqueue<>                 */
+    split_arguments,                    /* nsm::split_arguments()           */
+    pingstats,                          /* nsm::pingstats                   */
+    client_registry,                    /* nsm::clientregistry              */
+    session_file,                       /* nsm::sessionfile                 */
+    patch_graph,                        /* nsm::patch_graph                 */
+    patch_diff,                         /* nsm::patch_diff                  */
+    snapshot,                           /* nsm::snapshot_writer, _reader    */
+    daemon_registry,                    /* nsm::daemonregistry              */
+    trace_ring,                         /* osc::trace_record(), etc.        */
+    method_trie,                        /* osc::method_trie                 */
+    typed_method,                       /* osc::typed_handler<>             */
+    fanout,                             /* nsm::fanout class                */
+    unix_url,                           /* osc::unix_socket_path(), etc.    */
+    batch_list,                         /* osc::batch_end()                 */
+    session_list,                       /* nsmcontroller batched list       */
+    session_index,                      /* nsm::sessionindex class          */
+    thread_attributes,                  /* osc::thread_attributes           */
+    mailbox,                            /* osc::mailbox                     */
+    sharded_endpoint,                   /* endpoint::start_sharded()        */
+    pool,                               /* osc::pool<>                      */
+    metrics,                            /* osc::metrics counters            */
+    output_gate,                        /* osc::output_gate                 */
+    notify_gate,                        /* nsm::notifygate                  */
     all
 };
 
@@ -523,6 +583,1818 @@ run_test_extract_patch_line ()
     return result;
 }
 
+/**
+ *  Verifies that the hashed reverse lookup of the all-messages table
+ *  yields the same tags as a linear search of a copy of the table,
+ *  both with a pattern and with the "?" (message-only) wildcard.
+ */
+
+bool
+run_test_reverse_lookup ()
+{
+    bool result = true;
+    const osc::lookup copy = osc::all_messages();   /* not indexed, linear  */
+    for (const auto & m : copy)
+    {
+        const std::string & msg = m.second.msg_text;
+        const std::string & pattern = m.second.msg_pattern;
+        osc::tag hashed = osc::tag_reverse_lookup(msg, pattern);
+        osc::tag linear = osc::tag_reverse_lookup(copy, msg, pattern);
+        result = hashed == linear && hashed != osc::tag::illegal;
+        if (result)
+        {
+            hashed = osc::tag_reverse_lookup(msg);
+            linear = osc::tag_reverse_lookup(copy, msg);
+            result = hashed == linear;
+        }
+        if (! result)
+        {
+            util::error_message("Reverse lookup mismatch", msg);
+            break;
+        }
+    }
+    if (result)
+    {
+        result = osc::tag_reverse_lookup("/no/such/path", "s") ==
+            osc::tag::illegal;
+    }
+    return result;
+}
+
+/**
+ *  Builds an "/error" style message and compares it to the OSC wire format
+ *  worked out by hand, both directly and from a msgtemplate. Also checks
+ *  that a type mismatch is caught.
+ */
+
+bool
+run_test_msgbuilder ()
+{
+    static const unsigned char s_expected [] =
+    {
+        '/', 'a', 0, 0,                     /* path, padded to 4    */
+        ',', 's', 'i', 's', 0, 0, 0, 0,     /* type-tag string      */
+        'h', 'i', 0, 0,                     /* "hi"                 */
+        0xff, 0xff, 0xff, 0xfe,             /* -2, big-endian       */
+        'a', 'b', 'c', 'd', 0, 0, 0, 0      /* "abcd" needs 4 nulls */
+    };
+    osc::msgbuilder mb(4);                  /* force buffer growth  */
+    bool result = mb.start("/a", "sis") && mb.add_string("hi") &&
+        mb.add_int32(-2) && mb.add_string("abcd") && mb.complete();
+
+    if (result)
+    {
+        result = mb.size() == sizeof s_expected;
+        for (std::size_t i = 0; result && i < mb.size(); ++i)
+            result = static_cast<unsigned char>(mb.data()[i]) == s_expected[i];
+    }
+    if (result)
+        result = mb.start("/a", "s") && ! mb.add_int32(1) && ! mb.complete();
+
+    if (result)
+        result = ! mb.start("no/slash", "") && ! mb.start("/a", "b");
+
+    if (result)
+    {
+        osc::msgtemplate mt("/a", "sis");
+        result = mt.valid() && mt.header_size() == 12 && mb.start(mt) &&
+            mb.add_string("hi") && mb.add_int32(-2) &&
+            mb.add_string("abcd") && mb.complete();
+
+        if (result)
+            result = mb.size() == sizeof s_expected;
+
+        for (std::size_t i = 0; result && i < mb.size(); ++i)
+            result = static_cast<unsigned char>(mb.data()[i]) == s_expected[i];
+    }
+    if (result)
+    {
+        osc::msgtemplate bad("/a", "b");
+        result = ! bad.valid() && ! mb.start(bad) && ! mb.complete();
+    }
+    return result;
+}
+
+/**
+ *  Checks the capacity rounding and the full/empty cases, then passes a
+ *  run of integers from a producer thread and checks that they all arrive
+ *  in order, which exercises the wraparound of the small queue.
+ */
+
+bool
+run_test_spscqueue ()
+{
+    const int s_count = 100000;
+    osc::spscqueue<int> q(5);
+    bool result = q.capacity() == 8 && q.empty();
+    for (int i = 0; result && i < 8; ++i)
+        result = q.push(i);
+
+    if (result)
+        result = ! q.push(99) && q.size() == 8;
+
+    int v = (-1);
+    for (int i = 0; result && i < 8; ++i)
+        result = q.pop(v) && v == i;
+
+    if (result)
+        result = ! q.pop(v) && v == 7;
+
+    if (result)
+    {
+        std::thread producer
+        (
+            [&q] ()
+            {
+                for (int i = 0; i < s_count; )
+                {
+                    if (q.push(i))
+                        ++i;
+                    else
+                        std::this_thread::yield();
+                }
+            }
+        );
+        int expected = 0;
+        while (expected < s_count)
+        {
+            if (q.pop(v))
+            {
+                if (v != expected)
+                    break;
+
+                ++expected;
+            }
+            else
+                std::this_thread::yield();
+        }
+        producer.join();
+        result = expected == s_count && q.empty();
+    }
+    return result;
+}
+
+/**
+ *  Checks the splitting of simple argument strings, and that strings that
+ *  need the shell are refused.
+ */
+
+bool
+run_test_split_arguments ()
+{
+    lib66::tokenization words;
+    bool result = nsm::split_arguments("", words) && words.empty();
+    if (result)
+    {
+        result = nsm::split_arguments
+        (
+            " -a  'b c' \"d\\\"e\" f\\ g ", words
+        );
+    }
+    if (result)
+    {
+        result = words.size() == 4 && words[0] == "-a" &&
+            words[1] == "b c" && words[2] == "d\"e" && words[3] == "f g";
+    }
+    if (result)
+    {
+        static const char * const s_shell_needed [] =
+        {
+            "a | b", "> log", "$HOME", "\"$x\"", "*.mid", "'open", "# c", "~/x"
+        };
+        for (const char * args : s_shell_needed)
+        {
+            lib66::tokenization more;
+            if (nsm::split_arguments(args, more) || ! more.empty())
+            {
+                result = false;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ *  Feeds some synthetic round trips and a loss to a pingstats object and
+ *  checks the counters, the histogram buckets, and the percentiles.
+ */
+
+bool
+run_test_pingstats ()
+{
+    using us = std::chrono::microseconds;
+    nsm::pingstats ps;
+    nsm::pingstats::clock::time_point t0 = nsm::pingstats::clock::now();
+    bool result = nsm::pingstats::bucket(0) == 0 &&
+        nsm::pingstats::bucket(31) == 0 && nsm::pingstats::bucket(32) == 1 &&
+        nsm::pingstats::bucket(100) == 2 &&
+        nsm::pingstats::bucket(100000000) == nsm::pingstats::c_bucket_count - 1;
+
+    const long s_rtts [] = { 40, 50, 60, 100, 1000 };
+    for (long rtt : s_rtts)
+    {
+        ps.sent(t0);
+        if (ps.replied(t0 + us(rtt)) != rtt)
+            result = false;
+    }
+    ps.sent(t0);
+    if (result)                                 /* a lost, then late, reply */
+    {
+        result = ! ps.expire(t0 + us(10), 1000) &&
+            ps.expire(t0 + us(2000), 1000) && ps.consecutive_lost() == 1 &&
+            ps.replied(t0 + us(3000)) < 0 && ps.consecutive_lost() == 0;
+    }
+    if (result)
+    {
+        result = ps.sent_count() == 6 && ps.received() == 5 &&
+            ps.lost() == 1 && ps.late() == 1 &&
+            ps.min_us() == 40 && ps.max_us() == 1000 &&
+            ps.mean_us() == 250.0 && ps.buckets()[1] == 3;
+    }
+    if (result)
+        result = ps.percentile(50) == 64 && ps.percentile(100) == 1000;
+
+    return result;
+}
+
+/**
+ *  Adds, renames, switches, and removes clients in a clientregistry, and
+ *  checks that the handles and both indices stay in step.
+ */
+
+bool
+run_test_client_registry ()
+{
+    using reg = nsm::clientregistry;
+    nsm::daemon_list daemons;
+    auto client = [&daemons] (const char * id, const char * name)
+    {
+        return nsm::nsmctlclient(nullptr, daemons, id, "", name);
+    };
+    reg r;
+    reg::handle h0 = r.add(client("nAAAA", "alpha"));
+    reg::handle h1 = r.add(client("nBBBB", "beta"));
+    reg::handle h2 = r.add(client("nCCCC", "beta"));
+    bool result = h0 != h1 && h1 != h2 && r.size() == 3 &&
+        r.add(client("nAAAA", "x")) == reg::c_no_handle &&
+        r.find_id("nBBBB") == h1 && r.find_name("beta") == h1;
+
+    if (result)                                 /* h2 moves into h0's slot  */
+    {
+        result = r.remove(h0) && ! r.remove(h0) && r.size() == 2 &&
+            is_nullptr(r.get(h0)) && r.get(h2)->client_id() == "nCCCC" &&
+            r.find_id("nAAAA") == reg::c_no_handle;
+    }
+    if (result)                                 /* name passes to h2        */
+        result = r.remove(h1) && r.find_name("beta") == h2;
+
+    if (result)
+    {
+        reg::handle h3 = r.add(client("nDDDD", "delta"));
+        result = (h3 == h0 || h3 == h1) &&
+            r.client_id(h2, "nEEEE") && ! r.client_id(h2, "nDDDD") &&
+            r.find_id("nCCCC") == reg::c_no_handle &&
+            r.by_id("nEEEE") == r.get(h2) &&
+            r.client_name(h3, "gamma") &&
+            r.find_name("delta") == reg::c_no_handle &&
+            r.by_name("gamma")->client_id() == "nDDDD";
+    }
+    return result;
+}
+
+/**
+ *  Copies the sample session.nsm to a temporary file, parses it in place,
+ *  saves it unchanged (no write), then with one client changed, saves it
+ *  again through write_session_lines(), and then checks that a malformed
+ *  line is reported with its line number.
+ */
+
+bool
+run_test_session_file ()
+{
+    static std::string s_session_file { "tests/data/session.nsm" };
+    nsm::session_triplets trips;
+    std::string errmsg;
+    bool result = nsm::parse_session_lines(s_session_file, trips, errmsg) &&
+        trips.size() == 5 && trips[3].st_client_exe == "qseq66";
+
+    std::string tmpname = "/tmp/nsm66-test-session.nsm";
+    if (result)
+    {
+        nsm::sessionfile sf(tmpname);
+        bool changed = false;
+        (void) std::remove(tmpname.c_str());
+        result = sf.save(trips, changed) && changed &&  /* a new file       */
+            sf.save(trips, changed) && ! changed;       /* not rewritten    */
+
+        if (result)
+        {
+            trips[1].st_client_name = "JACK-Patch";
+            result = sf.save(trips, changed) && changed &&
+                sf.contents().find("JACK-Patch:jackpatch:nLWNW\n") !=
+                    std::string_view::npos;
+        }
+        if (result)
+        {
+            nsm::sessionfile::entry e;
+            int count = 0;
+            sf.rewind();
+            while (sf.next(e))
+                ++count;
+
+            result = count == 5 && sf.error_line() == 0;
+        }
+        if (result)
+        {
+            nsm::session_triplets saved;
+            trips[1].st_client_name = "JACKPatch";
+            result = nsm::write_session_lines(tmpname, trips, errmsg) &&
+                nsm::parse_session_lines(tmpname, saved, errmsg) &&
+                saved.size() == 5 && saved[1].st_client_name == "JACKPatch";
+        }
+    }
+    if (result)
+    {
+        std::FILE * f = std::fopen(tmpname.c_str(), "a");
+        result = not_nullptr(f);
+        if (result)
+        {
+            std::fputs("\nbroken-line\n", f);
+            std::fclose(f);
+            result = ! nsm::parse_session_lines(tmpname, trips, errmsg) &&
+                trips.size() == 5 && errmsg.find(":7:") != std::string::npos;
+
+            if (util::verbose())
+                std::cout << errmsg << std::endl;
+        }
+    }
+    (void) std::remove(tmpname.c_str());
+    return result;
+}
+
+/**
+ *  Loads the sample .jackpatch file into a patch_graph, and checks the
+ *  interning of the names, including the a2j names with the extra colon,
+ *  and the rebuilding of a patch line.
+ */
+
+bool
+run_test_patch_graph ()
+{
+    static std::string s_patch_file { "tests/data/test.jackpatch" };
+    nsm::patch_graph g;
+    bool result = g.load(s_patch_file) && g.edge_count() == 11 &&
+        g.port_count() == 22 && g.name_count() < 2 * g.port_count();
+
+    if (result)
+    {
+        nsm::patch_graph::id p = g.find_port("fluidsynth-midi", "midi_00");
+        nsm::patch_graph::id a = g.find_port
+        (
+            "a2j:Q25 (capture)", " Q25 MIDI 1"
+        );
+        result = p != nsm::patch_graph::c_no_id &&
+            a != nsm::patch_graph::c_no_id &&
+            g.edges().back().e_right == p &&
+            g.edges().back().e_direction == nsm::patch_direction::right &&
+            g.edge_line(g.edges().back()) ==
+                "seq66.nPSLM:fluidsynth-midi:midi_00 |> "
+                "fluidsynth-midi:midi_00";
+    }
+    if (result)
+    {
+        result = ! g.add_line("no separator here") && g.bad_lines() == 1 &&
+            g.add_line("a:b<|c:d") && g.edge_count() == 12 &&
+            g.edges().back().e_direction == nsm::patch_direction::left &&
+            g.name(g.port_at(g.edges().back().e_left).pt_name) == "b";
+    }
+    if (util::verbose())
+    {
+        std::cout
+            << g.name_count() << " names, " << g.port_count() << " ports, "
+            << g.edge_count() << " connections" << std::endl
+            ;
+    }
+    return result;
+}
+
+/**
+ *  Diffs a small saved patch set against a live snapshot, then feeds
+ *  port and connection events and checks that each produces only the new
+ *  work.
+ */
+
+bool
+run_test_patch_diff ()
+{
+    nsm::patch_graph saved;
+    nsm::patch_graph live;
+    nsm::patch_diff diff;
+    nsm::patch_diff::connections tomake, tobreak;
+    bool result = saved.add_line("a:out |> b:in") &&
+        saved.add_line("a:out2 |> c:in") && saved.add_line("x:y || z:w") &&
+        live.add_line("a:out |> c:in");
+
+    if (result)
+    {
+        (void) live.add_port("b", "in");        /* exists, not connected    */
+        diff.set_desired(saved);
+        diff.set_live(live);
+        diff.take(tomake, tobreak);
+        result = tomake.size() == 1 && tobreak.size() == 1 &&
+            diff.port_fullname(tomake[0].c_source) == "a:out" &&
+            diff.port_fullname(tomake[0].c_destination) == "b:in" &&
+            diff.port_fullname(tobreak[0].c_destination) == "c:in" &&
+            diff.pending() == 0;
+    }
+    if (result)
+    {
+        diff.connected("a:out", "b:in");
+        diff.disconnected("a:out", "c:in");
+        diff.port_registered("a:out2");
+        diff.take(tomake, tobreak);
+        result = tomake.size() == 1 && tobreak.empty() &&
+            diff.port_fullname(tomake[0].c_source) == "a:out2";
+    }
+    if (result)
+    {
+        diff.port_registered("x:y");
+        result = diff.pending() == 0;           /* z:w not there yet        */
+        diff.port_registered("z:w");
+        diff.take(tomake, tobreak);
+        result = result && tomake.size() == 2 && tobreak.empty();
+    }
+    if (result)
+    {
+        diff.port_unregistered("b:in");         /* drops a live connection  */
+        diff.port_registered("b:in");
+        diff.take(tomake, tobreak);
+        result = tomake.size() == 1 &&
+            diff.port_fullname(tomake[0].c_destination) == "b:in";
+    }
+    if (result)
+    {
+        nsm::patch_graph duplex;                /* live and desired         */
+        nsm::patch_diff same;
+        result = duplex.add_line("x:y || z:w");
+        if (result)
+        {
+            same.set_desired(duplex);
+            same.set_live(duplex);
+            same.take(tomake, tobreak);
+            result = tomake.empty() && tobreak.empty() &&
+                same.pending() == 0;
+        }
+    }
+    return result;
+}
+
+/**
+ *  Writes the sample session entries as a binary snapshot, reads them
+ *  back, and checks that a flipped byte and the wrong kind are caught.
+ */
+
+bool
+run_test_snapshot ()
+{
+    static std::string s_session_file { "tests/data/session.nsm" };
+    std::string tmpname = "/tmp/nsm66-test-session.snapshot";
+    nsm::session_triplets trips, loaded;
+    std::string errmsg;
+    bool result = nsm::parse_session_lines(s_session_file, trips, errmsg) &&
+        nsm::write_session_snapshot(tmpname, trips, errmsg) &&
+        nsm::is_snapshot_file(tmpname) &&
+        ! nsm::is_snapshot_file(s_session_file) &&
+        nsm::read_session_snapshot(tmpname, loaded, errmsg) &&
+        loaded.size() == trips.size();
+
+    for (std::size_t i = 0; result && i < trips.size(); ++i)
+    {
+        result = loaded[i].st_client_name == trips[i].st_client_name &&
+            loaded[i].st_client_exe == trips[i].st_client_exe &&
+            loaded[i].st_client_id == trips[i].st_client_id;
+    }
+    if (result)
+    {
+        nsm::snapshot_writer w(nsm::snapshot_kind::proxy);
+        w.add(1, "qsynth");
+        w.add(4, std::int32_t(-10));
+        std::string data = w.data();
+        nsm::snapshot_reader r;
+        std::uint16_t tag;
+        std::string_view value;
+        result = r.parse(data, nsm::snapshot_kind::proxy) &&
+            r.next(tag, value) && tag == 1 && value == "qsynth" &&
+            r.next(tag, value) && tag == 4 &&
+            nsm::snapshot_reader::to_int(value) == -10 &&
+            ! r.next(tag, value) && r.error_message().empty() &&
+            ! r.parse(data, nsm::snapshot_kind::session);
+
+        if (result)
+        {
+            data[data.size() - 1] ^= 0x01;
+            result = ! r.parse(data, nsm::snapshot_kind::proxy);
+            if (util::verbose())
+                std::cout << r.error_message() << std::endl;
+        }
+    }
+    (void) std::remove(tmpname.c_str());
+    return result;
+}
+
+/**
+ *  Registers this process in a scratch daemon directory, adds a stale
+ *  file and a junk file, and checks the listing, the liveness checks, and
+ *  the pruning.
+ */
+
+bool
+run_test_daemon_registry ()
+{
+    std::string dir = "/tmp/nsm66-test-d";
+    (void) util::make_directory_path(dir, 0771);
+
+    std::string stale = dir + "/2147483600";        /* no such process      */
+    std::string junk = dir + "/README";
+    std::string errmsg;
+    bool result =
+        nsm::write_file_atomically(stale, "osc.udp://gone:1/\n", errmsg) &&
+        nsm::write_file_atomically(junk, "not a daemon\n", errmsg);
+
+    nsm::daemonregistry reg(dir);
+    if (result)
+        result = reg.register_self("osc.udp://localhost:12345/");
+
+    if (result)
+    {
+        const auto & daemons = reg.daemons();
+        result = daemons.size() == 1 && daemons[0].di_locked &&
+            daemons[0].di_pid == pid_t(getpid()) &&
+            reg.newest_url() == "osc.udp://localhost:12345/";
+    }
+    if (result)
+    {
+        nsm::daemon_info info;
+        result = nsm::daemonregistry::read_entry(stale, info) &&
+            ! nsm::daemonregistry::alive(info) &&
+            reg.prune() == 1 && reg.daemons().size() == 1 &&
+            util::file_exists(junk);
+    }
+    if (result)
+    {
+        reg.unregister_self();
+        result = reg.daemons().empty();
+    }
+    (void) std::remove(junk.c_str());
+    (void) std::remove(stale.c_str());
+    (void) util::delete_directory(dir);
+    return result;
+}
+
+/**
+ *  Records events in this thread and in a second one, then checks the
+ *  snapshot and a dump file read back. If tracing is not built in, the
+ *  snapshot must be empty.
+ */
+
+bool
+run_test_trace_ring ()
+{
+    std::string tmpname = "/tmp/nsm66-test.trace";
+    osc::trace_reset();
+    osc::trace_enable(true);
+    osc::trace_record
+    (
+        osc::trace_dir::in, "/nsm/server/announce", "sssiii", nullptr, 96
+    );
+    osc::trace_finish();
+    osc::trace_record(osc::trace_dir::out, osc::tag::srvreply, 7, 40);
+    std::thread other
+    (
+        [] ()
+        {
+            for (std::size_t i = 0; i < osc::c_trace_ring_size + 10; ++i)
+            {
+                osc::trace_record
+                (
+                    osc::trace_dir::out, osc::tag::oscping, 1, 16
+                );
+            }
+        }
+    );
+    other.join();
+    osc::trace_enable(false);
+    osc::trace_record(osc::trace_dir::out, osc::tag::oscping, 1, 16);
+    osc::trace_enable(true);
+
+    std::vector<osc::trace_event> events = osc::trace_snapshot();
+    if (! osc::trace_compiled())
+        return events.empty();
+
+    std::size_t expected = 2 + osc::c_trace_ring_size - 1;
+    bool result = events.size() == expected &&
+        events[0].te_tag == std::uint16_t(osc::tag::srvannounce) &&
+        events[0].te_bytes == 96 &&
+        events[0].te_thread != events.back().te_thread;
+
+    if (result)
+    {
+        std::vector<osc::trace_event> loaded;
+        std::string errmsg;
+        result = osc::trace_dump(tmpname) &&
+            osc::trace_read(tmpname, loaded, errmsg) &&
+            loaded.size() >= expected;
+
+        if (util::verbose())
+            std::cout << osc::trace_format(events[0]) << std::endl;
+    }
+    (void) std::remove(tmpname.c_str());
+    osc::trace_reset();
+    return result;
+}
+
+/**
+ *  Fills a method trie, then checks the exact lookups, the prefix walks
+ *  (used for directory queries), and the removals, which must merge the
+ *  nodes that are left.
+ */
+
+bool
+run_test_method_trie ()
+{
+    osc::method_trie trie;
+    trie.insert(new osc::method("/a/b/one", "f"));
+    trie.insert(new osc::method("/a/b/two", "f"));
+    trie.insert(new osc::method("/a/b/one", "i"));
+    trie.insert(new osc::method("/a/bee", ""));
+    trie.insert(new osc::method("/c", "s"));
+    trie.insert(new osc::method("", ""));           /* catch-all method     */
+
+    std::string visited;
+    auto collect = [&visited] (const osc::method & m)
+    {
+        visited += m.path() + "+" + m.typespec() + ";";
+    };
+    trie.for_each_prefix("/a/b/", collect);
+
+    bool result = trie.size() == 6 &&
+        visited == "/a/b/one+f;/a/b/one+i;/a/b/two+f;" &&
+        trie.find("/a/b/one", "i") != nullptr &&
+        trie.find("/a/b/one", "s") == nullptr &&
+        trie.find("/a/b", "") == nullptr &&
+        trie.find("/a/bee", "") != nullptr;
+
+    if (result)
+    {
+        visited.clear();
+        trie.for_each_prefix("/a/b", collect);
+        result = visited == "/a/b/one+f;/a/b/one+i;/a/b/two+f;/a/bee+;";
+    }
+    if (result)
+    {
+        visited.clear();
+        trie.for_each_prefix("/x/", collect);
+        result = visited.empty() &&
+            trie.remove("/a/b/one", "f") && ! trie.remove("/a/b/one", "f") &&
+            trie.remove(trie.find("/a/b/two", "f")) &&
+            trie.find("/a/b/one", "i") != nullptr && trie.size() == 4;
+    }
+    if (result)
+    {
+        visited.clear();
+        trie.for_each(collect);
+        result = visited == "+;/a/b/one+i;/a/bee+;/c+s;";
+        if (util::verbose())
+            std::cout << visited << std::endl;
+    }
+    trie.clear();
+    return result && trie.empty();
+}
+
+/**
+ *  A fake handler object for the typed-method test. The arguments are
+ *  built by hand, the way liblo lays them out: a string argument is a
+ *  pointer to its characters, an integer is a pointer to its value.
+ */
+
+struct typed_sample
+{
+    std::string ts_label;
+    int ts_count = 0;
+    std::string ts_path;
+
+    bool on_pair (std::string_view label, std::int32_t count)
+    {
+        ts_label = std::string(label);
+        ts_count = int(count);
+        return count >= 0;
+    }
+
+    void on_path (const osc::message_info & info)
+    {
+        ts_path = info.mi_path;
+    }
+};
+
+bool
+run_test_typed_method ()
+{
+    using pair_handler = osc::typed_handler<&typed_sample::on_pair>;
+    using path_handler = osc::typed_handler<&typed_sample::on_path>;
+    static_assert(pair_handler::args::c_count == 2, "two arguments");
+    static_assert(path_handler::args::c_has_info, "message_info first");
+
+    typed_sample sample;
+    char text[8] = "Label";
+    lo_arg count;
+    count.i = 42;
+
+    lo_arg * argv[2] = { reinterpret_cast<lo_arg *>(text), &count };
+    bool result =
+        std::string(pair_handler::typespec()) == "si" &&
+        std::string(path_handler::typespec()).empty() &&
+        pair_handler::call("/x", "si", argv, 2, nullptr, &sample) == 0 &&
+        sample.ts_label == "Label" && sample.ts_count == 42;
+
+    if (result)
+    {
+        count.i = -1;                   /* handled, but returns false   */
+        result =
+            pair_handler::call("/x", "si", argv, 2, nullptr, &sample) == -1 &&
+            pair_handler::call("/x", "ss", argv, 2, nullptr, &sample) == -1 &&
+            pair_handler::call("/x", "s", argv, 1, nullptr, &sample) == -1 &&
+            path_handler::call("/y/z", "", nullptr, 0, nullptr, &sample) == 0 &&
+            sample.ts_path == "/y/z";
+    }
+    if (! result)
+        util::error_message("typed-method test failed");
+
+    return result;
+}
+
+/**
+ *  Runs a fan-out of a save to three clients: one answers, one fails,
+ *  and one never answers and is expired at the deadline.
+ */
+
+bool
+run_test_fanout ()
+{
+    using clock = nsm::fanout::clock;
+    nsm::fanout f;
+    clock::time_point t0 = clock::now();
+    f.start(osc::tag::guisave, t0, 100);
+    f.add("nAAAA", "fast");
+    f.add("nBBBB", "broken");
+    f.add("nCCCC", "slow");
+
+    bool result = f.active() && f.total_progress() == 0.0f;
+    if (result)
+    {
+        auto t1 = t0 + std::chrono::milliseconds(5);
+        result =
+            ! f.status("nAAAA", "save", t1) &&          /* not an answer    */
+            f.status("nAAAA", "ready", t1) &&
+            ! f.status("nAAAA", "ready", t1) &&         /* only once        */
+            f.status("nBBBB", "error", t1) &&
+            ! f.status("nXXXX", "ready", t1) &&         /* not in fan-out   */
+            f.progress("nCCCC", 0.5f) &&
+            ! f.visible("nCCCC", t1) &&                 /* show/hide only   */
+            f.latency_us(f.entries()[0]) == 5000 &&
+            f.total_progress() > 0.83f && f.total_progress() < 0.84f;
+    }
+    if (result)
+    {
+        result =
+            f.expire(t0 + std::chrono::milliseconds(50)) == 0 && f.active() &&
+            f.expire(t0 + std::chrono::milliseconds(100)) == 1 &&
+            ! f.active() && f.total_progress() == 1.0f &&
+            f.count(nsm::fanout::state::done) == 1 &&
+            f.count(nsm::fanout::state::failed) == 1 &&
+            f.count(nsm::fanout::state::expired) == 1 &&
+            f.slowest() == &f.entries()[2] &&
+            f.elapsed_us() == 100000;
+    }
+    if (result)
+    {
+        f.start(osc::tag::guishow, t0, 100);
+        f.add("nAAAA", "fast");
+        result = ! f.status("nAAAA", "ready", t0) &&
+            f.client_switch("nAAAA", "nDDDD") &&
+            f.visible("nDDDD", t0) && ! f.active();
+    }
+    if (! result)
+        util::error_message("fanout test failed");
+
+    return result;
+}
+
+/**
+ *  Checks the handling of "osc.unix://" URLs next to the UDP ones.
+ */
+
+bool
+run_test_unix_url ()
+{
+    const std::string udp { "osc.udp://mlsleno:17439/" };
+    const std::string unx { "osc.unix:///run/user/1000/nsm66-42-1.osc" };
+    bool result =
+        osc::is_osc_url(udp) && osc::is_osc_url(unx) &&
+        ! osc::is_osc_url("17439") &&
+        osc::url_protocol(udp) == LO_UDP &&
+        osc::url_protocol("osc.tcp://host:1/") == LO_TCP &&
+        osc::url_protocol(unx) == LO_UNIX &&
+        osc::extract_port_number(udp) == "17439" &&
+        osc::extract_port_number(unx) == "/run/user/1000/nsm66-42-1.osc" &&
+        osc::unix_socket_path("osc.unix:////tmp/lo_x") == "/tmp/lo_x" &&
+        osc::unix_socket_path("osc.unix://host/tmp/lo_x") == "/tmp/lo_x" &&
+        osc::unix_socket_path("osc.unix://") == "" &&
+        osc::unix_socket_path(udp) == "" &&
+        osc::unix_url("/tmp/lo_x") == "osc.unix:///tmp/lo_x" &&
+        osc::unix_url(osc::unix_socket_path(unx)) == unx;
+
+    if (! result)
+        util::error_message("unix-url test failed");
+
+    return result;
+}
+
+/**
+ *  Checks the splitting of a long list into batches that fit a message
+ *  size, using msgbuilder to measure the real size of a batch.
+ */
+
+bool
+run_test_batch_list ()
+{
+    const std::string path { "/nsm66/reply/list" };
+    lib66::tokenization names;
+    for (int i = 0; i < 100; ++i)
+        names.push_back(i < 10 ? "session-0" + std::to_string(i) :
+            "session-" + std::to_string(i));
+
+    std::size_t end = osc::batch_end(names, 0, path.length(), 128);
+    bool result = end == 7;
+    if (result)
+    {
+        osc::msgbuilder mb;
+        std::string types { "ii" };
+        types += std::string(end, 's');
+        result = mb.start(path.c_str(), types.c_str()) &&
+            mb.add_int32(0) && mb.add_int32(0);
+
+        for (std::size_t i = 0; result && i < end; ++i)
+            result = mb.add_string(names[i]);
+
+        result = result && mb.complete() && mb.size() <= 128 &&
+            mb.size() + 12 > 128;       /* one more name would not fit  */
+    }
+    if (result)
+    {
+        std::size_t batches = 0;
+        std::size_t next = 0;
+        do
+        {
+            next = osc::batch_end(names, next, path.length(), 512);
+            ++batches;
+        } while (next < names.size());
+
+        lib66::tokenization big { std::string(1000, 'x'), "y" };
+        result = next == names.size() && batches == 3 &&
+            osc::batch_end(big, 0, path.length(), 512) == 1 &&
+            osc::batch_end(big, 1, path.length(), 512) == 2 &&
+            osc::batch_end(lib66::tokenization(), 0, path.length(), 512) == 0;
+    }
+    if (! result)
+        util::error_message("batch-list test failed");
+
+    return result;
+}
+
+/**
+ *  A stand-in for an nsm66 daemon. It greets a controller's announce as
+ *  nsmd does, and answers "/nsm66/server/list" with its names, using
+ *  lowrapper::send_batched() with small batches so that the list takes
+ *  several messages. If "skip" is set, it sends only a last batch with
+ *  index 1, as if batch 0 were lost.
+ */
+
+class list_daemon : public osc::lowrapper
+{
+
+private:
+
+    lib66::tokenization m_names;
+    std::size_t m_batch_bytes;
+    bool m_skip;
+
+public:
+
+    list_daemon (const lib66::tokenization & names, std::size_t batchbytes) :
+        osc::lowrapper  (),
+        m_names         (names),
+        m_batch_bytes   (batchbytes),
+        m_skip          (false)
+    {
+        // no code
+    }
+
+    void skip (bool flag)
+    {
+        m_skip = flag;
+    }
+
+    std::string port () const
+    {
+        return std::to_string(lo_server_get_port(server()));
+    }
+
+    void pump (int timeoutms)
+    {
+        if (lo_server_wait(server(), timeoutms))
+            (void) receive_ready(server());
+    }
+
+protected:
+
+    virtual void add_methods (void * /*userdata*/) override
+    {
+        (void) lo_server_add_method
+        (
+            server(), osc::tag_message(osc::tag::announce).c_str(), "",
+            &list_daemon::osc_announce, this
+        );
+        (void) lo_server_add_method
+        (
+            server(), osc::tag_message(osc::tag::srvlistbatch).c_str(), "",
+            &list_daemon::osc_list, this
+        );
+    }
+
+private:
+
+    static int osc_announce
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+        int /*argc*/, lo_message msg, void * userdata
+    )
+    {
+        list_daemon * d = static_cast<list_daemon *>(userdata);
+        (void) d->send
+        (
+            lo_message_get_source(msg),
+            osc::tag_message(osc::tag::gui_announce), "hi"
+        );
+        return 0;
+    }
+
+    static int osc_list
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+        int /*argc*/, lo_message msg, void * userdata
+    )
+    {
+        list_daemon * d = static_cast<list_daemon *>(userdata);
+        lo_address source = lo_message_get_source(msg);
+        const std::string & path = osc::tag_message(osc::tag::replylist);
+        if (d->m_skip)
+        {
+            lo_message m = lo_message_new();
+            (void) lo_message_add_int32(m, 1);
+            (void) lo_message_add_int32(m, 1);
+            (void) lo_message_add_string(m, "late");
+            (void) lo_send_message_from(source, d->server(), path.c_str(), m);
+            lo_message_free(m);
+        }
+        else
+            (void) d->send_batched(source, path, d->m_names, d->m_batch_bytes);
+
+        return 0;
+    }
+
+};          // class list_daemon
+
+/**
+ *  Pumps the daemon until the controller's session list is done, or two
+ *  seconds pass.
+ */
+
+bool
+wait_session_list (list_daemon & nsmd, const nsm::nsmcontroller & ctrler)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::seconds(2);
+
+    while (! ctrler.session_list_done())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+
+        nsmd.pump(1);
+    }
+    return true;
+}
+
+/**
+ *  Drives a real nsmcontroller against a daemon over 127.0.0.1. The
+ *  announce is answered, which makes the controller ask for the list at
+ *  the numeric source of the answer. Then the list is refreshed through
+ *  the daemon list, where the daemon is known by a host name, "localhost",
+ *  as a daemon usually is; its replies come from a numeric host, and the
+ *  list must still end. Last, a lost batch must be counted as a gap.
+ */
+
+bool
+run_test_session_list ()
+{
+    lib66::tokenization names;
+    for (int i = 0; i < 40; ++i)
+        names.push_back("session-" + std::to_string(i));
+
+    list_daemon nsmd(names, 128);
+    bool result = nsmd.init(LO_UDP);
+    if (result)
+    {
+        std::string url = "osc.udp://localhost:" + nsmd.port() + "/";
+        lo_address a = lo_address_new_from_url(url.c_str());
+        nsm::daemon_list daemons;
+        daemons.push_back(nsm::daemon(url, a));
+        {
+            nsm::nsmcontroller ctrler(daemons);
+            lib66::tokenization got;
+            ctrler.batched_list(true);
+            result = ctrler.init_osc();
+            if (result)
+            {
+                ctrler.announce();          /* the answer starts a list */
+                result = wait_session_list(nsmd, ctrler) &&
+                    ctrler.osc_active() &&
+                    ctrler.get_sessions(0, got) == names.size();
+            }
+            if (result)
+            {
+                got.clear();
+                result = ctrler.send_server_message(osc::tag::srvlist) &&
+                    wait_session_list(nsmd, ctrler) &&
+                    ctrler.get_sessions(0, got) == names.size() &&
+                    got == names && ctrler.session_list_gaps() == 0;
+            }
+            if (result)
+            {
+                got.clear();
+                nsmd.skip(true);
+                result = ctrler.send_server_message(osc::tag::srvlist) &&
+                    wait_session_list(nsmd, ctrler) &&
+                    ctrler.get_sessions(0, got) == 1 && got[0] == "late" &&
+                    ctrler.session_list_gaps() == 1;
+            }
+            if (util::verbose())
+            {
+                std::cout
+                    << ctrler.session_count() << " sessions, "
+                    << ctrler.session_list_gaps() << " gaps" << std::endl
+                    ;
+            }
+            (void) ctrler.deactivate();
+        }
+        lo_address_free(a);
+    }
+    if (! result)
+        util::error_message("session-list test failed");
+
+    return result;
+}
+
+/**
+ *  Builds a small session root, indexes it, then changes it and checks
+ *  that refresh() follows without walking the root again.
+ */
+
+bool
+run_test_session_index ()
+{
+    std::string root = "/tmp/nsm66-test-root";
+    std::string errmsg;
+    (void) util::fts_delete_directory(root);
+    bool result =
+        util::make_directory_path(root + "/Song/seq66.nAAAA", 0771) &&
+        util::make_directory_path(root + "/Live/Set 1", 0771) &&
+        nsm::write_file_atomically
+        (
+            root + "/Song/session.nsm",
+            "seq66:qseq66:nAAAA\njack:jackpatch:nBBBB\n", errmsg
+        ) &&
+        nsm::write_file_atomically
+        (
+            root + "/Live/Set 1/session.nsm", "seq66:qseq66:nCCCC\n", errmsg
+        );
+
+    nsm::sessionindex index(root);
+    if (result)
+    {
+        const nsm::session_info * song = nullptr;
+        result = index.scan() && index.size() == 2;
+        if (result)
+            song = index.find("Song");
+
+        result = not_nullptr(song) && song->si_client_count == 2 &&
+            index.list("Live").size() == 1 &&
+            index.list("Live")[0] == "Live/Set 1" &&
+            index.search("Set").size() == 1 &&
+            index.find("Song/seq66.nAAAA") == nullptr;
+    }
+    if (result && index.watching())
+    {
+        result =
+            util::make_directory_path(root + "/New", 0771) &&
+            nsm::write_file_atomically
+            (
+                root + "/New/session.nsm", "a:b:nDDDD\n", errmsg
+            ) &&
+            std::remove((root + "/Song/session.nsm").c_str()) == 0 &&
+            std::rename
+            (
+                (root + "/Live").c_str(), (root + "/Gigs").c_str()
+            ) == 0;
+
+        if (result)
+        {
+            (void) index.refresh();
+            result = index.size() == 2 && index.scan_count() == 1 &&
+                not_nullptr(index.find("New")) &&
+                not_nullptr(index.find("Gigs/Set 1")) &&
+                index.find("Song") == nullptr &&
+                index.list("Live").empty();
+        }
+    }
+    (void) util::fts_delete_directory(root);
+    if (! result)
+        util::error_message("session-index test failed");
+
+    return result;
+}
+
+/**
+ *  Starts an osc::thread with attributes and checks that the thread_local
+ *  current() and is() see it. The realtime policy usually falls back to
+ *  the default here, for lack of privileges, which is also tested.
+ */
+
+bool
+run_test_thread_attributes ()
+{
+    osc::thread_attributes attr;
+    attr.ta_policy = SCHED_FIFO;
+    attr.ta_priority = 10;
+    attr.ta_cpus = { 0 };
+    attr.ta_stack_size = 256 * 1024;
+    attr.ta_lock_stack = true;
+
+    static osc::thread s_worker("worker");
+    static bool s_is_current = false;
+    auto entry = [] (void *) -> void *
+    {
+        s_is_current = osc::thread::current() == &s_worker &&
+            osc::thread::is("worker") && ! osc::thread::is("OSC");
+        return nullptr;
+    };
+    bool result = osc::thread_attributes().is_default() &&
+        ! attr.is_default() && attr.realtime() &&
+        ! osc::thread::is("worker") && s_worker.clone(entry, nullptr, attr);
+
+    if (result)
+    {
+        s_worker.join();
+        result = s_is_current && ! s_worker.running();
+    }
+    if (! result)
+        util::error_message("thread-attributes test failed");
+
+    return result;
+}
+
+/**
+ *  Checks the mailbox used between the endpoint and its shards: commands
+ *  posted from another thread are run in order by drain(), and a command
+ *  posted by a command waits for the next drain().
+ */
+
+bool
+run_test_mailbox ()
+{
+    osc::mailbox mb;
+    std::vector<int> ran;
+    bool result = ! mb.pending() && mb.drain() == 0;
+    if (result)
+    {
+        std::thread poster
+        (
+            [&mb, &ran] ()
+            {
+                for (int i = 0; i < 100; ++i)
+                    mb.post([&ran, i] () { ran.push_back(i); });
+            }
+        );
+        poster.join();
+        result = mb.pending() && mb.drain() == 100 && ! mb.pending();
+        for (int i = 0; result && i < 100; ++i)
+            result = ran[i] == i;
+    }
+    if (result)
+    {
+        mb.post([&mb, &ran] () { mb.post([&ran] () { ran.push_back(-1); }); });
+        result = mb.drain() == 1 && mb.pending() && mb.drain() == 1 &&
+            ran.size() == 101 && ran.back() == -1;
+    }
+    if (! result)
+        util::error_message("mailbox test failed");
+
+    return result;
+}
+
+/**
+ *  A sender for the sharded-endpoint test. Each has its own socket, and so
+ *  its own source port, which the kernel hashes to pick a receive thread.
+ *  It keeps the first value of the feedback it gets on the given path.
+ */
+
+class shard_peer : public osc::lowrapper
+{
+
+private:
+
+    std::string m_feedback_path;
+    int m_feedback_count;
+    float m_feedback_value;
+
+public:
+
+    shard_peer (const std::string & feedbackpath) :
+        osc::lowrapper      (),
+        m_feedback_path     (feedbackpath),
+        m_feedback_count    (0),
+        m_feedback_value    (0.0f)
+    {
+        // no code
+    }
+
+    int feedback_count () const
+    {
+        return m_feedback_count;
+    }
+
+    float feedback_value () const
+    {
+        return m_feedback_value;
+    }
+
+    std::string numeric_url () const
+    {
+        return "osc.udp://127.0.0.1:" +
+            std::to_string(lo_server_get_port(server())) + "/";
+    }
+
+    void pump (int timeoutms)
+    {
+        if (lo_server_wait(server(), timeoutms))
+            (void) receive_ready(server());
+    }
+
+protected:
+
+    virtual void add_methods (void * /*userdata*/) override
+    {
+        (void) lo_server_add_method
+        (
+            server(), m_feedback_path.c_str(), "f",
+            &shard_peer::osc_feedback, this
+        );
+        (void) lo_server_add_method
+        (
+            server(), NULL, NULL, &shard_peer::osc_ignore, this
+        );
+    }
+
+private:
+
+    static int osc_feedback
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** argv,
+        int /*argc*/, lo_message /*msg*/, void * userdata
+    )
+    {
+        shard_peer * p = static_cast<shard_peer *>(userdata);
+        if (p->m_feedback_count++ == 0)
+            p->m_feedback_value = argv[0]->f;
+
+        return 0;
+    }
+
+    static int osc_ignore
+    (
+        const char * /*path*/, const char * /*types*/, lo_arg ** /*argv*/,
+        int /*argc*/, lo_message /*msg*/, void * /*userdata*/
+    )
+    {
+        return 0;                       /* "/signal/list", etc.     */
+    }
+
+};          // class shard_peer
+
+/**
+ *  What the handlers of the sharded endpoint see. The signal handlers run
+ *  in any receive thread; the method handler runs in the endpoint thread.
+ */
+
+struct shard_counts
+{
+    std::atomic<int> sc_in;
+    std::atomic<int> sc_busy;
+    std::atomic<int> sc_who;
+    std::mutex sc_mutex;
+    std::vector<std::string> sc_sources;
+};
+
+/**
+ *  Runs a function in the endpoint thread, and waits for it, as the
+ *  signal and translation tables belong to that thread.
+ */
+
+void
+call_in_endpoint (osc::endpoint & ep, const std::function<void ()> & f)
+{
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    ep.post
+    (
+        [&f, &done] ()
+        {
+            f();
+            done.set_value();
+        }
+    );
+    finished.wait();
+}
+
+/**
+ *  Waits up to two seconds for a count to reach a value.
+ */
+
+bool
+wait_count (const std::atomic<int> & count, int value)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::seconds(2);
+
+    while (count.load() < value)
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ *  Starts a three-way sharded endpoint on 127.0.0.1 and sends to it from
+ *  several source ports. It checks that signal values reach the handler
+ *  and value(); that a non-signal method gets the real sender from
+ *  message_source(), even when a shard hands the message over; that a
+ *  translation is forwarded and its feedback to the sender suppressed, as
+ *  in an endpoint without shards; and that deleting a signal while it
+ *  gets traffic stops its handler at once.
+ */
+
+bool
+run_test_sharded_endpoint ()
+{
+    const int s_senders = 6;
+    const int s_values = 50;
+    const std::string fader { "/surface/fader" };
+    shard_counts counts;
+    counts.sc_in = counts.sc_busy = counts.sc_who = 0;
+    counts.sc_sources.assign(s_senders, "");
+
+    osc::signal_handler counter = [] (float, void * userdata) -> int
+    {
+        ++*static_cast<std::atomic<int> *>(userdata);
+        return 0;
+    };
+    lo_method_handler who = []
+    (
+        const char *, const char *, lo_arg ** argv, int,
+        lo_message msg, void * userdata
+    ) -> int
+    {
+        shard_counts * c = static_cast<shard_counts *>(userdata);
+        int index = argv[0]->i;
+        std::string url = osc::numeric_address_url(osc::message_source(msg));
+        {
+            std::lock_guard<std::mutex> lock(c->sc_mutex);
+            if (index >= 0 && index < int(c->sc_sources.size()))
+                c->sc_sources[index] = url;
+        }
+        ++c->sc_who;
+        return 0;
+    };
+
+    osc::endpoint ep;
+    std::vector<std::unique_ptr<shard_peer>> peers;
+    bool result = ep.init(LO_UDP);
+    for (int i = 0; result && i < s_senders; ++i)
+    {
+        peers.emplace_back(new shard_peer(fader));
+        result = peers.back()->init(LO_UDP);
+    }
+    if (! result)
+    {
+        util::error_message("sharded-endpoint test could not open sockets");
+        return false;
+    }
+
+    osc::signal * in = ep.add_signal
+    (
+        "/in", osc::signal::input, 0.0f, 1.0f, 0.0f, counter, &counts.sc_in
+    );
+    osc::signal * busy = ep.add_signal
+    (
+        "/busy", osc::signal::input, 0.0f, 1.0f, 0.0f,
+        counter, &counts.sc_busy
+    );
+    (void) ep.add_method("/who", "i", who, &counts);
+    ep.add_translation(fader, in->path());
+    ep.handle_hello("surface", peers[0]->numeric_url());
+    ep.active(true);
+    result = ep.start_sharded(3) && ep.receivers() == 3;
+
+    std::string epurl =
+        "osc.udp://127.0.0.1:" + std::to_string(ep.port()) + "/";
+
+    lo_address to = lo_address_new_from_url(epurl.c_str());
+    if (result)
+    {
+        for (auto & p : peers)
+        {
+            for (int j = 0; j < s_values; ++j)
+                (void) p->send(to, in->path(), float(j) / 100.0f);
+        }
+        result = wait_count(counts.sc_in, s_senders * s_values);
+        if (result)
+        {
+            (void) peers[1]->send(to, in->path(), 0.25f);
+            result = wait_count(counts.sc_in, s_senders * s_values + 1) &&
+                in->value() == 0.25f;
+        }
+    }
+    if (result)
+    {
+        for (int i = 0; i < s_senders; ++i)
+            (void) peers[i]->send(to, "/who", i);
+
+        result = wait_count(counts.sc_who, s_senders);
+        std::lock_guard<std::mutex> lock(counts.sc_mutex);
+        for (int i = 0; result && i < s_senders; ++i)
+            result = counts.sc_sources[i] == peers[i]->numeric_url();
+    }
+    if (result)
+    {
+        int before = counts.sc_in;
+        (void) peers[0]->send(to, fader, 0.5f);
+        result = wait_count(counts.sc_in, before + 1) && in->value() == 0.5f;
+        if (result)
+        {
+            std::string path = in->path();
+            call_in_endpoint
+            (
+                ep, [&ep, &path] ()
+                {
+                    ep.send_feedback(path, 0.5f);   /* the sender's value   */
+                    ep.send_feedback(path, 0.75f);  /* a change of our own  */
+                }
+            );
+
+            auto deadline = std::chrono::steady_clock::now() +
+                std::chrono::seconds(2);
+
+            while
+            (
+                peers[0]->feedback_count() == 0 &&
+                std::chrono::steady_clock::now() < deadline
+            )
+            {
+                peers[0]->pump(10);
+            }
+            result = peers[0]->feedback_count() == 1 &&
+                peers[0]->feedback_value() == 0.75f;
+        }
+    }
+    if (result)
+    {
+        std::atomic<bool> sending { true };
+        std::vector<std::thread> senders;
+        for (int i = 1; i < s_senders; ++i)
+        {
+            shard_peer * p = peers[i].get();
+            std::string path = busy->path();
+            senders.emplace_back
+            (
+                [p, &epurl, path, &sending] ()
+                {
+                    lo_address dest = lo_address_new_from_url(epurl.c_str());
+                    while (sending)
+                    {
+                        (void) p->send(dest, path, 0.5f);
+                        std::this_thread::sleep_for
+                        (
+                            std::chrono::microseconds(100)
+                        );
+                    }
+                    lo_address_free(dest);
+                }
+            );
+        }
+        result = wait_count(counts.sc_busy, 100);
+
+        int atdelete = 0;
+        call_in_endpoint
+        (
+            ep, [&busy, &counts, &atdelete] ()
+            {
+                delete busy;                    /* calls del_signal()   */
+                busy = nullptr;
+                atdelete = counts.sc_busy;
+            }
+        );
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sending = false;
+        for (auto & t : senders)
+            t.join();
+
+        result = result && counts.sc_busy == atdelete;
+        if (util::verbose())
+        {
+            std::cout
+                << counts.sc_busy << " busy values, " << atdelete
+                << " before the delete" << std::endl
+                ;
+        }
+    }
+    ep.active(false);
+    ep.stop();
+    lo_address_free(to);
+    delete busy;
+    delete in;
+    if (! result)
+        util::error_message("sharded-endpoint test failed");
+
+    return result;
+}
+
+/**
+ *  Checks the pool allocator: stable addresses across chunk growth, slot
+ *  reuse, stale handles, and destruction of what is left.
+ */
+
+bool
+run_test_pool ()
+{
+    static int s_live = 0;
+    struct item
+    {
+        int i_value;
+
+        item (int v) : i_value (v)
+        {
+            ++s_live;
+        }
+
+        ~item ()
+        {
+            --s_live;
+        }
+    };
+
+    bool result = true;
+    {
+        osc::pool<item, 4> p;
+        std::vector<item *> items;
+        for (int i = 0; i < 10; ++i)
+            items.push_back(p.create(i));
+
+        result = p.size() == 10 && p.capacity() == 12 && s_live == 10;
+        for (int i = 0; result && i < 10; ++i)
+            result = items[i]->i_value == i;        /* nothing has moved    */
+
+        osc::pool_handle h = p.handle(items[5]);
+        result = result && p.get(h) == items[5];
+        if (result)
+        {
+            p.destroy(items[5]);
+            item * reused = p.create(55);           /* takes the free slot  */
+            result = reused == items[5] && is_nullptr(p.get(h)) &&
+                p.get(p.handle(reused)) == reused && p.size() == 10 &&
+                ! osc::pool_handle().valid();
+        }
+        if (result)
+        {
+            int sum = 0;
+            p.for_each([&sum] (item & it) { sum += it.i_value; });
+            result = sum == 45 - 5 + 55;
+        }
+    }
+    result = result && s_live == 0;                 /* the pool cleaned up  */
+    if (! result)
+        util::error_message("pool test failed");
+
+    return result;
+}
+
+/**
+ *  Tests the metrics counters and histograms, and the binding used by
+ *  osc_msg_summary().
+ */
+
+bool
+run_test_metrics ()
+{
+    osc::metrics m;
+    bool result = is_nullptr(osc::metrics::current());
+    if (result)
+    {
+        osc::metrics::scope bind(&m);
+        result = osc::metrics::current() == &m;
+    }
+    result = result && is_nullptr(osc::metrics::current());
+    if (result)
+    {
+        m.received("/nsm/client/save", 24);
+        m.received(osc::tag::clisave, 24);
+        m.sent("/unknown/path", 16);
+        result = m.received_messages(osc::tag::clisave) == 2 &&
+            m.received_bytes(osc::tag::clisave) == 48 &&
+            m.sent_messages(osc::tag::illegal) == 1 &&
+            m.sent_bytes(osc::tag::illegal) == 16;
+    }
+    if (result)
+    {
+        m.queue_depth(osc::metric_queue::values, 5);
+        m.queue_depth(osc::metric_queue::values, 2);
+        m.send_failed();
+        m.unhandled();
+        m.unhandled();
+        result = m.queue_max(osc::metric_queue::values) == 5 &&
+            m.send_failures() == 1 && m.unhandled_count() == 2;
+    }
+    if (result)
+    {
+        result = osc::histogram::bucket_of(0) == 0 &&
+            osc::histogram::bucket_of(1) == 0 &&
+            osc::histogram::bucket_of(2) == 1 &&
+            osc::histogram::bucket_of(3) == 2 &&
+            osc::histogram::bucket_of(1000) == 10 &&
+            osc::histogram::bucket_of(~std::uint64_t(0)) ==
+                osc::histogram::c_buckets - 1;
+    }
+    if (result)
+    {
+        for (int i = 0; i < 99; ++i)
+            m.handler_time(3);
+
+        m.handler_time(900);
+        const osc::histogram & h = m.handler_latency();
+        result = h.count() == 100 && h.sum() == 99 * 3 + 900 &&
+            h.max() == 900 && h.percentile(0.5) == 4 &&
+            h.percentile(1.0) == 900;
+    }
+    if (result)
+    {
+        bool sawsave = false;
+        bool sawqueue = false;
+        for (const auto & r : m.snapshot())
+        {
+            if (r.mr_kind == "in" && r.mr_name == "/nsm/client/save")
+                sawsave = r.mr_a == 2 && r.mr_b == 48;
+            else if (r.mr_kind == "queue" && r.mr_name == "values")
+                sawqueue = r.mr_a == 2 && r.mr_b == 5;
+        }
+        m.reset();
+        result = sawsave && sawqueue && m.send_failures() == 0 &&
+            m.handler_latency().count() == 0;
+    }
+    if (! result)
+        util::error_message("metrics test failed");
+
+    return result;
+}
+
+/**
+ *  Tests the deadband and rate limit of osc::output_gate, without an
+ *  endpoint.
+ */
+
+bool
+run_test_output_gate ()
+{
+    using verdict = osc::output_gate::verdict;
+    using clock = osc::output_gate::clock;
+    osc::parameter_limits pl { 0.0f, 2.0f, 0.0f, 0.05f, true, 10 };
+    osc::output_gate g;
+    clock::time_point t0 = clock::now();
+    bool result = osc::has_output_policy(pl) &&
+        g.offer(pl, 1.0f, t0) == verdict::send;             /* first value  */
+
+    if (result)
+    {
+        g.sent(1.0f, t0);
+        result = g.offer(pl, 1.05f, t0) == verdict::drop && /* 0.05 * 2.0   */
+            g.offer(pl, 1.2f, t0) == verdict::hold && g.holding() &&
+            g.offer(pl, 1.3f, t0) == verdict::hold &&
+            g.held_value() == 1.3f;
+    }
+    if (result)
+    {
+        clock::time_point due = g.due(pl);
+        result = due == t0 + std::chrono::milliseconds(100) &&
+            g.offer(pl, 1.01f, t0) == verdict::drop && ! g.holding();
+
+        result = result && g.offer(pl, 1.4f, due) == verdict::send;
+    }
+    if (result)
+    {
+        osc::parameter_limits none { 0.0f, 1.0f, 0.0f, 0.0f, false, 0 };
+        osc::output_gate h;
+        h.sent(0.5f, t0);
+        result = ! osc::has_output_policy(none) &&
+            h.offer(none, 0.5001f, t0) == verdict::send;
+    }
+    if (! result)
+        util::error_message("output gate test failed");
+
+    return result;
+}
+
+/**
+ *  Tests the coalescing of the dirty and progress notifications by
+ *  nsm::notifygate, without a session manager.
+ */
+
+bool
+run_test_notify_gate ()
+{
+    using clock = nsm::notifygate::clock;
+    nsm::notifygate g;
+    clock::time_point t0 = clock::now();
+    bool isdirty = false;
+    bool result = g.offer_dirty(true, t0) &&            /* first is sent    */
+        ! g.offer_dirty(true, t0) &&                    /* nsmd has it      */
+        g.offer_dirty(false, t0) && g.timeout(t0) == (-1);
+
+    if (result)
+    {
+        g.dirty_debounce(50);
+        result = ! g.offer_dirty(true, t0) && g.timeout(t0) == 50 &&
+            ! g.due_dirty(t0, isdirty) &&
+            ! g.offer_dirty(false, t0 + std::chrono::milliseconds(10)) &&
+            g.timeout(t0) == (-1);                      /* flipped back     */
+    }
+    if (result)
+    {
+        clock::time_point due = t0 + std::chrono::milliseconds(50);
+        result = ! g.offer_dirty(true, t0) &&
+            ! g.offer_dirty(true, t0 + std::chrono::milliseconds(20)) &&
+            g.due_dirty(due, isdirty) && isdirty &&     /* first offer's    */
+            ! g.due_dirty(due, isdirty);                /* due time         */
+    }
+    if (result)
+    {
+        g.mark_clean();
+        result = ! g.dirty() && ! g.offer_dirty(false, t0) &&
+            ! g.offer_dirty(true, t0) && g.timeout(t0) == 50;
+    }
+    if (result)
+    {
+        float percent = 0.0f;
+        nsm::notifygate p;
+        p.progress_interval(100);
+        clock::time_point t1 = t0 + std::chrono::milliseconds(100);
+        result = p.offer_progress(10.0f, t1) &&         /* first is sent    */
+            ! p.offer_progress(20.0f, t1) &&
+            ! p.offer_progress(30.0f, t1) &&
+            ! p.due_progress(t1, percent) &&
+            p.due_progress(t1 + std::chrono::milliseconds(100), percent) &&
+            percent == 30.0f &&                         /* latest held      */
+            ! p.offer_progress(40.0f, t1 + std::chrono::milliseconds(150)) &&
+            p.offer_progress(100.0f, t1 + std::chrono::milliseconds(150)) &&
+            p.timeout(t1) == (-1);                      /* 100% discards    */
+    }
+    if (! result)
+        util::error_message("notify gate test failed");
+
+    return result;
+}
+
 /**
  *  Checks to see if a test can be run.
  */
@@ -562,20 +2434,150 @@ all_tests ()
         { "session-root",   test::session_root,     run_test_session_root   },
 #if defined USE_PROCESS_PATCH_SSCANF
         {
-            "process-patch-sscanf",
-            test::process_patch_sscanf,
-            run_test_process_patch_sscanf
+            "process-patch-sscanf",
+            test::process_patch_sscanf,
+            run_test_process_patch_sscanf
+        },
+#endif
+        {
+            "process-patch",
+            test::process_patch,
+            run_test_process_patch
+        },
+        {
+            "extract-patch-line",
+            test::extract_patch_line,
+            run_test_extract_patch_line
+        },
+        {
+            "reverse-lookup",
+            test::reverse_lookup,
+            run_test_reverse_lookup
+        },
+        {
+            "msgbuilder",
+            test::msgbuilder,
+            run_test_msgbuilder
+        },
+        {
+            "spscqueue",
+            test::spscqueue,
+            run_test_spscqueue
+        },
+        {
+            "split-arguments",
+            test::split_arguments,
+            run_test_split_arguments
+        },
+        {
+            "pingstats",
+            test::pingstats,
+            run_test_pingstats
+        },
+        {
+            "client-registry",
+            test::client_registry,
+            run_test_client_registry
+        },
+        {
+            "session-file",
+            test::session_file,
+            run_test_session_file
+        },
+        {
+            "patch-graph",
+            test::patch_graph,
+            run_test_patch_graph
+        },
+        {
+            "patch-diff",
+            test::patch_diff,
+            run_test_patch_diff
+        },
+        {
+            "snapshot",
+            test::snapshot,
+            run_test_snapshot
+        },
+        {
+            "daemon-registry",
+            test::daemon_registry,
+            run_test_daemon_registry
+        },
+        {
+            "trace-ring",
+            test::trace_ring,
+            run_test_trace_ring
+        },
+        {
+            "method-trie",
+            test::method_trie,
+            run_test_method_trie
+        },
+        {
+            "typed-method",
+            test::typed_method,
+            run_test_typed_method
+        },
+        {
+            "fanout",
+            test::fanout,
+            run_test_fanout
+        },
+        {
+            "unix-url",
+            test::unix_url,
+            run_test_unix_url
+        },
+        {
+            "batch-list",
+            test::batch_list,
+            run_test_batch_list
+        },
+        {
+            "session-list",
+            test::session_list,
+            run_test_session_list
         },
-#endif
         {
-            "process-patch",
-            test::process_patch,
-            run_test_process_patch
+            "session-index",
+            test::session_index,
+            run_test_session_index
         },
         {
-            "extract-patch-line",
-            test::extract_patch_line,
-            run_test_extract_patch_line
+            "thread-attributes",
+            test::thread_attributes,
+            run_test_thread_attributes
+        },
+        {
+            "mailbox",
+            test::mailbox,
+            run_test_mailbox
+        },
+        {
+            "sharded-endpoint",
+            test::sharded_endpoint,
+            run_test_sharded_endpoint
+        },
+        {
+            "pool",
+            test::pool,
+            run_test_pool
+        },
+        {
+            "metrics",
+            test::metrics,
+            run_test_metrics
+        },
+        {
+            "output-gate",
+            test::output_gate,
+            run_test_output_gate
+        },
+        {
+            "notify-gate",
+            test::notify_gate,
+            run_test_notify_gate
         },
     };
     return s_tests;
@@ -696,6 +2698,266 @@ cfg::options::container s_test_options
                 "If specified, the test of extract_patch_line is run by itself.",
                 false
             }
+        },
+        {
+            "reverse-lookup",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of tag_reverse_lookup() runs alone.",
+                false
+            }
+        },
+        {
+            "msgbuilder",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of osc::msgbuilder runs alone.",
+                false
+            }
+        },
+        {
+            "spscqueue",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of osc::spscqueue runs alone.",
+                false
+            }
+        },
+        {
+            "split-arguments",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of split_arguments() runs alone.",
+                false
+            }
+        },
+        {
+            "pingstats",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::pingstats runs alone.",
+                false
+            }
+        },
+        {
+            "client-registry",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::clientregistry runs alone.",
+                false
+            }
+        },
+        {
+            "session-file",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::sessionfile runs alone.",
+                false
+            }
+        },
+        {
+            "patch-graph",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::patch_graph runs alone.",
+                false
+            }
+        },
+        {
+            "patch-diff",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::patch_diff runs alone.",
+                false
+            }
+        },
+        {
+            "snapshot",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of the binary snapshots runs alone.",
+                false
+            }
+        },
+        {
+            "daemon-registry",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "If specified, the test of nsm::daemonregistry runs alone.",
+                false
+            }
+        },
+        {
+            "trace-ring",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the binary OSC message trace rings.",
+                false
+            }
+        },
+        {
+            "method-trie",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the radix trie of endpoint methods.",
+                false
+            }
+        },
+        {
+            "typed-method",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test typed OSC handler decoding.",
+                false
+            }
+        },
+        {
+            "fanout",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the tracking of commands sent to many clients.",
+                false
+            }
+        },
+        {
+            "unix-url",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the parsing of osc.unix:// URLs.",
+                false
+            }
+        },
+        {
+            "batch-list",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the batching of long lists into messages.",
+                false
+            }
+        },
+        {
+            "session-list",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test a controller's batched session list over loopback.",
+                false
+            }
+        },
+        {
+            "session-index",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the inotify session-root index.",
+                false
+            }
+        },
+        {
+            "thread-attributes",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test thread scheduling attributes and current().",
+                false
+            }
+        },
+        {
+            "mailbox",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the cross-thread mailbox of the OSC shards.",
+                false
+            }
+        },
+        {
+            "sharded-endpoint",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test a sharded endpoint over loopback.",
+                false
+            }
+        },
+        {
+            "pool",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the pool allocator used for peers and signals.",
+                false
+            }
+        },
+        {
+            "metrics",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the metrics counters and histograms.",
+                false
+            }
+        },
+        {
+            "output-gate",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the deadband and rate limit of signal output.",
+                false
+            }
+        },
+        {
+            "notify-gate",
+            {
+                cfg::options::code_null,
+                cfg::options::kind::boolean, cfg::options::enabled,
+                "false", "", false, false,
+                "Test the coalescing of dirty and progress notifications.",
+                false
+            }
         }
     }
 };
@@ -803,6 +3065,84 @@ main (int argc, char * argv [])
             if (opts.boolean_value("extract-patch-line"))
                 test_desired = test::mkpath;
 
+            if (opts.boolean_value("reverse-lookup"))
+                test_desired = test::reverse_lookup;
+
+            if (opts.boolean_value("msgbuilder"))
+                test_desired = test::msgbuilder;
+
+            if (opts.boolean_value("spscqueue"))
+                test_desired = test::spscqueue;
+
+            if (opts.boolean_value("split-arguments"))
+                test_desired = test::split_arguments;
+
+            if (opts.boolean_value("pingstats"))
+                test_desired = test::pingstats;
+
+            if (opts.boolean_value("client-registry"))
+                test_desired = test::client_registry;
+
+            if (opts.boolean_value("session-file"))
+                test_desired = test::session_file;
+
+            if (opts.boolean_value("patch-graph"))
+                test_desired = test::patch_graph;
+
+            if (opts.boolean_value("patch-diff"))
+                test_desired = test::patch_diff;
+
+            if (opts.boolean_value("snapshot"))
+                test_desired = test::snapshot;
+
+            if (opts.boolean_value("daemon-registry"))
+                test_desired = test::daemon_registry;
+
+            if (opts.boolean_value("trace-ring"))
+                test_desired = test::trace_ring;
+
+            if (opts.boolean_value("method-trie"))
+                test_desired = test::method_trie;
+
+            if (opts.boolean_value("typed-method"))
+                test_desired = test::typed_method;
+
+            if (opts.boolean_value("fanout"))
+                test_desired = test::fanout;
+
+            if (opts.boolean_value("unix-url"))
+                test_desired = test::unix_url;
+
+            if (opts.boolean_value("batch-list"))
+                test_desired = test::batch_list;
+
+            if (opts.boolean_value("session-list"))
+                test_desired = test::session_list;
+
+            if (opts.boolean_value("session-index"))
+                test_desired = test::session_index;
+
+            if (opts.boolean_value("thread-attributes"))
+                test_desired = test::thread_attributes;
+
+            if (opts.boolean_value("mailbox"))
+                test_desired = test::mailbox;
+
+            if (opts.boolean_value("sharded-endpoint"))
+                test_desired = test::sharded_endpoint;
+
+            if (opts.boolean_value("pool"))
+                test_desired = test::pool;
+
+            if (opts.boolean_value("metrics"))
+                test_desired = test::metrics;
+
+            if (opts.boolean_value("output-gate"))
+                test_desired = test::output_gate;
+
+            if (opts.boolean_value("notify-gate"))
+                test_desired = test::notify_gate;
+
             std::cout << cwd << std::endl;
             success = run_all_tests(test_desired);
         }